@@ -0,0 +1,77 @@
+/**
+ * NitroPascal Runtime - Benchmark Support
+ *
+ * Shared timing helpers for the standalone benchmarks in this folder. Each
+ * benchmark is a single translation unit linked against the runtime unity
+ * build, e.g. from this directory:
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_loops.cpp ../runtime/runtime.cpp
+ *
+ * Every benchmark prints one line per case: name, best-of-N time and rate.
+ */
+
+#pragma once
+
+#include "runtime.h"
+#include <chrono>
+#include <cstdio>
+
+namespace np {
+namespace bench {
+
+// ============================================================================
+// TIMING
+// ============================================================================
+
+/**
+ * DoNotOptimize - Keep a value alive so the optimizer cannot drop the work
+ */
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Seconds - Best wall-clock time in seconds over ARepeat runs of AFunc
+ */
+template<typename Func>
+double Seconds(Func&& AFunc, int ARepeat = 5) {
+    double best = 1e300;
+    for (int r = 0; r < ARepeat; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        AFunc();
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+/**
+ * Report - Print one result line; AUnits is the amount of work per run
+ * (iterations, bytes, lines...) and AUnitName its label.
+ */
+inline void Report(const char* AName, double ASeconds, double AUnits,
+                   const char* AUnitName) {
+    std::printf("%-40s %10.3f ms  %12.2f M%s/s\n", AName, ASeconds * 1e3,
+                AUnits / ASeconds / 1e6, AUnitName);
+}
+
+/**
+ * ReportBytes - Print one result line as throughput; ABytes is the input
+ * size per run
+ */
+inline void ReportBytes(const char* AName, double ASeconds, double ABytes) {
+    std::printf("%-40s %10.3f ms  %12.2f GB/s\n", AName, ASeconds * 1e3,
+                ABytes / ASeconds / 1e9);
+}
+
+/**
+ * ReportRatio - Print the speedup of ANew over ABaseline
+ */
+inline void ReportRatio(const char* AName, double ABaseline, double ANew) {
+    std::printf("%-40s %10.2fx\n", AName, ABaseline / ANew);
+}
+
+} // namespace bench
+} // namespace np
@@ -0,0 +1,67 @@
+/**
+ * NitroPascal Benchmark - Console Output
+ *
+ * Lines per second written by WriteLn, comparing the runtime console buffer
+ * with the former std::cout path that flushed on every line via std::endl
+ * and converted each String through a temporary std::string. Output goes to
+ * a temporary file so the numbers measure the write path, not a terminal:
+ *
+ *   for i := 1 to N do
+ *     WriteLn(S, i);
+ */
+
+#include "bench.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup  _dup
+#define dup2 _dup2
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+using namespace np::bench;
+
+static constexpr np::Integer N = 200000;
+
+// WriteLn as emitted before the console buffer
+template<typename... Args>
+static void LegacyWriteLn(Args&&... args) {
+    (std::cout << ... << args);
+    std::cout << std::endl;
+}
+
+static const np::String S("the quick brown fox jumps over line ");
+
+int main() {
+    // Route stdout to a scratch file for the timed part, keep the terminal
+    // for the report
+    std::fflush(stdout);
+    std::FILE* sink = std::tmpfile();
+    if (!sink) {
+        std::printf("cannot create temporary file\n");
+        return 1;
+    }
+    int saved = dup(fileno(stdout));
+    dup2(fileno(sink), fileno(stdout));
+
+    double legacy = Seconds([] {
+        for (np::Integer i = 1; i <= N; ++i)
+            LegacyWriteLn(S, i);
+    });
+    double buffered = Seconds([] {
+        for (np::Integer i = 1; i <= N; ++i)
+            np::WriteLn(S, i);
+        np::Flush();
+    });
+
+    std::fflush(stdout);
+    dup2(saved, fileno(stdout));
+
+    Report("WriteLn (std::cout + std::endl)", legacy, N, "line");
+    Report("WriteLn (np console buffer)", buffered, N, "line");
+    ReportRatio("console buffer vs std::endl", legacy, buffered);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * NitroPascal Benchmark - Dictionary
+ *
+ * np::Dictionary (TDictionary<K, V>) against std::unordered_map, the
+ * container a hand-written C++ port would reach for. Both see the same keys
+ * in the same shuffled order; lookups use a different shuffle so that they
+ * do not walk memory in insertion order.
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_dictionary.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <unordered_map>
+
+using namespace np::bench;
+
+static constexpr np::Integer N = 1 << 18;
+
+static std::vector<np::Integer> IntKeys;    // N distinct keys, shuffled
+static std::vector<np::Integer> IntProbe;   // the same keys, another shuffle
+static std::vector<np::Integer> IntMiss;    // N keys that are never added
+static std::vector<np::String>  StrKeys;    // 'customer-<n>', shuffled
+static std::vector<np::String>  StrProbe;   // equal copies in another order
+
+// The same operations on both containers
+template<typename K>
+static void Put(np::Dictionary<K, np::Integer>& AMap, const K& AKey, np::Integer AValue) {
+    AMap.Add(AKey, AValue);
+}
+
+template<typename K>
+static void Put(std::unordered_map<K, np::Integer>& AMap, const K& AKey, np::Integer AValue) {
+    AMap.emplace(AKey, AValue);
+}
+
+template<typename K>
+static bool Get(const np::Dictionary<K, np::Integer>& AMap, const K& AKey, np::Integer& AValue) {
+    return AMap.TryGetValue(AKey, AValue);
+}
+
+template<typename K>
+static bool Get(const std::unordered_map<K, np::Integer>& AMap, const K& AKey, np::Integer& AValue) {
+    auto it = AMap.find(AKey);
+    if (it == AMap.end()) {
+        return false;
+    }
+    AValue = it->second;
+    return true;
+}
+
+template<typename K>
+static void Del(np::Dictionary<K, np::Integer>& AMap, const K& AKey) {
+    AMap.Remove(AKey);
+}
+
+template<typename K>
+static void Del(std::unordered_map<K, np::Integer>& AMap, const K& AKey) {
+    AMap.erase(AKey);
+}
+
+// ----------------------------------------------------------------------------
+// var D: TDictionary<K, Integer>;
+// for i := 0 to N - 1 do D.Add(Keys[i], i);
+// for i := 0 to N - 1 do if D.TryGetValue(Probe[i], v) then Inc(Sum, v);
+// for i := 0 to N - 1 do begin D.Remove(Keys[i]); D.Add(Keys[i], i); end;
+// ----------------------------------------------------------------------------
+
+template<typename Map, typename K>
+static Map Build(const std::vector<K>& AKeys) {
+    Map d;
+    for (np::Integer i = 0; i < N; ++i) {
+        Put(d, AKeys[i], i);
+    }
+    return d;
+}
+
+template<typename Map, typename K>
+static np::Int64 Lookup(const Map& AMap, const std::vector<K>& AProbe) {
+    np::Int64 sum = 0;
+    np::Integer v;
+    for (const K& key : AProbe) {
+        if (Get(AMap, key, v)) {
+            sum += v;
+        }
+    }
+    return sum;
+}
+
+template<typename Map, typename K>
+static np::Int64 Churn(Map& AMap, const std::vector<K>& AKeys) {
+    for (np::Integer i = 0; i < N; ++i) {
+        Del(AMap, AKeys[i]);
+        Put(AMap, AKeys[i], i);
+    }
+    return Lookup(AMap, AKeys);
+}
+
+template<typename Func>
+static double Run(const char* AName, Func&& AFunc) {
+    double s = Seconds([&]() { DoNotOptimize(AFunc()); });
+    Report(AName, s, N, "op");
+    return s;
+}
+
+using IntDict = np::Dictionary<np::Integer, np::Integer>;
+using IntMap  = std::unordered_map<np::Integer, np::Integer>;
+using StrDict = np::Dictionary<np::String, np::Integer>;
+using StrMap  = std::unordered_map<np::String, np::Integer>;
+
+template<typename Dict, typename Map, typename K>
+static bool Agree(const std::vector<K>& AKeys, const std::vector<K>& AProbe) {
+    return Lookup(Build<Dict>(AKeys), AProbe) == Lookup(Build<Map>(AKeys), AProbe);
+}
+
+int main() {
+    std::mt19937 rng(42);
+    for (np::Integer i = 0; i < N; ++i) {
+        // Spread keys the way record ids and hashes tend to be
+        IntKeys.push_back(i * 2654435761u >> 1);
+        IntMiss.push_back((i * 2654435761u >> 1) | 1u << 31);
+        StrKeys.push_back(np::String(u"customer-") + np::IntToStr(i));
+    }
+    std::shuffle(IntKeys.begin(), IntKeys.end(), rng);
+    std::shuffle(StrKeys.begin(), StrKeys.end(), rng);
+    IntProbe = IntKeys;
+    std::shuffle(IntProbe.begin(), IntProbe.end(), rng);
+    for (const np::String& key : StrKeys) {
+        // Fresh blocks: no hash cached yet, as for keys read from input
+        StrProbe.push_back(np::Copy(key, 1, np::Length(key)));
+    }
+    std::shuffle(StrProbe.begin(), StrProbe.end(), rng);
+    if (!Agree<IntDict, IntMap>(IntKeys, IntProbe) ||
+        !Agree<StrDict, StrMap>(StrKeys, StrProbe)) {
+        std::printf("np::Dictionary and std::unordered_map disagree\n");
+        return 1;
+    }
+
+    IntDict id = Build<IntDict>(IntKeys);
+    IntMap  im = Build<IntMap>(IntKeys);
+    StrDict sd = Build<StrDict>(StrKeys);
+    StrMap  sm = Build<StrMap>(StrKeys);
+    double a, b;
+
+    a = Run("Add Integer (unordered_map)", [] { return Build<IntMap>(IntKeys).size(); });
+    b = Run("Add Integer (Dictionary)", [] { return Build<IntDict>(IntKeys).Count(); });
+    ReportRatio("Add Integer speedup", a, b);
+    a = Run("lookup hit Integer (unordered_map)", [&] { return Lookup(im, IntProbe); });
+    b = Run("lookup hit Integer (Dictionary)", [&] { return Lookup(id, IntProbe); });
+    ReportRatio("lookup hit Integer speedup", a, b);
+    a = Run("lookup miss Integer (unordered_map)", [&] { return Lookup(im, IntMiss); });
+    b = Run("lookup miss Integer (Dictionary)", [&] { return Lookup(id, IntMiss); });
+    ReportRatio("lookup miss Integer speedup", a, b);
+    a = Run("Remove+Add Integer (unordered_map)", [&] { return Churn(im, IntProbe); });
+    b = Run("Remove+Add Integer (Dictionary)", [&] { return Churn(id, IntProbe); });
+    ReportRatio("Remove+Add Integer speedup", a, b);
+
+    a = Run("Add String (unordered_map)", [] { return Build<StrMap>(StrKeys).size(); });
+    b = Run("Add String (Dictionary)", [] { return Build<StrDict>(StrKeys).Count(); });
+    ReportRatio("Add String speedup", a, b);
+    a = Run("lookup hit String (unordered_map)", [&] { return Lookup(sm, StrProbe); });
+    b = Run("lookup hit String (Dictionary)", [&] { return Lookup(sd, StrProbe); });
+    ReportRatio("lookup hit String speedup", a, b);
+    return 0;
+}
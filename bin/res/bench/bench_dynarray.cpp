@@ -0,0 +1,159 @@
+/**
+ * NitroPascal Benchmark - Dynamic Array Element Access
+ *
+ * Element read and write throughput of np::DynArray<Double> against raw
+ * std::vector<double>, with the former shared_ptr<vector> + copy-on-write
+ * DynArray reproduced below as LegacyArray for reference. Kernels are
+ * written as the code generator emits them for the Pascal shown above them,
+ * in both range-check modes: {$R-} emits A[i], {$R+} emits np::At(A, i).
+ */
+
+#include "bench.h"
+#include <memory>
+#include <vector>
+
+using namespace np::bench;
+
+static constexpr np::Integer N = 1 << 16;
+static constexpr int PASSES = 200;
+
+// Element access path of the previous DynArray implementation
+template<typename T>
+class LegacyArray {
+private:
+    std::shared_ptr<std::vector<T>> data_ = std::make_shared<std::vector<T>>();
+
+    void EnsureUnique() {
+        if (data_ && data_.use_count() > 1) {
+            data_ = std::make_shared<std::vector<T>>(*data_);
+        }
+    }
+
+public:
+    void Resize(np::Integer n) { data_->resize(n); }
+
+    const T& operator[](np::Integer index) const {
+        if (!data_ || index < 0 || index >= static_cast<np::Integer>(data_->size())) {
+            throw np::_Exception{np::EXC_ACCESS_VIOLATION, L"Array index out of range"};
+        }
+        return (*data_)[index];
+    }
+
+    T& operator[](np::Integer index) {
+        EnsureUnique();
+        if (!data_ || index < 0 || index >= static_cast<np::Integer>(data_->size())) {
+            throw np::_Exception{np::EXC_ACCESS_VIOLATION, L"Array index out of range"};
+        }
+        return (*data_)[index];
+    }
+};
+
+static std::vector<double>       VecA;
+static std::vector<double>       VecB;
+static LegacyArray<np::Double>   OldA;
+static LegacyArray<np::Double>   OldB;
+static np::DynArray<np::Double>  A;
+static np::DynArray<np::Double>  B;
+
+// ----------------------------------------------------------------------------
+// function Sum(): Double;
+// var i: Integer;
+// begin
+//   for i := 0 to N - 1 do
+//     Result := Result + A[i];
+// end;
+// ----------------------------------------------------------------------------
+
+template<typename Arr>
+static np::Double Sum(Arr& AArr) {
+    np::Double Result{};
+    np::Integer i;
+    for (np::Int64 _np_i1 = (0), _np_end1 = (N - 1); _np_i1 <= _np_end1; ++_np_i1) {
+        i = static_cast<decltype(i)>(_np_i1);
+        Result = Result + AArr[i];
+    }
+    return Result;
+}
+
+template<typename Arr>
+static np::Double SumChecked(Arr& AArr) {
+    np::Double Result{};
+    np::Integer i;
+    for (np::Int64 _np_i1 = (0), _np_end1 = (N - 1); _np_i1 <= _np_end1; ++_np_i1) {
+        i = static_cast<decltype(i)>(_np_i1);
+        Result = Result + np::At(AArr, i);
+    }
+    return Result;
+}
+
+// ----------------------------------------------------------------------------
+// procedure Axpy(K: Double);
+// var i: Integer;
+// begin
+//   for i := 0 to N - 1 do
+//     B[i] := B[i] + K * A[i];
+// end;
+// ----------------------------------------------------------------------------
+
+template<typename Arr>
+static np::Double Axpy(Arr& AArrA, Arr& AArrB, np::Double K) {
+    np::Integer i;
+    for (np::Int64 _np_i2 = (0), _np_end2 = (N - 1); _np_i2 <= _np_end2; ++_np_i2) {
+        i = static_cast<decltype(i)>(_np_i2);
+        AArrB[i] = AArrB[i] + K * AArrA[i];
+    }
+    return AArrB[N - 1];
+}
+
+template<typename Arr>
+static np::Double AxpyChecked(Arr& AArrA, Arr& AArrB, np::Double K) {
+    np::Integer i;
+    for (np::Int64 _np_i2 = (0), _np_end2 = (N - 1); _np_i2 <= _np_end2; ++_np_i2) {
+        i = static_cast<decltype(i)>(_np_i2);
+        np::At(AArrB, i) = np::At(AArrB, i) + K * np::At(AArrA, i);
+    }
+    return AArrB[N - 1];
+}
+
+template<typename Func>
+static double Run(const char* AName, Func&& AFunc) {
+    double s = Seconds([&]() {
+        for (int p = 0; p < PASSES; ++p)
+            DoNotOptimize(AFunc());
+    });
+    Report(AName, s, double(N) * PASSES, "elem");
+    return s;
+}
+
+int main() {
+    VecA.resize(N);
+    VecB.resize(N);
+    OldA.Resize(N);
+    OldB.Resize(N);
+    np::SetLength(A, N);
+    np::SetLength(B, N);
+    for (np::Integer k = 0; k < N; ++k) {
+        VecA[k] = OldA[k] = A[k] = k * 0.5;
+        VecB[k] = OldB[k] = B[k] = 1.0;
+    }
+    if (Sum(VecA) != Sum(A) || Sum(OldA) != Sum(A)) {
+        std::printf("array implementations disagree\n");
+        return 1;
+    }
+
+    double v, o, c, d;
+    v = Run("read  (std::vector)", [] { return Sum(VecA); });
+    o = Run("read  (legacy shared_ptr + COW)", [] { return Sum(OldA); });
+    c = Run("read  (np::DynArray, {$R+})", [] { return SumChecked(A); });
+    d = Run("read  (np::DynArray, {$R-})", [] { return Sum(A); });
+    ReportRatio("read  DynArray {$R+} vs legacy", o, c);
+    ReportRatio("read  DynArray {$R-} vs std::vector", v, d);
+
+    v = Run("write (std::vector)", [] { return Axpy(VecA, VecB, 1e-9); });
+    o = Run("write (legacy shared_ptr + COW)", [] { return Axpy(OldA, OldB, 1e-9); });
+    c = Run("write (np::DynArray, {$R+})", [] { return AxpyChecked(A, B, 1e-9); });
+    d = Run("write (np::DynArray, {$R-})", [] { return Axpy(A, B, 1e-9); });
+    ReportRatio("write DynArray {$R+} vs legacy", o, c);
+    ReportRatio("write DynArray {$R-} vs std::vector", v, d);
+    return 0;
+}
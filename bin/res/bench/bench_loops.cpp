@@ -0,0 +1,168 @@
+/**
+ * NitroPascal Benchmark - Loop Lowering
+ *
+ * Compares the two shapes the code generator can emit for Pascal loops:
+ * the np::ForLoop/WhileLoop lambda wrappers (TNitroPascal.SetNativeLoops(False))
+ * and native C++ loops (default). Each kernel is written exactly as the
+ * stmt.for / stmt.while emitters produce it for the Pascal shown above it.
+ */
+
+#include "bench.h"
+
+using namespace np::bench;
+
+static constexpr np::Integer N = 1 << 16;
+static constexpr int PASSES = 200;
+
+static np::DynArray<np::Double> A;
+static np::DynArray<np::Double> B;
+
+// ----------------------------------------------------------------------------
+// function Dot(): Double;
+// var i: Integer;
+// begin
+//   for i := 0 to N - 1 do
+//     Result := Result + A[i] * B[i];
+// end;
+// ----------------------------------------------------------------------------
+
+static np::Double DotLambda() {
+    np::Double Result{};
+    np::ForLoop(0, N - 1, [&](np::Integer i) {
+        Result = Result + A[i] * B[i];
+    });
+    return Result;
+}
+
+static np::Double DotNative() {
+    np::Double Result{};
+    np::Integer i;
+    for (np::Int64 _np_i1 = (0), _np_end1 = (N - 1); _np_i1 <= _np_end1; ++_np_i1) {
+        i = static_cast<decltype(i)>(_np_i1);
+        Result = Result + A[i] * B[i];
+    }
+    return Result;
+}
+
+// ----------------------------------------------------------------------------
+// function Find(AKey: Double): Integer;
+// var i: Integer;
+// begin
+//   Result := -1;
+//   for i := 0 to N - 1 do
+//     if A[i] = AKey then
+//     begin
+//       Result := i;
+//       break;
+//     end;
+// end;
+// ----------------------------------------------------------------------------
+
+static np::Integer FindLambda(np::Double AKey) {
+    np::Integer Result{};
+    Result = -1;
+    np::ForLoop(0, N - 1, [&](np::Integer i) {
+        if (A[i] == AKey) {
+            Result = i;
+            return np::LoopControl::Break;
+        }
+        return np::LoopControl::Normal;
+    });
+    return Result;
+}
+
+static np::Integer FindNative(np::Double AKey) {
+    np::Integer Result{};
+    np::Integer i;
+    Result = -1;
+    for (np::Int64 _np_i2 = (0), _np_end2 = (N - 1); _np_i2 <= _np_end2; ++_np_i2) {
+        i = static_cast<decltype(i)>(_np_i2);
+        if (A[i] == AKey) {
+            Result = i;
+            break;
+        }
+    }
+    return Result;
+}
+
+// ----------------------------------------------------------------------------
+// function CountPositive(): Integer;
+// var k: Integer;
+// begin
+//   k := 0;
+//   while k < N do
+//   begin
+//     k := k + 1;
+//     if B[k - 1] < 0 then
+//       continue;
+//     Result := Result + 1;
+//   end;
+// end;
+// ----------------------------------------------------------------------------
+
+static np::Integer CountLambda() {
+    np::Integer Result{};
+    np::Integer k;
+    k = 0;
+    np::WhileLoop([&]() { return k < N; }, [&]() {
+        k = k + 1;
+        if (B[k - 1] < 0) {
+            return np::LoopControl::Continue;
+        }
+        Result = Result + 1;
+        return np::LoopControl::Normal;
+    });
+    return Result;
+}
+
+static np::Integer CountNative() {
+    np::Integer Result{};
+    np::Integer k;
+    k = 0;
+    while (k < N) {
+        k = k + 1;
+        if (B[k - 1] < 0) {
+            continue;
+        }
+        Result = Result + 1;
+    }
+    return Result;
+}
+
+template<typename Func>
+static double Run(const char* AName, Func&& AFunc) {
+    double s = Seconds([&]() {
+        for (int p = 0; p < PASSES; ++p)
+            DoNotOptimize(AFunc());
+    });
+    Report(AName, s, double(N) * PASSES, "iter");
+    return s;
+}
+
+int main() {
+    np::SetLength(A, N);
+    np::SetLength(B, N);
+    for (np::Integer k = 0; k < N; ++k) {
+        A[k] = k * 0.5;
+        B[k] = (k % 3 == 0) ? -1.0 : 1.0;
+    }
+    if (DotLambda() != DotNative() || FindLambda(N - 1) != FindNative(N - 1) ||
+        CountLambda() != CountNative()) {
+        std::printf("lambda and native loops disagree\n");
+        return 1;
+    }
+
+    double l, n;
+    l = Run("for  (lambda np::ForLoop)", DotLambda);
+    n = Run("for  (native)", DotNative);
+    ReportRatio("for speedup", l, n);
+
+    l = Run("for+break (lambda LoopControl)", [] { return FindLambda((N - 1) * 0.5); });
+    n = Run("for+break (native)", [] { return FindNative((N - 1) * 0.5); });
+    ReportRatio("for+break speedup", l, n);
+
+    l = Run("while+continue (lambda)", CountLambda);
+    n = Run("while+continue (native)", CountNative);
+    ReportRatio("while+continue speedup", l, n);
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * NitroPascal Benchmark - Mapped Files
+ *
+ * Reading a file through a MappedFile against the buffered routines. A
+ * text file is scanned line by line with TextFile ReadLn, MappedFile ReadLn
+ * (one String per line) and the MappedFile line iterator (no String at
+ * all). A file of fixed-size records is probed at random indices with
+ * BinaryFile Seek + BlockRead and with the bounds-checked record view.
+ * Both files are written to the temp directory and removed at the end; the
+ * timings are for a warm page cache.
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_mappedfile.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace np::bench;
+
+static constexpr np::Integer LINES   = 1000000;
+static constexpr np::Integer RECORDS = 1 << 20;
+static constexpr np::Integer PROBES  = 1 << 20;
+
+struct TRecord {
+    np::Int64  id;
+    np::Double price;
+    np::Integer stock;
+    np::Integer flags;
+};
+
+static std::string TextName;
+static std::string DataName;
+static std::size_t TextBytes = 0;
+
+static void MakeFiles() {
+    auto dir = std::filesystem::temp_directory_path();
+    TextName = (dir / "np_bench_mapped.txt").string();
+    DataName = (dir / "np_bench_mapped.dat").string();
+
+    std::FILE* f = std::fopen(TextName.c_str(), "wb");
+    for (np::Integer i = 0; i < LINES; ++i) {
+        std::string line = "2024-05-01 12:00:" + std::to_string(i % 60) + " INFO request " +
+                           std::to_string(i) + " ";
+        line.append(static_cast<std::size_t>(i) * 7919 % 150, 'x');
+        line.push_back('\n');
+        std::fwrite(line.data(), 1, line.size(), f);
+        TextBytes += line.size();
+    }
+    std::fclose(f);
+
+    f = std::fopen(DataName.c_str(), "wb");
+    for (np::Integer i = 0; i < RECORDS; ++i) {
+        TRecord r{i, i * 0.25, i % 1000, 0};
+        std::fwrite(&r, sizeof(r), 1, f);
+    }
+    std::fclose(f);
+}
+
+// ============================================================================
+// LINES
+// ============================================================================
+
+static np::Int64 LinesText() {
+    np::TextFile f;
+    np::String s;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(TextName));
+    np::Reset(f);
+    while (!np::Eof(f)) {
+        np::ReadLn(f, s);
+        total += np::Length(s);
+    }
+    np::Close(f);
+    return total;
+}
+
+static np::Int64 LinesMapped() {
+    np::MappedFile m;
+    np::String s;
+    np::Int64 total = 0;
+    np::MapFile(m, np::String(TextName));
+    while (!np::Eof(m)) {
+        np::ReadLn(m, s);
+        total += np::Length(s);
+    }
+    return total;
+}
+
+static np::Int64 LinesIterator() {
+    np::MappedFile m;
+    np::Int64 total = 0;
+    np::MapFile(m, np::String(TextName));
+    for (std::string_view line : m.Lines()) {
+        total += static_cast<np::Int64>(line.size());
+    }
+    return total;
+}
+
+// ============================================================================
+// RECORDS
+// ============================================================================
+
+static std::vector<np::Integer> Probes;
+
+static np::Int64 ProbeBinaryFile() {
+    np::BinaryFile f;
+    TRecord r;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f, sizeof(TRecord));
+    for (np::Integer i : Probes) {
+        np::Seek(f, i);
+        np::BlockRead(f, r, 1);
+        total += r.stock;
+    }
+    np::Close(f);
+    return total;
+}
+
+static np::Int64 ProbeMapped() {
+    np::MappedFile m;
+    np::Int64 total = 0;
+    np::MapFile(m, np::String(DataName), np::MapAdvice::Random);
+    auto records = m.Records<TRecord>();
+    for (np::Integer i : Probes) {
+        total += records[i].stock;
+    }
+    return total;
+}
+
+int main() {
+    MakeFiles();
+    std::printf("%d lines, %.1f MB; %d records, %.1f MB\n", LINES, TextBytes / 1e6,
+                RECORDS, RECORDS * sizeof(TRecord) / 1e6);
+
+    np::Int64 a = 0, b = 0, c = 0;
+    double tText = Seconds([&] { a = LinesText(); }, 3);
+    double tMapped = Seconds([&] { b = LinesMapped(); }, 3);
+    double tIter = Seconds([&] { c = LinesIterator(); }, 3);
+    DoNotOptimize(a + b + c);
+    ReportBytes("Lines: TextFile ReadLn", tText, static_cast<double>(TextBytes));
+    ReportBytes("Lines: MappedFile ReadLn", tMapped, static_cast<double>(TextBytes));
+    ReportBytes("Lines: MappedFile Lines()", tIter, static_cast<double>(TextBytes));
+    ReportRatio("ReadLn: mapped vs buffered", tText, tMapped);
+
+    std::mt19937 rng(42);
+    Probes.resize(PROBES);
+    for (np::Integer& i : Probes) {
+        i = static_cast<np::Integer>(rng() % RECORDS);
+    }
+    double tFile = Seconds([&] { a = ProbeBinaryFile(); }, 3);
+    double tView = Seconds([&] { b = ProbeMapped(); }, 3);
+    DoNotOptimize(a + b);
+    Report("Records: Seek + BlockRead", tFile, PROBES, "reads");
+    Report("Records: Records<T>()[i]", tView, PROBES, "reads");
+    ReportRatio("Random records: mapped", tFile, tView);
+
+    std::remove(TextName.c_str());
+    std::remove(DataName.c_str());
+    return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * NitroPascal Benchmark - Set Representation
+ *
+ * Compares the hashed np::Set backend (the only one before small ordinal
+ * sets got a bitset) with the bitset backend now used for set of Char,
+ * set of Byte, subrange sets and constant set constructors. The hashed
+ * cases use np::Set<T, 0, -1>, which forces the unordered_set backend.
+ */
+
+#include "bench.h"
+
+using namespace np::bench;
+
+static constexpr np::Integer N = 1 << 16;
+static constexpr np::Integer ALG_N = 1 << 10;  // hashed algebra is slow
+static constexpr int PASSES = 200;
+
+using HashCharSet = np::Set<np::Char, 0, -1>;
+using HashByteSet = np::Set<np::Byte, 0, -1>;
+
+static np::DynArray<np::Char> Text;
+
+// ----------------------------------------------------------------------------
+// function CountDelims(): Integer;
+// var i: Integer;
+// begin
+//   for i := 0 to N - 1 do
+//     if Text[i] in [' ', ',', '.', ';', ':'] then
+//       Result := Result + 1;
+// end;
+// ----------------------------------------------------------------------------
+
+static np::Integer CountDelimsMakeSet() {
+    // Former emission: the constructor is rebuilt on every test
+    np::Integer Result{};
+    for (np::Integer i = 0; i < N; ++i)
+        if (np::In(Text[i], HashCharSet{u' ', u',', u'.', u';', u':'}))
+            Result = Result + 1;
+    return Result;
+}
+
+static np::Integer CountDelimsHash() {
+    // Hashed set hoisted by hand -- the best case for the old backend
+    static const HashCharSet Delims{u' ', u',', u'.', u';', u':'};
+    np::Integer Result{};
+    for (np::Integer i = 0; i < N; ++i)
+        if (np::In(Text[i], Delims))
+            Result = Result + 1;
+    return Result;
+}
+
+static np::Integer CountDelimsBitset() {
+    // Current emission: the constructor is a compile-time constant
+    np::Integer Result{};
+    for (np::Integer i = 0; i < N; ++i)
+        if (np::In(Text[i], np::SetLit<np::Char, 32, 44, 46, 59, 58>))
+            Result = Result + 1;
+    return Result;
+}
+
+// ----------------------------------------------------------------------------
+// var S: set of Byte;
+// for i := 0 to ALG_N - 1 do
+//   S := (S + [i and 255]) * [0..127, 200..255] - [i and 63];
+// ----------------------------------------------------------------------------
+
+static np::Integer AlgebraHash() {
+    static const HashByteSet Mask = [] {
+        HashByteSet m;
+        m.IncludeRange(0, 127).IncludeRange(200, 255);
+        return m;
+    }();
+    HashByteSet S;
+    for (np::Integer i = 0; i < ALG_N; ++i)
+        S = (S + HashByteSet{np::Byte(i & 255)}) * Mask - HashByteSet{np::Byte(i & 63)};
+    return S.Size();
+}
+
+static np::Integer AlgebraBitset() {
+    static constexpr np::Set<np::Byte> Mask =
+        np::Set<np::Byte>::FromOrdinals({}).IncludeRange(0, 127).IncludeRange(200, 255);
+    np::Set<np::Byte> S;
+    for (np::Integer i = 0; i < ALG_N; ++i)
+        S = (S + np::Set<np::Byte>{np::Byte(i & 255)}) * Mask -
+            np::Set<np::Byte>{np::Byte(i & 63)};
+    return S.Size();
+}
+
+template<typename Func>
+static double Run(const char* AName, Func&& AFunc, np::Integer AIters = N) {
+    double s = Seconds([&]() {
+        for (int p = 0; p < PASSES; ++p)
+            DoNotOptimize(AFunc());
+    });
+    Report(AName, s, double(AIters) * PASSES, "op");
+    return s;
+}
+
+int main() {
+    static const char Sample[] = "uses System, Classes; begin x := a.b; end. ";
+    np::SetLength(Text, N);
+    for (np::Integer k = 0; k < N; ++k)
+        Text[k] = static_cast<np::Char>(Sample[k % (sizeof(Sample) - 1)]);
+    if (CountDelimsMakeSet() != CountDelimsBitset() ||
+        CountDelimsHash() != CountDelimsBitset() ||
+        AlgebraHash() != AlgebraBitset()) {
+        std::printf("hashed and bitset sets disagree\n");
+        return 1;
+    }
+
+    double m, h, b;
+    m = Run("in [..] (hashed, rebuilt per test)", CountDelimsMakeSet);
+    h = Run("in [..] (hashed, hoisted)", CountDelimsHash);
+    b = Run("in [..] (bitset constant)", CountDelimsBitset);
+    ReportRatio("in speedup vs rebuilt", m, b);
+    ReportRatio("in speedup vs hoisted", h, b);
+
+    h = Run("+ * - (hashed set of Byte)", AlgebraHash, ALG_N);
+    b = Run("+ * - (bitset set of Byte)", AlgebraBitset, ALG_N);
+    ReportRatio("set algebra speedup", h, b);
+    return 0;
+}
@@ -0,0 +1,378 @@
+/**
+ * NitroPascal Benchmark - String Representation
+ *
+ * Typical string workloads, run against whichever np::String storage the
+ * runtime was built with. Build and run once per representation and
+ * compare the two reports:
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_string.cpp ../runtime/runtime.cpp
+ *   zig c++ -std=c++23 -O2 -DNP_STRING_UTF8 -I../runtime bench_string.cpp ../runtime/runtime.cpp
+ *
+ * Each kernel is the C++ the code generator emits for the Pascal shown in
+ * its comment.
+ */
+
+#include "bench.h"
+
+using namespace np::bench;
+
+#ifdef NP_STRING_UTF8
+static const char* REP = "utf8";
+#else
+static const char* REP = "utf16";
+#endif
+
+static constexpr int N = 200000;
+
+static np::String Line;    // 80-char ASCII record with padding
+static np::String Record;  // ASCII record of 40-char fields
+static np::String Text;    // ~64 KB of ASCII text
+static np::String Cyrillic;  // 80 characters of mixed-case Russian
+
+// while p > 0 do begin tok := Copy(Line, 1, p - 1); Delete(Line, 1, p); ... end;
+static np::Integer SplitCopy(const np::String& ALine) {
+    np::Integer n = 0;
+    np::String rest = ALine;
+    np::Integer p = np::Pos(u';', rest);
+    while (p > 0) {
+        n += np::Length(np::Trim(np::Copy(rest, 1, p - 1)));
+        np::Delete(rest, 1, p);
+        p = np::Pos(u';', rest);
+    }
+    return n;
+}
+
+// The same with Rest, Tok: TStringView:
+// while p > 0 do begin tok := Trim(Copy(Rest, 1, p - 1)); Rest := Copy(Rest, p + 1, Length(Rest)); ... end;
+static np::Integer SplitView(const np::String& ALine) {
+    np::Integer n = 0;
+    np::StringView rest = ALine;
+    np::Integer p = np::Pos(u';', rest);
+    while (p > 0) {
+        n += np::Length(np::Trim(np::Copy(rest, 1, p - 1)));
+        rest = np::Copy(rest, p + 1, np::Length(rest));
+        p = np::Pos(u';', rest);
+    }
+    return n;
+}
+
+template<typename Func>
+static void Run(const char* AName, double AUnits, const char* AUnitName, Func&& AFunc) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%-28s [%s]", AName, REP);
+    double s = Seconds([&]() { DoNotOptimize(AFunc()); });
+    Report(name, s, AUnits, AUnitName);
+}
+
+int main() {
+    Line = "   1234;ACME Corporation;Springfield;    widget, blue;  19.99;in stock   ";
+    for (int i = 0; i < 6; ++i) {
+        Record += "  customer record field with padding ";
+        Record += np::IntToStr(i);
+        Record += " ;";
+    }
+    Cyrillic = u"Съешь же ещё этих мягких французских булок, да выпей чаю. Широкая электрификация";
+    for (int i = 0; i < 1000; ++i) {
+        Text += "The quick brown fox jumps over the lazy dog; ";
+        Text += np::IntToStr(i);
+        Text += "\n";
+    }
+
+    // s := 'identifier';
+    Run("literal construction", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            np::String s = np::StrLit<u"identifier_name">;
+            n += np::Length(s);
+        }
+        return n;
+    });
+
+    // s := a + '=' + b;
+    Run("concatenation", N, "op", [] {
+        np::String a = np::StrLit<u"key">, b = np::StrLit<u"value">;
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            np::String s = a + u'=' + b;
+            n += np::Length(s);
+        }
+        return n;
+    });
+
+    // for j := 0 to 63 do if Names[j] = Key then ...;  (a linear symbol
+    // lookup over names of one length that differ at the end)
+    static np::String Names[64], Keys[64], Atoms[64], AtomKeys[64];
+    for (int j = 0; j < 64; ++j) {
+        Names[j] = np::String(u"compiler_symbol_table_entry_") + np::IntToStr(1000 + j);
+        Keys[j] = np::String(u"compiler_symbol_table_entry_") + np::IntToStr(1000 + j);
+        Atoms[j] = np::Intern(Names[j]);
+        AtomKeys[j] = np::Intern(Keys[j]);
+    }
+    Run("symbol lookup (String)", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            const np::String& key = Keys[i & 63];
+            for (int j = 0; j < 64; ++j) {
+                if (Names[j] == key) {
+                    n += j;
+                    break;
+                }
+            }
+        }
+        return n;
+    });
+
+    // As above, with both sides passed through Intern
+    Run("symbol lookup (interned)", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            const np::String& key = AtomKeys[i & 63];
+            for (int j = 0; j < 64; ++j) {
+                if (Atoms[j] == key) {
+                    n += j;
+                    break;
+                }
+            }
+        }
+        return n;
+    });
+
+    // if Key in Symbols then ...;  (Symbols: set of String, a hash set)
+    static np::Set<np::String> Symbols;
+    for (int j = 0; j < 64; ++j) {
+        np::Include(Symbols, Names[j]);
+    }
+    Run("symbol lookup (set of String)", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::In(Keys[i & 63], Symbols) ? 1 : 0;
+        }
+        return n;
+    });
+
+    // The hash of a String is kept in its block once worked out; a write
+    // clears it, so this times the hash itself
+    Run("hash (64 KB, uncached)", static_cast<double>(Text.RawSize() * sizeof(np::StringUnit)), "B", [] {
+        Text[1] = u'T';
+        return Text.Hash();
+    });
+
+    // s := UpperCase(Line);
+    Run("UpperCase (80 chars)", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::Length(np::UpperCase(Line));
+        }
+        return n;
+    });
+
+    // s := LowerCase(Text);
+    Run("LowerCase (64 KB)", 200.0 * np::Length(Text), "char", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < 200; ++i) {
+            n += np::Length(np::LowerCase(Text));
+        }
+        return n;
+    });
+
+    // s := AnsiUpperCase(Cyrillic);
+    Run("AnsiUpperCase (80 chars)", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::Length(np::AnsiUpperCase(Cyrillic));
+        }
+        return n;
+    });
+
+    // if SameText(Line, Upper) then ...
+    Run("SameText (80 chars)", N, "op", [] {
+        np::String upper = np::UpperCase(Line);
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::SameText(Line, upper);
+        }
+        return n;
+    });
+
+    // if AnsiSameText(Cyrillic, Upper) then ...
+    Run("AnsiSameText (80 chars)", N, "op", [] {
+        np::String upper = np::AnsiUpperCase(Cyrillic);
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::AnsiSameText(Cyrillic, upper);
+        }
+        return n;
+    });
+
+    // s := Trim(Line);
+    Run("Trim (80 chars)", N, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::Length(np::Trim(Line));
+        }
+        return n;
+    });
+
+    // n := n + StrToInt(IntToStr(i));
+    Run("IntToStr + StrToInt", N, "op", [] {
+        np::Int64 n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::StrToInt(np::IntToStr(i));
+        }
+        return n;
+    });
+
+    // n := n + StrToInt64(IntToStr(-i * 1000003));
+    Run("IntToStr + StrToInt64", N, "op", [] {
+        np::Int64 n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::StrToInt64(np::IntToStr(np::Int64(-i) * 1000003));
+        }
+        return n;
+    });
+
+    // d := d + StrToFloat(FloatToStr(i / 7));
+    Run("FloatToStr + StrToFloat", N, "op", [] {
+        np::Double d = 0;
+        for (int i = 0; i < N; ++i) {
+            d += np::StrToFloat(np::FloatToStr(i / 7.0));
+        }
+        return d;
+    });
+
+    // Val(Field, v, code); if code = 0 then n := n + v;
+    Run("Val (Integer)", N, "op", [] {
+        np::String field = np::StrLit<u"  -123456789">;
+        np::Integer n = 0, v, code;
+        for (int i = 0; i < N; ++i) {
+            np::Val(field, v, code);
+            if (code == 0) {
+                n += v & 1;
+            }
+        }
+        return n;
+    });
+
+    // s := Format('%s: item %d costs %.2f', [Name, i, i / 7]);
+    Run("Format (literal format)", N, "op", [] {
+        np::String name = np::StrLit<u"warehouse">;
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::Length(np::FormatLit<u"%s: item %d costs %.2f">(name, i, i / 7.0));
+        }
+        return n;
+    });
+
+    // s := Format(Fmt, [Name, i, i / 7]);
+    Run("Format (format in a variable)", N, "op", [] {
+        np::String fmt = np::StrLit<u"%s: item %d costs %.2f">;
+        np::String name = np::StrLit<u"warehouse">;
+        np::Integer n = 0;
+        for (int i = 0; i < N; ++i) {
+            n += np::Length(np::Format(fmt, name, i, i / 7.0));
+        }
+        return n;
+    });
+
+    // p := Pos('lazy dog; 999', Text);
+    Run("Pos (64 KB haystack)", 200, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < 200; ++i) {
+            n += np::Pos(np::StrLit<u"lazy dog; 999">, Text);
+        }
+        return n;
+    });
+
+    // p := Pos(Long, Text);  (a 40-char needle: Boyer-Moore-Horspool)
+    Run("Pos (64 KB, 40-char needle)", 200, "op", [] {
+        np::String needle = np::StrLit<u"jumps over the lazy dog; 999\nThe quick">;
+        np::Integer n = 0;
+        for (int i = 0; i < 200; ++i) {
+            n += np::Pos(needle, Text);
+        }
+        return n;
+    });
+
+    // p := PosEx('fox', Text, p + 1); until p = 0
+    Run("PosEx every match (64 KB)", 200, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < 200; ++i) {
+            for (np::Integer p = np::PosEx(np::StrLit<u"fox">, Text, 1); p > 0;
+                 p = np::PosEx(np::StrLit<u"fox">, Text, p + 1)) {
+                n++;
+            }
+        }
+        return n;
+    });
+
+    // s := StringReplace(Text, 'fox', 'wolf', [rfReplaceAll]);
+    Run("StringReplace all (64 KB)", 200, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < 200; ++i) {
+            n += np::Length(np::StringReplace(Text, np::StrLit<u"fox">, np::StrLit<u"wolf">,
+                                              np::MakeSet({np::rfReplaceAll})));
+        }
+        return n;
+    });
+
+    // s := StringReplace(Text, 'THE', 'a', [rfReplaceAll, rfIgnoreCase]);
+    Run("StringReplace ignore case", 200, "op", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < 200; ++i) {
+            n += np::Length(np::StringReplace(Text, np::StrLit<u"THE">, np::StrLit<u"a">,
+                                              np::MakeSet({np::rfReplaceAll, np::rfIgnoreCase})));
+        }
+        return n;
+    });
+
+    // for i := 1 to Length(Text) do if Text[i] = ' ' then Inc(n);
+    Run("indexed scan (64 KB)", 20.0 * np::Length(Text), "char", [] {
+        np::Integer n = 0;
+        for (int r = 0; r < 20; ++r) {
+            for (np::Integer i = 1; i <= np::Length(Text); ++i) {
+                if (Text[i] == u' ') {
+                    n++;
+                }
+            }
+        }
+        return n;
+    });
+
+    // Short fields fit a String's inline buffer, so Copy does not allocate;
+    // the long-field record shows what a view saves when it would
+    Run("split on ';' (Copy/Pos)", N / 10, "line", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N / 10; ++i) {
+            n += SplitCopy(Line);
+        }
+        return n;
+    });
+
+    Run("split on ';' (TStringView)", N / 10, "line", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N / 10; ++i) {
+            n += SplitView(Line);
+        }
+        return n;
+    });
+
+    Run("split long fields (Copy/Pos)", N / 10, "line", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N / 10; ++i) {
+            n += SplitCopy(Record);
+        }
+        return n;
+    });
+
+    Run("split long fields (TStringView)", N / 10, "line", [] {
+        np::Integer n = 0;
+        for (int i = 0; i < N / 10; ++i) {
+            n += SplitView(Record);
+        }
+        return n;
+    });
+
+    std::printf("%-40s %10zu bytes\n", "storage for 64 KB ASCII text",
+                np::String(Text).RawSize() * sizeof(np::StringUnit));
+    return 0;
+}
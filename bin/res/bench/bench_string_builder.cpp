@@ -0,0 +1,96 @@
+/**
+ * NitroPascal Benchmark - Building Long Strings
+ *
+ * Time to build a CSV-like report one line at a time, the way Pascal code
+ * does: `Report := Report + 'item_' + IntToStr(i) + ';' + ...`. The former
+ * emission evaluated the right-hand side into fresh temporaries and copied
+ * the whole report on every line, so it is only run on a small report.
+ * np::_AppendAll (what that statement is emitted as now) and TStringBuilder
+ * (np::StringBuilder) build a 100 MB one. Build and run once per
+ * representation:
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_string_builder.cpp ../runtime/runtime.cpp
+ *   zig c++ -std=c++23 -O2 -DNP_STRING_UTF8 -I../runtime bench_string_builder.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+
+using namespace np::bench;
+
+static constexpr size_t SMALL = 256u << 10;   // 256 KB
+static constexpr size_t LARGE = 100u << 20;   // 100 MB
+
+static double Price(int i) {
+    return (i % 10000) * 0.25;
+}
+
+// Report := Report + 'item_' + IntToStr(i) + ';' + FloatToStr(p) + #10;
+static np::String ConcatTemporaries(size_t ABytes) {
+    np::String report;
+    for (int i = 0; static_cast<size_t>(report.RawSize()) < ABytes; ++i) {
+        report = report + np::StrLit<u"item_"> + np::IntToStr(i) + u';' +
+                 np::FloatToStr(Price(i)) + u'\n';
+    }
+    return report;
+}
+
+// The same statement as emitted now
+static np::String AppendInPlace(size_t ABytes) {
+    np::String report;
+    for (int i = 0; static_cast<size_t>(report.RawSize()) < ABytes; ++i) {
+        np::_AppendAll(report, np::StrLit<u"item_">, np::IntToStr(i), u';',
+                       np::FloatToStr(Price(i)), u'\n');
+    }
+    return report;
+}
+
+// Append(Builder, 'item_'); Append(Builder, i); ... AppendLine(Builder);
+static np::String Builder(size_t ABytes) {
+    np::StringBuilder builder;
+    for (int i = 0; static_cast<size_t>(builder.Length()) < ABytes; ++i) {
+        np::Append(builder, np::StrLit<u"item_">);
+        np::Append(builder, i);
+        np::Append(builder, u';');
+        np::Append(builder, Price(i));
+        np::AppendLine(builder);
+    }
+    return np::ToString(builder);
+}
+
+// As above, with EnsureCapacity(Builder, ...) up front
+static np::String BuilderPresized(size_t ABytes) {
+    np::StringBuilder builder;
+    np::EnsureCapacity(builder, static_cast<np::Integer>(ABytes + 64));
+    for (int i = 0; static_cast<size_t>(builder.Length()) < ABytes; ++i) {
+        np::Append(builder, np::StrLit<u"item_">);
+        np::Append(builder, i);
+        np::Append(builder, u';');
+        np::Append(builder, Price(i));
+        np::AppendLine(builder);
+    }
+    return np::ToString(builder);
+}
+
+template<typename Func>
+static double Run(const char* AName, size_t ABytes, Func&& AFunc) {
+    size_t units = 0;
+    double s = Seconds([&]() {
+        np::String report = AFunc(ABytes);
+        units = report.RawSize();
+        DoNotOptimize(report);
+    }, 3);
+    ReportBytes(AName, s, static_cast<double>(units * sizeof(np::StringUnit)));
+    return s;
+}
+
+int main() {
+    double o, n;
+    o = Run("s := s + ... 256 KB (temporaries)", SMALL, ConcatTemporaries);
+    n = Run("s := s + ... 256 KB (in place)",    SMALL, AppendInPlace);
+    ReportRatio("256 KB report speedup", o, n);
+
+    Run("s := s + ...   100 MB (in place)",   LARGE, AppendInPlace);
+    Run("TStringBuilder 100 MB",              LARGE, Builder);
+    Run("TStringBuilder 100 MB (presized)",   LARGE, BuilderPresized);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ * NitroPascal Benchmark - String Copies and Allocations
+ *
+ * Time and heap allocations of the string assignments Pascal code does all
+ * the time: array elements, function results, record fields and short
+ * identifiers. np::String (inline buffer + refcounted copy-on-write) is
+ * compared with LegacyString, the former deep-copying std::u16string
+ * storage, reproduced below. Every operator new in the process is counted.
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_string_cow.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace np::bench;
+
+static std::atomic<long long> Allocations{0};
+
+void* operator new(std::size_t ASize) {
+    Allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(ASize ? ASize : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* APtr) noexcept {
+    std::free(APtr);
+}
+
+void operator delete(void* APtr, std::size_t) noexcept {
+    std::free(APtr);
+}
+
+// Storage and copy semantics of the previous np::String
+struct LegacyString {
+    std::u16string data_;
+
+    LegacyString() = default;
+    LegacyString(const char16_t* s) : data_(s) {}
+    LegacyString(std::u16string s) : data_(std::move(s)) {}
+    LegacyString operator+(const LegacyString& other) const { return LegacyString(data_ + other.data_); }
+};
+
+static LegacyString LegacyIntToStr(int AValue) {
+    std::string s = std::to_string(AValue);
+    return LegacyString(std::u16string(s.begin(), s.end()));
+}
+
+template<typename Str>
+struct TItem {
+    Str Name;
+};
+
+static constexpr int N = 100000;
+
+template<typename Str>
+static Str Echo(const Str& AValue) {
+    Str Result;
+    Result = AValue;
+    return Result;
+}
+
+template<typename Func>
+static double Run(const char* AName, Func&& AFunc) {
+    long long before = Allocations.load();
+    double s = Seconds([&]() { DoNotOptimize(AFunc()); }, 1);
+    long long count = Allocations.load() - before;
+    std::printf("%-40s %10.3f ms  %12lld allocs\n", AName, s * 1e3, count);
+    return s;
+}
+
+// ----------------------------------------------------------------------------
+// for i := 0 to N - 1 do Names[i] := Long;
+// ----------------------------------------------------------------------------
+
+template<typename Str, typename Arr>
+static int FillArray(Arr& ANames, const Str& ALong) {
+    for (int i = 0; i < N; ++i) {
+        ANames[i] = ALong;
+    }
+    return N;
+}
+
+// ----------------------------------------------------------------------------
+// for i := 1 to N do begin Copy := Echo(Long); Item.Name := Copy; end;
+// ----------------------------------------------------------------------------
+
+template<typename Str>
+static int PassThrough(const Str& ALong) {
+    Str copy;
+    TItem<Str> item;
+    for (int i = 0; i < N; ++i) {
+        copy = Echo(ALong);
+        item.Name = copy;
+    }
+    DoNotOptimize(item);
+    return N;
+}
+
+// ----------------------------------------------------------------------------
+// for i := 1 to N do Short := Prefix + IntToStr(i);
+// ----------------------------------------------------------------------------
+
+template<typename Str, typename IntToStr>
+static int ShortIdents(const Str& APrefix, IntToStr AIntToStr) {
+    Str s;
+    for (int i = 1; i <= N; ++i) {
+        s = APrefix + AIntToStr(i);
+    }
+    DoNotOptimize(s);
+    return N;
+}
+
+int main() {
+    const std::u16string longText(100, u'x');
+
+    LegacyString oldLong(longText);
+    np::String   newLong(longText);
+    LegacyString oldPrefix(u"item_");
+    np::String   newPrefix(u"item_");
+
+    auto* oldNames = new LegacyString[N];
+    np::DynArray<np::String> newNames;
+    np::SetLength(newNames, N);
+
+    double o, n;
+    o = Run("array elements  (legacy u16string)", [&] { return FillArray(oldNames, oldLong); });
+    n = Run("array elements  (np::String)",       [&] { return FillArray(newNames, newLong); });
+    ReportRatio("array elements speedup", o, n);
+
+    o = Run("result + field  (legacy u16string)", [&] { return PassThrough(oldLong); });
+    n = Run("result + field  (np::String)",       [&] { return PassThrough(newLong); });
+    ReportRatio("result + field speedup", o, n);
+
+    o = Run("short idents    (legacy u16string)", [&] { return ShortIdents(oldPrefix, LegacyIntToStr); });
+    n = Run("short idents    (np::String)",       [&] { return ShortIdents(newPrefix, [](int i) { return np::IntToStr(i); }); });
+    ReportRatio("short idents speedup", o, n);
+
+    delete[] oldNames;
+    return 0;
+}
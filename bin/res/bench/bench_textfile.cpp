@@ -0,0 +1,142 @@
+/**
+ * NitroPascal Benchmark - Text File I/O
+ *
+ * ReadLn and WriteLn on a TextFile against the std::wfstream path the
+ * runtime used before: getline into a std::wstring, then a String built from
+ * it, and `<< std::endl` (one flush per line) on the way out. The input is a
+ * generated log-like file of mixed line lengths, written to the temp
+ * directory and removed at the end. It is ASCII, since the wide streams stop
+ * at the first non-ASCII byte in the default locale; a second run reads the
+ * same lines with accented words through TextFile alone.
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_textfile.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace np::bench;
+
+static constexpr np::Integer LINES = 1000000;
+
+static std::string FileName;
+static std::size_t FileBytes = 0;
+
+static bool Accents = false;
+
+// Line i of the test file: 40..200 bytes; with Accents every eighth one has
+// two accented words
+static std::string MakeLine(np::Integer i) {
+    bool accented = Accents && i % 8 == 0;
+    std::string line = "2024-05-01 12:00:" + std::to_string(i % 60) + " INFO request " +
+                       std::to_string(i) + (accented ? " caf\xC3\xA9 na\xC3\xAFve " : " ");
+    line.append(static_cast<std::size_t>(i) * 7919 % 150, 'x');
+    return line;
+}
+
+static void MakeFile() {
+    FileName = (std::filesystem::temp_directory_path() / "np_bench_textfile.txt").string();
+    std::FILE* f = std::fopen(FileName.c_str(), "wb");
+    FileBytes = 0;
+    for (np::Integer i = 0; i < LINES; ++i) {
+        std::string line = MakeLine(i);
+        line.push_back('\n');
+        std::fwrite(line.data(), 1, line.size(), f);
+        FileBytes += line.size();
+    }
+    std::fclose(f);
+}
+
+// ============================================================================
+// READ
+// ============================================================================
+
+static np::Int64 ReadStream() {
+    std::wfstream stream(FileName, std::ios::in);
+    std::wstring line;
+    np::String s;
+    np::Int64 total = 0;
+    while (stream.peek() != std::char_traits<wchar_t>::eof()) {
+        std::getline(stream, line);
+        s = np::String(line);
+        total += np::Length(s);
+    }
+    return total;
+}
+
+static np::Int64 ReadText() {
+    np::TextFile f;
+    np::String s;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(FileName));
+    np::Reset(f);
+    while (!np::Eof(f)) {
+        np::ReadLn(f, s);
+        total += np::Length(s);
+    }
+    np::Close(f);
+    return total;
+}
+
+// ============================================================================
+// WRITE
+// ============================================================================
+
+static std::vector<np::String> Lines;   // the file's lines as Strings
+
+static void WriteStream() {
+    std::wfstream stream(FileName, std::ios::out | std::ios::trunc);
+    for (const np::String& s : Lines) {
+        stream << s.ToWString() << std::endl;
+    }
+}
+
+static void WriteText() {
+    np::TextFile f;
+    np::Assign(f, np::String(FileName));
+    np::Rewrite(f);
+    for (const np::String& s : Lines) {
+        np::WriteLn(f, s);
+    }
+    np::Close(f);
+}
+
+int main() {
+    MakeFile();
+    std::printf("%d lines, %.1f MB\n", LINES, FileBytes / 1e6);
+
+    np::Int64 a = 0, b = 0;
+    double tStream = Seconds([&] { a = ReadStream(); }, 3);
+    double tText = Seconds([&] { b = ReadText(); }, 3);
+    DoNotOptimize(a);
+    DoNotOptimize(b);
+    Report("ReadLn: wfstream getline", tStream, LINES, "lines");
+    Report("ReadLn: TextFile", tText, LINES, "lines");
+    ReportBytes("ReadLn: wfstream getline", tStream, static_cast<double>(FileBytes));
+    ReportBytes("ReadLn: TextFile", tText, static_cast<double>(FileBytes));
+    ReportRatio("ReadLn speedup", tStream, tText);
+
+    Lines.reserve(LINES);
+    for (np::Integer i = 0; i < LINES; ++i) {
+        std::string line = MakeLine(i);
+        Lines.push_back(np::String::FromUtf8(line.data(), line.size()));
+    }
+    tStream = Seconds(WriteStream, 3);
+    tText = Seconds(WriteText, 3);
+    Report("WriteLn: wfstream << endl", tStream, LINES, "lines");
+    Report("WriteLn: TextFile", tText, LINES, "lines");
+    ReportBytes("WriteLn: TextFile", tText, static_cast<double>(FileBytes));
+    ReportRatio("WriteLn speedup", tStream, tText);
+
+    Accents = true;
+    MakeFile();
+    tText = Seconds([&] { b = ReadText(); }, 3);
+    DoNotOptimize(b);
+    ReportBytes("ReadLn: TextFile, UTF-8 text", tText, static_cast<double>(FileBytes));
+
+    std::remove(FileName.c_str());
+    return 0;
+}
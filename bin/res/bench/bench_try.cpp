@@ -0,0 +1,129 @@
+/**
+ * NitroPascal Benchmark - Try Block Entry
+ *
+ * Cost of entering a try block that does not raise, in a per-record loop:
+ *
+ *   for i := 0 to N - 1 do
+ *     try
+ *       Total := Total + Parse(i);
+ *     except
+ *       Inc(Errors);
+ *     end;
+ *
+ * The former np::TryCatch (std::call_once + setjmp + thread-local jump
+ * target per entry) is reproduced below as LegacyTryCatch; the generated
+ * code now uses a native C++ try/catch. Its body opens with a fault frame,
+ * which is empty under GCC (non-call exceptions) and one setjmp where the
+ * build defines NP_FAULT_FRAMES; no call_once and no lambdas either way.
+ */
+
+#include "bench.h"
+#include <csetjmp>
+#include <mutex>
+
+using namespace np::bench;
+
+static constexpr np::Integer N = 1 << 22;
+
+// Entry path of the previous TryCatch implementation
+static thread_local jmp_buf* LegacyJmpTarget = nullptr;
+
+static void LegacyInstall() {
+    static std::once_flag LOnce;
+    std::call_once(LOnce, [] {});
+}
+
+template<typename TryFn, typename CatchFn>
+static void LegacyTryCatch(TryFn try_fn, CatchFn catch_fn) {
+    LegacyInstall();
+    jmp_buf           buf;
+    volatile jmp_buf* old_target    = LegacyJmpTarget;
+    volatile bool     had_exception = false;
+    LegacyJmpTarget = &buf;
+    if (setjmp(buf) == 0) {
+        try {
+            try_fn();
+        }
+        catch (...) {
+            np::_CaptureException();
+            had_exception = true;
+        }
+    }
+    else {
+        had_exception = true;
+    }
+    LegacyJmpTarget = const_cast<jmp_buf*>(old_target);
+    if (had_exception) {
+        catch_fn();
+    }
+}
+
+static np::Integer Data[256];
+
+// A small record parser; raises on a value that never occurs in the data
+__attribute__((noinline)) static np::Integer Parse(np::Integer AIndex) {
+    np::Integer v = Data[AIndex & 255];
+    if (v < 0) {
+        np::RaiseException("bad record");
+    }
+    return v;
+}
+
+static np::Int64 Legacy() {
+    np::Int64   Total  = 0;
+    np::Integer Errors = 0;
+    for (np::Integer i = 0; i < N; ++i) {
+        LegacyTryCatch([&]() {
+            Total = Total + Parse(i);
+        }, [&]() {
+            np::Inc(Errors);
+        });
+    }
+    return Total + Errors;
+}
+
+static np::Int64 Native() {
+    np::Int64 NP_FAULT_VOLATILE Total  = 0;
+    np::Integer                 Errors = 0;
+    for (np::Integer i = 0; i < N; ++i) {
+        {
+            try {
+                NP_FAULT_FRAME(_np_flt1);
+                Total = Total + Parse(i);
+            } catch (...) {
+                np::_CaptureException();
+                np::Inc(Errors);
+            }
+        }
+    }
+    return Total + Errors;
+}
+
+static np::Int64 Unprotected() {
+    np::Int64 Total = 0;
+    for (np::Integer i = 0; i < N; ++i) {
+        Total = Total + Parse(i);
+    }
+    return Total;
+}
+
+int main() {
+    for (np::Integer k = 0; k < 256; ++k) {
+        Data[k] = k;
+    }
+    if (Legacy() != Native() || Native() != Unprotected()) {
+        std::printf("try implementations disagree\n");
+        return 1;
+    }
+
+    double b = Seconds([] { DoNotOptimize(Unprotected()); });
+    double l = Seconds([] { DoNotOptimize(Legacy()); });
+    double n = Seconds([] { DoNotOptimize(Native()); });
+    Report("no try block", b, N, "iter");
+    Report("try..except (legacy setjmp)", l, N, "iter");
+    Report("try..except (native)", n, N, "iter");
+    ReportRatio("native vs legacy", l, n);
+    std::printf("%-40s %10.2f ns\n", "legacy entry overhead", (l - b) / N * 1e9);
+    std::printf("%-40s %10.2f ns\n", "native entry overhead", (n - b) / N * 1e9);
+    return 0;
+}
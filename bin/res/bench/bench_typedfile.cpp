@@ -0,0 +1,275 @@
+/**
+ * NitroPascal Benchmark - Typed Files
+ *
+ * A file of fixed-size records read and written through TypedFile<T>
+ * against BinaryFile. The sequential rows move one record per call
+ * (Write/Read against BlockWrite/BlockRead of one record); the bulk row
+ * moves the whole file through a DynArray in 4096-record blocks; the random
+ * row probes single records with Seek + Read. The query row seeks and asks
+ * for FileSize and FilePos in a loop, against the tellg/seekg round trip a
+ * std::fstream needs for the same answer. The truncate row drops the last
+ * record with Truncate, against reading the prefix and rewriting it through
+ * streams (what Truncate used to do). The file is written to the temp
+ * directory and removed at the end; the timings are for a warm page cache.
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_typedfile.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace np::bench;
+
+static constexpr np::Integer RECORDS = 1 << 20;
+static constexpr np::Integer PROBES  = 1 << 18;
+static constexpr np::Integer BLOCK   = 4096;
+static constexpr np::Integer QUERIES = 1 << 20;
+
+struct TRecord {
+    np::Int64  id;
+    np::Double price;
+    np::Integer stock;
+    np::Integer flags;
+};
+
+static std::string DataName;
+static std::vector<np::Integer> Probes;
+
+// ============================================================================
+// SEQUENTIAL
+// ============================================================================
+
+static void WriteBinaryFile() {
+    np::BinaryFile f;
+    np::Assign(f, np::String(DataName));
+    np::Rewrite(f, sizeof(TRecord));
+    for (np::Integer i = 0; i < RECORDS; ++i) {
+        TRecord r{i, i * 0.25, i % 1000, 0};
+        np::BlockWrite(f, r, 1);
+    }
+    np::Close(f);
+}
+
+static void WriteTyped() {
+    np::TypedFile<TRecord> f;
+    np::Assign(f, np::String(DataName));
+    np::Rewrite(f);
+    for (np::Integer i = 0; i < RECORDS; ++i) {
+        TRecord r{i, i * 0.25, i % 1000, 0};
+        np::Write(f, r);
+    }
+    np::Close(f);
+}
+
+static np::Int64 ReadBinaryFile() {
+    np::BinaryFile f;
+    TRecord r;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f, sizeof(TRecord));
+    while (!np::Eof(f)) {
+        np::BlockRead(f, r, 1);
+        total += r.stock;
+    }
+    np::Close(f);
+    return total;
+}
+
+static np::Int64 ReadTyped() {
+    np::TypedFile<TRecord> f;
+    TRecord r;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f);
+    while (!np::Eof(f)) {
+        np::Read(f, r);
+        total += r.stock;
+    }
+    np::Close(f);
+    return total;
+}
+
+static np::Int64 ReadTypedBlocks() {
+    np::TypedFile<TRecord> f;
+    np::DynArray<TRecord> buffer;
+    np::Integer count = 0;
+    np::Int64 total = 0;
+    np::SetLength(buffer, BLOCK);
+    np::Assign(f, np::String(DataName));
+    np::Reset(f);
+    do {
+        np::BlockRead(f, buffer, BLOCK, count);
+        for (np::Integer i = 0; i < count; ++i) {
+            total += buffer[i].stock;
+        }
+    } while (count == BLOCK);
+    np::Close(f);
+    return total;
+}
+
+// ============================================================================
+// RANDOM
+// ============================================================================
+
+static np::Int64 ProbeBinaryFile() {
+    np::BinaryFile f;
+    TRecord r;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f, sizeof(TRecord));
+    for (np::Integer i : Probes) {
+        np::Seek(f, i);
+        np::BlockRead(f, r, 1);
+        total += r.stock;
+    }
+    np::Close(f);
+    return total;
+}
+
+static np::Int64 ProbeTyped() {
+    np::TypedFile<TRecord> f;
+    TRecord r;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f);
+    for (np::Integer i : Probes) {
+        np::Seek(f, i);
+        np::Read(f, r);
+        total += r.stock;
+    }
+    np::Close(f);
+    return total;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+static np::Int64 QueryStream() {
+    std::fstream f(DataName, std::ios::in | std::ios::binary);
+    np::Int64 total = 0;
+    for (np::Integer i = 0; i < QUERIES; ++i) {
+        f.seekg(static_cast<std::streamoff>(i % RECORDS) * static_cast<std::streamoff>(sizeof(TRecord)));
+        auto current = f.tellg();
+        f.seekg(0, std::ios::end);
+        auto size = f.tellg();
+        f.seekg(current);
+        total += static_cast<np::Int64>(size - current) / static_cast<np::Int64>(sizeof(TRecord));
+    }
+    return total;
+}
+
+static np::Int64 QueryBinaryFile() {
+    np::BinaryFile f;
+    np::Int64 total = 0;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f, sizeof(TRecord));
+    for (np::Integer i = 0; i < QUERIES; ++i) {
+        np::Seek(f, i % RECORDS);
+        total += np::FileSize(f) - np::FilePos(f);
+    }
+    np::Close(f);
+    return total;
+}
+
+// ============================================================================
+// TRUNCATE
+// ============================================================================
+
+static void TruncateCopy() {
+    std::streamsize keep = static_cast<std::streamsize>(RECORDS - 1) * sizeof(TRecord);
+    std::vector<char> content(static_cast<std::size_t>(keep));
+    std::ifstream in(DataName, std::ios::binary);
+    in.read(content.data(), keep);
+    in.close();
+    std::ofstream out(DataName, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), keep);
+}
+
+static void TruncateInPlace() {
+    np::TypedFile<TRecord> f;
+    np::Assign(f, np::String(DataName));
+    np::Reset(f);
+    np::Seek(f, RECORDS - 1);
+    np::Truncate(f);
+    np::Close(f);
+}
+
+// Put the dropped record back, so every cut starts from the whole file
+static void RestoreLast() {
+    np::TypedFile<TRecord> f;
+    TRecord r{RECORDS - 1, 0.0, 0, 0};
+    np::Assign(f, np::String(DataName));
+    np::Reset(f);
+    np::Seek(f, RECORDS - 1);
+    np::Write(f, r);
+    np::Close(f);
+}
+
+// Best of five cuts, each followed by an untimed restore
+template<typename Func>
+static double TimeCut(Func&& ACut) {
+    double best = 1e300;
+    for (int r = 0; r < 5; ++r) {
+        best = std::min(best, Seconds(ACut, 1));
+        RestoreLast();
+    }
+    return best;
+}
+
+int main() {
+    DataName = (std::filesystem::temp_directory_path() / "np_bench_typed.dat").string();
+    const double bytes = static_cast<double>(RECORDS) * sizeof(TRecord);
+    std::printf("%d records, %.1f MB\n", RECORDS, bytes / 1e6);
+
+    double tWriteOld = Seconds([] { WriteBinaryFile(); }, 3);
+    double tWriteNew = Seconds([] { WriteTyped(); }, 3);
+    ReportBytes("Write: BinaryFile BlockWrite", tWriteOld, bytes);
+    ReportBytes("Write: TypedFile Write", tWriteNew, bytes);
+    ReportRatio("Sequential write", tWriteOld, tWriteNew);
+
+    np::Int64 a = 0, b = 0, c = 0;
+    double tReadOld = Seconds([&] { a = ReadBinaryFile(); }, 3);
+    double tReadNew = Seconds([&] { b = ReadTyped(); }, 3);
+    double tBlocks = Seconds([&] { c = ReadTypedBlocks(); }, 3);
+    DoNotOptimize(a + b + c);
+    ReportBytes("Read: BinaryFile BlockRead", tReadOld, bytes);
+    ReportBytes("Read: TypedFile Read", tReadNew, bytes);
+    ReportBytes("Read: TypedFile BlockRead", tBlocks, bytes);
+    ReportRatio("Sequential read", tReadOld, tReadNew);
+    ReportRatio("Bulk read vs BinaryFile", tReadOld, tBlocks);
+
+    std::mt19937 rng(42);
+    Probes.resize(PROBES);
+    for (np::Integer& i : Probes) {
+        i = static_cast<np::Integer>(rng() % RECORDS);
+    }
+    double tProbeOld = Seconds([&] { a = ProbeBinaryFile(); }, 3);
+    double tProbeNew = Seconds([&] { b = ProbeTyped(); }, 3);
+    DoNotOptimize(a + b);
+    Report("Random: BinaryFile Seek + BlockRead", tProbeOld, PROBES, "reads");
+    Report("Random: TypedFile Seek + Read", tProbeNew, PROBES, "reads");
+    ReportRatio("Random read", tProbeOld, tProbeNew);
+
+    double tQueryOld = Seconds([&] { a = QueryStream(); }, 3);
+    double tQueryNew = Seconds([&] { b = QueryBinaryFile(); }, 3);
+    DoNotOptimize(a + b);
+    Report("Query: fstream tellg/seekg", tQueryOld, QUERIES, "queries");
+    Report("Query: BinaryFile FileSize/FilePos", tQueryNew, QUERIES, "queries");
+    ReportRatio("FileSize + FilePos", tQueryOld, tQueryNew);
+
+    double tCutOld = TimeCut([] { TruncateCopy(); });
+    double tCutNew = TimeCut([] { TruncateInPlace(); });
+    ReportBytes("Truncate: copy prefix + rewrite", tCutOld, bytes);
+    ReportBytes("Truncate: ftruncate", tCutNew, bytes);
+    ReportRatio("Truncate last record", tCutOld, tCutNew);
+
+    std::remove(DataName.c_str());
+    return 0;
+}
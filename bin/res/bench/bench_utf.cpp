@@ -0,0 +1,144 @@
+/**
+ * NitroPascal Benchmark - UTF-8 / UTF-16 Transcoding
+ *
+ * Throughput of the conversions behind String construction from C++ text
+ * and ToStdString() (console output, Format, StrToInt...), for text with
+ * different shares of non-ASCII characters. The runtime transcoders use
+ * SSE2/AVX2 for ASCII runs; Legacy* below reproduces the former scalar
+ * loops, which appended one unit at a time. Build and run once per
+ * representation:
+ *
+ *   zig c++ -std=c++23 -O2 -I../runtime bench_utf.cpp ../runtime/runtime.cpp
+ *   zig c++ -std=c++23 -O2 -DNP_STRING_UTF8 -I../runtime bench_utf.cpp ../runtime/runtime.cpp
+ */
+
+#include "bench.h"
+#include <string>
+
+using namespace np::bench;
+
+#ifdef NP_STRING_UTF8
+static const char* REP = "utf8";
+#else
+static const char* REP = "utf16";
+#endif
+
+// Decoding of the previous runtime: lenient, no preallocation
+static std::u16string LegacyUtf8ToUtf16(const std::string& AUtf8) {
+    std::u16string result;
+    size_t i = 0;
+    while (i < AUtf8.size()) {
+        uint32_t codepoint = 0;
+        unsigned char ch = AUtf8[i];
+        if (ch <= 0x7F) {
+            codepoint = ch;
+            i++;
+        } else if ((ch & 0xE0) == 0xC0) {
+            if (i + 1 < AUtf8.size()) {
+                codepoint = ((ch & 0x1F) << 6) | (AUtf8[i + 1] & 0x3F);
+                i += 2;
+            } else break;
+        } else if ((ch & 0xF0) == 0xE0) {
+            if (i + 2 < AUtf8.size()) {
+                codepoint = ((ch & 0x0F) << 12) | ((AUtf8[i + 1] & 0x3F) << 6) | (AUtf8[i + 2] & 0x3F);
+                i += 3;
+            } else break;
+        } else if ((ch & 0xF8) == 0xF0) {
+            if (i + 3 < AUtf8.size()) {
+                codepoint = ((ch & 0x07) << 18) | ((AUtf8[i + 1] & 0x3F) << 12) |
+                            ((AUtf8[i + 2] & 0x3F) << 6) | (AUtf8[i + 3] & 0x3F);
+                i += 4;
+            } else break;
+        } else {
+            i++;
+            continue;
+        }
+        if (codepoint <= 0xFFFF) {
+            result += static_cast<char16_t>(codepoint);
+        } else {
+            codepoint -= 0x10000;
+            result += static_cast<char16_t>(0xD800 + (codepoint >> 10));
+            result += static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF));
+        }
+    }
+    return result;
+}
+
+// Encoding of the previous runtime
+static std::string LegacyUtf16ToUtf8(const std::u16string& AUtf16) {
+    std::string result;
+    size_t i = 0;
+    while (i < AUtf16.size()) {
+        uint32_t codepoint = AUtf16[i];
+        if (codepoint >= 0xD800 && codepoint <= 0xDBFF && i + 1 < AUtf16.size()) {
+            uint32_t low = AUtf16[i + 1];
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            } else {
+                i++;
+                continue;
+            }
+        } else {
+            i++;
+        }
+        if (codepoint <= 0x7F) {
+            result += static_cast<char>(codepoint);
+        } else if (codepoint <= 0x7FF) {
+            result += static_cast<char>(0xC0 | (codepoint >> 6));
+            result += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else if (codepoint <= 0xFFFF) {
+            result += static_cast<char>(0xE0 | (codepoint >> 12));
+            result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            result += static_cast<char>(0xF0 | (codepoint >> 18));
+            result += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+    return result;
+}
+
+static constexpr int REPEAT = 20;
+
+// ~256 KB of UTF-8 built from ASentence
+static std::string MakeText(const char* ASentence) {
+    std::string text;
+    while (text.size() < 256 * 1024) {
+        text += ASentence;
+    }
+    return text;
+}
+
+static void RunCase(const char* ALabel, const std::string& AUtf8) {
+    const std::u16string utf16 = LegacyUtf8ToUtf16(AUtf8);
+    const np::String str(AUtf8);
+    const double bytes = double(AUtf8.size()) * REPEAT;
+    char name[64];
+
+    auto run = [&](const char* AWhat, auto&& AFunc) {
+        std::snprintf(name, sizeof(name), "%-8s %-20s [%s]", ALabel, AWhat, REP);
+        ReportBytes(name, Seconds([&]() {
+            for (int r = 0; r < REPEAT; ++r) {
+                DoNotOptimize(AFunc());
+            }
+        }), bytes);
+    };
+
+    run("legacy utf8->utf16", [&] { return LegacyUtf8ToUtf16(AUtf8).size(); });
+    run("String(std::string)", [&] { return np::String(AUtf8).RawSize(); });
+    run("legacy utf16->utf8", [&] { return LegacyUtf16ToUtf8(utf16).size(); });
+    run("String(u16string)", [&] { return np::String(utf16).RawSize(); });
+    run("ToStdString()", [&] { return str.ToStdString().size(); });
+}
+
+int main() {
+    RunCase("ascii",   MakeText("The quick brown fox jumps over the lazy dog. "));
+    RunCase("latin",   MakeText("Le cœur déçu mais l'âme plutôt naïve, Louÿs rêva de crapaüter. "));
+    RunCase("cyrillic", MakeText("Съешь же ещё этих мягких французских булок, да выпей чаю. "));
+    RunCase("cjk",     MakeText("色は匂へど散りぬるを我が世誰ぞ常ならむ。"));
+    RunCase("emoji",   MakeText("status: ok 😀 build: green 🚀 tests: 100% ✅ "));
+    return 0;
+}
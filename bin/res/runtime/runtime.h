@@ -19,7 +19,7 @@
  * - runtime_control.h/cpp: Control flow (for, while, repeat)
  * - runtime_operators.h/cpp: Arithmetic operators (div, mod, shl, shr)
  * - runtime_ordinal.h/cpp: Ordinal functions (Ord, Chr, Succ, Pred, Inc, Dec)
- * - runtime_containers.h/cpp: DynArray<T>, Set<T>
+ * - runtime_containers.h/cpp: DynArray<T>, Set<T>, Dictionary<K, V>
  * - runtime_memory.h/cpp: Memory management (New, Dispose, GetMem, Move)
  * - runtime_math.h/cpp: Math functions (Abs, Sqrt, Sin, Cos, etc.)
  * - runtime_file.h/cpp: File I/O (Text, Binary files)
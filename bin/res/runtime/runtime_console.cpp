@@ -3,16 +3,103 @@
  */
 
 #include "runtime_console.h"
+#include <exception>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
 #include <fcntl.h>
+#else
+#include <unistd.h>
 #endif
 
 namespace np {
 
-void InitializeConsole() {
+// ============================================================================
+// CONSOLE OUTPUT BUFFER
+// ============================================================================
+
+void ConsoleBuffer::Put(const char16_t* s, size_t n) {
+    // Transcode UTF-16 to UTF-8 directly into the buffer (at most 3 bytes
+    // per code unit; a surrogate pair yields 4 bytes for 2 units)
+    size_t i = 0;
+    while (i < n) {
+        if (CAPACITY - len_ < 4) {
+            Flush();
+        }
+        char32_t cp = s[i++];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i < n &&
+            s[i] >= 0xDC00 && s[i] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (s[i++] - 0xDC00);
+        }
+        if (cp < 0x80) {
+            buf_[len_++] = static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            buf_[len_++] = static_cast<char>(0xC0 | (cp >> 6));
+            buf_[len_++] = static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            buf_[len_++] = static_cast<char>(0xE0 | (cp >> 12));
+            buf_[len_++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            buf_[len_++] = static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            buf_[len_++] = static_cast<char>(0xF0 | (cp >> 18));
+            buf_[len_++] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            buf_[len_++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            buf_[len_++] = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+}
+
+void ConsoleBuffer::PutLarge(const char* s, size_t n) {
+    Flush();
+    if (n >= CAPACITY) {
+        std::fwrite(s, 1, n, stdout);
+        std::fflush(stdout);
+        return;
+    }
+    std::memcpy(buf_, s, n);
+    len_ = n;
+}
+
+void ConsoleBuffer::Flush() {
+    // Anything a C++ passthrough block wrote to std::cout goes out first
+    std::cout.flush();
+    if (len_ > 0) {
+        std::fwrite(buf_, 1, len_, stdout);
+        len_ = 0;
+    }
+    std::fflush(stdout);
+}
+
+void ConsoleBuffer::SetBuffering(ConsoleBuffering mode) {
+    bool tty;
+#ifdef _WIN32
+    tty = _isatty(_fileno(stdout)) != 0;
+#else
+    tty = isatty(fileno(stdout)) != 0;
+#endif
+    lineFlush_ = (mode == ConsoleBuffering::LineOnTTY) && tty;
+}
+
+// ============================================================================
+// CONSOLE INITIALIZATION
+// ============================================================================
+
+namespace {
+    std::terminate_handler prevTerminate = nullptr;
+
+    // An uncaught exception bypasses static destructors; emit what the
+    // program printed before it died.
+    void FlushOnTerminate() {
+        _console.Flush();
+        if (prevTerminate) {
+            prevTerminate();
+        }
+        std::abort();
+    }
+}
+
+void InitializeConsole(ConsoleBuffering mode) {
 #ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
     SetConsoleCP(CP_UTF8);
@@ -27,6 +114,12 @@ void InitializeConsole() {
         }
     }
 #endif
+    // Console output no longer goes through std::cout; decouple the C++
+    // streams from stdio and from each other so ReadLn stays fast too.
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+    _console.SetBuffering(mode);
+    prevTerminate = std::set_terminate(FlushOnTerminate);
 }
 
 } // namespace np
@@ -8,48 +8,177 @@
 #include "runtime_operators_custom.h"
 #include "runtime_string.h"
 #include <iostream>
+#include <sstream>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
 
 namespace np {
 
+// ============================================================================
+// CONSOLE OUTPUT BUFFER
+// ============================================================================
+// Write/WriteLn format straight into one large user-space buffer that is
+// handed to stdout in a single write when it fills, when the program exits
+// (normally, through Halt, or on an uncaught exception), before console
+// input is read, and on an explicit Flush(). No per-line flush happens unless
+// the LineOnTTY policy is selected and stdout is a terminal.
+
+enum class ConsoleBuffering {
+    Full,       // flush only when full, on input, on Flush() and at exit
+    LineOnTTY   // additionally flush at every WriteLn when stdout is a terminal
+};
+
+class ConsoleBuffer {
+public:
+    static constexpr size_t CAPACITY = 64 * 1024;
+
+    ~ConsoleBuffer() { Flush(); }
+
+    void Put(char ch) {
+        if (len_ == CAPACITY) {
+            Flush();
+        }
+        buf_[len_++] = ch;
+    }
+
+    void Put(const char* s, size_t n) {
+        if (n > CAPACITY - len_) {
+            PutLarge(s, n);
+            return;
+        }
+        std::memcpy(buf_ + len_, s, n);
+        len_ += n;
+    }
+
+    void Put(const char16_t* s, size_t n);
+
+    void EndLine() {
+        Put('\n');
+        if (lineFlush_) {
+            Flush();
+        }
+    }
+
+    void Flush();
+    void SetBuffering(ConsoleBuffering mode);
+
+private:
+    void PutLarge(const char* s, size_t n);
+
+    char   buf_[CAPACITY];
+    size_t len_       = 0;
+    bool   lineFlush_ = false;
+};
+
+inline ConsoleBuffer _console;
+
 // ============================================================================
 // CONSOLE INITIALIZATION
 // ============================================================================
 
-void InitializeConsole();
+/**
+ * InitializeConsole - Set up UTF-8 console output and the output buffer policy
+ * @param mode Full buffering (default) or line buffering on a terminal
+ */
+void InitializeConsole(ConsoleBuffering mode = ConsoleBuffering::Full);
+
+/**
+ * Flush - Write any buffered console output to stdout
+ */
+inline void Flush() {
+    _console.Flush();
+}
 
 // ============================================================================
 // I/O FUNCTIONS
 // ============================================================================
 
-template<typename T>
-auto BoolFmt(T&& val) -> decltype(std::forward<T>(val)) {
-    return std::forward<T>(val);
+inline void ConsoleOut(const String& s) {
+    _console.Put(s.Raw(), s.RawSize());
+}
+
+inline void ConsoleOut(const StringView& s) {
+    _console.Put(s.Raw(), s.RawSize());
+}
+
+inline void ConsoleOut(const char* s) {
+    _console.Put(s, std::strlen(s));
+}
+
+inline void ConsoleOut(const std::string& s) {
+    _console.Put(s.data(), s.size());
+}
+
+inline void ConsoleOut(std::string_view s) {
+    _console.Put(s.data(), s.size());
+}
+
+inline void ConsoleOut(char ch) {
+    _console.Put(ch);
+}
+
+inline void ConsoleOut(char16_t ch) {
+    if (ch < 128) {
+        _console.Put(static_cast<char>(ch));
+    } else {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<int>(ch));
+        _console.Put(buf, 6);
+    }
 }
-inline const char* BoolFmt(bool val) {
-    return val ? "TRUE" : "FALSE";
+
+inline void ConsoleOut(bool val) {
+    if (val) {
+        _console.Put("TRUE", 4);
+    } else {
+        _console.Put("FALSE", 5);
+    }
+}
+
+template<typename T>
+void ConsoleOut(const T& val) {
+    if constexpr (std::is_integral_v<T>) {
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), val);
+        _console.Put(buf, static_cast<size_t>(res.ptr - buf));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        // Same text as the default std::ostream formatting (%g, 6 digits)
+        char buf[64];
+        auto res = std::to_chars(buf, buf + sizeof(buf), val, std::chars_format::general, 6);
+        _console.Put(buf, static_cast<size_t>(res.ptr - buf));
+    } else {
+        std::ostringstream os;
+        os << val;
+        ConsoleOut(os.str());
+    }
 }
 
 template<typename... Args>
 void Write(Args&&... args) {
-    (std::cout << ... << BoolFmt(std::forward<Args>(args)));
+    (ConsoleOut(args), ...);
 }
 
 template<typename... Args>
 void WriteLn(Args&&... args) {
-    (std::cout << ... << BoolFmt(std::forward<Args>(args)));
-    std::cout << std::endl;
+    (ConsoleOut(args), ...);
+    _console.EndLine();
 }
 
 inline void WriteLn() {
-    std::cout << std::endl;
+    _console.EndLine();
 }
 
 template<typename T>
 void ReadLn(T& value) {
+    _console.Flush();
     std::cin >> value;
 }
 
 inline void ReadLn(String& value) {
+    _console.Flush();
     std::string line;
     std::getline(std::cin, line);
     value = String(line);
@@ -1,5 +1,5 @@
 /**
- * NitroPascal Runtime - Containers (DynArray, Set)
+ * NitroPascal Runtime - Containers (DynArray, Set, Dictionary)
  */
 
 #pragma once
@@ -7,68 +7,167 @@
 #include "runtime_types.h"
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <new>
 #include <unordered_set>
 #include <stdexcept>
+#include <array>
+#include <bit>
+#include <type_traits>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace np {
 
 // ============================================================================
 // DYNAMIC ARRAY
 // ============================================================================
+// DynArray<T> follows the Delphi layout: one heap block holding a header
+// (reference count, length, capacity) followed by the elements inline, and
+// the handle is a single pointer to the first element. An empty array is a
+// null handle and owns no memory.
+//
+// As in Delphi, dynamic arrays are reference types: assignment shares the
+// block and element writes are seen through every reference. Only
+// SetLength and Copy produce a unique block, so element access is a plain
+// indexed load/store with no per-access ownership check. Bounds checking is
+// a code generation choice ({$R+}/{$R-}), see np::At below.
 
 template<typename T>
 class DynArray {
 private:
-    std::shared_ptr<std::vector<T>> data_;
-    
-    void EnsureUnique() {
-        if (data_ && data_.use_count() > 1) {
-            data_ = std::make_shared<std::vector<T>>(*data_);
+    struct Header {
+        std::atomic<Integer> refCount;
+        Integer              length;
+        Integer              capacity;
+    };
+
+    static constexpr std::size_t Align =
+        alignof(T) > alignof(Header) ? alignof(T) : alignof(Header);
+    static constexpr std::size_t HeaderSize =
+        (sizeof(Header) + Align - 1) / Align * Align;
+
+    T* data_ = nullptr;
+
+    Header* Head() const {
+        return reinterpret_cast<Header*>(reinterpret_cast<char*>(data_) - HeaderSize);
+    }
+
+    // Allocates a block with room for ACapacity elements; length is 0.
+    static T* Allocate(Integer ACapacity) {
+        void* block = ::operator new(HeaderSize + sizeof(T) * static_cast<std::size_t>(ACapacity),
+                                     std::align_val_t(Align));
+        Header* head = ::new (block) Header{{1}, 0, ACapacity};
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(head) + HeaderSize);
+    }
+
+    // Destroys the elements and frees the block of AData.
+    static void Free(T* AData) {
+        Header* head = reinterpret_cast<Header*>(reinterpret_cast<char*>(AData) - HeaderSize);
+        std::destroy_n(AData, head->length);
+        head->~Header();
+        ::operator delete(head, std::align_val_t(Align));
+    }
+
+    void Release() {
+        if (data_ && Head()->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Free(data_);
         }
+        data_ = nullptr;
     }
-    
-public:
-    DynArray() : data_(std::make_shared<std::vector<T>>()) {}
-    DynArray(const DynArray& other) : data_(other.data_) {}
-    
-    DynArray& operator=(const DynArray& other) {
-        if (this != &other) {
-            data_ = other.data_;
+
+    // Builds a new block of ANewLength elements: the first ACount come from
+    // ASource (moved when AMove is set), the rest are value-initialised.
+    static T* Rebuild(T* ASource, Integer ACount, Integer ANewLength,
+                      Integer ACapacity, bool AMove) {
+        T* result = Allocate(ACapacity);
+        try {
+            if (AMove) {
+                std::uninitialized_move_n(ASource, ACount, result);
+            } else {
+                std::uninitialized_copy_n(ASource, ACount, result);
+            }
+            try {
+                std::uninitialized_value_construct_n(result + ACount, ANewLength - ACount);
+            } catch (...) {
+                std::destroy_n(result, ACount);
+                throw;
+            }
+        } catch (...) {
+            ::operator delete(reinterpret_cast<char*>(result) - HeaderSize, std::align_val_t(Align));
+            throw;
         }
-        return *this;
+        reinterpret_cast<Header*>(reinterpret_cast<char*>(result) - HeaderSize)->length = ANewLength;
+        return result;
     }
-    
-    const T& operator[](Integer index) const {
-        if (!data_ || index < 0 || index >= static_cast<Integer>(data_->size())) {
-            throw _Exception{EXC_ACCESS_VIOLATION, L"Array index out of range"};
+
+public:
+    DynArray() = default;
+
+    DynArray(const DynArray& other) : data_(other.data_) {
+        if (data_) {
+            Head()->refCount.fetch_add(1, std::memory_order_relaxed);
         }
-        return (*data_)[index];
     }
-    
-    T& operator[](Integer index) {
-        EnsureUnique();
-        if (!data_ || index < 0 || index >= static_cast<Integer>(data_->size())) {
-            throw _Exception{EXC_ACCESS_VIOLATION, L"Array index out of range"};
+
+    DynArray(DynArray&& other) noexcept : data_(other.data_) {
+        other.data_ = nullptr;
+    }
+
+    ~DynArray() {
+        Release();
+    }
+
+    DynArray& operator=(const DynArray& other) {
+        if (data_ != other.data_) {
+            DynArray copy(other);
+            std::swap(data_, copy.data_);
         }
-        return (*data_)[index];
+        return *this;
     }
-    
+
+    DynArray& operator=(DynArray&& other) noexcept {
+        std::swap(data_, other.data_);
+        return *this;
+    }
+
+    // Raw element access ({$R-}); the code generator emits np::At() instead
+    // when range checking is on.
+    const T& operator[](Integer index) const { return data_[index]; }
+    T& operator[](Integer index) { return data_[index]; }
+
     Integer Length() const {
-        return data_ ? static_cast<Integer>(data_->size()) : 0;
+        return data_ ? Head()->length : 0;
     }
-    
+
     Integer Low() const {
         return 0;
     }
-    
+
     Integer High() const {
-        Integer len = Length();
-        return len > 0 ? len - 1 : -1;
+        return Length() - 1;
     }
-    
+
+    /**
+     * Data - Pointer to the first element (nullptr when empty), for kernels
+     * that walk the array without per-element bounds checks
+     */
+    T* Data() { return data_; }
+    const T* Data() const { return data_; }
+
+    T* begin() { return data_; }
+    T* end() { return data_ + Length(); }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + Length(); }
+
     template<typename U>
     friend void SetLength(DynArray<U>& arr, Integer newLength);
-    
+
     template<typename U>
     friend DynArray<U> Copy(const DynArray<U>& arr);
 };
@@ -77,23 +176,61 @@ public:
 // DYNAMIC ARRAY FUNCTIONS
 // ============================================================================
 
+/**
+ * SetLength - Resize in place when the block is unique and large enough;
+ * otherwise move (unique) or copy (shared) into a new block. As in Delphi,
+ * a shared array is detached, and new elements are zero/default initialised.
+ */
 template<typename T>
 void SetLength(DynArray<T>& arr, Integer newLength) {
+    using Array = DynArray<T>;
     if (newLength < 0) {
         throw _Exception{EXC_SOFTWARE, L"SetLength: negative length"};
     }
-    
-    arr.EnsureUnique();
-    if (arr.data_) {
-        arr.data_->resize(static_cast<size_t>(newLength));
+    if (newLength == 0) {
+        arr.Release();
+        return;
+    }
+    if (!arr.data_) {
+        arr.data_ = Array::Rebuild(nullptr, 0, newLength, newLength, false);
+        return;
+    }
+    auto* head = arr.Head();
+    Integer oldLength = head->length;
+    bool unique = head->refCount.load(std::memory_order_acquire) == 1;
+    if (unique && newLength <= head->capacity) {
+        if (newLength > oldLength) {
+            std::uninitialized_value_construct_n(arr.data_ + oldLength, newLength - oldLength);
+        } else {
+            std::destroy_n(arr.data_ + newLength, oldLength - newLength);
+        }
+        head->length = newLength;
+        return;
+    }
+    Integer keep = oldLength < newLength ? oldLength : newLength;
+    if (unique) {
+        // Growing a unique array: reserve 50% headroom so SetLength(A, Length(A) + 1)
+        // in a loop stays amortised O(1).
+        Int64 grown = static_cast<Int64>(head->capacity) + head->capacity / 2;
+        Integer capacity = grown > newLength && grown <= INT32_MAX
+            ? static_cast<Integer>(grown) : newLength;
+        T* data = Array::Rebuild(arr.data_, keep, newLength, capacity,
+                                 std::is_nothrow_move_constructible_v<T>);
+        Array::Free(arr.data_);
+        arr.data_ = data;
+    } else {
+        T* data = Array::Rebuild(arr.data_, keep, newLength, newLength, false);
+        arr.Release();
+        arr.data_ = data;
     }
 }
 
 template<typename T>
 DynArray<T> Copy(const DynArray<T>& arr) {
     DynArray<T> result;
-    if (arr.data_) {
-        result.data_ = std::make_shared<std::vector<T>>(*arr.data_);
+    Integer length = arr.Length();
+    if (length > 0) {
+        result.data_ = DynArray<T>::Rebuild(arr.data_, length, length, length, false);
     }
     return result;
 }
@@ -123,30 +260,302 @@ Integer High(const std::array<T, N>& arr) {
     return static_cast<Integer>(N) - 1;
 }
 
+// ============================================================================
+// RANGE-CHECKED INDEXING ({$R+})
+// ============================================================================
+// With range checking on, the code generator emits np::At(a, i) for every
+// a[i]; with it off it emits a[i], which is raw indexing for every array
+// type. Static array indices arrive already rebased to 0.
+
+template<typename T>
+inline T& At(DynArray<T>& arr, Integer index) {
+    if (static_cast<Cardinal>(index) >= static_cast<Cardinal>(arr.Length())) {
+        RangeError();
+    }
+    return arr[index];
+}
+
+template<typename T>
+inline const T& At(const DynArray<T>& arr, Integer index) {
+    if (static_cast<Cardinal>(index) >= static_cast<Cardinal>(arr.Length())) {
+        RangeError();
+    }
+    return arr[index];
+}
+
+template<typename T, std::size_t N>
+inline T& At(std::array<T, N>& arr, Integer index) {
+    if (static_cast<std::size_t>(static_cast<Cardinal>(index)) >= N) {
+        RangeError();
+    }
+    return arr[index];
+}
+
+template<typename T, std::size_t N>
+inline const T& At(const std::array<T, N>& arr, Integer index) {
+    if (static_cast<std::size_t>(static_cast<Cardinal>(index)) >= N) {
+        RangeError();
+    }
+    return arr[index];
+}
+
+// Pointers carry no length; indexing through them is never checked.
+template<typename T>
+inline T& At(T* ptr, Integer index) {
+    return ptr[index];
+}
+
 // ============================================================================
 // SET
 // ============================================================================
+// Set<T, Lo, Hi> picks its representation at compile time:
+//   - ordinal element types with at most 256 values (Byte, ShortInt, Boolean,
+//     Char, enums) and explicit subranges (set of 0..63, set of 'a'..'z') use
+//     a fixed-size bitset; membership is a bit test and the set operators
+//     work a 64-bit word at a time.
+//   - every other element type (Integer, Int64, String, ...) falls back to a
+//     hash set; String elements hash through the hash cached in their block.
+// As in Delphi, a set of Char is reduced to the low 256 code points.
+
+template<Integer L, Integer H>
+struct _SetBounds {
+    static constexpr bool    Bitset = true;
+    static constexpr Integer Low    = L;
+    static constexpr Integer High   = H;
+};
+
+template<typename T, typename = void>
+struct SetTraits {
+    static constexpr bool    Bitset = false;
+    static constexpr Integer Low    = 0;
+    static constexpr Integer High   = -1;
+};
+
+template<> struct SetTraits<Byte>     : _SetBounds<0, 255> {};
+template<> struct SetTraits<ShortInt> : _SetBounds<-128, 127> {};
+template<> struct SetTraits<Boolean>  : _SetBounds<0, 1> {};
+template<> struct SetTraits<Char>     : _SetBounds<0, 255> {};
 
 template<typename T>
-class Set {
+struct SetTraits<T, std::enable_if_t<std::is_enum_v<T>>> : _SetBounds<0, 255> {};
+
+template<typename T,
+         Integer Lo = SetTraits<T>::Low,
+         Integer Hi = SetTraits<T>::High,
+         bool Bits = (Hi >= Lo)>
+class Set;
+
+// ----------------------------------------------------------------------------
+// Bitset backend
+// ----------------------------------------------------------------------------
+
+template<typename T, Integer Lo, Integer Hi>
+class Set<T, Lo, Hi, true> {
+    static_assert(Hi - Lo < 256, "Pascal sets hold at most 256 elements");
+
+public:
+    static constexpr bool    IsBitset = true;
+    static constexpr Integer Count    = Hi - Lo + 1;
+    static constexpr Integer Words    = (Count + 63) / 64;
+
+private:
+    uint64_t words_[Words] = {};
+
+    template<typename, Integer, Integer, bool> friend class Set;
+
+    // Ordinal -> bit index, or -1 when the value is outside Lo..Hi
+    template<typename E>
+    static constexpr Integer Bit(E elem) {
+        const Int64 ord = static_cast<Int64>(elem) - Lo;
+        return (ord >= 0 && ord < Count) ? static_cast<Integer>(ord) : -1;
+    }
+
+public:
+    constexpr Set() = default;
+
+    constexpr Set(std::initializer_list<T> init) {
+        for (const T& elem : init) {
+            Include(elem);
+        }
+    }
+
+    // Conversion from any other set (literals, other element types/bounds)
+    template<typename U, Integer L2, Integer H2, bool B2>
+    constexpr Set(const Set<U, L2, H2, B2>& other) {
+        if constexpr (B2 && L2 == Lo && H2 == Hi) {
+            for (Integer w = 0; w < Words; w++) {
+                words_[w] = other.words_[w];
+            }
+        } else {
+            other.ForEach([this](U elem) { Include(elem); });
+        }
+    }
+
+    static constexpr Set FromOrdinals(std::initializer_list<Int64> ordinals) {
+        Set result;
+        for (Int64 ord : ordinals) {
+            result.Include(ord);
+        }
+        return result;
+    }
+
+    template<typename E>
+    constexpr void Include(E elem) {
+        const Integer bit = Bit(elem);
+        if (bit >= 0) {
+            words_[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+    }
+
+    template<typename E>
+    constexpr void Exclude(E elem) {
+        const Integer bit = Bit(elem);
+        if (bit >= 0) {
+            words_[bit >> 6] &= ~(uint64_t(1) << (bit & 63));
+        }
+    }
+
+    template<typename E>
+    constexpr bool Contains(E elem) const {
+        const Integer bit = Bit(elem);
+        return bit >= 0 && ((words_[bit >> 6] >> (bit & 63)) & 1) != 0;
+    }
+
+    // Adds every element of lo..hi (set constructor ranges such as ['a'..'z'])
+    template<typename E>
+    constexpr Set& IncludeRange(E lo, E hi) {
+        for (Int64 ord = static_cast<Int64>(lo); ord <= static_cast<Int64>(hi); ord++) {
+            Include(ord);
+        }
+        return *this;
+    }
+
+    template<typename Func>
+    constexpr void ForEach(Func&& fn) const {
+        for (Integer w = 0; w < Words; w++) {
+            uint64_t bits = words_[w];
+            while (bits != 0) {
+                const Integer bit = w * 64 + std::countr_zero(bits);
+                fn(static_cast<T>(bit + Lo));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    constexpr Set operator+(const Set& other) const {
+        Set result;
+        for (Integer w = 0; w < Words; w++) {
+            result.words_[w] = words_[w] | other.words_[w];
+        }
+        return result;
+    }
+
+    constexpr Set operator-(const Set& other) const {
+        Set result;
+        for (Integer w = 0; w < Words; w++) {
+            result.words_[w] = words_[w] & ~other.words_[w];
+        }
+        return result;
+    }
+
+    constexpr Set operator*(const Set& other) const {
+        Set result;
+        for (Integer w = 0; w < Words; w++) {
+            result.words_[w] = words_[w] & other.words_[w];
+        }
+        return result;
+    }
+
+    constexpr bool operator==(const Set& other) const {
+        uint64_t diff = 0;
+        for (Integer w = 0; w < Words; w++) {
+            diff |= words_[w] ^ other.words_[w];
+        }
+        return diff == 0;
+    }
+
+    constexpr bool operator!=(const Set& other) const {
+        return !(*this == other);
+    }
+
+    constexpr bool operator<=(const Set& other) const {
+        uint64_t extra = 0;
+        for (Integer w = 0; w < Words; w++) {
+            extra |= words_[w] & ~other.words_[w];
+        }
+        return extra == 0;
+    }
+
+    constexpr bool operator>=(const Set& other) const {
+        return other <= *this;
+    }
+
+    constexpr Integer Size() const {
+        Integer count = 0;
+        for (Integer w = 0; w < Words; w++) {
+            count += std::popcount(words_[w]);
+        }
+        return count;
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Hash backend (element types too wide for a bitset)
+// ----------------------------------------------------------------------------
+
+template<typename T, Integer Lo, Integer Hi>
+class Set<T, Lo, Hi, false> {
 private:
     std::unordered_set<T> data_;
     
 public:
+    static constexpr bool IsBitset = false;
+
     Set() = default;
     Set(std::initializer_list<T> init) : data_(init) {}
+
+    // Conversion from any other set (literals, other element types/bounds)
+    template<typename U, Integer L2, Integer H2, bool B2>
+    Set(const Set<U, L2, H2, B2>& other) {
+        other.ForEach([this](U elem) { Include(static_cast<T>(elem)); });
+    }
+
+    static Set FromOrdinals(std::initializer_list<Int64> ordinals) {
+        Set result;
+        for (Int64 ord : ordinals) {
+            result.Include(static_cast<T>(ord));
+        }
+        return result;
+    }
     
-    void Include(T elem) {
+    void Include(const T& elem) {
         data_.insert(elem);
     }
     
-    void Exclude(T elem) {
+    void Exclude(const T& elem) {
         data_.erase(elem);
     }
     
-    bool Contains(T elem) const {
+    bool Contains(const T& elem) const {
         return data_.count(elem) > 0;
     }
+
+    Set& IncludeRange(T lo, T hi) {
+        for (T elem = lo; elem <= hi; elem++) {
+            data_.insert(elem);
+            if (elem == hi) {
+                break;
+            }
+        }
+        return *this;
+    }
+
+    template<typename Func>
+    void ForEach(Func&& fn) const {
+        for (const auto& elem : data_) {
+            fn(elem);
+        }
+    }
     
     Set operator+(const Set& other) const {
         Set result = *this;
@@ -200,23 +609,180 @@ public:
     }
 };
 
+// ----------------------------------------------------------------------------
+// Set literals
+// ----------------------------------------------------------------------------
+
+/**
+ * SetLit - Set constructor whose elements are all constants, e.g.
+ * ['a'..'c', '_'] -> SetLit<Char, 97, 98, 99, 95>. A literal has no set
+ * type of its own: it becomes the type of the set it meets (the other
+ * operand, the variable it is assigned to, the parameter it is passed to),
+ * built once per type. For bitset types that is a compile-time constant,
+ * so `c in [...]` reduces to a single bit test.
+ */
+template<typename T, Int64... Ordinals>
+struct _SetLiteral {
+    // Bitset types: the literal as a compile-time constant
+    template<typename S>
+    static constexpr S Constant = S::FromOrdinals({Ordinals...});
+
+    template<typename S>
+    static const S& As() {
+        if constexpr (S::IsBitset) {
+            return Constant<S>;
+        } else {
+            static const S value = S::FromOrdinals({Ordinals...});
+            return value;
+        }
+    }
+
+    template<typename U, Integer Lo, Integer Hi, bool B>
+    operator Set<U, Lo, Hi, B>() const {
+        return As<Set<U, Lo, Hi, B>>();
+    }
+};
+
+template<typename T, Int64... Ordinals>
+inline constexpr _SetLiteral<T, Ordinals...> SetLit{};
+
+// ----------------------------------------------------------------------------
+// Mixed set operands
+// ----------------------------------------------------------------------------
+// Operators on two different set types (a literal and a set, a subrange set
+// and a full one, a bitset and a hash set) convert both sides to one type
+// that keeps every member: a hash set over a bitset, else the bitset whose
+// range covers both sides, else a bitset spanning both ranges. A literal
+// thus takes the type of the set it meets unless it has members outside it.
+
+template<typename S>
+struct _SetOperand : std::false_type {};
+
+template<typename T, Integer Lo, Integer Hi, bool B>
+struct _SetOperand<Set<T, Lo, Hi, B>> : std::true_type {
+    using Element = T;
+    using SetType = Set<T, Lo, Hi, B>;
+    static constexpr bool    Literal = false;
+    static constexpr bool    Bitset  = B;
+    static constexpr Integer Low     = Lo;
+    static constexpr Integer High    = Hi;
+};
+
+// A literal spans only its own members; [] spans nothing
+template<typename T, Int64... Ordinals>
+struct _SetOperand<_SetLiteral<T, Ordinals...>> : std::true_type {
+    using Element = T;
+    using SetType = Set<T, 0, 255>;
+    static constexpr bool    Literal = true;
+    static constexpr bool    Bitset  = true;
+    static constexpr Integer Low     = std::min({Int64(INT32_MAX), Ordinals...});
+    static constexpr Integer High    = std::max({Int64(INT32_MIN), Ordinals...});
+};
+
+template<typename A, typename B>
+struct _SetCommon {
+    using OA = _SetOperand<A>;
+    using OB = _SetOperand<B>;
+    using Element = std::conditional_t<OA::Literal, typename OB::Element,
+                                       typename OA::Element>;
+    static constexpr Integer Low  = std::min(OA::Low, OB::Low);
+    static constexpr Integer High = std::max(OA::High, OB::High);
+
+    // Keep a set type that already covers both sides
+    using Type =
+        std::conditional_t<OA::Literal && OB::Literal, typename OA::SetType,
+        std::conditional_t<!OA::Bitset, A,
+        std::conditional_t<!OB::Bitset, B,
+        std::conditional_t<!OA::Literal && OA::Low == Low && OA::High == High, A,
+        std::conditional_t<!OB::Literal && OB::Low == Low && OB::High == High, B,
+        std::conditional_t<(High - Low < 256),
+            Set<Element, Low, High>,
+            Set<Element, 0, -1, false>>>>>>>;
+};
+
+template<typename A, typename B>
+concept _MixedSets = _SetOperand<A>::value && _SetOperand<B>::value &&
+                     (!std::is_same_v<A, B> || _SetOperand<A>::Literal);
+
+// Operand as the common set type; no copy when it already has that type
+template<typename S, typename A>
+decltype(auto) _AsSet(const A& operand) {
+    if constexpr (std::is_same_v<S, A>) {
+        return (operand);
+    } else if constexpr (_SetOperand<A>::Literal) {
+        return A::template As<S>();
+    } else {
+        return S(operand);
+    }
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+auto operator+(const A& a, const B& b) {
+    using S = typename _SetCommon<A, B>::Type;
+    return _AsSet<S>(a) + _AsSet<S>(b);
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+auto operator-(const A& a, const B& b) {
+    using S = typename _SetCommon<A, B>::Type;
+    return _AsSet<S>(a) - _AsSet<S>(b);
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+auto operator*(const A& a, const B& b) {
+    using S = typename _SetCommon<A, B>::Type;
+    return _AsSet<S>(a) * _AsSet<S>(b);
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+bool operator==(const A& a, const B& b) {
+    using S = typename _SetCommon<A, B>::Type;
+    return _AsSet<S>(a) == _AsSet<S>(b);
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+bool operator!=(const A& a, const B& b) {
+    return !(a == b);
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+bool operator<=(const A& a, const B& b) {
+    using S = typename _SetCommon<A, B>::Type;
+    return _AsSet<S>(a) <= _AsSet<S>(b);
+}
+
+template<typename A, typename B> requires _MixedSets<A, B>
+bool operator>=(const A& a, const B& b) {
+    return b <= a;
+}
+
 // ============================================================================
 // SET FUNCTIONS
 // ============================================================================
 
-template<typename T>
-void Include(Set<T>& set, T elem) {
+template<typename T, Integer Lo, Integer Hi, bool B>
+void Include(Set<T, Lo, Hi, B>& set, std::type_identity_t<T> elem) {
     set.Include(elem);
 }
 
-template<typename T>
-void Exclude(Set<T>& set, T elem) {
+template<typename T, Integer Lo, Integer Hi, bool B>
+void Exclude(Set<T, Lo, Hi, B>& set, std::type_identity_t<T> elem) {
     set.Exclude(elem);
 }
 
-template<typename T>
-bool In(T elem, const Set<T>& set) {
-    return set.Contains(elem);
+template<typename E, typename T, Integer Lo, Integer Hi, bool B>
+constexpr bool In(const E& elem, const Set<T, Lo, Hi, B>& set) {
+    if constexpr (B) {
+        return set.Contains(elem);
+    } else {
+        return set.Contains(static_cast<T>(elem));
+    }
+}
+
+// A literal on its own takes the full 0..255 bitset type
+template<typename E, typename T, Int64... Ordinals>
+constexpr bool In(const E& elem, const _SetLiteral<T, Ordinals...>&) {
+    return _SetLiteral<T, Ordinals...>::template Constant<Set<T, 0, 255>>.Contains(elem);
 }
 
 template<typename T>
@@ -224,6 +790,13 @@ Set<T> MakeSet(std::initializer_list<T> init) {
     return Set<T>(init);
 }
 
+template<typename T>
+Set<T> MakeSetRange(T lo, T hi) {
+    Set<T> result;
+    result.IncludeRange(lo, hi);
+    return result;
+}
+
 template<typename T>
 inline DynArray<T> Copy(const DynArray<T>& AArray, const Integer AIndex, const Integer ACount) {
     if (AIndex < 0 || ACount < 0 || AIndex >= AArray.Length()) {
@@ -241,4 +814,378 @@ inline DynArray<T> Copy(const DynArray<T>& AArray, const Integer AIndex, const I
     return result;
 }
 
+// ============================================================================
+// DICTIONARY
+// ============================================================================
+// Dictionary<K, V> (TDictionary<K, V>) keeps its pairs in a dense array in
+// insertion order and indexes them with an open-addressing table laid out
+// like a Swiss table: one control byte per slot, holding 7 bits of the key's
+// hash or an empty/deleted marker, next to a slot array of indices into the
+// pairs. A lookup hashes the key once and matches a group of 16 control
+// bytes against those 7 bits with one SSE2 compare; only the pairs whose
+// byte matches are compared by key, and an empty byte in the group ends the
+// probe. The table is rebuilt before it gets more than 7/8 full.
+//
+// Iteration (range-for, Keys, Values) follows insertion order. Remove leaves
+// a hole in the pair array that iteration skips; holes are squeezed out when
+// the table is rebuilt. Unlike Delphi's class, a Dictionary is a value:
+// assignment copies it and it needs no Create/Free.
+
+// Helper: bit i of each mask is set when control byte i of the group matches
+struct _DictGroup {
+    static constexpr std::size_t Width = 16;
+
+#if defined(__SSE2__)
+    static uint32_t Match(const int8_t* ctrl, int8_t tag) {
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag))));
+    }
+
+    // Empty and deleted are the only control bytes with the sign bit set
+    static uint32_t MatchFree(const int8_t* ctrl) {
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))));
+    }
+#else
+    static uint32_t Match(const int8_t* ctrl, int8_t tag) {
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < Width; i++) {
+            mask |= static_cast<uint32_t>(ctrl[i] == tag) << i;
+        }
+        return mask;
+    }
+
+    static uint32_t MatchFree(const int8_t* ctrl) {
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < Width; i++) {
+            mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+        }
+        return mask;
+    }
+#endif
+};
+
+template<typename K, typename V>
+class Dictionary {
+public:
+    struct Pair {
+        K Key;
+        V Value;
+    };
+
+private:
+    static constexpr int8_t      CtrlEmpty   = -128;
+    static constexpr int8_t      CtrlDeleted = -2;
+    static constexpr std::size_t NoSlot      = ~std::size_t(0);
+
+    struct Entry {
+        uint64_t hash;     // 0 marks a removed pair
+        Pair     pair;
+    };
+
+    std::vector<Entry>    entries_;
+    std::vector<int8_t>   ctrl_;        // capacity + 16 bytes; the tail mirrors slots 0..15
+    std::vector<uint32_t> slots_;       // index into entries_ of each full slot
+    std::size_t           mask_ = 0;    // capacity - 1; capacity is a power of two >= 16
+    Integer               count_ = 0;
+    Integer               growthLeft_ = 0;  // empty slots that may fill before a rebuild
+
+    // std::hash of an integer is the identity: fold a 64x64->128 multiply so
+    // every key bit reaches both the probe position and the 7-bit tag.
+    static uint64_t HashOf(const K& key) {
+        uint64_t h = static_cast<uint64_t>(std::hash<K>{}(key));
+#if defined(__SIZEOF_INT128__)
+        __uint128_t product = static_cast<__uint128_t>(h) * 0x9E3779B97F4A7C15ull;
+        h = static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+        h = (h ^ (h >> 32)) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+#endif
+        return h ? h : 1;
+    }
+
+    static int8_t TagOf(uint64_t hash) {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    void SetCtrl(std::size_t slot, int8_t value) {
+        ctrl_[slot] = value;
+        if (slot < _DictGroup::Width) {
+            ctrl_[mask_ + 1 + slot] = value;
+        }
+    }
+
+    // Slot holding key, or NoSlot. Groups are probed triangularly
+    // (+16, +32, +48, ...), which visits every group of the table.
+    std::size_t FindSlot(const K& key, uint64_t hash) const {
+        if (count_ == 0) {
+            return NoSlot;
+        }
+        const int8_t tag = TagOf(hash);
+        std::size_t pos = (hash >> 7) & mask_;
+        for (std::size_t step = _DictGroup::Width;; step += _DictGroup::Width) {
+            const int8_t* group = ctrl_.data() + pos;
+            for (uint32_t m = _DictGroup::Match(group, tag); m != 0; m &= m - 1) {
+                std::size_t slot = (pos + static_cast<std::size_t>(std::countr_zero(m))) & mask_;
+                const Entry& entry = entries_[slots_[slot]];
+                if (entry.hash == hash && entry.pair.Key == key) {
+                    return slot;
+                }
+            }
+            if (_DictGroup::Match(group, CtrlEmpty) != 0) {
+                return NoSlot;
+            }
+            pos = (pos + step) & mask_;
+        }
+    }
+
+    // First empty or deleted slot on the probe sequence of hash
+    std::size_t FindFreeSlot(uint64_t hash) const {
+        std::size_t pos = (hash >> 7) & mask_;
+        for (std::size_t step = _DictGroup::Width;; step += _DictGroup::Width) {
+            uint32_t m = _DictGroup::MatchFree(ctrl_.data() + pos);
+            if (m != 0) {
+                return (pos + static_cast<std::size_t>(std::countr_zero(m))) & mask_;
+            }
+            pos = (pos + step) & mask_;
+        }
+    }
+
+    // Drops the holes left by Remove and re-indexes every pair into a table
+    // of ACapacity slots.
+    void Rebuild(std::size_t ACapacity) {
+        if (static_cast<std::size_t>(count_) != entries_.size()) {
+            std::erase_if(entries_, [](const Entry& entry) { return entry.hash == 0; });
+        }
+        ctrl_.assign(ACapacity + _DictGroup::Width, CtrlEmpty);
+        slots_.resize(ACapacity);
+        mask_ = ACapacity - 1;
+        for (std::size_t i = 0; i < entries_.size(); i++) {
+            std::size_t slot = FindFreeSlot(entries_[i].hash);
+            slots_[slot] = static_cast<uint32_t>(i);
+            SetCtrl(slot, TagOf(entries_[i].hash));
+        }
+        growthLeft_ = static_cast<Integer>(ACapacity - ACapacity / 8) - count_;
+    }
+
+    // Appends a pair whose key is known to be absent
+    template<typename KArg, typename VArg>
+    void Insert(uint64_t hash, KArg&& key, VArg&& value) {
+        std::size_t slot = mask_ ? FindFreeSlot(hash) : NoSlot;
+        if (slot == NoSlot || (growthLeft_ == 0 && ctrl_[slot] == CtrlEmpty)) {
+            // Grow when at least 7/16 full; otherwise most used slots are
+            // deleted ones and a rebuild at the same size reclaims them.
+            std::size_t capacity = mask_ + 1;
+            if (mask_ == 0) {
+                capacity = _DictGroup::Width;
+            } else if (static_cast<std::size_t>(count_) >= capacity * 7 / 16) {
+                capacity *= 2;
+            }
+            Rebuild(capacity);
+            slot = FindFreeSlot(hash);
+        }
+        entries_.push_back(Entry{hash, Pair{std::forward<KArg>(key), std::forward<VArg>(value)}});
+        if (ctrl_[slot] == CtrlEmpty) {
+            growthLeft_--;
+        }
+        slots_[slot] = static_cast<uint32_t>(entries_.size() - 1);
+        SetCtrl(slot, TagOf(hash));
+        count_++;
+    }
+
+    [[noreturn]] static void NotFound() {
+        throw _Exception{EXC_SOFTWARE, L"Item not found"};
+    }
+
+    template<typename E, typename P>
+    class Iterator {
+    private:
+        E* at_;
+        E* end_;
+
+        void Skip() {
+            while (at_ != end_ && at_->hash == 0) {
+                ++at_;
+            }
+        }
+
+    public:
+        Iterator(E* at, E* end) : at_(at), end_(end) { Skip(); }
+        P& operator*() const { return at_->pair; }
+        P* operator->() const { return &at_->pair; }
+        Iterator& operator++() { ++at_; Skip(); return *this; }
+        bool operator==(const Iterator& other) const { return at_ == other.at_; }
+        bool operator!=(const Iterator& other) const { return at_ != other.at_; }
+    };
+
+public:
+    Dictionary() = default;
+    Dictionary(const Dictionary&) = default;
+    Dictionary& operator=(const Dictionary&) = default;
+
+    Dictionary(Dictionary&& other) noexcept
+        : entries_(std::move(other.entries_)), ctrl_(std::move(other.ctrl_)),
+          slots_(std::move(other.slots_)), mask_(std::exchange(other.mask_, 0)),
+          count_(std::exchange(other.count_, 0)),
+          growthLeft_(std::exchange(other.growthLeft_, 0)) {}
+
+    Dictionary& operator=(Dictionary&& other) noexcept {
+        entries_.swap(other.entries_);
+        ctrl_.swap(other.ctrl_);
+        slots_.swap(other.slots_);
+        std::swap(mask_, other.mask_);
+        std::swap(count_, other.count_);
+        std::swap(growthLeft_, other.growthLeft_);
+        return *this;
+    }
+
+    /** Add - Add a pair; raises "Duplicates not allowed" when key is present */
+    void Add(const K& key, const V& value) {
+        uint64_t hash = HashOf(key);
+        if (FindSlot(key, hash) != NoSlot) {
+            throw _Exception{EXC_SOFTWARE, L"Duplicates not allowed"};
+        }
+        Insert(hash, key, value);
+    }
+
+    /** TryAdd - Add a pair unless key is present; true when it was added */
+    bool TryAdd(const K& key, const V& value) {
+        uint64_t hash = HashOf(key);
+        if (FindSlot(key, hash) != NoSlot) {
+            return false;
+        }
+        Insert(hash, key, value);
+        return true;
+    }
+
+    /** AddOrSetValue - Add a pair, or replace the value of an existing key */
+    void AddOrSetValue(const K& key, const V& value) {
+        uint64_t hash = HashOf(key);
+        std::size_t slot = FindSlot(key, hash);
+        if (slot != NoSlot) {
+            entries_[slots_[slot]].pair.Value = value;
+        } else {
+            Insert(hash, key, value);
+        }
+    }
+
+    /** TryGetValue - Fetch the value of key; value is Default(V) when absent */
+    bool TryGetValue(const K& key, V& value) const {
+        std::size_t slot = FindSlot(key, HashOf(key));
+        if (slot == NoSlot) {
+            value = V{};
+            return false;
+        }
+        value = entries_[slots_[slot]].pair.Value;
+        return true;
+    }
+
+    bool ContainsKey(const K& key) const {
+        return FindSlot(key, HashOf(key)) != NoSlot;
+    }
+
+    /** ContainsValue - Linear scan over the values */
+    bool ContainsValue(const V& value) const {
+        for (const Entry& entry : entries_) {
+            if (entry.hash != 0 && entry.pair.Value == value) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Remove - Remove key and its value; does nothing when key is absent */
+    void Remove(const K& key) {
+        std::size_t slot = FindSlot(key, HashOf(key));
+        if (slot == NoSlot) {
+            return;
+        }
+        Entry& entry = entries_[slots_[slot]];
+        entry.hash = 0;
+        entry.pair = Pair{};
+        SetCtrl(slot, CtrlDeleted);
+        count_--;
+        // Holes at the end of the pair array cost nothing to drop
+        while (!entries_.empty() && entries_.back().hash == 0) {
+            entries_.pop_back();
+        }
+    }
+
+    /** Clear - Remove every pair, keeping the table's capacity */
+    void Clear() {
+        entries_.clear();
+        if (mask_ != 0) {
+            std::fill(ctrl_.begin(), ctrl_.end(), CtrlEmpty);
+            growthLeft_ = static_cast<Integer>(mask_ + 1 - (mask_ + 1) / 8);
+        }
+        count_ = 0;
+    }
+
+    Integer Count() const {
+        return count_;
+    }
+
+    // Items[key]; as in Delphi, reading or writing an absent key raises
+    // "Item not found" (use AddOrSetValue to insert).
+    V& operator[](const K& key) {
+        std::size_t slot = FindSlot(key, HashOf(key));
+        if (slot == NoSlot) {
+            NotFound();
+        }
+        return entries_[slots_[slot]].pair.Value;
+    }
+
+    const V& operator[](const K& key) const {
+        std::size_t slot = FindSlot(key, HashOf(key));
+        if (slot == NoSlot) {
+            NotFound();
+        }
+        return entries_[slots_[slot]].pair.Value;
+    }
+
+    /** Keys - The keys in insertion order */
+    DynArray<K> Keys() const {
+        DynArray<K> result;
+        SetLength(result, count_);
+        Integer i = 0;
+        for (const Pair& pair : *this) {
+            result[i++] = pair.Key;
+        }
+        return result;
+    }
+
+    /** Values - The values in insertion order */
+    DynArray<V> Values() const {
+        DynArray<V> result;
+        SetLength(result, count_);
+        Integer i = 0;
+        for (const Pair& pair : *this) {
+            result[i++] = pair.Value;
+        }
+        return result;
+    }
+
+    // Pairs in insertion order; keys are read-only through the iterator
+    auto begin() const {
+        return Iterator<const Entry, const Pair>(entries_.data(), entries_.data() + entries_.size());
+    }
+
+    auto end() const {
+        const Entry* last = entries_.data() + entries_.size();
+        return Iterator<const Entry, const Pair>(last, last);
+    }
+};
+
+// Items[key] under {$R+}: a missing key already raises inside operator[]
+template<typename K, typename V>
+inline V& At(Dictionary<K, V>& dict, const std::type_identity_t<K>& key) {
+    return dict[key];
+}
+
+template<typename K, typename V>
+inline const V& At(const Dictionary<K, V>& dict, const std::type_identity_t<K>& key) {
+    return dict[key];
+}
+
 } // namespace np
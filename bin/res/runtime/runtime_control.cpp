@@ -3,6 +3,7 @@
  */
 
 #include "runtime_control.h"
+#include "runtime_console.h"
 #include <cstdlib>
 #include <cstdio>
 
@@ -19,6 +20,7 @@ void Halt(Integer exitCode) {
 }
 
 void RunError(Integer errorCode) {
+    _console.Flush();
     std::fprintf(stderr, "Runtime error %d\n", static_cast<int>(errorCode));
     std::exit(static_cast<int>(errorCode));
 }
@@ -12,6 +12,9 @@ namespace np {
 // ============================================================================
 // LOOP CONTROL
 // ============================================================================
+// The code generator lowers Pascal loops to native C++ for/while/do by
+// default. The lambda wrappers below are emitted only when native loops are
+// disabled (TNitroPascal.SetNativeLoops(False)).
 
 enum class LoopControl {
     Normal,
@@ -3,15 +3,26 @@
  *
  * Platform-specific hardware exception handlers:
  *   Windows : Vectored Exception Handler (VEH) via AddVectoredExceptionHandler
- *   POSIX   : signal handlers for SIGFPE, SIGSEGV, SIGBUS, SIGILL
+ *   POSIX   : signal handlers for SIGFPE, SIGSEGV, SIGBUS, SIGILL, running on
+ *             an alternate signal stack so stack overflow is reported too
  *
- * The handler writes the exception code and message into thread-local storage
- * and then longjmps back to the setjmp point established by TryCatch /
- * TryFinally / TryCatchFinally, allowing hardware faults to be caught by
- * Pascal try..except blocks just like software exceptions.
+ * The handlers are installed once, from the generated main(). A fault
+ * records its code and message and is thrown as an np::_Exception from the
+ * handler (_RaiseFault). GCC builds have non-call exceptions, so the
+ * unwinder treats the faulting instruction as a throwing point and runs the
+ * destructors and catch handlers of the code around it.
+ *
+ * Other compilers do not; there the unwinder would terminate when it finds
+ * no call site at the faulting instruction. With NP_FAULT_FRAMES the fault
+ * therefore longjmps to the innermost _FaultFrame of the thread, i.e. the
+ * innermost active try statement, which rethrows it from there. A fault
+ * outside every try statement is thrown from the handler and terminates the
+ * program, with console output flushed. Division by zero never gets here:
+ * np::Div / np::Mod check the divisor in software.
  */
 
 #include "runtime_exceptions.h"
+#include <mutex>
 
 #ifdef _WIN32
     #define WIN32_LEAN_AND_MEAN
@@ -22,6 +33,53 @@
 
 namespace np {
 
+// ============================================================================
+// EXCEPTION STATE
+// ============================================================================
+
+void _CaptureException() {
+    try {
+        throw;
+    }
+    catch (const _Exception& e) {
+        _g_exc_code = e.code;
+        _g_exc_msg  = e.msg;
+    }
+    catch (const std::exception& e) {
+        _g_exc_code = EXC_SOFTWARE;
+        _g_exc_msg  = _AsciiToWide(e.what());
+    }
+    catch (...) {
+        _g_exc_code = EXC_SOFTWARE;
+        _g_exc_msg  = L"Unknown exception";
+    }
+}
+
+// ============================================================================
+// FAULT DELIVERY
+// ============================================================================
+
+// Fault recorded by the handler on the faulting thread
+static thread_local Integer        _g_fault_code = EXC_NONE;
+static thread_local const wchar_t* _g_fault_msg  = L"";
+
+void _RaiseFault() {
+    throw _Exception{_g_fault_code, _g_fault_msg};
+}
+
+// Raises the recorded fault at the faulting instruction, or with fault
+// frames resumes the innermost try statement of this thread with it.
+// Without one there is no Pascal handler to reach, and the throw ends the
+// program.
+[[noreturn]] static void _NpDeliverFault() {
+#ifdef NP_FAULT_FRAMES
+    _FaultFrame* LFrame = _g_fault_frame;
+    if (LFrame != nullptr)
+        std::longjmp(LFrame->buf, 1);
+#endif
+    _RaiseFault();
+}
+
 // ============================================================================
 // WINDOWS: VECTORED EXCEPTION HANDLER
 // ============================================================================
@@ -47,64 +105,82 @@ static bool _IsHardwareException(DWORD ACode) {
     }
 }
 
-static LONG WINAPI _NpVehHandler(PEXCEPTION_POINTERS AEp) {
-    // Only handle this if a Pascal try block is active on this thread.
-    if (_g_jmp_target == nullptr)
-        return EXCEPTION_CONTINUE_SEARCH;
+// Only faults in this module are converted; faults that other DLLs probe
+// for and handle themselves keep their normal SEH path.
+static bool _IsOwnCode(PVOID AAddress) {
+    HMODULE LSelf  = nullptr;
+    HMODULE LFault = nullptr;
+    const DWORD LFlags = GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                         GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT;
+    if (!GetModuleHandleExW(LFlags, reinterpret_cast<LPCWSTR>(&_NpDeliverFault), &LSelf))
+        return false;
+    if (!GetModuleHandleExW(LFlags, reinterpret_cast<LPCWSTR>(AAddress), &LFault))
+        return false;
+    return LSelf == LFault;
+}
 
+static LONG WINAPI _NpVehHandler(PEXCEPTION_POINTERS AEp) {
     DWORD LCode = AEp->ExceptionRecord->ExceptionCode;
     if (!_IsHardwareException(LCode))
         return EXCEPTION_CONTINUE_SEARCH;
+    if (!_IsOwnCode(AEp->ExceptionRecord->ExceptionAddress))
+        return EXCEPTION_CONTINUE_SEARCH;
 
     // Map Windows exception code to NitroPascal exception code + message.
     switch (LCode) {
         case EXCEPTION_ACCESS_VIOLATION:
         case EXCEPTION_IN_PAGE_ERROR:
-            _g_exc_code = EXC_ACCESS_VIOLATION;
-            _g_exc_msg  = L"Access violation";
+            _g_fault_code = EXC_ACCESS_VIOLATION;
+            _g_fault_msg  = L"Access violation";
             break;
         case EXCEPTION_INT_DIVIDE_BY_ZERO:
         case EXCEPTION_FLT_DIVIDE_BY_ZERO:
         case EXCEPTION_FLT_INVALID_OPERATION:
-            _g_exc_code = EXC_DIV_BY_ZERO;
-            _g_exc_msg  = L"Divide by zero";
+            _g_fault_code = EXC_DIV_BY_ZERO;
+            _g_fault_msg  = L"Divide by zero";
             break;
         case EXCEPTION_STACK_OVERFLOW:
-            _g_exc_code = EXC_STACK_OVERFLOW;
-            _g_exc_msg  = L"Stack overflow";
+            _g_fault_code = EXC_STACK_OVERFLOW;
+            _g_fault_msg  = L"Stack overflow";
             break;
         case EXCEPTION_INT_OVERFLOW:
         case EXCEPTION_FLT_OVERFLOW:
         case EXCEPTION_FLT_UNDERFLOW:
-            _g_exc_code = EXC_INTEGER_OVERFLOW;
-            _g_exc_msg  = L"Numeric overflow";
+            _g_fault_code = EXC_INTEGER_OVERFLOW;
+            _g_fault_msg  = L"Numeric overflow";
             break;
         case EXCEPTION_ILLEGAL_INSTRUCTION:
         case EXCEPTION_PRIV_INSTRUCTION:
-            _g_exc_code = EXC_ILLEGAL_INSTRUCTION;
-            _g_exc_msg  = L"Illegal instruction";
+            _g_fault_code = EXC_ILLEGAL_INSTRUCTION;
+            _g_fault_msg  = L"Illegal instruction";
             break;
         default:
-            _g_exc_code = EXC_UNKNOWN;
-            _g_exc_msg  = L"Hardware exception";
+            _g_fault_code = EXC_UNKNOWN;
+            _g_fault_msg  = L"Hardware exception";
             break;
     }
 
-    // Jump back to the setjmp point in TryCatch / TryFinally / TryCatchFinally.
-    // Return value 2 distinguishes hardware path from software path (0 = normal,
-    // 1 is not used, 2 = hardware fault).
-    longjmp(*_g_jmp_target, 2);
-
-    // Unreachable; required to satisfy the WINAPI return type.
+#if defined(_M_X64) || defined(__x86_64__)
+    // Resume in _NpDeliverFault as though the faulting instruction had
+    // called it, so the throw or jump starts from a normal frame instead of
+    // from inside the exception dispatcher. The unwinder looks up the byte
+    // before a return address, so pushing Rip + 1 makes it find the
+    // faulting instruction itself.
+    PCONTEXT LCtx = AEp->ContextRecord;
+    LCtx->Rsp -= sizeof(DWORD64);
+    *reinterpret_cast<DWORD64*>(LCtx->Rsp) = LCtx->Rip + 1;
+    LCtx->Rip = reinterpret_cast<DWORD64>(&_NpDeliverFault);
+    return EXCEPTION_CONTINUE_EXECUTION;
+#else
     return EXCEPTION_CONTINUE_SEARCH;
+#endif
 }
 
-static PVOID _g_veh_handle = nullptr;
-
 static void _DoInstallHardwareHandlers() {
-    if (_g_veh_handle == nullptr) {
-        _g_veh_handle = AddVectoredExceptionHandler(1, _NpVehHandler);
-    }
+    // Leave room on an overflowed stack for the throw and its unwinding
+    ULONG LGuarantee = 64 * 1024;
+    SetThreadStackGuarantee(&LGuarantee);
+    AddVectoredExceptionHandler(1, _NpVehHandler);
 }
 
 // ============================================================================
@@ -113,44 +189,55 @@ static void _DoInstallHardwareHandlers() {
 
 #else // !_WIN32
 
-static void _NpSignalHandler(int ASig) {
-    if (_g_jmp_target == nullptr)
-        return;
-
+static void _NpSignalHandler(int ASig, siginfo_t* AInfo, void* AContext) {
+    (void)AInfo;
+    (void)AContext;
     switch (ASig) {
         case SIGFPE:
-            _g_exc_code = EXC_DIV_BY_ZERO;
-            _g_exc_msg  = L"Divide by zero";
+            _g_fault_code = EXC_DIV_BY_ZERO;
+            _g_fault_msg  = L"Divide by zero";
             break;
         case SIGSEGV:
-            _g_exc_code = EXC_ACCESS_VIOLATION;
-            _g_exc_msg  = L"Segmentation fault";
+            _g_fault_code = EXC_ACCESS_VIOLATION;
+            _g_fault_msg  = L"Segmentation fault";
             break;
 #ifdef SIGBUS
         case SIGBUS:
-            _g_exc_code = EXC_BUS_ERROR;
-            _g_exc_msg  = L"Bus error";
+            _g_fault_code = EXC_BUS_ERROR;
+            _g_fault_msg  = L"Bus error";
             break;
 #endif
         case SIGILL:
-            _g_exc_code = EXC_ILLEGAL_INSTRUCTION;
-            _g_exc_msg  = L"Illegal instruction";
+            _g_fault_code = EXC_ILLEGAL_INSTRUCTION;
+            _g_fault_msg  = L"Illegal instruction";
             break;
         default:
-            _g_exc_code = EXC_UNKNOWN;
-            _g_exc_msg  = L"Hardware exception";
+            _g_fault_code = EXC_UNKNOWN;
+            _g_fault_msg  = L"Hardware exception";
             break;
     }
-
-    longjmp(*_g_jmp_target, 2);
+    _NpDeliverFault();
 }
 
+// Alternate stack for the main thread: a SIGSEGV caused by stack overflow
+// has no room left on the faulting stack to run the handler.
+static char _g_alt_stack[64 * 1024];
+
 static void _DoInstallHardwareHandlers() {
+    stack_t LSs;
+    std::memset(&LSs, 0, sizeof(LSs));
+    LSs.ss_sp    = _g_alt_stack;
+    LSs.ss_size  = sizeof(_g_alt_stack);
+    LSs.ss_flags = 0;
+    sigaltstack(&LSs, nullptr);
+
     struct sigaction LSa;
     std::memset(&LSa, 0, sizeof(LSa));
-    LSa.sa_handler = _NpSignalHandler;
+    LSa.sa_sigaction = _NpSignalHandler;
     sigemptyset(&LSa.sa_mask);
-    LSa.sa_flags = 0;
+    // SA_NODEFER: the handler never returns (it longjmps or throws), so the
+    // signal must not stay blocked for the rest of the program.
+    LSa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
 
     sigaction(SIGFPE,  &LSa, nullptr);
     sigaction(SIGSEGV, &LSa, nullptr);
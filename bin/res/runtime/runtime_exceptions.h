@@ -4,20 +4,30 @@
  * Provides full hardware + software exception support for both Windows
  * (Vectored Exception Handler) and POSIX (signal handlers).
  *
- * Pascal semantics:
- *   try..except        -> np::TryCatch(tryFn, catchFn)
- *   try..finally       -> np::TryFinally(tryFn, finallyFn)
- *   try..except..finally -> np::TryCatchFinally(tryFn, catchFn, finallyFn)
+ * Pascal try blocks are emitted as native C++ try/catch; entering one costs
+ * nothing unless the build uses fault frames (see NP_FAULT_FRAME):
+ *   try..except          -> try { frame; ... } catch (...) { np::_CaptureException(); ... }
+ *   try..finally         -> np::_FinallyGuard guard([&]() { ... }); frame; ...
+ *   try..except..finally -> guard + try/catch
  *   raiseexception(msg)       -> np::RaiseException(msg)
  *   raiseexceptioncode(c,msg) -> np::RaiseException(c, msg)
  *   getexceptionmessage()     -> np::GetExceptionMessage()
  *   getexceptioncode()        -> np::GetExceptionCode()
+ *
+ * Hardware faults are turned into thrown np::_Exception objects by handlers
+ * installed once at program start (_InstallHardwareHandlers). GCC builds
+ * throw straight from the handler (non-call exceptions, see runtime_types.h);
+ * with NP_FAULT_FRAMES each try statement records a _FaultFrame the handlers
+ * jump back to, so the fault is rethrown from a point the unwinder handles.
  */
 
 #pragma once
 
 #include "runtime_types.h"
 #include "runtime_string.h"
+#include <csetjmp>
+#include <exception>
+#include <utility>
 
 namespace np {
 
@@ -25,12 +35,61 @@ namespace np {
 // INTERNAL
 // ============================================================================
 
-// _Exception, EXC_* constants, _g_exc_code, _g_exc_msg, _g_jmp_target
+// _Exception, EXC_* constants, _g_exc_code, _g_exc_msg
 // are all defined in runtime_types.h so every module can use them.
 
-// Installed once per process. Defined in runtime_exceptions.cpp.
+// Called once from the generated main(). Defined in runtime_exceptions.cpp.
 void _InstallHardwareHandlers();
 
+// --- fault frames ---
+// A hardware fault arrives at an instruction the C++ compiler does not treat
+// as a throwing point, so a throw straight from the fault handler is only
+// caught when the code has non-call exceptions (GCC; clang has no
+// equivalent). Without them (NP_FAULT_FRAMES) every try statement opens its
+// body with NP_FAULT_FRAME(_np_fltN), which declares a _FaultFrame and
+// setjmps into it. The handler longjmps back to the innermost frame of the
+// faulting thread, which rethrows the fault from inside the protected body
+// as an ordinary C++ exception. That costs a setjmp per entry, and as with
+// any longjmp:
+//   - a non-volatile local changed since the setjmp is indeterminate after
+//     it, so the code generator declares the scalar locals a try body
+//     writes and later code reads with NP_FAULT_VOLATILE;
+//   - destructors of objects created since the setjmp are skipped, so a
+//     String or DynArray built inside the body at the time of the fault
+//     leaks its buffer.
+// Elsewhere NP_FAULT_FRAME and NP_FAULT_VOLATILE expand to nothing.
+#ifdef NP_FAULT_FRAMES
+
+struct _FaultFrame;
+
+inline thread_local _FaultFrame* _g_fault_frame = nullptr;
+
+struct _FaultFrame {
+    std::jmp_buf buf;
+    _FaultFrame* prev;
+
+    _FaultFrame() : prev(_g_fault_frame) { _g_fault_frame = this; }
+    ~_FaultFrame() { _g_fault_frame = prev; }
+
+    _FaultFrame(const _FaultFrame&) = delete;
+    _FaultFrame& operator=(const _FaultFrame&) = delete;
+};
+
+#define NP_FAULT_FRAME(AName) \
+    np::_FaultFrame AName;    \
+    if (setjmp(AName.buf) != 0) np::_RaiseFault()
+#define NP_FAULT_VOLATILE volatile
+
+#else
+
+#define NP_FAULT_FRAME(AName) ((void)0)
+#define NP_FAULT_VOLATILE
+
+#endif // NP_FAULT_FRAMES
+
+// Throws the fault recorded by the fault handler.
+[[noreturn]] void _RaiseFault();
+
 // ============================================================================
 // INTERNAL HELPERS
 // ============================================================================
@@ -42,6 +101,43 @@ inline std::wstring _AsciiToWide(const char* AStr) {
     return std::wstring(AStr, AStr + std::strlen(AStr));
 }
 
+// Records the code and message of the exception being handled so that
+// GetExceptionCode/Message work inside an except block. Must be called from
+// within a catch handler; only the faulting path pays for it.
+void _CaptureException();
+
+// --- finally ---
+// Runs AFn when the enclosing scope is left: normally, through exit/break/
+// continue, or by an exception. If the scope is already unwinding, an
+// exception raised by the finally code is dropped so the original one keeps
+// propagating (C++ cannot carry two in flight).
+template<typename Fn>
+class _FinallyGuard {
+public:
+    explicit _FinallyGuard(Fn AFn)
+        : fn_(std::move(AFn)), unwinding_(std::uncaught_exceptions()) {}
+
+    _FinallyGuard(const _FinallyGuard&) = delete;
+    _FinallyGuard& operator=(const _FinallyGuard&) = delete;
+
+    ~_FinallyGuard() noexcept(false) {
+        if (std::uncaught_exceptions() > unwinding_) {
+            try {
+                fn_();
+            }
+            catch (...) {
+            }
+        }
+        else {
+            fn_();
+        }
+    }
+
+private:
+    Fn  fn_;
+    int unwinding_;
+};
+
 // ============================================================================
 // PUBLIC API
 // ============================================================================
@@ -69,52 +165,20 @@ inline Integer GetExceptionCode() {
 // ============================================================================
 // TRY WRAPPERS
 // ============================================================================
+// Callable forms of the try statements for hand-written C++ (cpp blocks).
+// The code generator emits the native constructs directly.
 
 // --- try..except ---
 // try_fn  : the protected body
 // catch_fn: the except handler; GetExceptionCode/Message are valid inside it
 template<typename TryFn, typename CatchFn>
 inline void TryCatch(TryFn try_fn, CatchFn catch_fn) {
-    _InstallHardwareHandlers();
-
-    jmp_buf                  buf;
-    volatile jmp_buf*        old_target     = _g_jmp_target;
-    volatile bool            had_exception  = false;
-    _g_jmp_target = &buf;
-
-    int jmp_result = setjmp(buf);
-
-    if (jmp_result == 0) {
-        // Normal path: run the try body inside a C++ try so software
-        // exceptions are caught here rather than via longjmp.
-        try {
-            try_fn();
-        }
-        catch (const _Exception& e) {
-            _g_exc_code   = e.code;
-            _g_exc_msg    = e.msg;
-            had_exception = true;
-        }
-        catch (const std::exception& e) {
-            _g_exc_code   = EXC_SOFTWARE;
-            _g_exc_msg    = _AsciiToWide(e.what());
-            had_exception = true;
-        }
-        catch (...) {
-            _g_exc_code   = EXC_SOFTWARE;
-            _g_exc_msg    = L"Unknown exception";
-            had_exception = true;
-        }
-    }
-    else {
-        // Hardware exception path: state was already written by the VEH /
-        // signal handler before it called longjmp.
-        had_exception = true;
+    try {
+        NP_FAULT_FRAME(frame);
+        try_fn();
     }
-
-    _g_jmp_target = const_cast<jmp_buf*>(old_target);
-
-    if (had_exception) {
+    catch (...) {
+        _CaptureException();
         catch_fn();
     }
 }
@@ -124,53 +188,9 @@ inline void TryCatch(TryFn try_fn, CatchFn catch_fn) {
 // finally_fn: always runs; if try_fn raised, exception re-propagates after
 template<typename TryFn, typename FinallyFn>
 inline void TryFinally(TryFn try_fn, FinallyFn finally_fn) {
-    _InstallHardwareHandlers();
-
-    jmp_buf           buf;
-    volatile jmp_buf* old_target    = _g_jmp_target;
-    volatile bool     had_exception = false;
-    _g_jmp_target = &buf;
-
-    int jmp_result = setjmp(buf);
-
-    if (jmp_result == 0) {
-        try {
-            try_fn();
-        }
-        catch (const _Exception& e) {
-            _g_exc_code   = e.code;
-            _g_exc_msg    = e.msg;
-            had_exception = true;
-        }
-        catch (const std::exception& e) {
-            _g_exc_code   = EXC_SOFTWARE;
-            _g_exc_msg    = _AsciiToWide(e.what());
-            had_exception = true;
-        }
-        catch (...) {
-            _g_exc_code   = EXC_SOFTWARE;
-            _g_exc_msg    = L"Unknown exception";
-            had_exception = true;
-        }
-    }
-    else {
-        had_exception = true;
-    }
-
-    _g_jmp_target = const_cast<jmp_buf*>(old_target);
-
-    // Save exception state -- finally_fn may itself raise an exception.
-    Integer      saved_code = _g_exc_code;
-    std::wstring saved_msg  = _g_exc_msg;
-
-    finally_fn();
-
-    if (had_exception) {
-        // Restore state and re-propagate so the caller sees the original fault.
-        _g_exc_code = saved_code;
-        _g_exc_msg  = saved_msg;
-        throw _Exception{saved_code, saved_msg};
-    }
+    _FinallyGuard guard(std::move(finally_fn));
+    NP_FAULT_FRAME(frame);
+    try_fn();
 }
 
 // --- try..except..finally ---
@@ -179,47 +199,15 @@ inline void TryFinally(TryFn try_fn, FinallyFn finally_fn) {
 // finally_fn: always runs after catch_fn (no re-propagation)
 template<typename TryFn, typename CatchFn, typename FinallyFn>
 inline void TryCatchFinally(TryFn try_fn, CatchFn catch_fn, FinallyFn finally_fn) {
-    _InstallHardwareHandlers();
-
-    jmp_buf           buf;
-    volatile jmp_buf* old_target    = _g_jmp_target;
-    volatile bool     had_exception = false;
-    _g_jmp_target = &buf;
-
-    int jmp_result = setjmp(buf);
-
-    if (jmp_result == 0) {
-        try {
-            try_fn();
-        }
-        catch (const _Exception& e) {
-            _g_exc_code   = e.code;
-            _g_exc_msg    = e.msg;
-            had_exception = true;
-        }
-        catch (const std::exception& e) {
-            _g_exc_code   = EXC_SOFTWARE;
-            _g_exc_msg    = _AsciiToWide(e.what());
-            had_exception = true;
-        }
-        catch (...) {
-            _g_exc_code   = EXC_SOFTWARE;
-            _g_exc_msg    = L"Unknown exception";
-            had_exception = true;
-        }
-    }
-    else {
-        had_exception = true;
+    _FinallyGuard guard(std::move(finally_fn));
+    try {
+        NP_FAULT_FRAME(frame);
+        try_fn();
     }
-
-    _g_jmp_target = const_cast<jmp_buf*>(old_target);
-
-    if (had_exception) {
+    catch (...) {
+        _CaptureException();
         catch_fn();
     }
-
-    // Finally always runs; exception was swallowed by catch_fn.
-    finally_fn();
 }
 
 } // namespace np
@@ -4,16 +4,687 @@
 
 #include "runtime_file.h"
 
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
 #else
 #include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+    // ------------------------------------------------------------------------
+    // Descriptor I/O. Interrupted calls are retried; other errors end the
+    // read or drop the write, as the stream-based files did.
+    // ------------------------------------------------------------------------
+
+    // Helper: Open AName with open(2) flags; -1 on failure
+    int open_file(const np::String& AName, int AFlags) {
+#ifdef _WIN32
+        return _wopen(AName.c_str_wide(), AFlags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        std::string name = AName.ToStdString();
+        int fd;
+        do {
+            fd = ::open(name.c_str(), AFlags | O_CLOEXEC, 0666);
+        } while (fd < 0 && errno == EINTR);
+        return fd;
+#endif
+    }
+
+    // Helper: Read up to ACount bytes; 0 at end of file or on error
+    std::size_t read_some(int AFd, char* ABuffer, std::size_t ACount) {
+        for (;;) {
+#ifdef _WIN32
+            int n = _read(AFd, ABuffer, static_cast<unsigned>(ACount < INT_MAX ? ACount : INT_MAX));
+#else
+            ssize_t n = ::read(AFd, ABuffer, ACount);
+#endif
+            if (n >= 0) {
+                return static_cast<std::size_t>(n);
+            }
+            if (errno != EINTR) {
+                return 0;
+            }
+        }
+    }
+
+    // Helper: Write all ACount bytes
+    void write_all(int AFd, const char* AData, std::size_t ACount) {
+        while (ACount > 0) {
+#ifdef _WIN32
+            int n = _write(AFd, AData, static_cast<unsigned>(ACount < INT_MAX ? ACount : INT_MAX));
+#else
+            ssize_t n = ::write(AFd, AData, ACount);
+#endif
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return;
+            }
+            AData += n;
+            ACount -= static_cast<std::size_t>(n);
+        }
+    }
+
+    // Helper: Read up to ACount bytes at AOffset; fewer only at end of file
+    std::size_t read_at(int AFd, void* ABuffer, std::size_t ACount, np::Int64 AOffset) {
+        auto* out = static_cast<char*>(ABuffer);
+        std::size_t done = 0;
+        while (done < ACount) {
+            np::Int64 at = AOffset + static_cast<np::Int64>(done);
+#ifdef _WIN32
+            if (_lseeki64(AFd, at, SEEK_SET) < 0) {
+                break;
+            }
+            std::size_t rest = ACount - done;
+            int n = _read(AFd, out + done, static_cast<unsigned>(rest < INT_MAX ? rest : INT_MAX));
+#else
+            ssize_t n = ::pread(AFd, out + done, ACount - done, static_cast<off_t>(at));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+#endif
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        return done;
+    }
+
+    // Helper: Write all ACount bytes at AOffset
+    void write_at(int AFd, const void* AData, std::size_t ACount, np::Int64 AOffset) {
+        const auto* data = static_cast<const char*>(AData);
+        std::size_t done = 0;
+        while (done < ACount) {
+            np::Int64 at = AOffset + static_cast<np::Int64>(done);
+#ifdef _WIN32
+            if (_lseeki64(AFd, at, SEEK_SET) < 0) {
+                return;
+            }
+            std::size_t rest = ACount - done;
+            int n = _write(AFd, data + done, static_cast<unsigned>(rest < INT_MAX ? rest : INT_MAX));
+#else
+            ssize_t n = ::pwrite(AFd, data + done, ACount - done, static_cast<off_t>(at));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+#endif
+            if (n <= 0) {
+                return;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+    }
+
+    // Helper: Cut or extend the open file to ASize bytes
+    bool resize_file(int AFd, np::Int64 ASize) {
+#ifdef _WIN32
+        return _chsize_s(AFd, ASize) == 0;
+#else
+        int result;
+        do {
+            result = ::ftruncate(AFd, static_cast<off_t>(ASize));
+        } while (result < 0 && errno == EINTR);
+        return result == 0;
+#endif
+    }
+
+    // Helper: Size of the open file in bytes
+    np::Int64 file_size(int AFd) {
+#ifdef _WIN32
+        struct _stat64 info;
+        return _fstat64(AFd, &info) == 0 ? static_cast<np::Int64>(info.st_size) : 0;
+#else
+        struct stat info;
+        return fstat(AFd, &info) == 0 ? static_cast<np::Int64>(info.st_size) : 0;
+#endif
+    }
+
+    void close_file(int AFd) {
+#ifdef _WIN32
+        _close(AFd);
+#else
+        ::close(AFd);
 #endif
+    }
+
+    // Helper: (Re)open AFile in AMode with open(2) flags
+    void open_text(np::Text& AFile, np::TextMode AMode, int AFlags) {
+        np::CloseFile(AFile);
+        AFile.fd = open_file(AFile.filename, AFlags);
+        if (AFile.fd < 0) {
+            return;
+        }
+        if (!AFile.buffer) {
+            AFile.buffer = std::make_unique_for_overwrite<char[]>(np::TextFile::BUFFER_SIZE);
+        }
+        AFile.mode   = AMode;
+        AFile.head   = 0;
+        AFile.tail   = 0;
+        AFile.at_end = false;
+    }
+
+    inline bool is_text_space(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+    }
+
+    // Helper: Skip blanks and tabs, and line ends too when ALineEnds; false
+    // at end of file
+    bool skip_space(const np::Text& AFile, bool ALineEnds) {
+        for (;;) {
+            if (AFile.head == AFile.tail && !AFile.Fill()) {
+                return false;
+            }
+            char ch = AFile.buffer[AFile.head];
+            if (ALineEnds ? !is_text_space(ch) : (ch != ' ' && ch != '\t')) {
+                return true;
+            }
+            AFile.head++;
+        }
+    }
+
+    // Helper: Skip white space, then gather the next white-space-delimited
+    // token in AFile.line
+    const std::string& read_token(np::Text& AFile) {
+        AFile.line.clear();
+        if (!skip_space(AFile, true)) {
+            return AFile.line;
+        }
+        for (;;) {
+            if (AFile.head == AFile.tail && !AFile.Fill()) {
+                break;
+            }
+            const char* from = AFile.buffer.get() + AFile.head;
+            const char* end  = AFile.buffer.get() + AFile.tail;
+            const char* at   = from;
+            while (at != end && !is_text_space(*at)) {
+                ++at;
+            }
+            AFile.line.append(from, static_cast<std::size_t>(at - from));
+            AFile.head += static_cast<std::size_t>(at - from);
+            if (at != end) {
+                break;
+            }
+        }
+        return AFile.line;
+    }
+
+    // Helper: Parse a token as a number; 0 when it does not start with one
+    template<typename T>
+    T parse_number(const std::string& AToken) {
+        const char* first = AToken.data();
+        const char* last  = first + AToken.size();
+        if (first != last && *first == '+') {
+            ++first;
+        }
+        T value{};
+        std::from_chars(first, last, value);
+        return value;
+    }
+}
 
 namespace np {
 
+// ============================================================================
+// TEXT FILE
+// ============================================================================
+
+TextFile::~TextFile() {
+    CloseFile(*this);
+}
+
+bool TextFile::Fill() const {
+    if (at_end) {
+        return false;
+    }
+    head = 0;
+    tail = read_some(fd, buffer.get(), BUFFER_SIZE);
+    at_end = tail == 0;
+    return !at_end;
+}
+
+void TextFile::FlushBuffer() {
+    if (tail > 0) {
+        write_all(fd, buffer.get(), tail);
+        tail = 0;
+    }
+}
+
+void TextFile::PutLarge(const char* s, std::size_t n) {
+    FlushBuffer();
+    if (n >= BUFFER_SIZE) {
+        write_all(fd, s, n);
+        return;
+    }
+    std::memcpy(buffer.get(), s, n);
+    tail = n;
+}
+
+void TextFile::Put(const char16_t* s, std::size_t n) {
+    // Transcode straight into the buffer in chunks that fit at the worst
+    // case of 3 bytes per unit (a surrogate pair yields 4 bytes for 2); a
+    // chunk never ends between the halves of a pair
+    while (n > 0) {
+        if (BUFFER_SIZE - tail < 8) {
+            FlushBuffer();
+        }
+        std::size_t count = std::min(n, (BUFFER_SIZE - tail) / 3);
+        if (count < n && s[count - 1] >= 0xD800 && s[count - 1] <= 0xDBFF) {
+            count--;
+        }
+        char* out = buffer.get();
+        tail = static_cast<std::size_t>(_EncodeUtf8(s, count, out + tail) - out);
+        s += count;
+        n -= count;
+    }
+}
+
+void Reset(Text& AFile) {
+    open_text(AFile, TextMode::Input, O_RDONLY);
+    // Skip a UTF-8 byte order mark
+    if (AFile.mode == TextMode::Input && AFile.Fill() && AFile.tail >= 3 &&
+        std::memcmp(AFile.buffer.get(), "\xEF\xBB\xBF", 3) == 0) {
+        AFile.head = 3;
+    }
+}
+
+void Rewrite(Text& AFile) {
+    open_text(AFile, TextMode::Output, O_WRONLY | O_CREAT | O_TRUNC);
+}
+
+void Append(Text& AFile) {
+    open_text(AFile, TextMode::Output, O_WRONLY | O_CREAT | O_APPEND);
+}
+
+void CloseFile(Text& AFile) {
+    if (AFile.mode == TextMode::Closed) {
+        return;
+    }
+    if (AFile.mode == TextMode::Output) {
+        AFile.FlushBuffer();
+    }
+    close_file(AFile.fd);
+    AFile.fd   = -1;
+    AFile.mode = TextMode::Closed;
+    AFile.head = 0;
+    AFile.tail = 0;
+}
+
+void ReadLn(Text& AFile, String& ALine) {
+    if (AFile.mode != TextMode::Input) {
+        return;
+    }
+    // The common case: the whole line is in the buffer and is decoded from
+    // there. Otherwise its pieces are gathered in AFile.line.
+    const char* start = nullptr;
+    std::size_t size = 0;
+    bool gathered = false;
+    AFile.line.clear();
+    for (;;) {
+        if (AFile.head == AFile.tail && !AFile.Fill()) {
+            start = AFile.line.data();
+            size  = AFile.line.size();
+            break;
+        }
+        char* from = AFile.buffer.get() + AFile.head;
+        std::size_t avail = AFile.tail - AFile.head;
+        auto* newline = static_cast<char*>(std::memchr(from, '\n', avail));
+        if (newline) {
+            std::size_t length = static_cast<std::size_t>(newline - from);
+            AFile.head += length + 1;
+            if (gathered) {
+                AFile.line.append(from, length);
+                start = AFile.line.data();
+                size  = AFile.line.size();
+            } else {
+                start = from;
+                size  = length;
+            }
+            break;
+        }
+        AFile.line.append(from, avail);
+        AFile.head = AFile.tail;
+        gathered = true;
+    }
+    if (size > 0 && start[size - 1] == '\r') {
+        size--;
+    }
+    ALine = String::FromUtf8(start, size);
+}
+
+void ReadLn(Text& AFile) {
+    if (AFile.mode != TextMode::Input) {
+        return;
+    }
+    for (;;) {
+        if (AFile.head == AFile.tail && !AFile.Fill()) {
+            return;
+        }
+        char* from = AFile.buffer.get() + AFile.head;
+        auto* newline = static_cast<char*>(std::memchr(from, '\n', AFile.tail - AFile.head));
+        if (newline) {
+            AFile.head += static_cast<std::size_t>(newline - from) + 1;
+            return;
+        }
+        AFile.head = AFile.tail;
+    }
+}
+
+void Read(Text& AFile, Integer& AValue) {
+    if (AFile.mode == TextMode::Input) {
+        AValue = parse_number<Integer>(read_token(AFile));
+    }
+}
+
+void Read(Text& AFile, Int64& AValue) {
+    if (AFile.mode == TextMode::Input) {
+        AValue = parse_number<Int64>(read_token(AFile));
+    }
+}
+
+void Read(Text& AFile, Double& AValue) {
+    if (AFile.mode == TextMode::Input) {
+        AValue = parse_number<Double>(read_token(AFile));
+    }
+}
+
+void Read(Text& AFile, String& AValue) {
+    if (AFile.mode == TextMode::Input) {
+        const std::string& token = read_token(AFile);
+        AValue = String::FromUtf8(token.data(), token.size());
+    }
+}
+
+void Read(Text& AFile, Char& AValue) {
+    if (AFile.mode != TextMode::Input || !skip_space(AFile, true)) {
+        return;
+    }
+    // One UTF-8 sequence, which may straddle a refill
+    auto lead = static_cast<unsigned char>(AFile.buffer[AFile.head++]);
+    if (lead < 0x80) {
+        AValue = static_cast<Char>(lead);
+        return;
+    }
+    std::size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+    AFile.line.assign(1, static_cast<char>(lead));
+    while (AFile.line.size() < length && (AFile.head < AFile.tail || AFile.Fill()) &&
+           (AFile.buffer[AFile.head] & 0xC0) == 0x80) {
+        AFile.line.push_back(AFile.buffer[AFile.head++]);
+    }
+    AValue = String::FromUtf8(AFile.line.data(), AFile.line.size())[1];
+}
+
+Boolean SeekEof(Text& AFile) {
+    return AFile.mode != TextMode::Input || !skip_space(AFile, true);
+}
+
+Boolean SeekEoln(Text& AFile) {
+    if (AFile.mode != TextMode::Input || !skip_space(AFile, false)) {
+        return true;
+    }
+    char ch = AFile.buffer[AFile.head];
+    return ch == '\n' || ch == '\r';
+}
+
+// ============================================================================
+// RECORD FILE
+// ============================================================================
+
+_FileDescriptor::~_FileDescriptor() {
+    Close();
+}
+
+bool _FileDescriptor::Open(bool ACreate) {
+    Close();
+    if (ACreate) {
+        fd = open_file(filename, O_RDWR | O_CREAT | O_TRUNC);
+    } else {
+        fd = open_file(filename, O_RDWR);
+        if (fd < 0) {
+            fd = open_file(filename, O_RDONLY);
+        }
+    }
+    if (fd < 0) {
+        return false;
+    }
+    size          = file_size(fd);
+    offset        = 0;
+    buffer_offset = 0;
+    buffered      = 0;
+    dirty         = false;
+    return true;
+}
+
+void _FileDescriptor::Close() {
+    if (fd < 0) {
+        return;
+    }
+    Flush();
+    close_file(fd);
+    fd       = -1;
+    offset   = 0;
+    size     = 0;
+    buffered = 0;
+}
+
+void _FileDescriptor::Flush() {
+    if (dirty) {
+        write_at(fd, buffer.get(), buffered, buffer_offset);
+        buffer_offset += static_cast<Int64>(buffered);
+        buffered = 0;
+        dirty    = false;
+    }
+}
+
+void _FileDescriptor::Truncate() {
+    if (fd < 0) {
+        return;
+    }
+    Flush();
+    if (resize_file(fd, offset)) {
+        // The read-ahead may hold bytes past the new end
+        size          = offset;
+        buffer_offset = offset;
+        buffered      = 0;
+    }
+}
+
+std::size_t _FileDescriptor::Read(void* ABuffer, std::size_t ACount) {
+    Flush();
+    auto* out = static_cast<char*>(ABuffer);
+    std::size_t done = 0;
+    while (done < ACount && offset < size) {
+        Int64 buffer_end = buffer_offset + static_cast<Int64>(buffered);
+        if (offset >= buffer_offset && offset < buffer_end) {
+            // The cursor is inside the read-ahead
+            std::size_t at = static_cast<std::size_t>(offset - buffer_offset);
+            std::size_t n  = std::min(ACount - done, buffered - at);
+            std::memcpy(out + done, buffer.get() + at, n);
+            done   += n;
+            offset += static_cast<Int64>(n);
+            continue;
+        }
+        std::size_t rest = ACount - done;
+        if (offset != buffer_end || rest >= BUFFER_SIZE) {
+            // A jump (random access) or a large block: read just what was
+            // asked for. Reading on from its end then counts as sequential.
+            std::size_t n = read_at(fd, out + done, rest, offset);
+            done         += n;
+            offset       += static_cast<Int64>(n);
+            buffer_offset = offset;
+            buffered      = 0;
+            break;
+        }
+        // Sequential: read ahead
+        if (!buffer) {
+            buffer = std::make_unique_for_overwrite<char[]>(BUFFER_SIZE);
+        }
+        buffer_offset = offset;
+        buffered      = read_at(fd, buffer.get(), BUFFER_SIZE, offset);
+        if (buffered == 0) {
+            break;
+        }
+    }
+    return done;
+}
+
+void _FileDescriptor::Write(const void* AData, std::size_t ACount) {
+    if (!dirty) {
+        buffered = 0;       // the read-ahead may cover the bytes written
+    } else if (offset != buffer_offset + static_cast<Int64>(buffered) ||
+               buffered + ACount > BUFFER_SIZE) {
+        Flush();
+    }
+    if (ACount >= BUFFER_SIZE) {
+        Flush();
+        write_at(fd, AData, ACount, offset);
+        buffer_offset = offset + static_cast<Int64>(ACount);
+    } else {
+        if (!buffer) {
+            buffer = std::make_unique_for_overwrite<char[]>(BUFFER_SIZE);
+        }
+        if (!dirty) {
+            buffer_offset = offset;
+            dirty = true;
+        }
+        std::memcpy(buffer.get() + buffered, AData, ACount);
+        buffered += ACount;
+    }
+    offset += static_cast<Int64>(ACount);
+    size = std::max(size, offset);
+}
+
+// ============================================================================
+// MAPPED FILE
+// ============================================================================
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const String& AFileName, MapAdvice AAdvice) {
+    Close();
+#ifdef _WIN32
+    DWORD flags = AAdvice == MapAdvice::Random ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN;
+    HANDLE file = CreateFileW(reinterpret_cast<LPCWSTR>(AFileName.c_str_wide()), GENERIC_READ,
+                              FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER length;
+    bool ok = GetFileSizeEx(file, &length) != 0 &&
+              static_cast<uint64_t>(length.QuadPart) <= SIZE_MAX;
+    if (ok && length.QuadPart > 0) {
+        // The view keeps the mapping alive once both handles are closed
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        ok = data != nullptr;
+    }
+    CloseHandle(file);
+    if (!ok) {
+        data = nullptr;
+        return false;
+    }
+    size = static_cast<std::size_t>(length.QuadPart);
+#else
+    int fd = open_file(AFileName, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+              static_cast<uint64_t>(info.st_size) <= SIZE_MAX;
+    if (ok && info.st_size > 0) {
+        // The mapping stays valid after the descriptor is closed
+        void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = view != MAP_FAILED;
+        if (ok) {
+            data = static_cast<const char*>(view);
+        }
+    }
+    close_file(fd);
+    if (!ok) {
+        return false;
+    }
+    size = static_cast<std::size_t>(info.st_size);
+#endif
+    pos  = 0;
+    open = true;
+    Advise(AAdvice);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<char*>(data), size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+    pos  = 0;
+    open = false;
+}
+
+void MappedFile::Advise(MapAdvice AAdvice) const {
+#ifndef _WIN32
+    // Windows takes the hint when the file is opened
+    if (data) {
+        int advice = AAdvice == MapAdvice::Sequential ? MADV_SEQUENTIAL :
+                     AAdvice == MapAdvice::Random     ? MADV_RANDOM : MADV_NORMAL;
+        madvise(const_cast<char*>(data), size, advice);
+    }
+#else
+    (void)AAdvice;
+#endif
+}
+
+void ReadLn(MappedFile& AFile, String& ALine) {
+    if (AFile.pos >= AFile.size) {
+        ALine = String();
+        return;
+    }
+    if (AFile.pos == 0 && AFile.size >= 3 && std::memcmp(AFile.data, "\xEF\xBB\xBF", 3) == 0) {
+        AFile.pos = 3;
+    }
+    const char* from = AFile.data + AFile.pos;
+    std::size_t avail = AFile.size - AFile.pos;
+    auto* newline = static_cast<const char*>(std::memchr(from, '\n', avail));
+    std::size_t length = newline ? static_cast<std::size_t>(newline - from) : avail;
+    AFile.pos += newline ? length + 1 : length;
+    if (length > 0 && from[length - 1] == '\r') {
+        length--;
+    }
+    ALine = String::FromUtf8(from, length);
+}
+
+void ReadLn(MappedFile& AFile) {
+    if (AFile.pos >= AFile.size) {
+        return;
+    }
+    const char* from = AFile.data + AFile.pos;
+    auto* newline = static_cast<const char*>(std::memchr(from, '\n', AFile.size - AFile.pos));
+    AFile.pos = newline ? static_cast<std::size_t>(newline - AFile.data) + 1 : AFile.size;
+}
+
+// ============================================================================
+// FILE SYSTEM
+// ============================================================================
+
 Boolean DirectoryExists(const String& ADirName) {
-    std::string dname(ADirName.Data().begin(), ADirName.Data().end());
+    std::string dname = ADirName.ToStdString();
 #ifdef _WIN32
     DWORD attrs = GetFileAttributesA(dname.c_str());
     return (attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY));
@@ -24,7 +695,7 @@ Boolean DirectoryExists(const String& ADirName) {
 }
 
 Boolean CreateDir(const String& ADirName) {
-    std::string dname(ADirName.Data().begin(), ADirName.Data().end());
+    std::string dname = ADirName.ToStdString();
 #ifdef _WIN32
     return CreateDirectoryA(dname.c_str(), NULL) != 0;
 #else
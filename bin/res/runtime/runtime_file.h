@@ -6,9 +6,18 @@
 
 #include "runtime_types.h"
 #include "runtime_string.h"
+#include "runtime_containers.h"
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+#include <string_view>
+#include <array>
+#include <algorithm>
 #include <sys/stat.h>
 
 namespace np {
@@ -16,42 +25,155 @@ namespace np {
 // ============================================================================
 // TEXT FILE
 // ============================================================================
+// A TextFile reads and writes UTF-8 through its own 256 KB buffer over a raw
+// file descriptor; no C++ stream or codecvt is involved. ReadLn finds the
+// line end with memchr and builds the String straight from the buffered
+// bytes with one allocation. A line that runs past the end of the buffer is
+// gathered in a side buffer that keeps its capacity between lines. Eof and
+// Eoln look at the next buffered byte and read from the descriptor only when
+// the buffer is empty. Output is written when the buffer fills, on Flush and
+// on Close. A UTF-8 byte order mark at the start of the file is skipped, and
+// CR LF line ends read as LF.
+
+enum class TextMode {
+    Closed,
+    Input,      // Reset
+    Output      // Rewrite, Append
+};
 
 struct TextFile {
-    std::wfstream* stream;
-    std::wstring filename;
-    bool is_open;
-    
-    TextFile() : stream(nullptr), is_open(false) {}
-    
-    ~TextFile() {
-        if (stream && is_open) {
-            stream->close();
-            delete stream;
+    static constexpr std::size_t BUFFER_SIZE = 256 * 1024;
+
+    int         fd = -1;
+    String      filename;
+    TextMode    mode = TextMode::Closed;
+    std::unique_ptr<char[]> buffer;
+    // Input: bytes [head, tail) are read but not consumed. Output: bytes
+    // [0, tail) are waiting to be written. Reading ahead is not a change to
+    // the file, so Eof and Eoln may refill a const TextFile.
+    mutable std::size_t head = 0;
+    mutable std::size_t tail = 0;
+    mutable bool        at_end = false;   // the descriptor has no more bytes
+    std::string         line;             // ReadLn: a line longer than the buffer
+
+    TextFile() = default;
+    TextFile(const TextFile&) = delete;
+    TextFile& operator=(const TextFile&) = delete;
+    ~TextFile();
+
+    bool IsOpen() const { return mode != TextMode::Closed; }
+
+    /**
+     * Fill - Read more bytes once the buffer is consumed; false at end of file
+     */
+    bool Fill() const;
+
+    // Output: append n bytes, writing the buffer out when it is full
+    void Put(const char* s, std::size_t n) {
+        if (n <= BUFFER_SIZE - tail) {
+            std::memcpy(buffer.get() + tail, s, n);
+            tail += n;
+        } else {
+            PutLarge(s, n);
+        }
+    }
+
+    void Put(char ch) {
+        if (tail == BUFFER_SIZE) {
+            FlushBuffer();
         }
+        buffer[tail++] = ch;
     }
+
+    // Output: append UTF-16 units as UTF-8
+    void Put(const char16_t* s, std::size_t n);
+
+    // Output: write the pending bytes to the descriptor
+    void FlushBuffer();
+
+private:
+    void PutLarge(const char* s, std::size_t n);
 };
 
 using Text = TextFile;
 
+// ============================================================================
+// FILE DESCRIPTOR
+// ============================================================================
+// Binary and typed files are opened on a raw descriptor and moved with
+// positioned reads and writes (pread and pwrite): there is no stream
+// position to keep in step. The cursor and the file size live in the file
+// variable as Int64, so Seek, FilePos, FileSize and Eof make no system call
+// and work past 2 GB. Small transfers go through a 64 KB buffer, which holds
+// either read-ahead or pending writes.
+
+struct _FileDescriptor {
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    int    fd = -1;
+    String filename;
+    Int64  offset = 0;          // cursor, in bytes
+    Int64  size   = 0;          // file size, pending writes included
+    std::unique_ptr<char[]> buffer;
+    // Bytes [0, buffered) of the buffer mirror the file at buffer_offset:
+    // read-ahead, or writes not yet made when dirty
+    Int64       buffer_offset = 0;
+    std::size_t buffered      = 0;
+    bool        dirty         = false;
+
+    _FileDescriptor() = default;
+    _FileDescriptor(const _FileDescriptor&) = delete;
+    _FileDescriptor& operator=(const _FileDescriptor&) = delete;
+    ~_FileDescriptor();
+
+    bool IsOpen() const { return fd >= 0; }
+
+    /**
+     * Open - Rewrite (ACreate) creates or empties the file; Reset opens it
+     * for reading and writing, or read-only when writing is not allowed.
+     * Closes the file first; false when it cannot be opened.
+     */
+    bool Open(bool ACreate);
+
+    /**
+     * Close - Write pending bytes and close the descriptor
+     */
+    void Close();
+
+    /**
+     * Read - Copy up to ACount bytes at the cursor and advance it; returns
+     * the number of bytes copied
+     */
+    std::size_t Read(void* ABuffer, std::size_t ACount);
+
+    /**
+     * Write - Write ACount bytes at the cursor and advance it
+     */
+    void Write(const void* AData, std::size_t ACount);
+
+    /**
+     * Flush - Write pending bytes to the descriptor
+     */
+    void Flush();
+
+    /**
+     * Truncate - Cut the file at the cursor with ftruncate; what follows
+     * the cursor is discarded, buffered bytes included
+     */
+    void Truncate();
+};
+
 // ============================================================================
 // BINARY FILE
 // ============================================================================
 
-struct BinaryFile {
-    std::fstream* stream;
-    std::string filename;
-    bool is_open;
-    Integer record_size;
-    
-    BinaryFile() : stream(nullptr), is_open(false), record_size(1) {}
-    
-    ~BinaryFile() {
-        if (stream && is_open) {
-            stream->close();
-            delete stream;
-        }
-    }
+/**
+ * BinaryFile - An untyped `file`; BlockRead, BlockWrite, Seek, FilePos and
+ * FileSize count records of record_size bytes (1 unless Reset or Rewrite
+ * says otherwise)
+ */
+struct BinaryFile : _FileDescriptor {
+    Integer record_size = 1;
 };
 
 // ============================================================================
@@ -59,7 +181,7 @@ struct BinaryFile {
 // ============================================================================
 
 inline void AssignFile(Text& AFile, const String& AFileName) {
-    AFile.filename = AFileName.ToWString();
+    AFile.filename = AFileName;
 }
 
 // Alias: Pascal 'Assign' maps to AssignFile
@@ -67,171 +189,143 @@ inline void Assign(Text& AFile, const String& AFileName) {
     AssignFile(AFile, AFileName);
 }
 
-inline void Reset(Text& AFile) {
-    if (AFile.stream) {
-        delete AFile.stream;
-    }
-    std::string fname(AFile.filename.begin(), AFile.filename.end());
-    AFile.stream = new std::wfstream(fname, std::ios::in);
-    AFile.is_open = AFile.stream && AFile.stream->is_open();
-}
-
-inline void Rewrite(Text& AFile) {
-    if (AFile.stream) {
-        delete AFile.stream;
-    }
-    std::string fname(AFile.filename.begin(), AFile.filename.end());
-    AFile.stream = new std::wfstream(fname, std::ios::out | std::ios::trunc);
-    AFile.is_open = AFile.stream && AFile.stream->is_open();
-}
-
-inline void Append(Text& AFile) {
-    if (AFile.stream) {
-        delete AFile.stream;
-    }
-    std::string fname(AFile.filename.begin(), AFile.filename.end());
-    AFile.stream = new std::wfstream(fname, std::ios::out | std::ios::app);
-    AFile.is_open = AFile.stream && AFile.stream->is_open();
-}
-
-inline void CloseFile(Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        AFile.stream->close();
-        AFile.is_open = false;
-    }
-}
+void Reset(Text& AFile);
+void Rewrite(Text& AFile);
+void Append(Text& AFile);
+void CloseFile(Text& AFile);
 
 // Alias: Pascal 'Close' maps to CloseFile
 inline void Close(Text& AFile) {
     CloseFile(AFile);
 }
 
-inline void WriteLn(Text& AFile, const String& AText) {
-    if (AFile.stream && AFile.is_open) {
-        *AFile.stream << AText.ToWString() << std::endl;
+inline void Flush(Text& AFile) {
+    if (AFile.mode == TextMode::Output) {
+        AFile.FlushBuffer();
     }
 }
 
-template<typename... Args>
-void WriteLn(Text& AFile, Args&&... args) {
-    if (AFile.stream && AFile.is_open) {
-        (*AFile.stream << ... << std::forward<Args>(args));
-        *AFile.stream << std::endl;
-    }
-}
+// Write/WriteLn format values the way the console does, into the file's
+// buffer. Char is written as UTF-8 rather than escaped.
 
-template<typename... Args>
-void Write(Text& AFile, Args&&... args) {
-    if (AFile.stream && AFile.is_open) {
-        (*AFile.stream << ... << std::forward<Args>(args));
-    }
+inline void TextOut(Text& AFile, const String& s) {
+    AFile.Put(s.Raw(), s.RawSize());
 }
 
-inline void WriteLn(Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        *AFile.stream << std::endl;
-    }
+inline void TextOut(Text& AFile, const StringView& s) {
+    AFile.Put(s.Raw(), s.RawSize());
 }
 
-inline void ReadLn(Text& AFile, String& ALine) {
-    if (AFile.stream && AFile.is_open) {
-        std::wstring line;
-        std::getline(*AFile.stream, line);
-        ALine = String(line);
-    }
+inline void TextOut(Text& AFile, const char* s) {
+    AFile.Put(s, std::strlen(s));
 }
 
-inline Boolean Eof(const Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        return AFile.stream->peek() == std::char_traits<wchar_t>::eof();
-    }
-    return true;
+inline void TextOut(Text& AFile, const std::string& s) {
+    AFile.Put(s.data(), s.size());
 }
 
-inline Boolean Eoln(const Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        wchar_t ch = static_cast<wchar_t>(AFile.stream->peek());
-        return (ch == L'\n' || ch == std::char_traits<wchar_t>::eof());
-    }
-    return true;
+inline void TextOut(Text& AFile, char ch) {
+    AFile.Put(ch);
 }
 
-inline void Read(Text& AFile, Integer& AValue) {
-    if (AFile.stream && AFile.is_open) {
-        *AFile.stream >> AValue;
+inline void TextOut(Text& AFile, char16_t ch) {
+    if (ch < 0x80) {
+        AFile.Put(static_cast<char>(ch));
+    } else {
+        AFile.Put(&ch, 1);
     }
 }
 
-inline void Read(Text& AFile, Double& AValue) {
-    if (AFile.stream && AFile.is_open) {
-        *AFile.stream >> AValue;
+inline void TextOut(Text& AFile, bool val) {
+    if (val) {
+        AFile.Put("TRUE", 4);
+    } else {
+        AFile.Put("FALSE", 5);
     }
 }
 
-inline void Read(Text& AFile, String& AValue) {
-    if (AFile.stream && AFile.is_open) {
-        std::wstring temp;
-        *AFile.stream >> temp;
-        AValue = String(temp);
+template<typename T>
+void TextOut(Text& AFile, const T& val) {
+    if constexpr (std::is_integral_v<T>) {
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), val);
+        AFile.Put(buf, static_cast<std::size_t>(res.ptr - buf));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        char buf[64];
+        auto res = std::to_chars(buf, buf + sizeof(buf), val, std::chars_format::general, 6);
+        AFile.Put(buf, static_cast<std::size_t>(res.ptr - buf));
+    } else {
+        std::ostringstream os;
+        os << val;
+        TextOut(AFile, os.str());
     }
 }
 
-inline void Read(Text& AFile, Char& AValue) {
-    if (AFile.stream && AFile.is_open) {
-        wchar_t ch;
-        // Skip leading whitespace to match Delphi text file Read behavior
-        *AFile.stream >> std::ws;
-        AFile.stream->get(ch);
-        AValue = static_cast<char16_t>(ch);
+template<typename... Args>
+void Write(Text& AFile, Args&&... args) {
+    if (AFile.mode == TextMode::Output) {
+        (TextOut(AFile, args), ...);
     }
 }
 
-inline Boolean SeekEof(Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        while (true) {
-            auto ch_int = AFile.stream->peek();
-            // Check for EOF first
-            if (ch_int == std::char_traits<wchar_t>::eof()) {
-                return true;
-            }
-            wchar_t ch = static_cast<wchar_t>(ch_int);
-            if (!std::isspace(ch)) {
-                return false;
-            }
-            AFile.stream->get();
-        }
+template<typename... Args>
+void WriteLn(Text& AFile, Args&&... args) {
+    if (AFile.mode == TextMode::Output) {
+        (TextOut(AFile, args), ...);
+        AFile.Put('\n');
     }
-    return true;
 }
 
-inline Boolean SeekEoln(Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        while (!AFile.stream->eof()) {
-            wchar_t ch = static_cast<wchar_t>(AFile.stream->peek());
-            if (ch == L'\n') {
-                return true;
-            }
-            if (!std::isspace(ch)) {
-                return false;
-            }
-            AFile.stream->get();
-        }
+/**
+ * ReadLn - Read the rest of the current line into ALine and move to the
+ * next one; an empty String at end of file
+ */
+void ReadLn(Text& AFile, String& ALine);
+
+/**
+ * ReadLn - Skip the rest of the current line
+ */
+void ReadLn(Text& AFile);
+
+inline Boolean Eof(const Text& AFile) {
+    if (AFile.mode != TextMode::Input) {
+        return true;
     }
-    return true;
+    return AFile.head == AFile.tail && !AFile.Fill();
 }
 
-inline void Flush(Text& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        AFile.stream->flush();
+inline Boolean Eoln(const Text& AFile) {
+    if (Eof(AFile)) {
+        return true;
     }
+    char ch = AFile.buffer[AFile.head];
+    return ch == '\n' || ch == '\r';
 }
 
+// Read(F, x) skips leading white space, line ends included, and reads one
+// white-space-delimited token; a number that does not parse reads as 0.
+void Read(Text& AFile, Integer& AValue);
+void Read(Text& AFile, Int64& AValue);
+void Read(Text& AFile, Double& AValue);
+void Read(Text& AFile, String& AValue);
+void Read(Text& AFile, Char& AValue);
+
+/**
+ * SeekEof - Skip white space and line ends; true when nothing else is left
+ */
+Boolean SeekEof(Text& AFile);
+
+/**
+ * SeekEoln - Skip blanks and tabs; true at a line end or at end of file
+ */
+Boolean SeekEoln(Text& AFile);
+
 // ============================================================================
 // BINARY FILE OPERATIONS
 // ============================================================================
 
 inline void AssignFile(BinaryFile& AFile, const String& AFileName) {
-    AFile.filename = std::string(AFileName.Data().begin(), AFileName.Data().end());
+    AFile.filename = AFileName;
 }
 
 inline void Assign(BinaryFile& AFile, const String& AFileName) {
@@ -239,11 +333,7 @@ inline void Assign(BinaryFile& AFile, const String& AFileName) {
 }
 
 inline void Reset(BinaryFile& AFile) {
-    if (AFile.stream) {
-        delete AFile.stream;
-    }
-    AFile.stream = new std::fstream(AFile.filename, std::ios::in | std::ios::binary);
-    AFile.is_open = AFile.stream && AFile.stream->is_open();
+    AFile.Open(false);
 }
 
 inline void Reset(BinaryFile& AFile, const Integer ARecordSize) {
@@ -252,11 +342,7 @@ inline void Reset(BinaryFile& AFile, const Integer ARecordSize) {
 }
 
 inline void Rewrite(BinaryFile& AFile) {
-    if (AFile.stream) {
-        delete AFile.stream;
-    }
-    AFile.stream = new std::fstream(AFile.filename, std::ios::out | std::ios::binary | std::ios::trunc);
-    AFile.is_open = AFile.stream && AFile.stream->is_open();
+    AFile.Open(true);
 }
 
 inline void Rewrite(BinaryFile& AFile, const Integer ARecordSize) {
@@ -265,21 +351,22 @@ inline void Rewrite(BinaryFile& AFile, const Integer ARecordSize) {
 }
 
 inline void CloseFile(BinaryFile& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        AFile.stream->close();
-        AFile.is_open = false;
-    }
+    AFile.Close();
 }
 
 inline void Close(BinaryFile& AFile) {
     CloseFile(AFile);
 }
 
+inline void Flush(BinaryFile& AFile) {
+    AFile.Flush();
+}
+
 template<typename T>
 inline void BlockRead(BinaryFile& AFile, T& ABuffer, const Integer ACount, Integer& ABytesRead) {
-    if (AFile.stream && AFile.is_open) {
-        AFile.stream->read(reinterpret_cast<char*>(&ABuffer), ACount * AFile.record_size);
-        ABytesRead = static_cast<Integer>(AFile.stream->gcount());
+    if (AFile.IsOpen() && ACount > 0) {
+        std::size_t bytes = static_cast<std::size_t>(ACount) * static_cast<std::size_t>(AFile.record_size);
+        ABytesRead = static_cast<Integer>(AFile.Read(&ABuffer, bytes));
     } else {
         ABytesRead = 0;
     }
@@ -293,9 +380,10 @@ inline void BlockRead(BinaryFile& AFile, T& ABuffer, const Integer ACount) {
 
 template<typename T>
 inline void BlockWrite(BinaryFile& AFile, const T& ABuffer, const Integer ACount, Integer& ABytesWritten) {
-    if (AFile.stream && AFile.is_open) {
-        AFile.stream->write(reinterpret_cast<const char*>(&ABuffer), ACount * AFile.record_size);
-        ABytesWritten = AFile.stream->good() ? ACount : 0;
+    if (AFile.IsOpen() && ACount > 0) {
+        std::size_t bytes = static_cast<std::size_t>(ACount) * static_cast<std::size_t>(AFile.record_size);
+        AFile.Write(&ABuffer, bytes);
+        ABytesWritten = ACount;
     } else {
         ABytesWritten = 0;
     }
@@ -307,78 +395,413 @@ inline void BlockWrite(BinaryFile& AFile, const T& ABuffer, const Integer ACount
     BlockWrite(AFile, ABuffer, ACount, bytesWritten);
 }
 
-inline Integer FileSize(BinaryFile& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        auto current = AFile.stream->tellg();
-        AFile.stream->seekg(0, std::ios::end);
-        auto size = AFile.stream->tellg();
-        AFile.stream->seekg(current);
-        return static_cast<Integer>(size) / AFile.record_size;
+// FileSize, FilePos and Seek count records, as Int64
+inline Int64 FileSize(const BinaryFile& AFile) {
+    return AFile.size / AFile.record_size;
+}
+
+inline Int64 FilePos(const BinaryFile& AFile) {
+    return AFile.offset / AFile.record_size;
+}
+
+inline void Seek(BinaryFile& AFile, const Int64 APosition) {
+    if (AFile.IsOpen()) {
+        AFile.offset = APosition * AFile.record_size;
     }
+}
+
+inline Boolean Eof(const BinaryFile& AFile) {
+    return AFile.offset >= AFile.size;
+}
+
+inline void Truncate(BinaryFile& AFile) {
+    AFile.Truncate();
+}
+
+inline Integer IOResult() {
     return 0;
 }
 
-inline Integer FilePos(BinaryFile& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        return static_cast<Integer>(AFile.stream->tellg()) / AFile.record_size;
+// ============================================================================
+// RECORD FILE
+// ============================================================================
+// A `file of T` is a _FileDescriptor whose cursor moves in records of
+// sizeof(T). Bulk BlockRead and BlockWrite of a DynArray or std::array
+// bypass the buffer and transfer the whole run in one call.
+
+[[noreturn]] inline void _ReadBeyondEof() {
+    throw _Exception{EXC_SOFTWARE, L"Read beyond end of file"};
+}
+
+/**
+ * TypedFile - A `file of T`; T must be a plain record (trivially copyable)
+ */
+template<typename T>
+struct TypedFile : _FileDescriptor {
+    static_assert(std::is_trivially_copyable_v<T>, "file of T needs a plain record type");
+    using Record = T;
+};
+
+template<typename T>
+void AssignFile(TypedFile<T>& AFile, const String& AFileName) {
+    AFile.filename = AFileName;
+}
+
+template<typename T>
+void Assign(TypedFile<T>& AFile, const String& AFileName) {
+    AssignFile(AFile, AFileName);
+}
+
+template<typename T>
+void Reset(TypedFile<T>& AFile) {
+    AFile.Open(false);
+}
+
+template<typename T>
+void Rewrite(TypedFile<T>& AFile) {
+    AFile.Open(true);
+}
+
+template<typename T>
+void CloseFile(TypedFile<T>& AFile) {
+    AFile.Close();
+}
+
+template<typename T>
+void Close(TypedFile<T>& AFile) {
+    AFile.Close();
+}
+
+template<typename T>
+void Flush(TypedFile<T>& AFile) {
+    AFile.Flush();
+}
+
+template<typename T>
+void Truncate(TypedFile<T>& AFile) {
+    AFile.Truncate();
+}
+
+/**
+ * Read - Read the next record into each argument; raises "Read beyond end
+ * of file" when no whole record is left
+ */
+template<typename T, typename... Records>
+void Read(TypedFile<T>& AFile, Records&&... ARecords) {
+    static_assert((std::is_same_v<std::remove_cvref_t<Records>, T> && ...),
+                  "Read from a file of T needs variables of type T");
+    if (AFile.IsOpen()) {
+        ([&](T& ARecord) {
+            if (AFile.Read(&ARecord, sizeof(T)) != sizeof(T)) {
+                _ReadBeyondEof();
+            }
+        }(ARecords), ...);
     }
-    return 0;
 }
 
-inline void Seek(BinaryFile& AFile, const Integer APosition) {
-    if (AFile.stream && AFile.is_open) {
-        AFile.stream->seekg(APosition * AFile.record_size);
-        AFile.stream->seekp(APosition * AFile.record_size);
+/**
+ * Write - Write each argument as the next record
+ */
+template<typename T, typename... Records>
+void Write(TypedFile<T>& AFile, Records&&... ARecords) {
+    if (AFile.IsOpen()) {
+        ([&](const T& ARecord) { AFile.Write(&ARecord, sizeof(T)); }(ARecords), ...);
     }
 }
 
-inline Boolean Eof(const BinaryFile& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        return AFile.stream->peek() == std::char_traits<char>::eof();
+// Seek, FilePos and FileSize count records
+template<typename T>
+void Seek(TypedFile<T>& AFile, Int64 ARecord) {
+    AFile.offset = ARecord * static_cast<Int64>(sizeof(T));
+}
+
+template<typename T>
+Int64 FilePos(const TypedFile<T>& AFile) {
+    return AFile.offset / static_cast<Int64>(sizeof(T));
+}
+
+template<typename T>
+Int64 FileSize(const TypedFile<T>& AFile) {
+    return AFile.size / static_cast<Int64>(sizeof(T));
+}
+
+template<typename T>
+Boolean Eof(const TypedFile<T>& AFile) {
+    return !AFile.IsOpen() || AFile.offset + static_cast<Int64>(sizeof(T)) > AFile.size;
+}
+
+/**
+ * BlockRead - Read up to ACount records (no more than ABuffer holds) into
+ * ABuffer[0..]; ARecordsRead is the number of whole records read
+ */
+template<typename T>
+void BlockRead(TypedFile<T>& AFile, T* ABuffer, Integer ACount, Integer& ARecordsRead) {
+    ARecordsRead = 0;
+    if (AFile.IsOpen() && ACount > 0) {
+        std::size_t bytes = AFile.Read(ABuffer, static_cast<std::size_t>(ACount) * sizeof(T));
+        ARecordsRead = static_cast<Integer>(bytes / sizeof(T));
+        // A partial record at the end of the file is not consumed
+        AFile.offset -= static_cast<Int64>(bytes % sizeof(T));
     }
-    return true;
 }
 
-inline void Truncate(BinaryFile& AFile) {
-    if (AFile.stream && AFile.is_open) {
-        // Truncate at current position
-        // Note: This is a simplified implementation
-        // In a full implementation, platform-specific calls would be used
-        auto pos = AFile.stream->tellp();
-        AFile.stream->flush();
-        
-        // Close and reopen with truncate at position
-        // This is approximate behavior - proper implementation needs platform APIs
-        std::string fname = AFile.filename;
-        AFile.stream->close();
-        delete AFile.stream;
-        
-        // Read existing content up to pos
-        std::ifstream in(fname, std::ios::binary);
-        std::vector<char> content(static_cast<size_t>(pos));
-        if (in.is_open() && pos > 0) {
-            in.read(content.data(), pos);
-            in.close();
+template<typename T>
+void BlockRead(TypedFile<T>& AFile, DynArray<T>& ABuffer, Integer ACount, Integer& ARecordsRead) {
+    BlockRead(AFile, ABuffer.Data(), std::min(ACount, ABuffer.Length()), ARecordsRead);
+}
+
+template<typename T, std::size_t N>
+void BlockRead(TypedFile<T>& AFile, std::array<T, N>& ABuffer, Integer ACount, Integer& ARecordsRead) {
+    BlockRead(AFile, ABuffer.data(), std::min(ACount, static_cast<Integer>(N)), ARecordsRead);
+}
+
+template<typename T, typename Buffer>
+void BlockRead(TypedFile<T>& AFile, Buffer& ABuffer, Integer ACount) {
+    Integer recordsRead;
+    BlockRead(AFile, ABuffer, ACount, recordsRead);
+}
+
+/**
+ * BlockWrite - Write the first ACount records of ABuffer (no more than it
+ * holds); ARecordsWritten is the number written
+ */
+template<typename T>
+void BlockWrite(TypedFile<T>& AFile, const T* ABuffer, Integer ACount, Integer& ARecordsWritten) {
+    ARecordsWritten = 0;
+    if (AFile.IsOpen() && ACount > 0) {
+        AFile.Write(ABuffer, static_cast<std::size_t>(ACount) * sizeof(T));
+        ARecordsWritten = ACount;
+    }
+}
+
+template<typename T>
+void BlockWrite(TypedFile<T>& AFile, const DynArray<T>& ABuffer, Integer ACount, Integer& ARecordsWritten) {
+    BlockWrite(AFile, ABuffer.Data(), std::min(ACount, ABuffer.Length()), ARecordsWritten);
+}
+
+template<typename T, std::size_t N>
+void BlockWrite(TypedFile<T>& AFile, const std::array<T, N>& ABuffer, Integer ACount, Integer& ARecordsWritten) {
+    BlockWrite(AFile, ABuffer.data(), std::min(ACount, static_cast<Integer>(N)), ARecordsWritten);
+}
+
+template<typename T, typename Buffer>
+void BlockWrite(TypedFile<T>& AFile, const Buffer& ABuffer, Integer ACount) {
+    Integer recordsWritten;
+    BlockWrite(AFile, ABuffer, ACount, recordsWritten);
+}
+
+// ============================================================================
+// MAPPED FILE
+// ============================================================================
+// A MappedFile maps a whole file read-only into memory (mmap, or a file
+// mapping view on Windows). The bytes are read straight from the page cache
+// as they are touched: there is no read call and no copy, and random access
+// is pointer arithmetic. Programs see it as TMappedFile and use the usual
+// file routines on it: ReadLn takes the next line, Read(F, Rec) the next
+// record, and Seek, FilePos and FileSize work in bytes, with Int64
+// positions. C++ code can also use the typed pointer (As<T>), a
+// bounds-checked record view (Records<T>) and a line iterator (Lines).
+
+// Access pattern hint, passed to madvise on POSIX
+enum class MapAdvice {
+    Normal,
+    Sequential,     // read ahead aggressively, drop pages behind the reader
+    Random          // no read-ahead
+};
+
+/**
+ * MappedRecords - Bounds-checked view of a mapping as an array of T;
+ * indexing outside 0..Count()-1 raises a range error
+ */
+template<typename T>
+class MappedRecords {
+public:
+    MappedRecords(const T* AData, Int64 ACount) : data_(AData), count_(ACount) {}
+
+    Int64 Count() const { return count_; }
+
+    const T& operator[](Int64 AIndex) const {
+        if (static_cast<uint64_t>(AIndex) >= static_cast<uint64_t>(count_)) {
+            RangeError();
+        }
+        return data_[AIndex];
+    }
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + count_; }
+
+private:
+    const T* data_;
+    Int64    count_;
+};
+
+/**
+ * MappedLines - The lines of a mapping as UTF-8 byte views, without the
+ * line end (LF or CR LF); a final line without LF is included
+ */
+class MappedLines {
+public:
+    class Iterator {
+    public:
+        Iterator(const char* APos, const char* AEnd) : pos_(APos), end_(AEnd) { Scan(); }
+
+        std::string_view operator*() const { return line_; }
+
+        Iterator& operator++() {
+            pos_ = next_;
+            Scan();
+            return *this;
         }
-        
-        // Write back truncated content
-        std::ofstream out(fname, std::ios::binary | std::ios::trunc);
-        if (out.is_open() && pos > 0) {
-            out.write(content.data(), pos);
-            out.close();
+
+        bool operator!=(const Iterator& AOther) const { return pos_ != AOther.pos_; }
+
+    private:
+        void Scan() {
+            if (pos_ == end_) {
+                return;
+            }
+            auto* newline = static_cast<const char*>(
+                std::memchr(pos_, '\n', static_cast<std::size_t>(end_ - pos_)));
+            const char* stop = newline ? newline : end_;
+            next_ = newline ? newline + 1 : end_;
+            if (stop != pos_ && stop[-1] == '\r') {
+                --stop;
+            }
+            line_ = std::string_view(pos_, static_cast<std::size_t>(stop - pos_));
         }
-        
-        // Reopen for continued use
-        AFile.stream = new std::fstream(fname, std::ios::in | std::ios::out | std::ios::binary);
-        AFile.is_open = AFile.stream && AFile.stream->is_open();
-        if (AFile.is_open) {
-            AFile.stream->seekp(pos);
+
+        const char*      pos_;
+        const char*      end_;
+        const char*      next_ = nullptr;
+        std::string_view line_;
+    };
+
+    // A UTF-8 byte order mark at the start is skipped
+    MappedLines(const char* AData, std::size_t ASize) : data_(AData), size_(ASize) {
+        if (size_ >= 3 && std::memcmp(data_, "\xEF\xBB\xBF", 3) == 0) {
+            data_ += 3;
+            size_ -= 3;
         }
     }
+
+    Iterator begin() const { return Iterator(data_, data_ + size_); }
+    Iterator end() const { return Iterator(data_ + size_, data_ + size_); }
+
+private:
+    const char* data_;
+    std::size_t size_;
+};
+
+struct MappedFile {
+    const char* data = nullptr;
+    std::size_t size = 0;
+    std::size_t pos  = 0;       // ReadLn/Read cursor, in bytes
+    bool        open = false;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    /**
+     * Open - Map AFileName read-only; false when it cannot be opened or
+     * mapped. An empty file maps to no bytes.
+     */
+    bool Open(const String& AFileName, MapAdvice AAdvice = MapAdvice::Sequential);
+
+    /**
+     * Close - Unmap; the pointers and views handed out become invalid
+     */
+    void Close();
+
+    /**
+     * Advise - Tell the kernel how the mapping will be read
+     */
+    void Advise(MapAdvice AAdvice) const;
+
+    bool IsOpen() const { return open; }
+    const char* Data() const { return data; }
+    Int64 Size() const { return static_cast<Int64>(size); }
+
+    // The mapping as a pointer to T; the mapping is page-aligned
+    template<typename T>
+    const T* As() const {
+        static_assert(std::is_trivially_copyable_v<T>, "MappedFile::As needs a plain record type");
+        return reinterpret_cast<const T*>(data);
+    }
+
+    // The mapping as whole records of T; a partial record at the end is left out
+    template<typename T>
+    MappedRecords<T> Records() const {
+        return MappedRecords<T>(As<T>(), static_cast<Int64>(size / sizeof(T)));
+    }
+
+    MappedLines Lines() const { return MappedLines(data, size); }
+};
+
+inline Boolean MapFile(MappedFile& AFile, const String& AFileName,
+                       MapAdvice AAdvice = MapAdvice::Sequential) {
+    return AFile.Open(AFileName, AAdvice);
 }
 
-inline Integer IOResult() {
-    return 0;
+inline void CloseFile(MappedFile& AFile) {
+    AFile.Close();
+}
+
+inline void Close(MappedFile& AFile) {
+    AFile.Close();
+}
+
+// Reset moves the cursor back to the start of the mapping
+inline void Reset(MappedFile& AFile) {
+    AFile.pos = 0;
+}
+
+inline Boolean Eof(const MappedFile& AFile) {
+    return AFile.pos >= AFile.size;
+}
+
+inline Boolean Eoln(const MappedFile& AFile) {
+    return AFile.pos >= AFile.size || AFile.data[AFile.pos] == '\n' || AFile.data[AFile.pos] == '\r';
+}
+
+inline Int64 FileSize(const MappedFile& AFile) {
+    return AFile.Size();
+}
+
+inline Int64 FilePos(const MappedFile& AFile) {
+    return static_cast<Int64>(AFile.pos);
+}
+
+// Seek to a byte offset; offsets past the end are clamped to it
+inline void Seek(MappedFile& AFile, Int64 AOffset) {
+    AFile.pos = AOffset <= 0 ? 0 : std::min(static_cast<std::size_t>(AOffset), AFile.size);
+}
+
+/**
+ * ReadLn - Read the line at the cursor into ALine (without its line end)
+ * and move to the next one; an empty String at end of file. A UTF-8 byte
+ * order mark at the start of the file is skipped.
+ */
+void ReadLn(MappedFile& AFile, String& ALine);
+
+/**
+ * ReadLn - Skip the rest of the line at the cursor
+ */
+void ReadLn(MappedFile& AFile);
+
+/**
+ * Read - Copy the record at the cursor into ARecord and move past it;
+ * raises "Read beyond end of file" when fewer bytes are left
+ */
+template<typename T>
+void Read(MappedFile& AFile, T& ARecord) {
+    static_assert(std::is_trivially_copyable_v<T>, "Read from a TMappedFile needs a plain record type");
+    if (AFile.size - AFile.pos < sizeof(T)) {
+        _ReadBeyondEof();
+    }
+    std::memcpy(&ARecord, AFile.data + AFile.pos, sizeof(T));
+    AFile.pos += sizeof(T);
 }
 
 // ============================================================================
@@ -386,19 +809,19 @@ inline Integer IOResult() {
 // ============================================================================
 
 inline Boolean FileExists(const String& AFileName) {
-    std::string fname(AFileName.Data().begin(), AFileName.Data().end());
+    std::string fname = AFileName.ToStdString();
     std::ifstream f(fname);
     return f.good();
 }
 
 inline Boolean DeleteFile(const String& AFileName) {
-    std::string fname(AFileName.Data().begin(), AFileName.Data().end());
+    std::string fname = AFileName.ToStdString();
     return std::remove(fname.c_str()) == 0;
 }
 
 inline Boolean RenameFile(const String& AOldName, const String& ANewName) {
-    std::string old_name(AOldName.Data().begin(), AOldName.Data().end());
-    std::string new_name(ANewName.Data().begin(), ANewName.Data().end());
+    std::string old_name = AOldName.ToStdString();
+    std::string new_name = ANewName.ToStdString();
     return std::rename(old_name.c_str(), new_name.c_str()) == 0;
 }
 
@@ -3,9 +3,332 @@
  */
 
 #include "runtime_format.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+using np::_FormatArg;
+using np::_FormatSpec;
+using np::StringUnit;
+
+// Helper: The text Format is writing, in the storage encoding
+struct FormatWriter {
+    np::StringBuffer<StringUnit> buffer;
+
+    void Units(const StringUnit* AData, std::size_t ALength) {
+        if (ALength != 0) {
+            std::copy_n(AData, ALength, buffer.Extend(ALength));
+        }
+    }
+
+    void Ascii(const char* AData, std::size_t ALength) {
+        StringUnit* out = buffer.Extend(ALength);
+        for (std::size_t k = 0; k < ALength; ++k) {
+            out[k] = static_cast<StringUnit>(AData[k]);
+        }
+    }
+
+    void Spaces(std::size_t ACount) {
+        std::fill_n(buffer.Extend(ACount), ACount, StringUnit(' '));
+    }
+};
+
+[[noreturn]] void raise_format_error(const StringUnit* AFmt, std::size_t ALength, const wchar_t* AMessage,
+                                     const wchar_t* ATail) {
+    np::String fmt = np::String::FromRaw(np::StringBuffer<StringUnit>(AFmt, ALength));
+    throw np::_Exception{np::EXC_SOFTWARE, AMessage + fmt.ToWString() + ATail};
+}
+
+bool is_integer(const _FormatArg& AArg) {
+    return AArg.kind == _FormatArg::Int32 || AArg.kind == _FormatArg::Int64 ||
+           AArg.kind == _FormatArg::UInt64;
+}
+
+// Helper: Writes AValue as decimal digits, at least AMinDigits of them
+char* put_decimal(char* AOut, bool ANegative, uint64_t AValue, int AMinDigits) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), AValue).ptr;
+    int count = static_cast<int>(end - digits);
+    if (ANegative) {
+        *AOut++ = '-';
+    }
+    for (; count < AMinDigits; --AMinDigits) {
+        *AOut++ = '0';
+    }
+    return std::copy(digits, end, AOut);
+}
+
+// Helper: Writes AValue as upper-case hex digits, at least AMinDigits of them
+char* put_hex(char* AOut, uint64_t AValue, int AMinDigits) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), AValue, 16).ptr;
+    for (char* p = digits; p < end; ++p) {
+        if (*p >= 'a') {
+            *p -= 'a' - 'A';
+        }
+    }
+    for (int count = static_cast<int>(end - digits); count < AMinDigits; --AMinDigits) {
+        *AOut++ = '0';
+    }
+    return std::copy(digits, end, AOut);
+}
+
+// Helper: d.dddE+ddd with ADigits significant digits (%e)
+char* put_scientific(char* AOut, double AValue, int ADigits) {
+    char sci[48];
+    char* end = std::to_chars(sci, sci + sizeof(sci), AValue, std::chars_format::scientific, ADigits - 1).ptr;
+    char* e = std::find(sci, end, 'e');
+    AOut = std::copy(sci, e, AOut);
+    *AOut++ = 'E';
+    *AOut++ = e[1];
+    for (std::ptrdiff_t count = end - (e + 2); count < 3; ++count) {
+        *AOut++ = '0';
+    }
+    return std::copy(e + 2, end, AOut);
+}
+
+// Helper: Fixed-point with ADecimals decimals (%f, %n, %m), optionally
+// with thousands separators; "-" is dropped when the digits round to zero
+char* put_fixed(char* AOut, double AValue, int ADecimals, bool AThousands) {
+    char fixed[48];
+    char* end = std::to_chars(fixed, fixed + sizeof(fixed), AValue, std::chars_format::fixed, ADecimals).ptr;
+    const char* p = fixed;
+    if (*p == '-') {
+        p++;
+        if (std::find_if(p, static_cast<const char*>(end), [](char c) { return c > '0' && c <= '9'; }) != end) {
+            *AOut++ = '-';
+        }
+    }
+    const char* point = std::find(p, static_cast<const char*>(end), '.');
+    for (std::ptrdiff_t left = point - p; p < point; --left) {
+        *AOut++ = *p++;
+        if (AThousands && left > 1 && (left - 1) % 3 == 0) {
+            *AOut++ = ',';
+        }
+    }
+    return std::copy(point, static_cast<const char*>(end), AOut);
+}
+
+// Helper: Writes the text of one numeric or pointer specifier to AOut (128
+// bytes of room); false when AArg is not of a kind it accepts
+bool format_number(char AType, int APrec, const _FormatArg& AArg, char*& AOut) {
+    const int digits = std::min(APrec, 32);
+    switch (AType) {
+        case 'd':
+            if (!is_integer(AArg)) {
+                return false;
+            }
+            if (AArg.kind == _FormatArg::UInt64) {
+                AOut = put_decimal(AOut, false, AArg.u, digits);
+            } else {
+                AOut = put_decimal(AOut, AArg.i < 0, AArg.i < 0 ? 0 - static_cast<uint64_t>(AArg.i)
+                                                                : static_cast<uint64_t>(AArg.i), digits);
+            }
+            return true;
+        case 'u':
+        case 'x': {
+            if (!is_integer(AArg)) {
+                return false;
+            }
+            // A negative Integer reads as its 32-bit two's complement
+            uint64_t value = AArg.kind == _FormatArg::Int32 ? static_cast<uint32_t>(AArg.i)
+                           : AArg.kind == _FormatArg::Int64 ? static_cast<uint64_t>(AArg.i) : AArg.u;
+            AOut = AType == 'u' ? put_decimal(AOut, false, value, digits) : put_hex(AOut, value, digits);
+            return true;
+        }
+        case 'p':
+            if (AArg.kind != _FormatArg::Pointer && AArg.kind != _FormatArg::WideText &&
+                AArg.kind != _FormatArg::AnsiText) {
+                return false;
+            }
+            AOut = put_hex(AOut, reinterpret_cast<uintptr_t>(AArg.p), 2 * sizeof(void*));
+            return true;
+    }
+    if (AArg.kind != _FormatArg::Float) {
+        return false;
+    }
+    const double value = AArg.d;
+    if (!std::isfinite(value)) {
+        const char* text = std::isnan(value) ? "NAN" : value < 0 ? "-INF" : "INF";
+        AOut = std::copy_n(text, std::strlen(text), AOut);
+        return true;
+    }
+    switch (AType) {
+        case 'e':
+            AOut = put_scientific(AOut, value, std::clamp(APrec < 0 ? 15 : APrec, 1, 18));
+            break;
+        case 'g':
+            AOut += np::_FloatToText(AOut, value, APrec < 0 ? 15 : APrec);
+            break;
+        default: {
+            // f, n and m: 18 digits before the point at most, as in Delphi
+            if (std::fabs(value) >= 1e18) {
+                AOut = put_scientific(AOut, value, 15);
+                break;
+            }
+            int decimals = std::min(APrec < 0 ? 2 : APrec, 18);
+            if (AType == 'm') {
+                char text[64];
+                char* end = put_fixed(text, value, decimals, true);
+                const char* p = text;
+                if (*p == '-') {
+                    *AOut++ = *p++;
+                }
+                *AOut++ = '$';
+                AOut = std::copy(p, static_cast<const char*>(end), AOut);
+            } else {
+                AOut = put_fixed(AOut, value, decimals, AType == 'n');
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+// Helper: Pads the ALength characters AWrite writes to AWidth
+template<typename Write>
+void put_padded(FormatWriter& AOut, int AWidth, bool ALeft, np::Integer ALength, Write&& AWrite) {
+    std::size_t pad = AWidth > ALength ? static_cast<std::size_t>(AWidth - ALength) : 0;
+    if (pad != 0 && !ALeft) {
+        AOut.Spaces(pad);
+    }
+    AWrite();
+    if (pad != 0 && ALeft) {
+        AOut.Spaces(pad);
+    }
+}
+
+// Helper: %s; false when AArg is not text
+bool format_text(FormatWriter& AOut, int AWidth, bool ALeft, int APrec, const _FormatArg& AArg) {
+    np::String text;
+    const np::String* s = &text;
+    switch (AArg.kind) {
+        case _FormatArg::Str:
+            s = AArg.s;
+            break;
+        case _FormatArg::View: {
+            // Written from the viewed String's storage; a precision narrows
+            // a copy of the view, not the text
+            np::StringView view = *AArg.v;
+            if (APrec >= 0 && APrec < view.Length()) {
+                view = np::Copy(std::move(view), 1, APrec);
+            }
+            put_padded(AOut, AWidth, ALeft, view.Length(), [&] { AOut.Units(view.Raw(), view.RawSize()); });
+            return true;
+        }
+        case _FormatArg::Chr:
+            text = np::String(AArg.c);
+            break;
+        case _FormatArg::WideText: {
+            const char16_t* p = static_cast<const char16_t*>(AArg.p);
+            text = p ? np::String::FromUtf16(p, std::char_traits<char16_t>::length(p)) : np::String();
+            break;
+        }
+        case _FormatArg::AnsiText:
+            text = AArg.p ? np::String(static_cast<const char*>(AArg.p)) : np::String();
+            break;
+        default:
+            return false;
+    }
+    if (APrec >= 0 && APrec < s->Length()) {
+        text = s->Sub(0, APrec);
+        s = &text;
+    }
+    put_padded(AOut, AWidth, ALeft, s->Length(), [&] { AOut.Units(s->Raw(), s->RawSize()); });
+    return true;
+}
+
+// Helper: The Format engine; ANext(spec) yields the next literal run and
+// specifier of AFmt
+template<typename Next>
+np::String format_units(const StringUnit* AFmt, std::size_t ALength, Next&& ANext,
+                        const _FormatArg* AArgs, std::size_t ACount) {
+    FormatWriter out;
+    out.buffer.EnsureCapacity(ALength + 16 * ACount);
+    std::size_t next = 0;
+    auto argument = [&]() -> const _FormatArg& {
+        if (next >= ACount) {
+            raise_format_error(AFmt, ALength, L"No argument for format '", L"'");
+        }
+        return AArgs[next++];
+    };
+    auto invalid = [&]() {
+        raise_format_error(AFmt, ALength, L"Format '", L"' invalid or incompatible with argument");
+    };
+    // '*' takes its value from the next argument, which must be an integer
+    auto star = [&](int32_t AValue) -> int32_t {
+        if (AValue != -2) {
+            return AValue;
+        }
+        const _FormatArg& arg = argument();
+        if (arg.kind != _FormatArg::Int32 && arg.kind != _FormatArg::Int64) {
+            invalid();
+        }
+        return static_cast<int32_t>(std::clamp<int64_t>(arg.i, -1, 0xFFFFFF));
+    };
+    _FormatSpec spec;
+    for (;;) {
+        ANext(spec);
+        out.Units(AFmt + spec.start, spec.count);
+        if (spec.type == 0) {
+            break;
+        }
+        if (spec.type == '%') {
+            out.Ascii("%", 1);
+            continue;
+        }
+        if (spec.type == '?') {
+            invalid();
+        }
+        if (spec.index != -1) {
+            next = static_cast<std::size_t>(std::max(star(spec.index), 0));
+        }
+        int32_t width = std::max(star(spec.width), 0);
+        int32_t prec  = star(spec.prec);
+        const _FormatArg& arg = argument();
+        if (spec.type == 's') {
+            if (!format_text(out, width, spec.left, prec, arg)) {
+                invalid();
+            }
+            continue;
+        }
+        char text[128];
+        char* end = text;
+        if (!format_number(spec.type, prec, arg, end)) {
+            invalid();
+        }
+        put_padded(out, width, spec.left, static_cast<np::Integer>(end - text),
+                   [&] { out.Ascii(text, static_cast<std::size_t>(end - text)); });
+    }
+    return np::String::FromRaw(std::move(out.buffer));
+}
+
+} // anonymous namespace
 
 namespace np {
 
-// Format functions are header-only (inline templates)
+// ============================================================================
+// FORMAT
+// ============================================================================
+
+String _FormatRun(const StringUnit* AFmt, std::size_t ALength,
+                  const _FormatSpec* ASpecs, std::size_t ASpecCount,
+                  const _FormatArg* AArgs, std::size_t AArgCount) {
+    std::size_t k = 0;
+    return format_units(AFmt, ALength, [&](_FormatSpec& ASpec) {
+        ASpec = ASpecs[k < ASpecCount ? k++ : ASpecCount - 1];
+    }, AArgs, AArgCount);
+}
+
+String _Format(const String& AFmt, const _FormatArg* AArgs, std::size_t AArgCount) {
+    const StringUnit* fmt = AFmt.Raw();
+    std::size_t length = AFmt.RawSize();
+    std::size_t pos = 0;
+    return format_units(fmt, length, [&](_FormatSpec& ASpec) {
+        pos = _ParseFormatSpec(fmt, length, pos, ASpec);
+    }, AArgs, AArgCount);
+}
 
 } // namespace np
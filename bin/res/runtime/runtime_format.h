@@ -6,12 +6,11 @@
 
 #include "runtime_types.h"
 #include "runtime_string.h"
-#include <cstdio>
-#include <vector>
-#include <string>
+#include "runtime_containers.h"
 #include <algorithm>
-#include <cctype>
-#include <tuple>
+#include <array>
+#include <cstdint>
+#include <type_traits>
 
 namespace np {
 
@@ -27,89 +26,268 @@ inline String BoolToStr(const Boolean AValue, const Boolean AUseBoolStrs = true)
     }
 }
 
-// Helper to convert String to std::string and store it
-template<typename T>
-auto store_converted_arg(T&& arg) {
-    using Decay = std::decay_t<T>;
-    if constexpr (std::is_same_v<Decay, String>) {
-        return arg.ToStdString();
-    } else {
-        return std::forward<T>(arg);
+// ============================================================================
+// FORMAT
+// ============================================================================
+// Format(Fmt, [Args]) follows Delphi. Each specifier is
+//
+//   "%" [index ":"] ["-"] [width] ["." prec] type
+//
+// where index (0-based), width and prec are digits or '*' (taken from the
+// next argument), and type is one of d u x e f g n m p s ("%%" writes a
+// percent sign). The arguments are passed by reference as _FormatArg
+// records, Delphi's TVarRec. The text is written once, in the storage
+// encoding, into a buffer sized from the format: literal runs are copied,
+// String and StringView arguments are copied from their storage and
+// numbers are written with std::to_chars. Nothing round-trips through UTF-8
+// or printf.
+//
+// A literal format string is split into its specifiers at compile time:
+// Format('%s=%d', [Key, Value]) is emitted as
+// np::FormatLit<u"%s=%d">(Key, Value), so the call only formats the
+// arguments.
+
+/**
+ * _FormatArg - One Format argument, held by reference or by value
+ */
+struct _FormatArg {
+    enum Kind : uint8_t {
+        Int32,      // ShortInt .. Integer, Byte, Word
+        Int64,      // Int64, Cardinal
+        UInt64,
+        Float,
+        Str,        // String
+        View,       // StringView
+        Chr,        // Char
+        WideText,   // zero-terminated UTF-16 text (PChar)
+        AnsiText,   // zero-terminated UTF-8 text
+        Pointer,
+        Other       // Boolean, enums...: accepted by no specifier
+    };
+
+    Kind kind;
+    union {
+        int64_t           i;
+        uint64_t          u;
+        double            d;
+        const String*     s;
+        const StringView* v;
+        char16_t          c;
+        const void*       p;
+    };
+
+    template<typename T>
+    _FormatArg(const T& AValue) {
+        using V = std::remove_cv_t<T>;
+        if constexpr (std::is_same_v<V, String>) {
+            kind = Str;
+            s = &AValue;
+        } else if constexpr (std::is_same_v<V, StringView>) {
+            kind = View;
+            v = &AValue;
+        } else if constexpr (std::is_same_v<V, char16_t>) {
+            kind = Chr;
+            c = AValue;
+        } else if constexpr (std::is_same_v<V, bool> || std::is_enum_v<V>) {
+            kind = Other;
+            i = 0;
+        } else if constexpr (std::is_integral_v<V> && sizeof(V) < 4) {
+            kind = Int32;
+            i = AValue;
+        } else if constexpr (std::is_integral_v<V> && sizeof(V) == 4) {
+            kind = std::is_signed_v<V> ? Int32 : Int64;
+            i = AValue;
+        } else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+            kind = Int64;
+            i = AValue;
+        } else if constexpr (std::is_integral_v<V>) {
+            kind = UInt64;
+            u = AValue;
+        } else if constexpr (std::is_floating_point_v<V>) {
+            kind = Float;
+            d = static_cast<double>(AValue);
+        } else if constexpr (std::is_convertible_v<const T&, const char16_t*>) {
+            kind = WideText;
+            p = AValue;
+        } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+            kind = AnsiText;
+            p = AValue;
+        } else if constexpr (std::is_pointer_v<V> || std::is_null_pointer_v<V>) {
+            kind = Pointer;
+            p = AValue;
+        } else {
+            kind = Other;
+            i = 0;
+        }
     }
-}
+};
 
-// Helper to get the actual value for snprintf
-template<typename T>
-auto get_snprintf_arg(const T& arg) {
-    if constexpr (std::is_same_v<std::decay_t<T>, std::string>) {
-        return arg.c_str();
-    } else {
-        return arg;
+/**
+ * _FormatSpec - A run of literal text and the specifier that follows it.
+ * type is 0 for the text after the last specifier and '?' for a malformed
+ * specifier; index, width and prec are -1 when absent and -2 for '*'.
+ */
+struct _FormatSpec {
+    uint32_t start = 0;     // literal text: [start, start + count) of the format
+    uint32_t count = 0;
+    int32_t  index = -1;
+    int32_t  width = -1;
+    int32_t  prec  = -1;
+    bool     left  = false;
+    char     type  = 0;
+};
+
+/**
+ * _ParseFormatSpec - Read the literal run and the specifier starting at
+ * APos of AFmt (UTF-16 units or UTF-8 bytes: specifiers are ASCII either
+ * way); returns the position after them
+ */
+template<typename Unit>
+constexpr std::size_t _ParseFormatSpec(const Unit* AFmt, std::size_t ALength, std::size_t APos,
+                                       _FormatSpec& ASpec) {
+    ASpec = _FormatSpec{};
+    ASpec.start = static_cast<uint32_t>(APos);
+    std::size_t i = APos;
+    while (i < ALength && AFmt[i] != '%') {
+        i++;
+    }
+    ASpec.count = static_cast<uint32_t>(i - APos);
+    if (i == ALength) {
+        return ALength;
+    }
+    i++;
+    // Digits or '*': -1 when neither is there
+    auto number = [&]() -> int32_t {
+        if (i < ALength && AFmt[i] == '*') {
+            i++;
+            return -2;
+        }
+        int32_t value = -1;
+        while (i < ALength && AFmt[i] >= '0' && AFmt[i] <= '9') {
+            value = (value < 0 ? 0 : value) * 10 + static_cast<int32_t>(AFmt[i] - '0');
+            if (value > 0xFFFFFF) {
+                value = 0xFFFFFF;
+            }
+            i++;
+        }
+        return value;
+    };
+    if (i < ALength && AFmt[i] == '%') {
+        ASpec.type = '%';
+        return i + 1;
+    }
+    int32_t first = number();
+    if (i < ALength && AFmt[i] == ':') {
+        ASpec.index = first;
+        i++;
+        first = -1;
+    }
+    if (first == -1 && i < ALength && AFmt[i] == '-') {
+        ASpec.left = true;
+        i++;
+    }
+    ASpec.width = first != -1 ? first : number();
+    if (i < ALength && AFmt[i] == '.') {
+        i++;
+        ASpec.prec = number();
+        if (ASpec.prec == -1) {
+            ASpec.prec = 0;
+        }
     }
+    char type = '?';
+    if (i < ALength) {
+        switch (AFmt[i] | 0x20) {
+            case 'd': case 'u': case 'x': case 'e': case 'f':
+            case 'g': case 'n': case 'm': case 'p': case 's':
+                type = static_cast<char>(AFmt[i] | 0x20);
+                i++;
+                break;
+        }
+    }
+    ASpec.type = type;
+    return type == '?' ? ALength : i;
 }
 
+/**
+ * _FormatRun - Format with the specifiers already split out (FormatLit)
+ */
+String _FormatRun(const StringUnit* AFmt, std::size_t ALength,
+                  const _FormatSpec* ASpecs, std::size_t ASpecCount,
+                  const _FormatArg* AArgs, std::size_t AArgCount);
+
+/**
+ * _Format - Format, reading the specifiers as it goes
+ */
+String _Format(const String& AFmt, const _FormatArg* AArgs, std::size_t AArgCount);
+
+/**
+ * Format - Delphi's Format(Fmt, [Args]) with the arguments passed directly
+ */
 template<typename... Args>
-inline String Format(const String& AFmt, Args&&... AArgs) {
-    // Convert np::String format to std::string
-    std::string fmt_str = AFmt.ToStdString();
-    
-    // Store converted arguments (keeps std::strings alive)
-    auto stored_args = std::make_tuple(store_converted_arg(std::forward<Args>(AArgs))...);
-    
-    // First, get the required buffer size
-    int size = std::apply([&](const auto&... args) {
-        return std::snprintf(nullptr, 0, fmt_str.c_str(), get_snprintf_arg(args)...);
-    }, stored_args);
-    
-    if (size < 0) {
-        return String("");
-    }
-    
-    // Allocate buffer and format
-    std::vector<char> buffer(size + 1);
-    std::apply([&](const auto&... args) {
-        std::snprintf(buffer.data(), buffer.size(), fmt_str.c_str(), get_snprintf_arg(args)...);
-    }, stored_args);
-    
-    // Convert result back to np::String
-    return String(std::string(buffer.data()));
+inline String Format(const String& AFmt, const Args&... AArgs) {
+    const _FormatArg args[sizeof...(Args) + 1] = {_FormatArg(AArgs)..., _FormatArg(0)};
+    return _Format(AFmt, args, sizeof...(Args));
 }
 
-inline String StringReplace(const String& AText, const String& AOld, const String& ANew) {
-    std::wstring result = AText.ToWString();
-    std::wstring old_str = AOld.ToWString();
-    std::wstring new_str = ANew.ToWString();
-    
-    if (old_str.empty()) {
-        return AText;
-    }
-    
-    size_t pos = 0;
-    while ((pos = result.find(old_str, pos)) != std::wstring::npos) {
-        result.replace(pos, old_str.length(), new_str);
-        pos += new_str.length();
-    }
-    
-    return String(result);
+// The format text in the storage encoding and its specifiers, worked out
+// by the compiler
+template<_LiteralText Text>
+struct _FormatPlan {
+    static constexpr std::size_t Size = _LiteralBlock<Text>::Size;
+
+    static constexpr std::array<StringUnit, Size + 1> Units = [] {
+        std::array<StringUnit, Size + 1> units{};
+#ifdef NP_STRING_UTF8
+        _EncodeUtf8(Text.units, _LiteralBlock<Text>::Units, units.data());
+#else
+        std::copy_n(Text.units, Size, units.data());
+#endif
+        return units;
+    }();
+
+    static constexpr std::size_t Count = [] {
+        std::size_t count = 0;
+        std::size_t pos = 0;
+        _FormatSpec spec;
+        do {
+            pos = _ParseFormatSpec(Units.data(), Size, pos, spec);
+            count++;
+        } while (spec.type != 0 && spec.type != '?');
+        return count;
+    }();
+
+    static constexpr std::array<_FormatSpec, Count> Specs = [] {
+        std::array<_FormatSpec, Count> specs{};
+        std::size_t pos = 0;
+        for (std::size_t k = 0; k < Count; ++k) {
+            pos = _ParseFormatSpec(Units.data(), Size, pos, specs[k]);
+        }
+        return specs;
+    }();
+};
+
+/**
+ * FormatLit - Format with a literal format string, parsed at compile time
+ */
+template<_LiteralText Text, typename... Args>
+inline String FormatLit(const Args&... AArgs) {
+    using Plan = _FormatPlan<Text>;
+    const _FormatArg args[sizeof...(Args) + 1] = {_FormatArg(AArgs)..., _FormatArg(0)};
+    return _FormatRun(Plan::Units.data(), Plan::Size, Plan::Specs.data(), Plan::Count,
+                      args, sizeof...(Args));
 }
 
-inline Integer CompareStr(const String& A, const String& B) {
-    const std::wstring& a_data = A.ToWString();
-    const std::wstring& b_data = B.ToWString();
-    
-    if (a_data < b_data) return -1;
-    if (a_data > b_data) return 1;
-    return 0;
+// StringReplace(S, Old, New) replaces every match, as it always has here
+inline String StringReplace(const String& AText, const String& AOld, const String& ANew) {
+    return _StringReplace(AText, AOld, ANew, true, false);
 }
 
-inline Boolean SameText(const String& A, const String& B) {
-    std::wstring a_lower = A.ToWString();
-    std::wstring b_lower = B.ToWString();
-    
-    std::transform(a_lower.begin(), a_lower.end(), a_lower.begin(), ::towlower);
-    std::transform(b_lower.begin(), b_lower.end(), b_lower.begin(), ::towlower);
-    
-    return a_lower == b_lower;
+// StringReplace(S, Old, New, [rfReplaceAll, rfIgnoreCase]); [] replaces the
+// first match only, as in Delphi
+template<typename T, Integer Lo, Integer Hi, bool B>
+inline String StringReplace(const String& AText, const String& AOld, const String& ANew,
+                            const Set<T, Lo, Hi, B>& AFlags) {
+    return _StringReplace(AText, AOld, ANew, In(rfReplaceAll, AFlags), In(rfIgnoreCase, AFlags));
 }
 
 inline String QuotedStr(const String& AText) {
@@ -14,14 +14,20 @@ namespace np {
 // ============================================================================
 
 inline Integer Div(Integer a, Integer b) {
-    // No explicit zero check -- let the hardware fault fire so the VEH /
-    // signal handler can catch it as EXC_DIV_BY_ZERO inside a try block.
-    // Outside a try block the process will fault (correct Delphi behaviour).
+    // Checked in software: integer division by zero is undefined behaviour
+    // in C++, and a trap raised inside the same function as the handling
+    // try block cannot be unwound without non-call exception support.
+    if (b == 0) {
+        throw _Exception{EXC_DIV_BY_ZERO, L"Divide by zero"};
+    }
     return a / b;
 }
 
 inline Integer Mod(Integer a, Integer b) {
-    // Same as Div -- hardware fault for divide-by-zero.
+    // Same as Div -- divide-by-zero raises EXC_DIV_BY_ZERO.
+    if (b == 0) {
+        throw _Exception{EXC_DIV_BY_ZERO, L"Divide by zero"};
+    }
     return a % b;
 }
 
@@ -4,102 +4,509 @@
 
 #include "runtime_string.h"
 #include <algorithm>
+#include <bit>
+#include <charconv>
 #include <cctype>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
-#include <sstream>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define NP_SIMD_X86
+#include <immintrin.h>
+#endif
 
 namespace {
-    // Helper: Convert UTF-8 to UTF-16
-    std::u16string utf8_to_utf16(const std::string& utf8) {
-        std::u16string result;
+    // ------------------------------------------------------------------------
+    // Transcoding kernels. ASCII runs are found, widened and narrowed 16
+    // (SSE2) or 32 (AVX2) units at a time, and the output size is counted
+    // with SSE2. The first call picks the widest set the CPU supports.
+    // ------------------------------------------------------------------------
+
+    // Helper: Length of the leading run of ASCII bytes (8 bytes per step)
+    size_t ascii_prefix8_scalar(const char* s, size_t n) {
         size_t i = 0;
-        while (i < utf8.size()) {
-            uint32_t codepoint = 0;
-            unsigned char ch = utf8[i];
-            
-            if (ch <= 0x7F) {
-                codepoint = ch;
-                i++;
-            } else if ((ch & 0xE0) == 0xC0) {
-                if (i + 1 < utf8.size()) {
-                    codepoint = ((ch & 0x1F) << 6) | (utf8[i + 1] & 0x3F);
-                    i += 2;
-                } else break;
-            } else if ((ch & 0xF0) == 0xE0) {
-                if (i + 2 < utf8.size()) {
-                    codepoint = ((ch & 0x0F) << 12) | 
-                               ((utf8[i + 1] & 0x3F) << 6) | 
-                               (utf8[i + 2] & 0x3F);
-                    i += 3;
-                } else break;
-            } else if ((ch & 0xF8) == 0xF0) {
-                if (i + 3 < utf8.size()) {
-                    codepoint = ((ch & 0x07) << 18) | 
-                               ((utf8[i + 1] & 0x3F) << 12) | 
-                               ((utf8[i + 2] & 0x3F) << 6) | 
-                               (utf8[i + 3] & 0x3F);
-                    i += 4;
-                } else break;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, s + i, 8);
+            if (word & 0x8080808080808080ULL) {
+                break;
+            }
+        }
+        while (i < n && static_cast<unsigned char>(s[i]) < 0x80) {
+            i++;
+        }
+        return i;
+    }
+
+    // Helper: Length of the leading run of ASCII units (4 units per step)
+    size_t ascii_prefix16_scalar(const char16_t* s, size_t n) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            uint64_t word;
+            std::memcpy(&word, s + i, 8);
+            if (word & 0xFF80FF80FF80FF80ULL) {
+                break;
+            }
+        }
+        while (i < n && s[i] < 0x80) {
+            i++;
+        }
+        return i;
+    }
+
+    // Helper: Copy n ASCII bytes to UTF-16 units
+    void widen_scalar(const char* s, size_t n, char16_t* out) {
+        std::copy_n(reinterpret_cast<const unsigned char*>(s), n, out);
+    }
+
+    // Helper: Copy n ASCII units to bytes
+    void narrow_scalar(const char16_t* s, size_t n, char* out) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<char>(s[i]);
+        }
+    }
+
+#if !defined(NP_SIMD_X86)
+    // Helper: Number of UTF-8 bytes n UTF-16 units encode to
+    size_t utf8_length_scalar(const char16_t* s, size_t n) {
+        return np::_Utf8Length(s, n);
+    }
+#endif
+
+    // Helper: Number of UTF-16 units n bytes of valid UTF-8 decode to: one
+    // per byte that is not a continuation byte, and one more per 4-byte lead
+    size_t utf16_length_scalar(const char* s, size_t n) {
+        size_t units = 0;
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char ch = static_cast<unsigned char>(s[i]);
+            units += ((ch & 0xC0) != 0x80) + (ch >= 0xF0);
+        }
+        return units;
+    }
+
+#if defined(NP_SIMD_X86)
+
+    size_t ascii_prefix8_sse2(const char* s, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            if (int mask = _mm_movemask_epi8(v)) {
+                return i + std::countr_zero(static_cast<unsigned>(mask));
+            }
+        }
+        return i + ascii_prefix8_scalar(s + i, n - i);
+    }
+
+    size_t ascii_prefix16_sse2(const char16_t* s, size_t n) {
+        const __m128i above7f = _mm_set1_epi16(static_cast<short>(0xFF80));
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(v, above7f), _mm_setzero_si128());
+            if (unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(ascii)) & 0xFFFF) {
+                return i + std::countr_zero(mask) / 2;
+            }
+        }
+        return i + ascii_prefix16_scalar(s + i, n - i);
+    }
+
+    void widen_sse2(const char* s, size_t n, char16_t* out) {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(v, zero));
+        }
+        widen_scalar(s + i, n - i, out + i);
+    }
+
+    void narrow_sse2(const char16_t* s, size_t n, char* out) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+        }
+        narrow_scalar(s + i, n - i, out + i);
+    }
+
+    // Each unit encodes to 3 bytes, one less below U+0800 and one less again
+    // below U+0080. A surrogate pair would count 3 + 3 but encodes to 4, so
+    // a high surrogate directly followed by a low one (exactly the pairs
+    // _DecodeUtf16 forms) takes off 2. The compare masks are -1 per lane and
+    // are summed in 16-bit lanes, flushed before they can overflow.
+    size_t utf8_length_sse2(const char16_t* s, size_t n) {
+        const __m128i above7f  = _mm_set1_epi16(static_cast<short>(0xFF80));
+        const __m128i above7ff = _mm_set1_epi16(static_cast<short>(0xF800));
+        const __m128i tenbits  = _mm_set1_epi16(static_cast<short>(0xFC00));
+        const __m128i high     = _mm_set1_epi16(static_cast<short>(0xD800));
+        const __m128i low      = _mm_set1_epi16(static_cast<short>(0xDC00));
+        const __m128i zero     = _mm_setzero_si128();
+        int64_t bytes = 0;
+        size_t i = 0;
+        // The pair test reads one unit ahead; the scalar tail pairs the rest
+        while (i + 9 <= n) {
+            __m128i acc = zero;
+            for (int block = 0; block < 4096 && i + 9 <= n; ++block, i += 8) {
+                __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 1));
+                __m128i below80  = _mm_cmpeq_epi16(_mm_and_si128(v, above7f), zero);
+                __m128i below800 = _mm_cmpeq_epi16(_mm_and_si128(v, above7ff), zero);
+                __m128i pair = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(v, tenbits), high),
+                                             _mm_cmpeq_epi16(_mm_and_si128(next, tenbits), low));
+                acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_add_epi16(below80, below800),
+                                                       _mm_add_epi16(pair, pair)));
+                bytes += 8 * 3;
+            }
+            __m128i sum = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            bytes += _mm_cvtsi128_si32(sum);
+        }
+        return static_cast<size_t>(bytes) + np::_Utf8Length(s + i, n - i);
+    }
+
+    // Continuation bytes (0x80-0xBF) are the signed bytes below -64, and
+    // 4-byte leads (0xF0-0xFF) the unsigned bytes whose max with 0xF0 is
+    // themselves. Both are counted in 8-bit lanes, flushed with a sum of
+    // absolute differences.
+    size_t utf16_length_sse2(const char* s, size_t n) {
+        const __m128i contMax  = _mm_set1_epi8(-64);
+        const __m128i fourMin  = _mm_set1_epi8(static_cast<char>(0xF0));
+        const __m128i zero     = _mm_setzero_si128();
+        size_t units = 0;
+        size_t i = 0;
+        while (i + 16 <= n) {
+            __m128i cont = zero;
+            __m128i four = zero;
+            for (int block = 0; block < 255 && i + 16 <= n; ++block, i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                cont = _mm_sub_epi8(cont, _mm_cmpgt_epi8(contMax, v));
+                four = _mm_sub_epi8(four, _mm_cmpeq_epi8(_mm_max_epu8(v, fourMin), v));
+                units += 16;
+            }
+            __m128i sum = _mm_sub_epi64(_mm_sad_epu8(four, zero), _mm_sad_epu8(cont, zero));
+            sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+            units += static_cast<size_t>(_mm_cvtsi128_si64(sum));
+        }
+        return units + utf16_length_scalar(s + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    size_t ascii_prefix8_avx2(const char* s, size_t n) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            if (int mask = _mm256_movemask_epi8(v)) {
+                return i + std::countr_zero(static_cast<unsigned>(mask));
+            }
+        }
+        // GCC emits no vzeroupper before the call into SSE code; a dirty upper
+        // half would slow every later SSE instruction in the program
+        _mm256_zeroupper();
+        return i + ascii_prefix8_sse2(s + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    size_t ascii_prefix16_avx2(const char16_t* s, size_t n) {
+        const __m256i above7f = _mm256_set1_epi16(static_cast<short>(0xFF80));
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            __m256i ascii = _mm256_cmpeq_epi16(_mm256_and_si256(v, above7f), _mm256_setzero_si256());
+            if (unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ascii))) {
+                return i + std::countr_zero(mask) / 2;
+            }
+        }
+        _mm256_zeroupper();  // as in ascii_prefix8_avx2
+        return i + ascii_prefix16_sse2(s + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    void widen_avx2(const char* s, size_t n, char16_t* out) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 16));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtepu8_epi16(lo));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), _mm256_cvtepu8_epi16(hi));
+        }
+        _mm256_zeroupper();  // as in ascii_prefix8_avx2
+        widen_sse2(s + i, n - i, out + i);
+    }
+
+    __attribute__((target("avx2")))
+    void narrow_avx2(const char16_t* s, size_t n, char* out) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 16));
+            // packus works per 128-bit lane; restore the unit order after it
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+        }
+        _mm256_zeroupper();  // as in ascii_prefix8_avx2
+        narrow_sse2(s + i, n - i, out + i);
+    }
+
+#endif // NP_SIMD_X86
+
+    // Helper: The transcoding kernels chosen for this CPU
+    struct TranscodeKernels {
+        size_t (*ascii_prefix8)(const char*, size_t);
+        size_t (*ascii_prefix16)(const char16_t*, size_t);
+        void   (*widen)(const char*, size_t, char16_t*);
+        void   (*narrow)(const char16_t*, size_t, char*);
+        size_t (*utf8_length)(const char16_t*, size_t);
+        size_t (*utf16_length)(const char*, size_t);
+    };
+
+    TranscodeKernels select_kernels() {
+#if defined(NP_SIMD_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {ascii_prefix8_avx2, ascii_prefix16_avx2, widen_avx2, narrow_avx2,
+                    utf8_length_sse2, utf16_length_sse2};
+        }
+        return {ascii_prefix8_sse2, ascii_prefix16_sse2, widen_sse2, narrow_sse2,
+                utf8_length_sse2, utf16_length_sse2};
+#else
+        return {ascii_prefix8_scalar, ascii_prefix16_scalar, widen_scalar, narrow_scalar,
+                utf8_length_scalar, utf16_length_scalar};
+#endif
+    }
+
+    // A function-local static, so strings built during static initialization
+    // of other translation units already see the kernels
+    const TranscodeKernels& kernels() {
+        static const TranscodeKernels selected = select_kernels();
+        return selected;
+    }
+
+    // Helper: End of the ASCII run starting at s[i]. Short runs (spaces and
+    // punctuation between words) are cheaper to find here than in a kernel.
+    template<typename Unit, typename Kernel>
+    inline size_t ascii_run(const Unit* s, size_t i, size_t n, Kernel AKernel) {
+        size_t stop = std::min(n, i + 16);
+        while (i < stop && static_cast<std::make_unsigned_t<Unit>>(s[i]) < 0x80) {
+            i++;
+        }
+        if (i == stop && i < n) {
+            i += AKernel(s + i, n - i);
+        }
+        return i;
+    }
+
+    // ------------------------------------------------------------------------
+    // UTF-8 decoding is strict: overlong forms, surrogates, code points above
+    // U+10FFFF, stray continuation bytes and truncated sequences each become
+    // one U+FFFD per maximal invalid subpart, as the Unicode standard
+    // recommends. Valid input takes the fast path; malformed input is then
+    // decoded again by the replacing decoder.
+    // ------------------------------------------------------------------------
+
+    inline bool is_continuation(unsigned char ch) {
+        return (ch & 0xC0) == 0x80;
+    }
+
+    // Helper: Decode valid UTF-8 to out, which has utf16_length() units of
+    // room (nothing is written when Write is false); false at the first
+    // malformed sequence
+    template<bool Write>
+    bool decode_utf8_valid(const char* utf8, size_t n, char16_t* out) {
+        const auto* s = reinterpret_cast<const unsigned char*>(utf8);
+        const TranscodeKernels& k = kernels();
+        size_t i = 0;
+        while (i < n) {
+            uint32_t lead = s[i];
+            if (lead < 0x80) {
+                size_t end = ascii_run(utf8, i, n, k.ascii_prefix8);
+                if constexpr (Write) {
+                    if (end - i < 16) {
+                        widen_scalar(utf8 + i, end - i, out);
+                    } else {
+                        k.widen(utf8 + i, end - i, out);
+                    }
+                    out += end - i;
+                }
+                i = end;
+            } else if (lead < 0xE0) {
+                if (lead < 0xC2 || i + 1 >= n || !is_continuation(s[i + 1])) {
+                    return false;
+                }
+                if constexpr (Write) {
+                    *out++ = static_cast<char16_t>(((lead & 0x1F) << 6) | (s[i + 1] & 0x3F));
+                }
+                i += 2;
+            } else if (lead < 0xF0) {
+                if (i + 2 >= n || !is_continuation(s[i + 1]) || !is_continuation(s[i + 2])) {
+                    return false;
+                }
+                uint32_t codepoint = ((lead & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+                if (codepoint < 0x800 || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+                    return false;
+                }
+                if constexpr (Write) {
+                    *out++ = static_cast<char16_t>(codepoint);
+                }
+                i += 3;
             } else {
-                i++;
-                continue;
+                if (lead > 0xF4 || i + 3 >= n || !is_continuation(s[i + 1]) ||
+                    !is_continuation(s[i + 2]) || !is_continuation(s[i + 3])) {
+                    return false;
+                }
+                uint32_t codepoint = ((lead & 0x07) << 18) | ((s[i + 1] & 0x3F) << 12) |
+                                     ((s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F);
+                if (codepoint < 0x10000 || codepoint > 0x10FFFF) {
+                    return false;
+                }
+                if constexpr (Write) {
+                    codepoint -= 0x10000;
+                    *out++ = static_cast<char16_t>(0xD800 + (codepoint >> 10));
+                    *out++ = static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF));
+                }
+                i += 4;
+            }
+        }
+        return true;
+    }
+
+    constexpr uint32_t INVALID_UTF8 = 0xFFFFFFFF;
+
+    // Helper: Decode the sequence at s[i] (not ASCII) and advance past it,
+    // stopping at the first byte that cannot continue it; INVALID_UTF8 if
+    // the bytes consumed are not a whole sequence
+    uint32_t decode_utf8_one(const unsigned char* s, size_t n, size_t& i) {
+        unsigned char lead = s[i++];
+        uint32_t codepoint;
+        int follow;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            codepoint = lead & 0x1F;
+            follow = 1;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            codepoint = lead & 0x0F;
+            follow = 2;
+            if (lead == 0xE0) lo = 0xA0;          // overlong
+            else if (lead == 0xED) hi = 0x9F;     // surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            codepoint = lead & 0x07;
+            follow = 3;
+            if (lead == 0xF0) lo = 0x90;          // overlong
+            else if (lead == 0xF4) hi = 0x8F;     // above U+10FFFF
+        } else {
+            return INVALID_UTF8;
+        }
+        for (; follow > 0; --follow) {
+            if (i >= n || s[i] < lo || s[i] > hi) {
+                return INVALID_UTF8;
+            }
+            codepoint = (codepoint << 6) | (s[i++] & 0x3F);
+            lo = 0x80;
+            hi = 0xBF;
+        }
+        return codepoint;
+    }
+
+    // Helper: Decode possibly malformed UTF-8, passing each code point (or
+    // U+FFFD for each invalid subpart) to AEmit
+    template<typename Emit>
+    void decode_utf8_replacing(const char* utf8, size_t n, Emit&& AEmit) {
+        const auto* s = reinterpret_cast<const unsigned char*>(utf8);
+        size_t i = 0;
+        while (i < n) {
+            if (s[i] < 0x80) {
+                AEmit(s[i++]);
+            } else {
+                uint32_t codepoint = decode_utf8_one(s, n, i);
+                AEmit(codepoint == INVALID_UTF8 ? 0xFFFD : codepoint);
             }
-            
+        }
+    }
+
+    // Helper: Convert UTF-8 to UTF-16
+    np::StringBuffer<char16_t> utf8_to_utf16(const char* utf8, size_t n) {
+        np::StringBuffer<char16_t> result;
+        const TranscodeKernels& k = kernels();
+        size_t prefix = k.ascii_prefix8(utf8, n);
+        char16_t* out = result.Overwrite(prefix + k.utf16_length(utf8 + prefix, n - prefix));
+        k.widen(utf8, prefix, out);
+        if (prefix == n || decode_utf8_valid<true>(utf8 + prefix, n - prefix, out + prefix)) {
+            return result;
+        }
+        size_t units = 0;
+        decode_utf8_replacing(utf8, n, [&](uint32_t codepoint) {
+            units += (codepoint > 0xFFFF) ? 2 : 1;
+        });
+        out = result.Overwrite(units);
+        decode_utf8_replacing(utf8, n, [&](uint32_t codepoint) {
             if (codepoint <= 0xFFFF) {
-                result += static_cast<char16_t>(codepoint);
+                *out++ = static_cast<char16_t>(codepoint);
             } else {
                 codepoint -= 0x10000;
-                result += static_cast<char16_t>(0xD800 + (codepoint >> 10));
-                result += static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF));
+                *out++ = static_cast<char16_t>(0xD800 + (codepoint >> 10));
+                *out++ = static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF));
             }
-        }
+        });
         return result;
     }
-    
-    // Helper: Convert UTF-16 to UTF-8
-    std::string utf16_to_utf8(const std::u16string& utf16) {
-        std::string result;
+
+    // Helper: Number of UTF-8 bytes n UTF-16 units encode to
+    size_t utf8_length(const char16_t* utf16, size_t n) {
+        const TranscodeKernels& k = kernels();
+        size_t prefix = k.ascii_prefix16(utf16, n);
+        return prefix + (prefix == n ? 0 : k.utf8_length(utf16 + prefix, n - prefix));
+    }
+
+    // Helper: Write n UTF-16 units as UTF-8 to out, which has utf8_length()
+    // bytes of room; an unpaired surrogate becomes U+FFFD
+    void encode_utf8(const char16_t* utf16, size_t n, char* out) {
+        const TranscodeKernels& k = kernels();
         size_t i = 0;
-        while (i < utf16.size()) {
-            uint32_t codepoint = utf16[i];
-            
-            if (codepoint >= 0xD800 && codepoint <= 0xDBFF && i + 1 < utf16.size()) {
-                uint32_t high = codepoint;
-                uint32_t low = utf16[i + 1];
-                if (low >= 0xDC00 && low <= 0xDFFF) {
-                    codepoint = 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
-                    i += 2;
-                } else {
-                    i++;
-                    continue;
-                }
+        while (i < n) {
+            size_t end = ascii_run(utf16, i, n, k.ascii_prefix16);
+            if (end - i < 16) {
+                narrow_scalar(utf16 + i, end - i, out);
             } else {
-                i++;
+                k.narrow(utf16 + i, end - i, out);
             }
-            
-            if (codepoint <= 0x7F) {
-                result += static_cast<char>(codepoint);
-            } else if (codepoint <= 0x7FF) {
-                result += static_cast<char>(0xC0 | (codepoint >> 6));
-                result += static_cast<char>(0x80 | (codepoint & 0x3F));
-            } else if (codepoint <= 0xFFFF) {
-                result += static_cast<char>(0xE0 | (codepoint >> 12));
-                result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-                result += static_cast<char>(0x80 | (codepoint & 0x3F));
-            } else {
-                result += static_cast<char>(0xF0 | (codepoint >> 18));
-                result += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
-                result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-                result += static_cast<char>(0x80 | (codepoint & 0x3F));
+            out += end - i;
+            // A surrogate pair never contains an ASCII unit, so each
+            // non-ASCII run can be encoded on its own
+            i = end;
+            while (end < n && utf16[end] >= 0x80) {
+                end++;
             }
+            out = np::_EncodeUtf8(utf16 + i, end - i, out);
+            i = end;
         }
+    }
+
+    // Helper: Convert UTF-16 to a UTF-8 std::string
+    [[maybe_unused]] std::string utf16_to_std_string(const char16_t* utf16, size_t n) {
+        std::string result(utf8_length(utf16, n), '\0');
+        encode_utf8(utf16, n, result.data());
+        return result;
+    }
+
+    // Helper: Convert UTF-16 to UTF-8
+    [[maybe_unused]] np::StringBuffer<char> utf16_to_utf8(const char16_t* utf16, size_t n) {
+        np::StringBuffer<char> result;
+        encode_utf8(utf16, n, result.Overwrite(utf8_length(utf16, n)));
         return result;
     }
     
     // Helper: Convert UTF-16 to wstring
-    std::wstring utf16_to_wstring(const std::u16string& utf16) {
+    std::wstring utf16_to_wstring(std::u16string_view utf16) {
 #ifdef _WIN32
-        return std::wstring(reinterpret_cast<const wchar_t*>(utf16.c_str()), utf16.length());
+        return std::wstring(reinterpret_cast<const wchar_t*>(utf16.data()), utf16.length());
 #else
         std::wstring result;
         result.reserve(utf16.size());
@@ -123,118 +530,1634 @@ namespace {
         return result;
 #endif
     }
+    
+    // Helper: Code unit as an unsigned value (char is signed on most targets)
+    template<typename Unit>
+    inline uint32_t unit_value(Unit ch) {
+        return static_cast<std::make_unsigned_t<Unit>>(ch);
+    }
+    
+    // Helper: Units removed by Trim: the space and every control character,
+    // as in Delphi (S[I] <= ' ')
+    inline bool is_space(np::StringUnit ch) {
+        return unit_value(ch) <= ' ';
+    }
+    
+    // ------------------------------------------------------------------------
+    // Case mapping. UpperCase, LowerCase, CompareText and SameText only map
+    // 'a'..'z' and 'A'..'Z', as in Delphi, and work on the stored units in
+    // place of a transcoded copy, 8 UTF-16 units or 16 bytes per SSE2 step.
+    // The Ansi* forms map every BMP character that has a one-to-one case
+    // mapping through two-stage tables built from the runs below on first
+    // use; ASCII runs still take the vector path. Nothing allocates unless
+    // a result differs from its argument.
+    // ------------------------------------------------------------------------
+    
+#if defined(NP_SIMD_X86)
+    // Helper: All-ones lanes where AUnits (8 x 16-bit or 16 x 8-bit) holds
+    // one of ALo..ALo+25
+    template<typename Unit>
+    inline __m128i ascii_letters(__m128i AUnits, Unit ALo) {
+        if constexpr (sizeof(Unit) == 2) {
+            __m128i offset = _mm_sub_epi16(AUnits, _mm_set1_epi16(static_cast<short>(ALo)));
+            return _mm_cmpeq_epi16(_mm_subs_epu16(offset, _mm_set1_epi16(25)), _mm_setzero_si128());
+        } else {
+            __m128i offset = _mm_sub_epi8(AUnits, _mm_set1_epi8(static_cast<char>(ALo)));
+            return _mm_cmpeq_epi8(_mm_subs_epu8(offset, _mm_set1_epi8(25)), _mm_setzero_si128());
+        }
+    }
+    
+    // Helper: 'a'..'z' as 'A'..'Z', leaving every other unit alone
+    template<typename Unit>
+    inline __m128i ascii_upper(__m128i AUnits) {
+        __m128i bit = sizeof(Unit) == 2 ? _mm_set1_epi16(0x20) : _mm_set1_epi8(0x20);
+        return _mm_xor_si128(AUnits, _mm_and_si128(ascii_letters(AUnits, static_cast<Unit>('a')), bit));
+    }
+#endif
+    
+    // Helper: 'a'..'z' as 'A'..'Z' for one unit
+    inline uint32_t ascii_upper(uint32_t c) {
+        return (c - 'a' <= 'z' - 'a') ? c - 0x20 : c;
+    }
+    
+    // Helper: Index of the first unit of s in ALo..ALo+25, or n
+    template<typename Unit>
+    size_t find_ascii_letter(const Unit* s, size_t n, Unit ALo) {
+        size_t i = 0;
+#if defined(NP_SIMD_X86)
+        constexpr size_t STEP = 16 / sizeof(Unit);
+        for (; i + STEP <= n; i += STEP) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(ascii_letters(v, ALo)));
+            if (mask != 0) {
+                return i + static_cast<size_t>(std::countr_zero(mask)) / sizeof(Unit);
+            }
+        }
+#endif
+        while (i < n && unit_value(s[i]) - unit_value(ALo) > 25) {
+            i++;
+        }
+        return i;
+    }
+    
+    // Helper: Switch the case of every unit of s in ALo..ALo+25 (the letters
+    // of one case differ from the other only in bit 5)
+    template<typename Unit>
+    void toggle_ascii_letters(Unit* s, size_t n, Unit ALo) {
+        size_t i = 0;
+#if defined(NP_SIMD_X86)
+        constexpr size_t STEP = 16 / sizeof(Unit);
+        __m128i bit = sizeof(Unit) == 2 ? _mm_set1_epi16(0x20) : _mm_set1_epi8(0x20);
+        for (; i + STEP <= n; i += STEP) {
+            __m128i* p = reinterpret_cast<__m128i*>(s + i);
+            __m128i v = _mm_loadu_si128(p);
+            _mm_storeu_si128(p, _mm_xor_si128(v, _mm_and_si128(ascii_letters(v, ALo), bit)));
+        }
+#endif
+        for (; i < n; ++i) {
+            if (unit_value(s[i]) - unit_value(ALo) <= 25) {
+                s[i] = static_cast<Unit>(s[i] ^ 0x20);
+            }
+        }
+    }
+    
+    // Helper: UpperCase (ALo = 'a') or LowerCase (ALo = 'A'); a string with
+    // nothing to change is returned shared rather than copied
+    np::String ascii_case(const np::String& s, np::StringUnit ALo) {
+        size_t n = s.RawSize();
+        size_t i = find_ascii_letter(s.Raw(), n, ALo);
+        if (i == n) {
+            return s;
+        }
+        np::String result = s;
+        toggle_ascii_letters(result.MutableRaw() + i, n - i, ALo);
+        return result;
+    }
+    
+    // Helper: CompareText of two unit runs: 'a'..'z' compare as 'A'..'Z'
+    template<typename Unit>
+    np::Integer compare_ascii_text(const Unit* a, size_t na, const Unit* b, size_t nb) {
+        size_t n = std::min(na, nb);
+        size_t i = 0;
+#if defined(NP_SIMD_X86)
+        constexpr size_t STEP = 16 / sizeof(Unit);
+        for (; i + STEP <= n; i += STEP) {
+            __m128i va = ascii_upper<Unit>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+            __m128i vb = ascii_upper<Unit>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) ^ 0xFFFFu;
+            if (mask != 0) {
+                i += static_cast<size_t>(std::countr_zero(mask)) / sizeof(Unit);
+                break;
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            uint32_t ca = ascii_upper(unit_value(a[i]));
+            uint32_t cb = ascii_upper(unit_value(b[i]));
+            if (ca != cb) {
+                return ca < cb ? -1 : 1;
+            }
+        }
+        return na < nb ? -1 : (na > nb ? 1 : 0);
+    }
+    
+    // A run of characters first..last (every stride-th one) whose case
+    // mapping adds delta to the code point
+    struct CaseRun {
+        char16_t first;
+        char16_t last;
+        int      delta;
+        int      stride;
+    };
+    
+    // One-to-one case mappings of the BMP (Unicode 14), as runs
+    constexpr CaseRun UPPER_RUNS[] = {
+        {0x0061, 0x007A, -32, 1}, {0x00B5, 0x00B5, 743, 1}, {0x00E0, 0x00F6, -32, 1},
+        {0x00F8, 0x00FE, -32, 1}, {0x00FF, 0x00FF, 121, 1}, {0x0101, 0x012F, -1, 2},
+        {0x0131, 0x0131, -232, 1}, {0x0133, 0x0137, -1, 2}, {0x013A, 0x0148, -1, 2},
+        {0x014B, 0x0177, -1, 2}, {0x017A, 0x017E, -1, 2}, {0x017F, 0x017F, -300, 1},
+        {0x0180, 0x0180, 195, 1}, {0x0183, 0x0185, -1, 2}, {0x0188, 0x0188, -1, 1},
+        {0x018C, 0x018C, -1, 1}, {0x0192, 0x0192, -1, 1}, {0x0195, 0x0195, 97, 1},
+        {0x0199, 0x0199, -1, 1}, {0x019A, 0x019A, 163, 1}, {0x019E, 0x019E, 130, 1},
+        {0x01A1, 0x01A5, -1, 2}, {0x01A8, 0x01A8, -1, 1}, {0x01AD, 0x01AD, -1, 1},
+        {0x01B0, 0x01B0, -1, 1}, {0x01B4, 0x01B6, -1, 2}, {0x01B9, 0x01B9, -1, 1},
+        {0x01BD, 0x01BD, -1, 1}, {0x01BF, 0x01BF, 56, 1}, {0x01C5, 0x01C5, -1, 1},
+        {0x01C6, 0x01C6, -2, 1}, {0x01C8, 0x01C8, -1, 1}, {0x01C9, 0x01C9, -2, 1},
+        {0x01CB, 0x01CB, -1, 1}, {0x01CC, 0x01CC, -2, 1}, {0x01CE, 0x01DC, -1, 2},
+        {0x01DD, 0x01DD, -79, 1}, {0x01DF, 0x01EF, -1, 2}, {0x01F2, 0x01F2, -1, 1},
+        {0x01F3, 0x01F3, -2, 1}, {0x01F5, 0x01F5, -1, 1}, {0x01F9, 0x021F, -1, 2},
+        {0x0223, 0x0233, -1, 2}, {0x023C, 0x023C, -1, 1}, {0x023F, 0x0240, 10815, 1},
+        {0x0242, 0x0242, -1, 1}, {0x0247, 0x024F, -1, 2}, {0x0250, 0x0250, 10783, 1},
+        {0x0251, 0x0251, 10780, 1}, {0x0252, 0x0252, 10782, 1}, {0x0253, 0x0253, -210, 1},
+        {0x0254, 0x0254, -206, 1}, {0x0256, 0x0257, -205, 1}, {0x0259, 0x0259, -202, 1},
+        {0x025B, 0x025B, -203, 1}, {0x025C, 0x025C, 42319, 1}, {0x0260, 0x0260, -205, 1},
+        {0x0261, 0x0261, 42315, 1}, {0x0263, 0x0263, -207, 1}, {0x0265, 0x0265, 42280, 1},
+        {0x0266, 0x0266, 42308, 1}, {0x0268, 0x0268, -209, 1}, {0x0269, 0x0269, -211, 1},
+        {0x026A, 0x026A, 42308, 1}, {0x026B, 0x026B, 10743, 1}, {0x026C, 0x026C, 42305, 1},
+        {0x026F, 0x026F, -211, 1}, {0x0271, 0x0271, 10749, 1}, {0x0272, 0x0272, -213, 1},
+        {0x0275, 0x0275, -214, 1}, {0x027D, 0x027D, 10727, 1}, {0x0280, 0x0280, -218, 1},
+        {0x0282, 0x0282, 42307, 1}, {0x0283, 0x0283, -218, 1}, {0x0287, 0x0287, 42282, 1},
+        {0x0288, 0x0288, -218, 1}, {0x0289, 0x0289, -69, 1}, {0x028A, 0x028B, -217, 1},
+        {0x028C, 0x028C, -71, 1}, {0x0292, 0x0292, -219, 1}, {0x029D, 0x029D, 42261, 1},
+        {0x029E, 0x029E, 42258, 1}, {0x0345, 0x0345, 84, 1}, {0x0371, 0x0373, -1, 2},
+        {0x0377, 0x0377, -1, 1}, {0x037B, 0x037D, 130, 1}, {0x03AC, 0x03AC, -38, 1},
+        {0x03AD, 0x03AF, -37, 1}, {0x03B1, 0x03C1, -32, 1}, {0x03C2, 0x03C2, -31, 1},
+        {0x03C3, 0x03CB, -32, 1}, {0x03CC, 0x03CC, -64, 1}, {0x03CD, 0x03CE, -63, 1},
+        {0x03D0, 0x03D0, -62, 1}, {0x03D1, 0x03D1, -57, 1}, {0x03D5, 0x03D5, -47, 1},
+        {0x03D6, 0x03D6, -54, 1}, {0x03D7, 0x03D7, -8, 1}, {0x03D9, 0x03EF, -1, 2},
+        {0x03F0, 0x03F0, -86, 1}, {0x03F1, 0x03F1, -80, 1}, {0x03F2, 0x03F2, 7, 1},
+        {0x03F3, 0x03F3, -116, 1}, {0x03F5, 0x03F5, -96, 1}, {0x03F8, 0x03F8, -1, 1},
+        {0x03FB, 0x03FB, -1, 1}, {0x0430, 0x044F, -32, 1}, {0x0450, 0x045F, -80, 1},
+        {0x0461, 0x0481, -1, 2}, {0x048B, 0x04BF, -1, 2}, {0x04C2, 0x04CE, -1, 2},
+        {0x04CF, 0x04CF, -15, 1}, {0x04D1, 0x052F, -1, 2}, {0x0561, 0x0586, -48, 1},
+        {0x10D0, 0x10FA, 3008, 1}, {0x10FD, 0x10FF, 3008, 1}, {0x13F8, 0x13FD, -8, 1},
+        {0x1C80, 0x1C80, -6254, 1}, {0x1C81, 0x1C81, -6253, 1}, {0x1C82, 0x1C82, -6244, 1},
+        {0x1C83, 0x1C84, -6242, 1}, {0x1C85, 0x1C85, -6243, 1}, {0x1C86, 0x1C86, -6236, 1},
+        {0x1C87, 0x1C87, -6181, 1}, {0x1C88, 0x1C88, 35266, 1}, {0x1D79, 0x1D79, 35332, 1},
+        {0x1D7D, 0x1D7D, 3814, 1}, {0x1D8E, 0x1D8E, 35384, 1}, {0x1E01, 0x1E95, -1, 2},
+        {0x1E9B, 0x1E9B, -59, 1}, {0x1EA1, 0x1EFF, -1, 2}, {0x1F00, 0x1F07, 8, 1},
+        {0x1F10, 0x1F15, 8, 1}, {0x1F20, 0x1F27, 8, 1}, {0x1F30, 0x1F37, 8, 1},
+        {0x1F40, 0x1F45, 8, 1}, {0x1F51, 0x1F57, 8, 2}, {0x1F60, 0x1F67, 8, 1},
+        {0x1F70, 0x1F71, 74, 1}, {0x1F72, 0x1F75, 86, 1}, {0x1F76, 0x1F77, 100, 1},
+        {0x1F78, 0x1F79, 128, 1}, {0x1F7A, 0x1F7B, 112, 1}, {0x1F7C, 0x1F7D, 126, 1},
+        {0x1FB0, 0x1FB1, 8, 1}, {0x1FBE, 0x1FBE, -7205, 1}, {0x1FD0, 0x1FD1, 8, 1},
+        {0x1FE0, 0x1FE1, 8, 1}, {0x1FE5, 0x1FE5, 7, 1}, {0x214E, 0x214E, -28, 1},
+        {0x2170, 0x217F, -16, 1}, {0x2184, 0x2184, -1, 1}, {0x24D0, 0x24E9, -26, 1},
+        {0x2C30, 0x2C5F, -48, 1}, {0x2C61, 0x2C61, -1, 1}, {0x2C65, 0x2C65, -10795, 1},
+        {0x2C66, 0x2C66, -10792, 1}, {0x2C68, 0x2C6C, -1, 2}, {0x2C73, 0x2C73, -1, 1},
+        {0x2C76, 0x2C76, -1, 1}, {0x2C81, 0x2CE3, -1, 2}, {0x2CEC, 0x2CEE, -1, 2},
+        {0x2CF3, 0x2CF3, -1, 1}, {0x2D00, 0x2D25, -7264, 1}, {0x2D27, 0x2D27, -7264, 1},
+        {0x2D2D, 0x2D2D, -7264, 1}, {0xA641, 0xA66D, -1, 2}, {0xA681, 0xA69B, -1, 2},
+        {0xA723, 0xA72F, -1, 2}, {0xA733, 0xA76F, -1, 2}, {0xA77A, 0xA77C, -1, 2},
+        {0xA77F, 0xA787, -1, 2}, {0xA78C, 0xA78C, -1, 1}, {0xA791, 0xA793, -1, 2},
+        {0xA794, 0xA794, 48, 1}, {0xA797, 0xA7A9, -1, 2}, {0xA7B5, 0xA7C3, -1, 2},
+        {0xA7C8, 0xA7CA, -1, 2}, {0xA7D1, 0xA7D1, -1, 1}, {0xA7D7, 0xA7D9, -1, 2},
+        {0xA7F6, 0xA7F6, -1, 1}, {0xAB53, 0xAB53, -928, 1}, {0xAB70, 0xABBF, -38864, 1},
+        {0xFF41, 0xFF5A, -32, 1},
+    };
+    constexpr CaseRun LOWER_RUNS[] = {
+        {0x0041, 0x005A, 32, 1}, {0x00C0, 0x00D6, 32, 1}, {0x00D8, 0x00DE, 32, 1},
+        {0x0100, 0x012E, 1, 2}, {0x0132, 0x0136, 1, 2}, {0x0139, 0x0147, 1, 2},
+        {0x014A, 0x0176, 1, 2}, {0x0178, 0x0178, -121, 1}, {0x0179, 0x017D, 1, 2},
+        {0x0181, 0x0181, 210, 1}, {0x0182, 0x0184, 1, 2}, {0x0186, 0x0186, 206, 1},
+        {0x0187, 0x0187, 1, 1}, {0x0189, 0x018A, 205, 1}, {0x018B, 0x018B, 1, 1},
+        {0x018E, 0x018E, 79, 1}, {0x018F, 0x018F, 202, 1}, {0x0190, 0x0190, 203, 1},
+        {0x0191, 0x0191, 1, 1}, {0x0193, 0x0193, 205, 1}, {0x0194, 0x0194, 207, 1},
+        {0x0196, 0x0196, 211, 1}, {0x0197, 0x0197, 209, 1}, {0x0198, 0x0198, 1, 1},
+        {0x019C, 0x019C, 211, 1}, {0x019D, 0x019D, 213, 1}, {0x019F, 0x019F, 214, 1},
+        {0x01A0, 0x01A4, 1, 2}, {0x01A6, 0x01A6, 218, 1}, {0x01A7, 0x01A7, 1, 1},
+        {0x01A9, 0x01A9, 218, 1}, {0x01AC, 0x01AC, 1, 1}, {0x01AE, 0x01AE, 218, 1},
+        {0x01AF, 0x01AF, 1, 1}, {0x01B1, 0x01B2, 217, 1}, {0x01B3, 0x01B5, 1, 2},
+        {0x01B7, 0x01B7, 219, 1}, {0x01B8, 0x01B8, 1, 1}, {0x01BC, 0x01BC, 1, 1},
+        {0x01C4, 0x01C4, 2, 1}, {0x01C5, 0x01C5, 1, 1}, {0x01C7, 0x01C7, 2, 1},
+        {0x01C8, 0x01C8, 1, 1}, {0x01CA, 0x01CA, 2, 1}, {0x01CB, 0x01DB, 1, 2},
+        {0x01DE, 0x01EE, 1, 2}, {0x01F1, 0x01F1, 2, 1}, {0x01F2, 0x01F4, 1, 2},
+        {0x01F6, 0x01F6, -97, 1}, {0x01F7, 0x01F7, -56, 1}, {0x01F8, 0x021E, 1, 2},
+        {0x0220, 0x0220, -130, 1}, {0x0222, 0x0232, 1, 2}, {0x023A, 0x023A, 10795, 1},
+        {0x023B, 0x023B, 1, 1}, {0x023D, 0x023D, -163, 1}, {0x023E, 0x023E, 10792, 1},
+        {0x0241, 0x0241, 1, 1}, {0x0243, 0x0243, -195, 1}, {0x0244, 0x0244, 69, 1},
+        {0x0245, 0x0245, 71, 1}, {0x0246, 0x024E, 1, 2}, {0x0370, 0x0372, 1, 2},
+        {0x0376, 0x0376, 1, 1}, {0x037F, 0x037F, 116, 1}, {0x0386, 0x0386, 38, 1},
+        {0x0388, 0x038A, 37, 1}, {0x038C, 0x038C, 64, 1}, {0x038E, 0x038F, 63, 1},
+        {0x0391, 0x03A1, 32, 1}, {0x03A3, 0x03AB, 32, 1}, {0x03CF, 0x03CF, 8, 1},
+        {0x03D8, 0x03EE, 1, 2}, {0x03F4, 0x03F4, -60, 1}, {0x03F7, 0x03F7, 1, 1},
+        {0x03F9, 0x03F9, -7, 1}, {0x03FA, 0x03FA, 1, 1}, {0x03FD, 0x03FF, -130, 1},
+        {0x0400, 0x040F, 80, 1}, {0x0410, 0x042F, 32, 1}, {0x0460, 0x0480, 1, 2},
+        {0x048A, 0x04BE, 1, 2}, {0x04C0, 0x04C0, 15, 1}, {0x04C1, 0x04CD, 1, 2},
+        {0x04D0, 0x052E, 1, 2}, {0x0531, 0x0556, 48, 1}, {0x10A0, 0x10C5, 7264, 1},
+        {0x10C7, 0x10C7, 7264, 1}, {0x10CD, 0x10CD, 7264, 1}, {0x13A0, 0x13EF, 38864, 1},
+        {0x13F0, 0x13F5, 8, 1}, {0x1C90, 0x1CBA, -3008, 1}, {0x1CBD, 0x1CBF, -3008, 1},
+        {0x1E00, 0x1E94, 1, 2}, {0x1E9E, 0x1E9E, -7615, 1}, {0x1EA0, 0x1EFE, 1, 2},
+        {0x1F08, 0x1F0F, -8, 1}, {0x1F18, 0x1F1D, -8, 1}, {0x1F28, 0x1F2F, -8, 1},
+        {0x1F38, 0x1F3F, -8, 1}, {0x1F48, 0x1F4D, -8, 1}, {0x1F59, 0x1F5F, -8, 2},
+        {0x1F68, 0x1F6F, -8, 1}, {0x1F88, 0x1F8F, -8, 1}, {0x1F98, 0x1F9F, -8, 1},
+        {0x1FA8, 0x1FAF, -8, 1}, {0x1FB8, 0x1FB9, -8, 1}, {0x1FBA, 0x1FBB, -74, 1},
+        {0x1FBC, 0x1FBC, -9, 1}, {0x1FC8, 0x1FCB, -86, 1}, {0x1FCC, 0x1FCC, -9, 1},
+        {0x1FD8, 0x1FD9, -8, 1}, {0x1FDA, 0x1FDB, -100, 1}, {0x1FE8, 0x1FE9, -8, 1},
+        {0x1FEA, 0x1FEB, -112, 1}, {0x1FEC, 0x1FEC, -7, 1}, {0x1FF8, 0x1FF9, -128, 1},
+        {0x1FFA, 0x1FFB, -126, 1}, {0x1FFC, 0x1FFC, -9, 1}, {0x2126, 0x2126, -7517, 1},
+        {0x212A, 0x212A, -8383, 1}, {0x212B, 0x212B, -8262, 1}, {0x2132, 0x2132, 28, 1},
+        {0x2160, 0x216F, 16, 1}, {0x2183, 0x2183, 1, 1}, {0x24B6, 0x24CF, 26, 1},
+        {0x2C00, 0x2C2F, 48, 1}, {0x2C60, 0x2C60, 1, 1}, {0x2C62, 0x2C62, -10743, 1},
+        {0x2C63, 0x2C63, -3814, 1}, {0x2C64, 0x2C64, -10727, 1}, {0x2C67, 0x2C6B, 1, 2},
+        {0x2C6D, 0x2C6D, -10780, 1}, {0x2C6E, 0x2C6E, -10749, 1}, {0x2C6F, 0x2C6F, -10783, 1},
+        {0x2C70, 0x2C70, -10782, 1}, {0x2C72, 0x2C72, 1, 1}, {0x2C75, 0x2C75, 1, 1},
+        {0x2C7E, 0x2C7F, -10815, 1}, {0x2C80, 0x2CE2, 1, 2}, {0x2CEB, 0x2CED, 1, 2},
+        {0x2CF2, 0x2CF2, 1, 1}, {0xA640, 0xA66C, 1, 2}, {0xA680, 0xA69A, 1, 2},
+        {0xA722, 0xA72E, 1, 2}, {0xA732, 0xA76E, 1, 2}, {0xA779, 0xA77B, 1, 2},
+        {0xA77D, 0xA77D, -35332, 1}, {0xA77E, 0xA786, 1, 2}, {0xA78B, 0xA78B, 1, 1},
+        {0xA78D, 0xA78D, -42280, 1}, {0xA790, 0xA792, 1, 2}, {0xA796, 0xA7A8, 1, 2},
+        {0xA7AA, 0xA7AA, -42308, 1}, {0xA7AB, 0xA7AB, -42319, 1}, {0xA7AC, 0xA7AC, -42315, 1},
+        {0xA7AD, 0xA7AD, -42305, 1}, {0xA7AE, 0xA7AE, -42308, 1}, {0xA7B0, 0xA7B0, -42258, 1},
+        {0xA7B1, 0xA7B1, -42282, 1}, {0xA7B2, 0xA7B2, -42261, 1}, {0xA7B3, 0xA7B3, 928, 1},
+        {0xA7B4, 0xA7C2, 1, 2}, {0xA7C4, 0xA7C4, -48, 1}, {0xA7C5, 0xA7C5, -42307, 1},
+        {0xA7C6, 0xA7C6, -35384, 1}, {0xA7C7, 0xA7C9, 1, 2}, {0xA7D0, 0xA7D0, 1, 1},
+        {0xA7D6, 0xA7D8, 1, 2}, {0xA7F5, 0xA7F5, 1, 1}, {0xFF21, 0xFF3A, 32, 1},
+    };
+    
+    // Helper: c mapped through ARuns, or c itself when no run covers it
+    template<size_t N>
+    char16_t run_case(const CaseRun (&ARuns)[N], char16_t c) {
+        const CaseRun* run = std::upper_bound(ARuns, ARuns + N, c,
+            [](char16_t value, const CaseRun& r) { return value < r.first; });
+        if (run == ARuns) {
+            return c;
+        }
+        --run;
+        if (c > run->last || (c - run->first) % run->stride != 0) {
+            return c;
+        }
+        return static_cast<char16_t>(c + run->delta);
+    }
+    
+    // Two-stage lookup over the BMP: each block of 128 code points selects a
+    // row of 128 deltas (mod 2^16), shared by every block that maps alike
+    class CaseTable {
+    public:
+        template<typename Map>
+        explicit CaseTable(Map AMap) {
+            uint16_t row[128];
+            for (size_t block = 0; block < 512; ++block) {
+                for (size_t k = 0; k < 128; ++k) {
+                    char16_t c = static_cast<char16_t>(block * 128 + k);
+                    row[k] = static_cast<uint16_t>(AMap(c) - c);
+                }
+                size_t rows = rows_.size() / 128;
+                size_t found = 0;
+                while (found < rows && !std::equal(row, row + 128, rows_.begin() + found * 128)) {
+                    found++;
+                }
+                if (found == rows) {
+                    rows_.insert(rows_.end(), row, row + 128);
+                }
+                index_[block] = static_cast<uint8_t>(found);
+            }
+        }
+        
+        char16_t operator()(char16_t c) const {
+            return static_cast<char16_t>(c + rows_[index_[c >> 7] * 128u + (c & 127u)]);
+        }
+        
+    private:
+        uint8_t               index_[512];
+        std::vector<uint16_t> rows_;
+    };
+    
+    struct CaseTables {
+        CaseTable upper;
+        CaseTable lower;
+        CaseTable fold;   // AnsiCompareText: lower(upper(c)), so 'ſ' = 's'
+    };
+    
+    // Helper: The tables, built on first use
+    const CaseTables& case_tables() {
+        static const CaseTables tables{
+            CaseTable([](char16_t c) { return run_case(UPPER_RUNS, c); }),
+            CaseTable([](char16_t c) { return run_case(LOWER_RUNS, c); }),
+            CaseTable([](char16_t c) { return run_case(LOWER_RUNS, run_case(UPPER_RUNS, c)); })};
+        return tables;
+    }
+    
+#if defined(NP_SIMD_X86)
+    // Helper: True when the 8 units at s are all ASCII
+    inline bool ascii_chunk(__m128i AUnits) {
+        __m128i high = _mm_and_si128(AUnits, _mm_set1_epi16(static_cast<short>(0xFF80)));
+        return _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF;
+    }
+#endif
+    
+    // Helper: Index of the first unit of s that AMap changes, or n. An
+    // all-ASCII chunk of 8 units is tested for ALo..ALo+25 as one vector.
+    size_t find_cased(const char16_t* s, size_t n, const CaseTable& AMap, char16_t ALo) {
+        size_t i = 0;
+#if defined(NP_SIMD_X86)
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            if (ascii_chunk(v)) {
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(ascii_letters(v, ALo)));
+                if (mask != 0) {
+                    return i + static_cast<size_t>(std::countr_zero(mask)) / 2;
+                }
+                continue;
+            }
+            for (size_t k = i; k < i + 8; ++k) {
+                if (AMap(s[k]) != s[k]) {
+                    return k;
+                }
+            }
+        }
+#else
+        (void)ALo;
+#endif
+        while (i < n && AMap(s[i]) == s[i]) {
+            i++;
+        }
+        return i;
+    }
+    
+    // Helper: Map every unit of s through AMap, all-ASCII chunks as vectors
+    void map_cased(char16_t* s, size_t n, const CaseTable& AMap, char16_t ALo) {
+        size_t i = 0;
+#if defined(NP_SIMD_X86)
+        for (; i + 8 <= n; i += 8) {
+            __m128i* p = reinterpret_cast<__m128i*>(s + i);
+            __m128i v = _mm_loadu_si128(p);
+            if (ascii_chunk(v)) {
+                _mm_storeu_si128(p, _mm_xor_si128(v, _mm_and_si128(ascii_letters(v, ALo), _mm_set1_epi16(0x20))));
+                continue;
+            }
+            for (size_t k = i; k < i + 8; ++k) {
+                s[k] = AMap(s[k]);
+            }
+        }
+#else
+        (void)ALo;
+#endif
+        for (; i < n; ++i) {
+            s[i] = AMap(s[i]);
+        }
+    }
+    
+    // Helper: AnsiUpperCase (ALo = 'a') or AnsiLowerCase (ALo = 'A')
+    np::String unicode_case(const np::String& s, const CaseTable& AMap, char16_t ALo) {
+#ifdef NP_STRING_UTF8
+        if (s.RawSize() == static_cast<size_t>(s.Length())) {
+            return ascii_case(s, static_cast<char>(ALo));
+        }
+        std::u16string_view units = s.Data();
+        size_t i = find_cased(units.data(), units.size(), AMap, ALo);
+        if (i == units.size()) {
+            return s;
+        }
+        np::StringBuffer<char16_t> mapped(units.data(), units.size());
+        map_cased(mapped.MutableData() + i, units.size() - i, AMap, ALo);
+        return np::String::FromUtf16(mapped.Data(), mapped.Size());
+#else
+        size_t n = s.RawSize();
+        size_t i = find_cased(s.Raw(), n, AMap, ALo);
+        if (i == n) {
+            return s;
+        }
+        np::String result = s;
+        map_cased(result.MutableRaw() + i, n - i, AMap, ALo);
+        return result;
+#endif
+    }
+    
+    // Helper: Next code point of s (a UTF-16 unit, or a whole UTF-8
+    // sequence) folded through AFold when it is in the BMP
+    inline uint32_t next_folded(const char16_t* s, size_t, size_t& i, const CaseTable& AFold) {
+        return AFold(s[i++]);
+    }
+    
+    inline uint32_t next_folded(const char* s, size_t, size_t& i, const CaseTable& AFold) {
+        // Stored UTF-8 is always valid
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s) + i;
+        uint32_t c = p[0];
+        if (c < 0x80) {
+            i += 1;
+        } else if (c < 0xE0) {
+            c = ((c & 0x1F) << 6) | (p[1] & 0x3F);
+            i += 2;
+        } else if (c < 0xF0) {
+            c = ((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+            i += 3;
+        } else {
+            i += 4;
+            return ((c & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        }
+        return AFold(static_cast<char16_t>(c));
+    }
+    
+    // Helper: AnsiCompareText of two unit runs, by folded code point (the
+    // order the relational operators use for the storage encoding)
+    template<typename Unit>
+    np::Integer compare_unicode_text(const Unit* a, size_t na, const Unit* b, size_t nb) {
+        const CaseTable& fold = case_tables().fold;
+        size_t i = 0, j = 0;
+        while (i < na && j < nb) {
+            if (a[i] == b[j] && unit_value(a[i]) < 0x80) {
+                i++;
+                j++;
+                continue;
+            }
+            uint32_t ca = next_folded(a, na, i, fold);
+            uint32_t cb = next_folded(b, nb, j, fold);
+            if (ca != cb) {
+                return ca < cb ? -1 : 1;
+            }
+        }
+        return (i < na) ? 1 : (j < nb ? -1 : 0);
+    }
+    
+    // ------------------------------------------------------------------------
+    // Substring search, behind Pos, PosEx and StringReplace. A needle of up
+    // to LONG_NEEDLE units is found by comparing its first and last unit
+    // with 16 bytes' worth of candidate positions per SSE2 step and the rest
+    // of it only where both agree; a longer one by Boyer-Moore-Horspool,
+    // which moves ahead by up to the needle's length per probe.
+    // ------------------------------------------------------------------------
+    
+    constexpr size_t NOT_FOUND   = static_cast<size_t>(-1);
+    constexpr size_t LONG_NEEDLE = 32;
+    
+#if defined(NP_SIMD_X86)
+    // Helper: AUnit in every lane
+    template<typename Unit>
+    inline __m128i splat_unit(Unit AUnit) {
+        if constexpr (sizeof(Unit) == 2) {
+            return _mm_set1_epi16(static_cast<short>(AUnit));
+        } else {
+            return _mm_set1_epi8(static_cast<char>(AUnit));
+        }
+    }
+    
+    // Helper: movemask of the lanes where a and b are equal, one bit per unit
+    template<typename Unit>
+    inline unsigned equal_lanes(__m128i a, __m128i b) {
+        if constexpr (sizeof(Unit) == 2) {
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(a, b))) & 0x5555u;
+        } else {
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+        }
+    }
+#endif
+    
+    // Helper: Index of the first AUnit in s[from, n), or NOT_FOUND
+    template<typename Unit>
+    size_t find_unit(const Unit* s, size_t n, Unit AUnit, size_t from) {
+        size_t i = from;
+#if defined(NP_SIMD_X86)
+        constexpr size_t STEP = 16 / sizeof(Unit);
+        __m128i needle = splat_unit(AUnit);
+        for (; i + STEP <= n; i += STEP) {
+            unsigned mask = equal_lanes<Unit>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)), needle);
+            if (mask != 0) {
+                return i + static_cast<size_t>(std::countr_zero(mask)) / sizeof(Unit);
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            if (s[i] == AUnit) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+    
+    // Helper: First/last-unit filter for needles of 2..LONG_NEEDLE units
+    template<typename Unit>
+    size_t find_short(const Unit* s, size_t n, const Unit* p, size_t m, size_t from) {
+        const Unit first = p[0];
+        const Unit last  = p[m - 1];
+        const size_t end = n - m + 1;   // candidate positions are [from, end)
+        const size_t middle = (m - 2) * sizeof(Unit);
+        size_t i = from;
+#if defined(NP_SIMD_X86)
+        constexpr size_t STEP = 16 / sizeof(Unit);
+        __m128i vfirst = splat_unit(first);
+        __m128i vlast  = splat_unit(last);
+        for (; i + STEP <= end; i += STEP) {
+            unsigned mask = equal_lanes<Unit>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)), vfirst) &
+                            equal_lanes<Unit>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + m - 1)), vlast);
+            while (mask != 0) {
+                size_t k = i + static_cast<size_t>(std::countr_zero(mask)) / sizeof(Unit);
+                if (std::memcmp(s + k + 1, p + 1, middle) == 0) {
+                    return k;
+                }
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < end; ++i) {
+            if (s[i] == first && s[i + m - 1] == last && std::memcmp(s + i + 1, p + 1, middle) == 0) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+    
+    // Helper: Boyer-Moore-Horspool for needles longer than LONG_NEEDLE. The
+    // shift is looked up by the low byte of the unit under the needle's last
+    // position; units sharing a low byte share the smallest shift, so none
+    // skips a match.
+    template<typename Unit>
+    size_t find_long(const Unit* s, size_t n, const Unit* p, size_t m, size_t from) {
+        uint32_t shift[256];
+        std::fill_n(shift, 256, static_cast<uint32_t>(m));
+        for (size_t k = 0; k + 1 < m; ++k) {
+            shift[unit_value(p[k]) & 0xFF] = static_cast<uint32_t>(m - 1 - k);
+        }
+        const Unit last = p[m - 1];
+        for (size_t i = from; i + m <= n;) {
+            Unit u = s[i + m - 1];
+            if (u == last && std::memcmp(s + i, p, (m - 1) * sizeof(Unit)) == 0) {
+                return i;
+            }
+            i += shift[unit_value(u) & 0xFF];
+        }
+        return NOT_FOUND;
+    }
+    
+    // Helper: Index of the first occurrence of p[0, m) in s[from, n), or
+    // NOT_FOUND; an empty needle is never found, as in Delphi
+    template<typename Unit>
+    size_t find_units(const Unit* s, size_t n, const Unit* p, size_t m, size_t from) {
+        if (m == 0 || from > n || m > n - from) {
+            return NOT_FOUND;
+        }
+        if (m == 1) {
+            return find_unit(s, n, p[0], from);
+        }
+        if (m <= LONG_NEEDLE) {
+            return find_short(s, n, p, m, from);
+        }
+        return find_long(s, n, p, m, from);
+    }
+    
+    // Helper: s upper-cased into AOut for an rfIgnoreCase search (AnsiUpperCase;
+    // ASCII letters only for the bytes of an ASCII string), or s itself when
+    // nothing in it changes
+    const char16_t* upper_key(const char16_t* s, size_t n, np::StringBuffer<char16_t>& AOut) {
+        const CaseTable& upper = case_tables().upper;
+        size_t i = find_cased(s, n, upper, u'a');
+        if (i == n) {
+            return s;
+        }
+        char16_t* key = AOut.Overwrite(n);
+        std::copy_n(s, n, key);
+        map_cased(key + i, n - i, upper, u'a');
+        return key;
+    }
+    
+#ifdef NP_STRING_UTF8
+    const char* upper_key(const char* s, size_t n, np::StringBuffer<char>& AOut) {
+        size_t i = find_ascii_letter(s, n, 'a');
+        if (i == n) {
+            return s;
+        }
+        char* key = AOut.Overwrite(n);
+        std::copy_n(s, n, key);
+        toggle_ascii_letters(key + i, n - i, 'a');
+        return key;
+    }
+#endif
+    
+    // Helper: Copy the run of text between two matches. Most runs are a few
+    // units long, and for those a library call costs more than the copy.
+    template<typename Unit>
+    inline Unit* copy_run(const Unit* s, size_t n, Unit* out) {
+        if (n * sizeof(Unit) > 64) {
+            return std::copy_n(s, n, out);
+        }
+        for (size_t k = 0; k < n; ++k) {
+            out[k] = s[k];
+        }
+        return out + n;
+    }
+    
+    // Helper: StringReplace over one unit type. Matches of AOld are looked up
+    // in AKey, which is s itself or its upper-cased copy of the same length,
+    // starting from the first one at AFirst; the output is sized before it is
+    // written, so it takes one allocation.
+    template<typename Unit>
+    np::StringBuffer<Unit> replace_units(const Unit* s, const Unit* AKey, size_t n,
+                                         std::basic_string_view<Unit> AOld,
+                                         std::basic_string_view<Unit> ANew,
+                                         size_t AFirst, bool AAll) {
+        const size_t m = AOld.size();
+        const size_t r = ANew.size();
+        size_t size = n - m + r;
+        if (AAll && r <= m) {
+            size = n;   // an upper bound; trimmed below
+        } else if (AAll) {
+            size_t count = 0;
+            for (size_t at = AFirst; at != NOT_FOUND; at = find_units(AKey, n, AOld.data(), m, at + m)) {
+                count++;
+            }
+            size = n + count * (r - m);
+        }
+        np::StringBuffer<Unit> result;
+        Unit* out = result.Overwrite(size);
+        Unit* w = out;
+        size_t done = 0;
+        for (size_t at = AFirst; at != NOT_FOUND;) {
+            w = copy_run(s + done, at - done, w);
+            w = copy_run(ANew.data(), r, w);
+            done = at + m;
+            at = AAll ? find_units(AKey, n, AOld.data(), m, done) : NOT_FOUND;
+        }
+        w = std::copy_n(s + done, n - done, w);
+        result.Resize(static_cast<size_t>(w - out), Unit());
+        return result;
+    }
+    
+    // Helper: StringReplace on the units of text, old and new in one
+    // encoding; text is returned shared when AOld does not occur in it
+    template<typename Unit>
+    bool replace_text(std::basic_string_view<Unit> AText, std::basic_string_view<Unit> AOld,
+                      std::basic_string_view<Unit> ANew, bool AAll, bool AIgnoreCase,
+                      np::StringBuffer<Unit>& AResult) {
+        np::StringBuffer<Unit> textKey;
+        np::StringBuffer<Unit> oldKey;
+        const Unit* key = AText.data();
+        const Unit* old = AOld.data();
+        if (AIgnoreCase) {
+            key = upper_key(AText.data(), AText.size(), textKey);
+            old = upper_key(AOld.data(), AOld.size(), oldKey);
+        }
+        size_t first = find_units(key, AText.size(), old, AOld.size(), 0);
+        if (first == NOT_FOUND) {
+            return false;
+        }
+        AResult = replace_units(AText.data(), key, AText.size(),
+                                std::basic_string_view<Unit>(old, AOld.size()), ANew, first, AAll);
+        return true;
+    }
+    
+    // Helper: The units [begin, end) of s, shared with s when they are all of it
+    np::String trimmed(const np::String& s, const np::StringUnit* begin, const np::StringUnit* end) {
+        if (begin == s.Raw() && end == s.Raw() + s.RawSize()) {
+            return s;
+        }
+#ifdef NP_STRING_UTF8
+        if (s.RawSize() == static_cast<size_t>(s.Length())) {
+            return np::String::FromAscii(begin, static_cast<size_t>(end - begin));
+        }
+#endif
+        return np::String::FromRaw(np::StringBuffer<np::StringUnit>(begin, static_cast<size_t>(end - begin)));
+    }
+    
+    // ------------------------------------------------------------------------
+    // Number conversion. Numbers are formatted with std::to_chars into a
+    // stack buffer and parsed straight from the string's code units: their
+    // text is ASCII, so unit and character positions agree up to the first
+    // character that is not part of the number. Nothing throws internally.
+    // ------------------------------------------------------------------------
+    
+    // Helper: Decimal text of an integer
+    template<typename T>
+    np::String format_integer(T value) {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return np::String::FromAscii(buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+    
+    // Helper: Decimal text of an integer appended to AText (StringBuilder)
+    template<typename T>
+    void append_integer(np::String& AText, T value) {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        AText.AppendAscii(buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+    
+    // Helper: buffer[0..n) right-aligned in a field of AWidth characters
+    np::String pad_left(const char* buffer, size_t n, np::Integer AWidth) {
+        if (AWidth <= 0 || static_cast<size_t>(AWidth) <= n) {
+            return np::String::FromAscii(buffer, n);
+        }
+        np::StringBuffer<np::StringUnit> raw;
+        size_t pad = static_cast<size_t>(AWidth) - n;
+        np::StringUnit* out = raw.Overwrite(pad + n);
+        std::fill_n(out, pad, ' ');
+        std::copy_n(reinterpret_cast<const unsigned char*>(buffer), n, out + pad);
+        return np::String::FromRaw(std::move(raw));
+    }
+    
+    // Helper: Result of parsing a number: ok, or the 1-based position of the
+    // first character that could not be used (Val's error code)
+    struct ParseStatus {
+        size_t next;        // units consumed
+        np::Integer error;  // 0 when the text up to next is a number
+    };
+    
+    inline bool is_digit(uint32_t ch) {
+        return ch >= '0' && ch <= '9';
+    }
+    
+    inline int hex_digit(uint32_t ch) {
+        if (ch >= '0' && ch <= '9') return static_cast<int>(ch - '0');
+        if (ch >= 'A' && ch <= 'F') return static_cast<int>(ch - 'A' + 10);
+        if (ch >= 'a' && ch <= 'f') return static_cast<int>(ch - 'a' + 10);
+        return -1;
+    }
+    
+    // Helper: Parse an integer as Val does: leading spaces, an optional sign,
+    // decimal digits or hexadecimal ones after $, 0x or x. A decimal value
+    // must fit in [AMin, AMax]; a hexadecimal one may use the full unsigned
+    // range of the type and wraps, so $FFFFFFFF is -1 for an Integer.
+    ParseStatus parse_integer(const np::StringUnit* s, size_t n, int64_t AMin, int64_t AMax,
+                              uint64_t AHexMax, int64_t& AValue) {
+        size_t i = 0;
+        while (i < n && s[i] == ' ') {
+            i++;
+        }
+        bool negative = false;
+        if (i < n && (s[i] == '+' || s[i] == '-')) {
+            negative = s[i] == '-';
+            i++;
+        }
+        bool hex = false;
+        if (i < n && s[i] == '$') {
+            hex = true;
+            i++;
+        } else if (i + 1 < n && s[i] == '0' && (s[i + 1] == 'x' || s[i + 1] == 'X')) {
+            hex = true;
+            i += 2;
+        } else if (i < n && (s[i] == 'x' || s[i] == 'X')) {
+            hex = true;
+            i++;
+        }
+        uint64_t limit = hex ? AHexMax
+                       : negative ? static_cast<uint64_t>(-(AMin + 1)) + 1
+                       : static_cast<uint64_t>(AMax);
+        uint64_t base = hex ? 16 : 10;
+        uint64_t cutoff = limit / base;       // largest magnitude that may take another digit
+        uint64_t cutlim = limit % base;       // largest digit it may take then
+        uint64_t magnitude = 0;
+        size_t first = i;
+        for (; i < n; ++i) {
+            int digit = hex ? hex_digit(unit_value(s[i])) : (is_digit(unit_value(s[i])) ? static_cast<int>(s[i] - '0') : -1);
+            if (digit < 0) {
+                break;
+            }
+            if (magnitude > cutoff || (magnitude == cutoff && static_cast<uint64_t>(digit) > cutlim)) {
+                return {i, static_cast<np::Integer>(i + 1)};
+            }
+            magnitude = magnitude * base + static_cast<uint64_t>(digit);
+        }
+        if (i == first) {
+            return {i, static_cast<np::Integer>(i + 1)};
+        }
+        AValue = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        return {i, 0};
+    }
+    
+    // Helper: Parse a float: leading spaces, an optional sign, digits with
+    // an optional fraction (at least one digit in all) and an optional
+    // exponent. A value too large for a Double is an error at its first
+    // character; one too small becomes 0 or a denormal.
+    ParseStatus parse_float(const np::StringUnit* s, size_t n, double& AValue) {
+        size_t i = 0;
+        while (i < n && s[i] == ' ') {
+            i++;
+        }
+        size_t start = i;
+        if (i < n && (s[i] == '+' || s[i] == '-')) {
+            i++;
+        }
+        size_t digits = 0;
+        while (i < n && is_digit(unit_value(s[i]))) {
+            i++;
+            digits++;
+        }
+        if (i < n && s[i] == '.') {
+            i++;
+            while (i < n && is_digit(unit_value(s[i]))) {
+                i++;
+                digits++;
+            }
+        }
+        if (digits == 0) {
+            return {i, static_cast<np::Integer>(i + 1)};
+        }
+        if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+            size_t mark = i++;
+            if (i < n && (s[i] == '+' || s[i] == '-')) {
+                i++;
+            }
+            if (i == n || !is_digit(unit_value(s[i]))) {
+                return {mark, static_cast<np::Integer>(i + 1)};
+            }
+            while (i < n && is_digit(unit_value(s[i]))) {
+                i++;
+            }
+        }
+        // The text is now known to be a number: narrow it (without a leading
+        // '+', which from_chars rejects) and convert it
+        size_t from = (s[start] == '+') ? start + 1 : start;
+        size_t length = i - from;
+        char local[128];
+        std::string spill;
+        char* text = local;
+        if (length >= sizeof(local)) {
+            spill.resize(length + 1);
+            text = spill.data();
+        }
+        for (size_t k = 0; k < length; ++k) {
+            text[k] = static_cast<char>(s[from + k]);
+        }
+        text[length] = '\0';
+#if defined(__cpp_lib_to_chars)
+        double value = 0.0;
+        auto result = std::from_chars(text, text + length, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            value = std::strtod(text, nullptr);
+        }
+#else
+        // No floating-point from_chars in this standard library: the syntax
+        // is already checked, so strtod only converts
+        double value = std::strtod(text, nullptr);
+#endif
+        if (std::isinf(value)) {
+            return {i, static_cast<np::Integer>(start + 1)};
+        }
+        AValue = value;
+        return {i, 0};
+    }
+    
+    // Helper: Text of FloatToStr: the value rounded to APrecision (1..18,
+    // 15 for FloatToStr) significant digits without trailing zeros, in fixed
+    // notation unless that needs more than APrecision digits before the
+    // point or the value is below 1E-5, then as d.dddE[-]x. Returns the
+    // length written to AOut (40 bytes of room).
+    size_t format_float_general(double value, char* AOut, int APrecision = 15) {
+        char* out = AOut;
+        if (std::isnan(value)) {
+            std::memcpy(out, "NAN", 3);
+            return 3;
+        }
+        if (std::isinf(value)) {
+            return value < 0 ? (std::memcpy(out, "-INF", 4), 4) : (std::memcpy(out, "INF", 3), 3);
+        }
+        if (value == 0.0) {
+            *out = '0';
+            return 1;
+        }
+        // d.ddd...e[+-]x: APrecision correctly rounded significant digits
+        char sci[40];
+        auto result = std::to_chars(sci, sci + sizeof(sci), value, std::chars_format::scientific, APrecision - 1);
+        const char* p = sci;
+        if (*p == '-') {
+            *out++ = '-';
+            p++;
+        }
+        char digits[18];
+        int count = 0;
+        for (; *p != 'e'; ++p) {
+            if (*p != '.') {
+                digits[count++] = *p;
+            }
+        }
+        int exponent = 0;
+        std::from_chars(p + 1 + (p[1] == '+'), result.ptr, exponent);
+        while (count > 1 && digits[count - 1] == '0') {
+            count--;
+        }
+        if (exponent >= APrecision || exponent < -5) {
+            *out++ = digits[0];
+            if (count > 1) {
+                *out++ = '.';
+                out = std::copy_n(digits + 1, count - 1, out);
+            }
+            *out++ = 'E';
+            out = std::to_chars(out, out + 8, exponent).ptr;
+        } else if (exponent >= 0) {
+            for (int k = 0; k <= exponent; ++k) {
+                *out++ = k < count ? digits[k] : '0';
+            }
+            if (count > exponent + 1) {
+                *out++ = '.';
+                out = std::copy_n(digits + exponent + 1, count - exponent - 1, out);
+            }
+        } else {
+            *out++ = '0';
+            *out++ = '.';
+            out = std::fill_n(out, -exponent - 1, '0');
+            out = std::copy_n(digits, count, out);
+        }
+        return static_cast<size_t>(out - AOut);
+    }
+    
+    // Helper: Number of units left once trailing spaces are dropped
+    size_t without_trailing_spaces(const np::StringUnit* s, size_t n) {
+        while (n > 0 && s[n - 1] == ' ') {
+            n--;
+        }
+        return n;
+    }
+    
+    // Helper: Parse all of s (a String or a StringView) as an integer in
+    // [AMin, AMax]; false if it is not one
+    template<typename Text>
+    bool str_to_integer(const Text& s, int64_t AMin, int64_t AMax, uint64_t AHexMax,
+                        int64_t& AValue) {
+        ParseStatus status = parse_integer(s.Raw(), s.RawSize(), AMin, AMax, AHexMax, AValue);
+        return status.error == 0 && status.next == s.RawSize();
+    }
+    
+    // Helper: Parse all of s as a float; false if it is not one. Trailing
+    // spaces are allowed, as in StrToFloat.
+    template<typename Text>
+    bool str_to_float(const Text& s, double& AValue) {
+        size_t n = without_trailing_spaces(s.Raw(), s.RawSize());
+        ParseStatus status = parse_float(s.Raw(), n, AValue);
+        return status.error == 0 && status.next == n;
+    }
+    
+    [[noreturn]] void raise_convert_error(const np::String& s, const wchar_t* AWhat) {
+        throw np::_Exception{np::EXC_SOFTWARE, L"'" + s.ToWString() + L"' is not a valid " + AWhat};
+    }
+
+#ifdef NP_STRING_UTF8
+    // Helper: Bytes of the whole characters among the first AUnits UTF-16
+    // code units of valid UTF-8; ASplit is set when unit AUnits is the
+    // second half of a surrogate pair, whose 4 bytes are not counted
+    size_t utf8_unit_bytes(const char* s, size_t AUnits, bool& ASplit) {
+        size_t bytes = 0;
+        ASplit = false;
+        while (AUnits > 0) {
+            unsigned char lead = static_cast<unsigned char>(s[bytes]);
+            if (lead >= 0xF0) {
+                if (AUnits == 1) {
+                    ASplit = true;
+                    break;
+                }
+                bytes += 4;
+                AUnits -= 2;
+            } else {
+                bytes += lead < 0x80 ? 1 : lead < 0xE0 ? 2 : 3;
+                AUnits--;
+            }
+        }
+        return bytes;
+    }
+#endif
+
+    // ------------------------------------------------------------------------
+    // Hashing and ordering
+    // ------------------------------------------------------------------------
+
+    // Helper: Unaligned little-endian loads for the hash
+    inline uint64_t load64(const unsigned char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline uint64_t load32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    // Helper: 64x64 -> 128-bit multiply folded back to 64 bits
+    inline uint64_t wymix(uint64_t a, uint64_t b) {
+        unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+        return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+    }
+
+    // Helper: wyhash (final version 4) of a run of storage units, with 0
+    // mapped to 1 so a block header can use 0 for "not worked out yet"
+    uint64_t hash_units(const np::StringUnit* AData, size_t ACount) {
+        constexpr uint64_t S0 = 0xA0761D6478BD642Full;
+        constexpr uint64_t S1 = 0xE7037ED1A0B428DBull;
+        constexpr uint64_t S2 = 0x8EBC6AF09C88C6E3ull;
+        constexpr uint64_t S3 = 0x589965CC75374CC3ull;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(AData);
+        size_t len = ACount * sizeof(np::StringUnit);
+        uint64_t seed = wymix(S0, S1);
+        uint64_t a, b;
+        if (len <= 16) {
+            if (len >= 4) {
+                size_t step = (len >> 3) << 2;
+                a = (load32(p) << 32) | load32(p + step);
+                b = (load32(p + len - 4) << 32) | load32(p + len - 4 - step);
+            } else if (len > 0) {
+                a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = len;
+            if (i > 48) {
+                uint64_t see1 = seed, see2 = seed;
+                do {
+                    seed = wymix(load64(p) ^ S1, load64(p + 8) ^ seed);
+                    see1 = wymix(load64(p + 16) ^ S2, load64(p + 24) ^ see1);
+                    see2 = wymix(load64(p + 32) ^ S3, load64(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = wymix(load64(p) ^ S1, load64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = load64(p + i - 16);
+            b = load64(p + i - 8);
+        }
+        a ^= S1;
+        b ^= seed;
+        unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+        uint64_t h = wymix(static_cast<uint64_t>(r) ^ S0 ^ len, static_cast<uint64_t>(r >> 64) ^ S1);
+        return h != 0 ? h : 1;
+    }
+
+    // Helper: Three-way ordinal comparison of two unit runs. Bytes compare
+    // as memcmp does; UTF-16 units are compared four at a time until a
+    // word differs, then by the first unit that does.
+#ifdef NP_STRING_UTF8
+    int compare_units(const char* a, size_t na, const char* b, size_t nb) {
+        int c = std::memcmp(a, b, std::min(na, nb));
+        if (c != 0) {
+            return c;
+        }
+        return na < nb ? -1 : (na > nb ? 1 : 0);
+    }
+#else
+    int compare_units(const char16_t* a, size_t na, const char16_t* b, size_t nb) {
+        size_t n = std::min(na, nb);
+        size_t i = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            for (; i + 4 <= n; i += 4) {
+                uint64_t wa, wb;
+                std::memcpy(&wa, a + i, 8);
+                std::memcpy(&wb, b + i, 8);
+                if (wa != wb) {
+                    i += static_cast<size_t>(std::countr_zero(wa ^ wb)) / 16;
+                    return a[i] < b[i] ? -1 : 1;
+                }
+            }
+        }
+        for (; i < n; ++i) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return na < nb ? -1 : (na > nb ? 1 : 0);
+    }
+#endif
+
+    // ------------------------------------------------------------------------
+    // Intern table. It is split into shards picked by the top bits of the
+    // hash, each an open-addressed array behind a reader/writer lock, so
+    // threads interning texts that are already there only share a lock.
+    // ------------------------------------------------------------------------
+
+    struct InternSlot {
+        uint64_t   hash = 0;
+        np::String text;    // empty: free
+    };
+
+    struct InternShard {
+        std::shared_mutex       lock;
+        std::vector<InternSlot> slots;   // power-of-two size
+        size_t                  count = 0;
+
+        // The interned copy of AText, or nullptr
+        const np::String* Find(uint64_t AHash, const np::String& AText) const {
+            if (slots.empty()) {
+                return nullptr;
+            }
+            size_t mask = slots.size() - 1;
+            for (size_t i = AHash & mask;; i = (i + 1) & mask) {
+                const InternSlot& slot = slots[i];
+                if (slot.text.RawSize() == 0) {
+                    return nullptr;
+                }
+                if (slot.hash == AHash && slot.text.RawSize() == AText.RawSize() &&
+                    std::equal(AText.Raw(), AText.Raw() + AText.RawSize(), slot.text.Raw())) {
+                    return &slot.text;
+                }
+            }
+        }
+
+        void Place(InternSlot&& ASlot) {
+            size_t mask = slots.size() - 1;
+            size_t i = ASlot.hash & mask;
+            while (slots[i].text.RawSize() != 0) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = std::move(ASlot);
+        }
+
+        // Adds a copy of AText, keeping the slots at most 3/4 full
+        const np::String& Add(uint64_t AHash, const np::String& AText) {
+            if ((count + 1) * 4 > slots.size() * 3) {
+                std::vector<InternSlot> old(std::max<size_t>(slots.size() * 2, 16));
+                old.swap(slots);
+                for (InternSlot& slot : old) {
+                    if (slot.text.RawSize() != 0) {
+                        Place(std::move(slot));
+                    }
+                }
+            }
+            // A heap block with its hash already in place, never freed
+            size_t size = AText.RawSize();
+            void* block = ::operator new(sizeof(np::_StringHeader) + sizeof(np::StringUnit) * (size + 1));
+            np::_g_string_allocs++;
+            np::_StringHeader* head = ::new (block)
+                np::_StringHeader{{np::_INTERNED_REFCOUNT}, static_cast<np::Integer>(size), {AHash}};
+            np::StringUnit* units = reinterpret_cast<np::StringUnit*>(head + 1);
+            std::copy_n(AText.Raw(), size, units);
+            units[size] = np::StringUnit();
+            count++;
+            Place(InternSlot{AHash, np::String::FromRaw(np::StringBuffer<np::StringUnit>::FromInterned(units, size))});
+            return *Find(AHash, AText);
+        }
+    };
+
+    constexpr size_t INTERN_SHARDS = 64;
+
+    // Helper: The shards, built on first use and never destroyed, so
+    // interned Strings stay valid during static destruction
+    InternShard* intern_shards() {
+        static InternShard* shards = new InternShard[INTERN_SHARDS];
+        return shards;
+    }
 } // anonymous namespace
 
-namespace np {
+namespace np {
+
+// ============================================================================
+// STRING CLASS IMPLEMENTATION
+// ============================================================================
+
+#ifdef NP_STRING_UTF8
+
+// --- UTF-8 storage ---
+
+void String::Assign(StringBuffer<char>&& bytes) {
+    data_ = std::move(bytes);
+    utf16_ = StringBuffer<char16_t>();
+    size_t prefix = kernels().ascii_prefix8(data_.Data(), data_.Size());
+    ascii_ = prefix == data_.Size();
+    if (ascii_) {
+        length_ = static_cast<Integer>(data_.Size());
+        return;
+    }
+    if (!decode_utf8_valid<false>(data_.Data() + prefix, data_.Size() - prefix, nullptr)) {
+        // Store malformed input the way it reads: with U+FFFD in place
+        StringBuffer<char16_t> units = utf8_to_utf16(data_.Data(), data_.Size());
+        AssignUtf16(units.Data(), units.Size());
+        return;
+    }
+    length_ = static_cast<Integer>(prefix + kernels().utf16_length(data_.Data() + prefix, data_.Size() - prefix));
+}
+
+// Encoding UTF-16 gives valid UTF-8 of known length: only ASCII when every
+// unit took one byte
+void String::AssignUtf16(const char16_t* units, size_t n) {
+    data_ = utf16_to_utf8(units, n);
+    utf16_ = StringBuffer<char16_t>();
+    ascii_ = data_.Size() == n;
+    length_ = static_cast<Integer>(n);
+}
+
+std::u16string_view String::Utf16() const {
+    if (utf16_.Size() == 0 && length_ > 0) {
+        utf16_ = utf8_to_utf16(data_.Data(), data_.Size());
+    }
+    return utf16_.View();
+}
+
+void String::SetChar(Integer index, char16_t ch) {
+    if (ascii_ && ch < 0x80) {
+        data_.MutableData()[index - 1] = static_cast<char>(ch);
+        utf16_ = StringBuffer<char16_t>();
+        return;
+    }
+    std::u16string_view view = Utf16();
+    StringBuffer<char16_t> units(view.data(), view.size());
+    units.MutableData()[index - 1] = ch;
+    AssignUtf16(units.Data(), units.Size());
+}
+
+String::String() {
+}
+
+String::String(const char* s) {
+    Assign(StringBuffer<char>(s, std::strlen(s)));
+}
+
+String::String(const char16_t* s) {
+    AssignUtf16(s, std::char_traits<char16_t>::length(s));
+}
+
+String::String(const wchar_t* s) {
+    std::u16string units = wstring_to_utf16(std::wstring(s));
+    AssignUtf16(units.data(), units.size());
+}
+
+String::String(const std::string& s) {
+    Assign(StringBuffer<char>(s.data(), s.size()));
+}
+
+String::String(const std::u16string& s) {
+    AssignUtf16(s.data(), s.size());
+}
+
+String::String(const std::wstring& s) {
+    std::u16string units = wstring_to_utf16(s);
+    AssignUtf16(units.data(), units.size());
+}
+
+String String::FromAscii(const char* s, size_t n) {
+    String result;
+    result.data_ = StringBuffer<char>(s, n);
+    result.length_ = static_cast<Integer>(n);
+    return result;
+}
+
+String String::FromUtf16(const char16_t* s, size_t n) {
+    String result;
+    result.AssignUtf16(s, n);
+    return result;
+}
+
+String String::FromUtf8(const char* s, size_t n) {
+    String result;
+    result.Assign(StringBuffer<char>(s, n));
+    return result;
+}
+
+String String::FromRaw(StringBuffer<char>&& raw) {
+    String result;
+    result.Assign(std::move(raw));
+    return result;
+}
+
+String String::operator+(const String& other) const {
+    if (other.length_ == 0) {
+        return *this;
+    }
+    if (length_ == 0) {
+        return other;
+    }
+    String result;
+    char* out = result.data_.Overwrite(data_.Size() + other.data_.Size());
+    std::copy_n(other.data_.Data(), other.data_.Size(),
+                std::copy_n(data_.Data(), data_.Size(), out));
+    result.length_ = length_ + other.length_;
+    result.ascii_  = ascii_ && other.ascii_;
+    return result;
+}
+
+String& String::operator+=(const String& other) {
+    data_.Append(other.data_);
+    length_ += other.length_;
+    ascii_ = ascii_ && other.ascii_;
+    utf16_ = StringBuffer<char16_t>();
+    return *this;
+}
+
+String& String::operator+=(const StringView& other) {
+    data_.Append(other.Raw(), other.RawSize());
+    length_ += other.Length();
+    ascii_ = ascii_ && other.IsAscii();
+    utf16_ = StringBuffer<char16_t>();
+    return *this;
+}
+
+void String::AppendAscii(const char* s, size_t n) {
+    std::copy_n(s, n, data_.Extend(n));
+    length_ += static_cast<Integer>(n);
+    if (!ascii_) {
+        utf16_ = StringBuffer<char16_t>();
+    }
+}
+
+void String::SetLength(Integer newLength) {
+    if (newLength < 0) {
+        newLength = 0;
+    }
+    if (newLength >= length_) {
+        data_.Resize(data_.Size() + static_cast<size_t>(newLength - length_), '\0');
+        length_ = newLength;
+        utf16_ = StringBuffer<char16_t>();
+    } else if (ascii_) {
+        data_.Resize(static_cast<size_t>(newLength), '\0');
+        length_ = newLength;
+        utf16_ = StringBuffer<char16_t>();
+    } else {
+        AssignUtf16(Utf16().data(), static_cast<size_t>(newLength));
+    }
+}
+
+std::string String::ToStdString() const {
+    return std::string(data_.Data(), data_.Size());
+}
+
+std::wstring String::ToWString() const {
+    if (ascii_) {
+        return std::wstring(data_.Data(), data_.Data() + data_.Size());
+    }
+    return utf16_to_wstring(Utf16());
+}
+
+String String::Sub(Integer offset, Integer count) const {
+    if (offset == 0 && count == length_) {
+        return *this;
+    }
+    if (ascii_) {
+        return FromAscii(data_.Data() + offset, static_cast<size_t>(count));
+    }
+    return FromUtf16(Utf16().data() + offset, static_cast<size_t>(count));
+}
+
+void String::Erase(Integer offset, Integer count) {
+    if (ascii_) {
+        data_.Erase(offset, count);
+        length_ -= count;
+        utf16_ = StringBuffer<char16_t>();
+        return;
+    }
+    std::u16string_view view = Utf16();
+    StringBuffer<char16_t> units(view.data(), view.size());
+    units.Erase(offset, count);
+    AssignUtf16(units.Data(), units.Size());
+}
+
+void String::InsertAt(Integer offset, const String& s) {
+    if (ascii_) {
+        data_.Insert(offset, s.data_.Data(), s.data_.Size());
+        length_ += s.length_;
+        ascii_ = s.ascii_;
+        utf16_ = StringBuffer<char16_t>();
+        return;
+    }
+    std::u16string_view view = Utf16();
+    StringBuffer<char16_t> units(view.data(), view.size());
+    std::u16string_view insert = s.Utf16();
+    units.Insert(offset, insert.data(), insert.size());
+    AssignUtf16(units.Data(), units.Size());
+}
+
+// Stored UTF-8 is valid, so a byte match always starts on a character and
+// the bytes before it give its unit index; only a search from an offset
+// into a non-ASCII string needs the UTF-16 copy.
+Integer String::Find(const String& s, Integer offset) const {
+    size_t pos;
+    if (ascii_ || offset == 0) {
+        pos = find_units(data_.Data(), data_.Size(), s.data_.Data(), s.data_.Size(),
+                         static_cast<size_t>(offset));
+        if (pos != NOT_FOUND && !ascii_) {
+            pos = kernels().utf16_length(data_.Data(), pos);
+        }
+    } else {
+        std::u16string_view text = Utf16();
+        std::u16string_view sub = s.Data();
+        pos = find_units(text.data(), text.size(), sub.data(), sub.size(), static_cast<size_t>(offset));
+    }
+    return (pos == NOT_FOUND) ? -1 : static_cast<Integer>(pos);
+}
+
+std::ostream& operator<<(std::ostream& os, const String& s) {
+    os.write(s.data_.Data(), static_cast<std::streamsize>(s.data_.Size()));
+    return os;
+}
 
-// ============================================================================
-// STRING CLASS IMPLEMENTATION
-// ============================================================================
+#else // !NP_STRING_UTF8
+
+// --- UTF-16 storage ---
 
-String::String() : data_() {
+String::String() {
 }
 
-String::String(const char* s) {
-    data_ = utf8_to_utf16(s);
+String::String(const char* s) : data_(utf8_to_utf16(s, std::strlen(s))) {
 }
 
-String::String(const char16_t* s) : data_(s) {
+String::String(const char16_t* s) : data_(s, std::char_traits<char16_t>::length(s)) {
 }
 
 String::String(const wchar_t* s) {
-    std::wstring wstr(s);
-    data_ = wstring_to_utf16(wstr);
+    std::u16string units = wstring_to_utf16(std::wstring(s));
+    data_ = StringBuffer<char16_t>(units.data(), units.size());
 }
 
-String::String(const std::string& s) {
-    data_ = utf8_to_utf16(s);
+String::String(const std::string& s) : data_(utf8_to_utf16(s.data(), s.size())) {
 }
 
-String::String(const std::u16string& s) : data_(s) {
+String::String(const std::u16string& s) : data_(s.data(), s.size()) {
 }
 
 String::String(const std::wstring& s) {
-    data_ = wstring_to_utf16(s);
+    std::u16string units = wstring_to_utf16(s);
+    data_ = StringBuffer<char16_t>(units.data(), units.size());
 }
 
-char16_t String::operator[](Integer index) const {
-    if (index < 1 || index > static_cast<Integer>(data_.length())) {
-        throw std::out_of_range("String index out of range");
-    }
-    return data_[index - 1];
+String String::FromAscii(const char* s, size_t n) {
+    String result;
+    std::copy_n(s, n, result.data_.Overwrite(n));
+    return result;
 }
 
-char16_t& String::operator[](Integer index) {
-    if (index < 1 || index > static_cast<Integer>(data_.length())) {
-        throw std::out_of_range("String index out of range");
-    }
-    return data_[index - 1];
+String String::FromUtf16(const char16_t* s, size_t n) {
+    String result;
+    result.data_ = StringBuffer<char16_t>(s, n);
+    return result;
+}
+
+String String::FromUtf8(const char* s, size_t n) {
+    String result;
+    result.data_ = utf8_to_utf16(s, n);
+    return result;
+}
+
+String String::FromRaw(StringBuffer<char16_t>&& raw) {
+    String result;
+    result.data_ = std::move(raw);
+    return result;
 }
 
 String String::operator+(const String& other) const {
-    return String(data_ + other.data_);
+    if (other.data_.Size() == 0) {
+        return *this;
+    }
+    if (data_.Size() == 0) {
+        return other;
+    }
+    String result;
+    char16_t* out = result.data_.Overwrite(data_.Size() + other.data_.Size());
+    std::copy_n(other.data_.Data(), other.data_.Size(),
+                std::copy_n(data_.Data(), data_.Size(), out));
+    return result;
 }
 
 String& String::operator+=(const String& other) {
-    data_ += other.data_;
+    data_.Append(other.data_);
+    return *this;
+}
+
+String& String::operator+=(const StringView& other) {
+    data_.Append(other.Raw(), other.RawSize());
     return *this;
 }
 
+void String::AppendAscii(const char* s, size_t n) {
+    std::copy_n(reinterpret_cast<const unsigned char*>(s), n, data_.Extend(n));
+}
+
+void String::SetLength(Integer newLength) {
+    if (newLength < 0) {
+        newLength = 0;
+    }
+    data_.Resize(static_cast<size_t>(newLength), u'\0');
+}
+
+std::string String::ToStdString() const {
+    return utf16_to_std_string(data_.Data(), data_.Size());
+}
+
+std::wstring String::ToWString() const {
+    return utf16_to_wstring(data_.View());
+}
+
+String String::Sub(Integer offset, Integer count) const {
+    if (offset == 0 && count == Length()) {
+        return *this;
+    }
+    return FromUtf16(data_.Data() + offset, static_cast<size_t>(count));
+}
+
+void String::Erase(Integer offset, Integer count) {
+    data_.Erase(offset, count);
+}
+
+void String::InsertAt(Integer offset, const String& s) {
+    data_.Insert(offset, s.data_.Data(), s.data_.Size());
+}
+
+Integer String::Find(const String& s, Integer offset) const {
+    size_t pos = find_units(data_.Data(), data_.Size(), s.data_.Data(), s.data_.Size(),
+                            static_cast<size_t>(offset));
+    return (pos == NOT_FOUND) ? -1 : static_cast<Integer>(pos);
+}
+
+std::ostream& operator<<(std::ostream& os, const String& s) {
+    os << s.ToStdString();
+    return os;
+}
+
+#endif // NP_STRING_UTF8
+
+// --- Common to both representations ---
+
+// Most characters appended to strings are ASCII (';', ' ', #10...)
+String::String(Char c) {
+    if (c < 0x80) {
+        char ascii = static_cast<char>(c);
+        *this = FromAscii(&ascii, 1);
+    } else {
+        *this = FromUtf16(&c, 1);
+    }
+}
+
 bool String::operator==(const String& other) const {
-    return data_ == other.data_;
+    if (data_.SharesWith(other.data_)) {
+        return true;
+    }
+    if (data_.Size() != other.data_.Size()) {
+        return false;
+    }
+    // Equal texts intern to one block
+    if (data_.IsInterned() && other.data_.IsInterned()) {
+        return false;
+    }
+    // Texts whose hashes are both known and differ cannot be equal
+    uint64_t hash = data_.CachedHash();
+    uint64_t other_hash = other.data_.CachedHash();
+    if (hash != 0 && other_hash != 0 && hash != other_hash) {
+        return false;
+    }
+    // memcmp: char_traits<char16_t>::compare is a unit-at-a-time loop
+    return std::memcmp(data_.Data(), other.data_.Data(), data_.Size() * sizeof(StringUnit)) == 0;
 }
 
 bool String::operator!=(const String& other) const {
-    return data_ != other.data_;
+    return !(*this == other);
 }
 
 bool String::operator<(const String& other) const {
-    return data_ < other.data_;
+    return compare_units(data_.Data(), data_.Size(), other.data_.Data(), other.data_.Size()) < 0;
 }
 
 bool String::operator>(const String& other) const {
-    return data_ > other.data_;
+    return compare_units(data_.Data(), data_.Size(), other.data_.Data(), other.data_.Size()) > 0;
 }
 
 bool String::operator<=(const String& other) const {
-    return data_ <= other.data_;
+    return compare_units(data_.Data(), data_.Size(), other.data_.Data(), other.data_.Size()) <= 0;
 }
 
 bool String::operator>=(const String& other) const {
-    return data_ >= other.data_;
-}
-
-Integer String::Length() const {
-    return static_cast<Integer>(data_.length());
+    return compare_units(data_.Data(), data_.Size(), other.data_.Data(), other.data_.Size()) >= 0;
 }
 
-std::string String::ToStdString() const {
-    return utf16_to_utf8(data_);
+std::strong_ordering String::operator<=>(const String& other) const {
+    if (data_.SharesWith(other.data_)) {
+        return std::strong_ordering::equal;
+    }
+    return compare_units(data_.Data(), data_.Size(), other.data_.Data(), other.data_.Size()) <=> 0;
 }
 
-std::wstring String::ToWString() const {
-    return utf16_to_wstring(data_);
+uint64_t String::Hash() const {
+    uint64_t hash = data_.CachedHash();
+    if (hash == 0) {
+        hash = hash_units(data_.Data(), data_.Size());
+        data_.CacheHash(hash);
+    }
+    return hash;
 }
 
 const wchar_t* String::c_str_wide() const {
 #ifdef _WIN32
-    return reinterpret_cast<const wchar_t*>(data_.c_str());
+    return reinterpret_cast<const wchar_t*>(Data().data());
 #else
     thread_local std::wstring temp;
     temp.clear();
-    temp.reserve(data_.size());
-    for (char16_t ch : data_) {
+    temp.reserve(Data().size());
+    for (char16_t ch : Data()) {
         temp.push_back(static_cast<wchar_t>(ch));
     }
     return temp.c_str();
 #endif
 }
 
-std::ostream& operator<<(std::ostream& os, const String& s) {
-    os << s.ToStdString();
-    return os;
-}
-
 // ============================================================================
 // STRING UTILITY FUNCTIONS
 // ============================================================================
@@ -261,137 +2184,177 @@ String Copy(const String& s, Integer start, Integer count) {
         return String();
     }
     
-    const std::u16string& data = s.Data();
-    return String(data.substr(start - 1, count));
+    return s.Sub(start - 1, count);
 }
 
 Integer Pos(const String& substr, const String& s) {
-    const std::u16string& haystack = s.Data();
-    const std::u16string& needle = substr.Data();
-    
-    size_t pos = haystack.find(needle);
-    if (pos == std::u16string::npos) {
+    return s.Find(substr) + 1;
+}
+
+Integer PosEx(const String& substr, const String& s, Integer offset) {
+    if (offset < 1 || offset > s.Length()) {
         return 0;
     }
-    
-    return static_cast<Integer>(pos) + 1;
+    return s.Find(substr, offset - 1) + 1;
+}
+
+String _StringReplace(const String& text, const String& oldPattern, const String& newPattern,
+                      Boolean replaceAll, Boolean ignoreCase) {
+#ifdef NP_STRING_UTF8
+    // Byte matches are character matches in valid UTF-8; folding case keeps
+    // the byte count only for ASCII, so other strings go through UTF-16
+    bool ascii = text.RawSize() == static_cast<size_t>(text.Length()) &&
+                 oldPattern.RawSize() == static_cast<size_t>(oldPattern.Length());
+    if (!ignoreCase || ascii) {
+        StringBuffer<char> bytes;
+        if (!replace_text(std::string_view(text.Raw(), text.RawSize()),
+                          std::string_view(oldPattern.Raw(), oldPattern.RawSize()),
+                          std::string_view(newPattern.Raw(), newPattern.RawSize()),
+                          replaceAll, ignoreCase, bytes)) {
+            return text;
+        }
+        return String::FromRaw(std::move(bytes));
+    }
+    StringBuffer<char16_t> units;
+    if (!replace_text(text.Data(), oldPattern.Data(), newPattern.Data(), replaceAll, ignoreCase, units)) {
+        return text;
+    }
+    return String::FromUtf16(units.Data(), units.Size());
+#else
+    StringBuffer<char16_t> units;
+    if (!replace_text(text.Data(), oldPattern.Data(), newPattern.Data(), replaceAll, ignoreCase, units)) {
+        return text;
+    }
+    return String::FromRaw(std::move(units));
+#endif
 }
 
 String IntToStr(Integer value) {
-    return String(std::to_string(value));
+    return format_integer(value);
+}
+
+String IntToStr(Int64 value) {
+    return format_integer(value);
+}
+
+String IntToStr(Cardinal value) {
+    return format_integer(value);
 }
 
 Integer StrToInt(const String& s) {
-    try {
-        std::string str = s.ToStdString();
-        return std::stoi(str);
-    } catch (...) {
-        throw std::runtime_error("Invalid integer string");
+    int64_t value;
+    if (!str_to_integer(s, INT32_MIN, INT32_MAX, UINT32_MAX, value)) {
+        raise_convert_error(s, L"integer value");
     }
+    return static_cast<Integer>(value);
 }
 
 Integer StrToIntDef(const String& s, Integer defaultValue) {
-    try {
-        std::string str = s.ToStdString();
-        return std::stoi(str);
-    } catch (...) {
-        return defaultValue;
+    int64_t value;
+    return str_to_integer(s, INT32_MIN, INT32_MAX, UINT32_MAX, value) ? static_cast<Integer>(value) : defaultValue;
+}
+
+Int64 StrToInt64(const String& s) {
+    int64_t value;
+    if (!str_to_integer(s, INT64_MIN, INT64_MAX, UINT64_MAX, value)) {
+        raise_convert_error(s, L"integer value");
     }
+    return value;
+}
+
+Int64 StrToInt64Def(const String& s, Int64 defaultValue) {
+    int64_t value;
+    return str_to_integer(s, INT64_MIN, INT64_MAX, UINT64_MAX, value) ? value : defaultValue;
+}
+
+size_t _FloatToText(char* AOut, Double AValue, Integer APrecision) {
+    return format_float_general(AValue, AOut, std::clamp<Integer>(APrecision, 1, 18));
 }
 
 String FloatToStr(Double value) {
-    // Use ostringstream for proper floating-point formatting
-    // This matches Delphi's FloatToStr behavior:
-    // - No unnecessary trailing zeros
-    // - Scientific notation for very large/small numbers
-    // - Clean, human-readable output
-    std::ostringstream oss;
-    
-    // Set precision and disable scientific notation for readability
-    oss.precision(15);  // Sufficient precision for Double
-    oss << std::fixed << value;
-    
-    std::string result = oss.str();
-    
-    // Remove trailing zeros after decimal point
-    if (result.find('.') != std::string::npos) {
-        result.erase(result.find_last_not_of('0') + 1, std::string::npos);
-        // Remove trailing decimal point if no decimals remain
-        if (result.back() == '.') {
-            result.pop_back();
-        }
-    }
-    
-    return String(result);
+    char buffer[40];
+    return String::FromAscii(buffer, format_float_general(value, buffer));
 }
 
 Double StrToFloat(const String& s) {
-    try {
-        std::string str = s.ToStdString();
-        return std::stod(str);
-    } catch (...) {
-        throw std::runtime_error("Invalid float string");
+    double value;
+    if (!str_to_float(s, value)) {
+        raise_convert_error(s, L"floating point value");
     }
+    return value;
 }
 
 String UpperCase(const String& s) {
-    std::string str = s.ToStdString();
-    std::transform(str.begin(), str.end(), str.begin(),
-                   [](unsigned char c) { return std::toupper(c); });
-    return String(str);
+    return ascii_case(s, 'a');
 }
 
 String LowerCase(const String& s) {
-    std::string str = s.ToStdString();
-    std::transform(str.begin(), str.end(), str.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    return String(str);
+    return ascii_case(s, 'A');
+}
+
+String AnsiUpperCase(const String& s) {
+    return unicode_case(s, case_tables().upper, u'a');
+}
+
+String AnsiLowerCase(const String& s) {
+    return unicode_case(s, case_tables().lower, u'A');
+}
+
+Integer CompareStr(const String& A, const String& B) {
+    int c = compare_units(A.Raw(), A.RawSize(), B.Raw(), B.RawSize());
+    return c < 0 ? -1 : (c > 0 ? 1 : 0);
+}
+
+Integer CompareText(const String& A, const String& B) {
+    return compare_ascii_text(A.Raw(), A.RawSize(), B.Raw(), B.RawSize());
+}
+
+Boolean SameText(const String& A, const String& B) {
+    return A.RawSize() == B.RawSize() && CompareText(A, B) == 0;
+}
+
+Integer AnsiCompareText(const String& A, const String& B) {
+    return compare_unicode_text(A.Raw(), A.RawSize(), B.Raw(), B.RawSize());
+}
+
+Boolean AnsiSameText(const String& A, const String& B) {
+    return A.SharesWith(B) || AnsiCompareText(A, B) == 0;
 }
 
 String Trim(const String& s) {
-    std::string str = s.ToStdString();
+    const StringUnit* begin = s.Raw();
+    const StringUnit* end   = begin + s.RawSize();
     
-    auto start = str.begin();
-    while (start != str.end() && std::isspace(*start)) {
-        start++;
+    while (begin != end && is_space(*begin)) {
+        begin++;
     }
-    
-    auto end = str.end();
-    do {
+    while (end != begin && is_space(*(end - 1))) {
         end--;
-    } while (std::distance(start, end) > 0 && std::isspace(*end));
+    }
     
-    return String(std::string(start, end + 1));
+    return trimmed(s, begin, end);
 }
 
 String TrimLeft(const String& s) {
-    std::string str = s.ToStdString();
+    const StringUnit* begin = s.Raw();
+    const StringUnit* end   = begin + s.RawSize();
     
-    auto start = str.begin();
-    while (start != str.end() && std::isspace(static_cast<unsigned char>(*start))) {
-        start++;
+    while (begin != end && is_space(*begin)) {
+        begin++;
     }
     
-    return String(std::string(start, str.end()));
+    return trimmed(s, begin, end);
 }
 
 String TrimRight(const String& s) {
-    std::string str = s.ToStdString();
-    
-    if (str.empty()) {
-        return String();
-    }
+    const StringUnit* begin = s.Raw();
+    const StringUnit* end   = begin + s.RawSize();
     
-    auto end = str.end();
-    do {
+    while (end != begin && is_space(*(end - 1))) {
         end--;
-    } while (end != str.begin() && std::isspace(static_cast<unsigned char>(*end)));
-    
-    if (end == str.begin() && std::isspace(static_cast<unsigned char>(*end))) {
-        return String();
     }
     
-    return String(std::string(str.begin(), end + 1));
+    return trimmed(s, begin, end);
 }
 
 void Delete(String& s, Integer index, Integer count) {
@@ -408,8 +2371,7 @@ void Delete(String& s, Integer index, Integer count) {
         count = len - index + 1;
     }
     
-    std::u16string& data = const_cast<std::u16string&>(s.Data());
-    data.erase(index - 1, count);
+    s.Erase(index - 1, count);
 }
 
 void Insert(const String& substr, String& s, Integer index) {
@@ -424,15 +2386,7 @@ void Insert(const String& substr, String& s, Integer index) {
         return;
     }
     
-    std::u16string& data = const_cast<std::u16string&>(s.Data());
-    data.insert(index - 1, substr.Data());
-}
-
-void String::SetLength(Integer newLength) {
-    if (newLength < 0) {
-        newLength = 0;
-    }
-    data_.resize(static_cast<size_t>(newLength));
+    s.InsertAt(index - 1, substr);
 }
 
 void SetLength(String& s, Integer newLength) {
@@ -440,8 +2394,26 @@ void SetLength(String& s, Integer newLength) {
 }
 
 void UniqueString(String& s) {
-    String temp = s;
-    s = temp;
+    s.MakeUnique();
+}
+
+String Intern(const String& s) {
+    if (s.RawSize() == 0 || s.IsInterned()) {
+        return s;
+    }
+    uint64_t hash = s.Hash();
+    InternShard& shard = intern_shards()[hash >> 58];
+    {
+        std::shared_lock read(shard.lock);
+        if (const String* found = shard.Find(hash, s)) {
+            return *found;
+        }
+    }
+    std::unique_lock write(shard.lock);
+    if (const String* found = shard.Find(hash, s)) {
+        return *found;
+    }
+    return shard.Add(hash, s);
 }
 
 void SetString(String& s, const char16_t* buffer, Integer length) {
@@ -449,31 +2421,30 @@ void SetString(String& s, const char16_t* buffer, Integer length) {
         s = String();
         return;
     }
-    s = String(std::u16string(buffer, static_cast<size_t>(length)));
+    s = String::FromUtf16(buffer, static_cast<size_t>(length));
 }
 
+// Val leaves 0 in value on error, and errorCode is the 1-based position of
+// the first character that is not part of the number
 void Val(const String& s, Integer& value, Integer& errorCode) {
-    try {
-        std::string str = s.ToStdString();
-        size_t pos = 0;
-        value = std::stoi(str, &pos);
-        errorCode = (pos == str.length()) ? 0 : static_cast<Integer>(pos + 1);
-    } catch (...) {
-        errorCode = 1;
-        value = 0;
-    }
+    int64_t parsed = 0;
+    ParseStatus status = parse_integer(s.Raw(), s.RawSize(), INT32_MIN, INT32_MAX, UINT32_MAX, parsed);
+    errorCode = status.error ? status.error : status.next == s.RawSize() ? 0 : static_cast<Integer>(status.next + 1);
+    value = errorCode ? 0 : static_cast<Integer>(parsed);
+}
+
+void Val(const String& s, Int64& value, Integer& errorCode) {
+    int64_t parsed = 0;
+    ParseStatus status = parse_integer(s.Raw(), s.RawSize(), INT64_MIN, INT64_MAX, UINT64_MAX, parsed);
+    errorCode = status.error ? status.error : status.next == s.RawSize() ? 0 : static_cast<Integer>(status.next + 1);
+    value = errorCode ? 0 : parsed;
 }
 
 void Val(const String& s, Double& value, Integer& errorCode) {
-    try {
-        std::string str = s.ToStdString();
-        size_t pos = 0;
-        value = std::stod(str, &pos);
-        errorCode = (pos == str.length()) ? 0 : static_cast<Integer>(pos + 1);
-    } catch (...) {
-        errorCode = 1;
-        value = 0.0;
-    }
+    double parsed = 0.0;
+    ParseStatus status = parse_float(s.Raw(), s.RawSize(), parsed);
+    errorCode = status.error ? status.error : status.next == s.RawSize() ? 0 : static_cast<Integer>(status.next + 1);
+    value = errorCode ? 0.0 : parsed;
 }
 
 void Str(Integer value, String& s) {
@@ -485,23 +2456,18 @@ void Str(Double value, String& s) {
 }
 
 void Str(Integer value, Integer width, String& s) {
-    std::string result = std::to_string(value);
-    if (width > 0 && static_cast<Integer>(result.length()) < width) {
-        result = std::string(width - result.length(), ' ') + result;
-    }
-    s = String(result);
+    char buffer[16];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    s = pad_left(buffer, static_cast<size_t>(result.ptr - buffer), width);
 }
 
+// Fixed notation with decimals digits (at most 64), right-aligned in width;
+// without decimals, 6 digits and no alignment
 void Str(Double value, Integer width, Integer decimals, String& s) {
-    char buffer[256];
-    if (width > 0 && decimals >= 0) {
-        snprintf(buffer, sizeof(buffer), "%*.*f", width, decimals, value);
-    } else if (decimals >= 0) {
-        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
-    } else {
-        snprintf(buffer, sizeof(buffer), "%f", value);
-    }
-    s = String(buffer);
+    char buffer[400];
+    int precision = decimals >= 0 ? std::min<Integer>(decimals, 64) : 6;
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, precision);
+    s = pad_left(buffer, static_cast<size_t>(result.ptr - buffer), decimals >= 0 ? width : 0);
 }
 
 Char UpCase(Char c) {
@@ -515,7 +2481,14 @@ String StringOfChar(Char c, Integer count) {
     if (count <= 0) {
         return String();
     }
-    return String(std::u16string(static_cast<size_t>(count), c));
+    if (c < 0x80) {
+        StringBuffer<StringUnit> raw;
+        std::fill_n(raw.Overwrite(static_cast<size_t>(count)), count, static_cast<StringUnit>(c));
+        return String::FromRaw(std::move(raw));
+    }
+    StringBuffer<char16_t> units;
+    std::fill_n(units.Overwrite(static_cast<size_t>(count)), count, c);
+    return String::FromUtf16(units.Data(), units.Size());
 }
 
 Integer WideCharLen(const wchar_t* str) {
@@ -557,4 +2530,271 @@ void WideCharToStrVar(const wchar_t* buffer, String& s) {
     s = String(buffer);
 }
 
+// ============================================================================
+// STRING VIEWS
+// ============================================================================
+
+StringView::StringView(const String& AText) : text_(AText), size_(AText.RawSize()) {
+#ifdef NP_STRING_UTF8
+    length_ = AText.Length();
+    ascii_  = size_ == static_cast<size_t>(length_);
+#endif
+}
+
+StringView::operator String() const {
+    if (offset_ == 0 && size_ == text_.RawSize()) {
+        return text_;
+    }
+#ifdef NP_STRING_UTF8
+    if (ascii_) {
+        return String::FromAscii(Raw(), size_);
+    }
+    return String::FromRaw(StringBuffer<char>(Raw(), size_));
+#else
+    return String::FromUtf16(Raw(), size_);
+#endif
+}
+
+Integer StringView::Length() const {
+#ifdef NP_STRING_UTF8
+    return length_;
+#else
+    return static_cast<Integer>(size_);
+#endif
+}
+
+void StringView::Narrow(Integer offset, Integer count) {
+#ifdef NP_STRING_UTF8
+    if (!ascii_) {
+        bool split_start, split_end;
+        size_t skip = utf8_unit_bytes(Raw(), static_cast<size_t>(offset), split_start);
+        size_t size = utf8_unit_bytes(Raw() + skip, static_cast<size_t>(count), split_end);
+        if (split_start || split_end) {
+            // Half a surrogate pair has no UTF-8 form: copy, as String::Sub does
+            *this = StringView(text_.Sub(start_ + offset, count));
+            return;
+        }
+        offset_ += skip;
+        size_    = size;
+        ascii_   = size == static_cast<size_t>(count);
+        start_  += offset;
+        length_  = count;
+        return;
+    }
+    start_  += offset;
+    length_  = count;
+#endif
+    offset_ += static_cast<size_t>(offset);
+    size_    = static_cast<size_t>(count);
+}
+
+void StringView::NarrowAscii(size_t AOffset, size_t ASize) {
+#ifdef NP_STRING_UTF8
+    start_  += static_cast<Integer>(AOffset);
+    length_ -= static_cast<Integer>(size_ - ASize);
+#endif
+    offset_ += AOffset;
+    size_    = ASize;
+}
+
+// As String::Find; under NP_STRING_UTF8 a byte match is a character match,
+// and the bytes before it give its unit index
+Integer StringView::Find(const StringUnit* AUnits, size_t ASize, Integer offset) const {
+    size_t from = static_cast<size_t>(offset);
+#ifdef NP_STRING_UTF8
+    if (!ascii_ && offset != 0) {
+        bool split;
+        from = utf8_unit_bytes(Raw(), from, split);
+        from += split ? 4 : 0;  // no match starts inside a character
+    }
+#endif
+    size_t pos = find_units(Raw(), size_, AUnits, ASize, from);
+    if (pos == NOT_FOUND) {
+        return -1;
+    }
+#ifdef NP_STRING_UTF8
+    if (!ascii_) {
+        pos = kernels().utf16_length(Raw(), pos);
+    }
+#endif
+    return static_cast<Integer>(pos);
+}
+
+Integer Length(const StringView& s) {
+    return s.Length();
+}
+
+StringView Copy(StringView s, Integer start, Integer count) {
+    if (start < 1) {
+        start = 1;
+    }
+    Integer len = s.Length();
+    if (start > len || count <= 0) {
+        return StringView();
+    }
+    if (count > len - start + 1) {
+        count = len - start + 1;
+    }
+    s.Narrow(start - 1, count);
+    return s;
+}
+
+StringView Trim(StringView s) {
+    const StringUnit* begin = s.Raw();
+    const StringUnit* end   = begin + s.RawSize();
+    while (begin != end && is_space(*begin)) {
+        begin++;
+    }
+    while (end != begin && is_space(*(end - 1))) {
+        end--;
+    }
+    s.NarrowAscii(static_cast<size_t>(begin - s.Raw()), static_cast<size_t>(end - begin));
+    return s;
+}
+
+StringView TrimLeft(StringView s) {
+    const StringUnit* begin = s.Raw();
+    const StringUnit* end   = begin + s.RawSize();
+    while (begin != end && is_space(*begin)) {
+        begin++;
+    }
+    s.NarrowAscii(static_cast<size_t>(begin - s.Raw()), static_cast<size_t>(end - begin));
+    return s;
+}
+
+StringView TrimRight(StringView s) {
+    const StringUnit* begin = s.Raw();
+    const StringUnit* end   = begin + s.RawSize();
+    while (end != begin && is_space(*(end - 1))) {
+        end--;
+    }
+    s.NarrowAscii(0, static_cast<size_t>(end - begin));
+    return s;
+}
+
+Integer PosEx(const StringView& substr, const StringView& s, Integer offset) {
+    if (offset < 1 || offset > s.Length()) {
+        return 0;
+    }
+    return s.Find(substr, offset - 1) + 1;
+}
+
+Integer StrToInt(const StringView& s) {
+    int64_t value;
+    if (!str_to_integer(s, INT32_MIN, INT32_MAX, UINT32_MAX, value)) {
+        raise_convert_error(s, L"integer value");
+    }
+    return static_cast<Integer>(value);
+}
+
+Integer StrToIntDef(const StringView& s, Integer defaultValue) {
+    int64_t value;
+    return str_to_integer(s, INT32_MIN, INT32_MAX, UINT32_MAX, value) ? static_cast<Integer>(value) : defaultValue;
+}
+
+Int64 StrToInt64(const StringView& s) {
+    int64_t value;
+    if (!str_to_integer(s, INT64_MIN, INT64_MAX, UINT64_MAX, value)) {
+        raise_convert_error(s, L"integer value");
+    }
+    return value;
+}
+
+Double StrToFloat(const StringView& s) {
+    double value;
+    if (!str_to_float(s, value)) {
+        raise_convert_error(s, L"floating point value");
+    }
+    return value;
+}
+
+bool operator==(const StringView& a, const StringView& b) {
+    return a.RawSize() == b.RawSize() &&
+           std::memcmp(a.Raw(), b.Raw(), a.RawSize() * sizeof(StringUnit)) == 0;
+}
+
+String operator+(const StringView& a, const StringView& b) {
+    String result;
+    result.Reserve(a.RawSize() + b.RawSize());
+    result += a;
+    result += b;
+    return result;
+}
+
+// ============================================================================
+// STRING BUILDER
+// ============================================================================
+
+StringBuilder::StringBuilder(Integer ACapacity) {
+    EnsureCapacity(ACapacity);
+}
+
+StringBuilder& StringBuilder::Append(const String& AValue) {
+    text_ += AValue;
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(const char16_t* AValue) {
+    text_ += String(AValue);
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(Char AValue) {
+    if (AValue < 0x80) {
+        char ascii = static_cast<char>(AValue);
+        text_.AppendAscii(&ascii, 1);
+    } else {
+        text_ += String(AValue);
+    }
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(Integer AValue) {
+    append_integer(text_, AValue);
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(Cardinal AValue) {
+    append_integer(text_, AValue);
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(Int64 AValue) {
+    append_integer(text_, AValue);
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(Double AValue) {
+    char buffer[32];
+    text_.AppendAscii(buffer, format_float_general(AValue, buffer));
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(Boolean AValue) {
+    if (AValue) {
+        text_.AppendAscii("True", 4);
+    } else {
+        text_.AppendAscii("False", 5);
+    }
+    return *this;
+}
+
+StringBuilder& StringBuilder::AppendLine() {
+    text_.AppendAscii("\n", 1);
+    return *this;
+}
+
+// Keeps the buffer for the next round of appends
+void StringBuilder::Clear() {
+    size_t capacity = text_.Capacity();
+    text_.SetLength(0);
+    text_.Reserve(capacity);
+}
+
+void StringBuilder::EnsureCapacity(Integer ACapacity) {
+    if (ACapacity > 0) {
+        text_.Reserve(static_cast<size_t>(ACapacity));
+    }
+}
+
 } // namespace np
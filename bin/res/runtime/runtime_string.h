@@ -1,28 +1,461 @@
 /**
  * NitroPascal Runtime - String Type
- * UTF-16 String class with 1-based indexing and Delphi semantics
+ * String class with 1-based UTF-16 indexing and Delphi semantics
  */
 
 #pragma once
 
 #include "runtime_types.h"
 #include <string>
+#include <cstring>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <compare>
+#include <algorithm>
+#include <new>
+#include <tuple>
+#include <type_traits>
 #include <iostream>
 
 namespace np {
 
 // Forward declarations
 class String;
+class StringView;
 std::ostream& operator<<(std::ostream& os, const String& s);
 std::wostream& operator<<(std::wostream& os, const String& s);
 
 // ============================================================================
-// STRING CLASS - UTF-16, 1-based indexing, Delphi semantics
+// STRING STORAGE - inline small buffer, refcounted copy-on-write heap block
 // ============================================================================
+// StringBuffer<Unit> holds a zero-terminated run of code units. Up to
+// InlineUnits units live inside the object itself (11 UTF-16 units or 23
+// UTF-8 bytes), so short strings never allocate. Longer contents live in a
+// heap block laid out as in Delphi: a header with an atomic reference count,
+// the capacity and the hash of the units once String::Hash has worked it
+// out, followed by the units. Copying a buffer shares the block
+// (one atomic increment); every mutating member detaches a shared block
+// first, so a write never shows through another copy. A block whose count
+// is -1 is static (see STRING LITERALS below) and one whose count is -2 is
+// interned (see Intern): either is shared without counting and never freed.
+
+/**
+ * _g_string_allocs - Number of string heap blocks the calling thread has
+ * allocated so far, read through StringAllocCount(); inline strings do not
+ * count
+ */
+inline thread_local Int64 _g_string_allocs = 0;
+
+inline Int64 StringAllocCount() {
+    return _g_string_allocs;
+}
+
+// Header in front of the units of every heap or static string block. The
+// hash is 0 until String::Hash stores it; a write to a unique block clears
+// it, and a shared block is never written, so readers can cache it freely.
+struct _StringHeader {
+    std::atomic<Integer>  refCount;
+    Integer               capacity;
+    std::atomic<uint64_t> hash;
+};
+
+// Reference count of a block made by Intern
+inline constexpr Integer _INTERNED_REFCOUNT = -2;
+
+template<typename Unit, std::size_t N>
+struct _StringBlock;
+
+template<typename Unit>
+class StringBuffer {
+public:
+    static constexpr std::size_t InlineUnits = 24 / sizeof(Unit) - 1;
+
+private:
+    using Header = _StringHeader;
+
+    Integer size_ = 0;
+    bool    heap_ = false;
+    union {
+        Unit* ptr_;
+        Unit  inline_[InlineUnits + 1] = {};
+    };
+
+    static Header* HeadOf(Unit* AData) {
+        return reinterpret_cast<Header*>(AData) - 1;
+    }
+
+    // Allocates a unique block with room for ACapacity units plus the terminator.
+    static Unit* Allocate(std::size_t ACapacity) {
+        if (ACapacity > static_cast<std::size_t>(INT32_MAX)) {
+            throw _Exception{EXC_RANGE_ERROR, L"String too long"};
+        }
+        void* block = ::operator new(sizeof(Header) + sizeof(Unit) * (ACapacity + 1));
+        _g_string_allocs++;
+        Header* head = ::new (block) Header{{1}, static_cast<Integer>(ACapacity), {0}};
+        return reinterpret_cast<Unit*>(head + 1);
+    }
+
+    // Drops this handle's reference. A count of 1 means no other handle
+    // exists to race with, so the common unshared case skips the atomic
+    // read-modify-write.
+    constexpr void Release() {
+        if (std::is_constant_evaluated() || !heap_) {
+            return;  // constant destruction of a literal holds nothing to free
+        }
+        Header* head  = HeadOf(ptr_);
+        Integer count = head->refCount.load(std::memory_order_acquire);
+        if (count < 0) {
+            return;
+        }
+        if (count == 1 || head->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            head->~Header();
+            ::operator delete(head);
+        }
+    }
+
+    // Forgets the cached hash of a unique block about to be written
+    void ClearHash() {
+        HeadOf(ptr_)->hash.store(0, std::memory_order_relaxed);
+    }
+
+    void SetEmpty() {
+        size_ = 0;
+        heap_ = false;
+        inline_[0] = Unit();
+    }
+
+    // Copies AOther's handle; the caller has already released this one.
+    void Share(const StringBuffer& AOther) {
+        size_ = AOther.size_;
+        heap_ = AOther.heap_;
+        if (heap_) {
+            ptr_ = AOther.ptr_;
+            Header* head = HeadOf(ptr_);
+            if (head->refCount.load(std::memory_order_relaxed) >= 0) {
+                head->refCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            std::memcpy(inline_, AOther.inline_, sizeof(inline_));
+        }
+    }
+
+    void Steal(StringBuffer& AOther) noexcept {
+        size_ = AOther.size_;
+        heap_ = AOther.heap_;
+        if (heap_) {
+            ptr_ = AOther.ptr_;
+        } else {
+            std::memcpy(inline_, AOther.inline_, sizeof(inline_));
+        }
+        AOther.SetEmpty();
+    }
+
+    // Makes the buffer unique with room for at least ACapacity units,
+    // keeping the first AKeep units. Returns the (possibly new) storage.
+    Unit* Reserve(std::size_t ACapacity, std::size_t AKeep) {
+        if (!heap_) {
+            if (ACapacity <= InlineUnits) {
+                return inline_;
+            }
+        } else if (HeadOf(ptr_)->refCount.load(std::memory_order_acquire) == 1 &&
+                   ACapacity <= static_cast<std::size_t>(HeadOf(ptr_)->capacity)) {
+            ClearHash();
+            return ptr_;
+        }
+        // Grow by half again when appending to a unique heap string, so
+        // repeated s := s + x stays amortised O(1).
+        std::size_t capacity = ACapacity;
+        if (heap_ && AKeep == static_cast<std::size_t>(size_) && ACapacity > static_cast<std::size_t>(size_)) {
+            std::size_t grown = static_cast<std::size_t>(size_) + size_ / 2;
+            if (grown > capacity && grown <= static_cast<std::size_t>(INT32_MAX)) {
+                capacity = grown;
+            }
+        }
+        Unit* data = Allocate(capacity);
+        std::copy_n(Data(), AKeep, data);
+        Release();
+        heap_ = true;
+        ptr_  = data;
+        return data;
+    }
+
+public:
+    StringBuffer() = default;
+
+    StringBuffer(const Unit* AData, std::size_t ALength) {
+        Unit* data = Overwrite(ALength);
+        std::copy_n(AData, ALength, data);
+    }
+
+    StringBuffer(const StringBuffer& other) {
+        Share(other);
+    }
+
+    // Refers to a static block without copying it
+    template<std::size_t N>
+    constexpr explicit StringBuffer(_StringBlock<Unit, N>& AStatic)
+        : size_(static_cast<Integer>(N)), heap_(true), ptr_(AStatic.data) {
+    }
+
+    StringBuffer(StringBuffer&& other) noexcept {
+        Steal(other);
+    }
+
+    /**
+     * FromInterned - Refer to a block made by Intern, without counting it
+     */
+    static StringBuffer FromInterned(Unit* AData, std::size_t ALength) {
+        StringBuffer result;
+        result.size_ = static_cast<Integer>(ALength);
+        result.heap_ = true;
+        result.ptr_  = AData;
+        return result;
+    }
+
+    constexpr ~StringBuffer() {
+        Release();
+    }
+
+    StringBuffer& operator=(const StringBuffer& other) {
+        if (this != &other) {
+            if (heap_ && other.heap_ && ptr_ == other.ptr_) {
+                return *this;
+            }
+            StringBuffer copy(other);
+            Release();
+            Steal(copy);
+        }
+        return *this;
+    }
+
+    StringBuffer& operator=(StringBuffer&& other) noexcept {
+        if (this != &other) {
+            Release();
+            Steal(other);
+        }
+        return *this;
+    }
+
+    const Unit* Data() const { return heap_ ? ptr_ : inline_; }
+    std::size_t Size() const { return static_cast<std::size_t>(size_); }
+    std::basic_string_view<Unit> View() const { return {Data(), Size()}; }
+
+    // True when another String shares the heap block
+    bool IsShared() const {
+        return heap_ && HeadOf(ptr_)->refCount.load(std::memory_order_acquire) != 1;
+    }
+
+    /**
+     * MutableData - Writable units; detaches a shared block first
+     */
+    Unit* MutableData() {
+        if (!heap_) {
+            return inline_;
+        }
+        if (HeadOf(ptr_)->refCount.load(std::memory_order_acquire) != 1) {
+            return Reserve(Size(), Size());
+        }
+        ClearHash();
+        return ptr_;
+    }
+
+    /**
+     * Overwrite - Replace the contents with ALength units (terminated, left
+     * uninitialised otherwise) and return them for the caller to fill
+     */
+    Unit* Overwrite(std::size_t ALength) {
+        Unit* data;
+        if (heap_ && !IsShared() && ALength <= static_cast<std::size_t>(HeadOf(ptr_)->capacity)) {
+            ClearHash();
+            data = ptr_;
+        } else if (ALength <= InlineUnits) {
+            Release();
+            heap_ = false;
+            data  = inline_;
+        } else {
+            data = Allocate(ALength);
+            Release();
+            heap_ = true;
+            ptr_  = data;
+        }
+        size_ = static_cast<Integer>(ALength);
+        data[ALength] = Unit();
+        return data;
+    }
+
+    void Append(const Unit* AData, std::size_t ALength) {
+        if (ALength == 0) {
+            return;
+        }
+        // AData may point into this buffer (s := s + s); the kept units are
+        // copied into any new block, so re-base it there.
+        std::size_t size   = Size();
+        const Unit* old    = Data();
+        bool        inside = AData >= old && AData < old + size;
+        Unit* data = Reserve(size + ALength, size);
+        if (inside) {
+            AData = data + (AData - old);
+        }
+        std::copy_n(AData, ALength, data + size);
+        size_ = static_cast<Integer>(size + ALength);
+        data[size_] = Unit();
+    }
+
+    /**
+     * Extend - Grow by ALength units (uninitialised) and return them for
+     * the caller to fill
+     */
+    Unit* Extend(std::size_t ALength) {
+        std::size_t size = Size();
+        Unit* data = Reserve(size + ALength, size);
+        size_ = static_cast<Integer>(size + ALength);
+        data[size_] = Unit();
+        return data + size;
+    }
+
+    void Append(const StringBuffer& other) {
+        // Appending to an empty string shares the block, unless this one
+        // has a block of its own reserved for the appends that follow
+        if (size_ == 0 && (!heap_ || IsShared())) {
+            *this = other;
+            return;
+        }
+        Append(other.Data(), other.Size());
+    }
+
+    // Resizes to ALength units, padding with AFill when growing
+    void Resize(std::size_t ALength, Unit AFill) {
+        std::size_t size = Size();
+        Unit* data = Reserve(ALength, ALength < size ? ALength : size);
+        if (ALength > size) {
+            std::fill(data + size, data + ALength, AFill);
+        }
+        size_ = static_cast<Integer>(ALength);
+        data[ALength] = Unit();
+    }
+
+    void Erase(std::size_t AOffset, std::size_t ACount) {
+        Unit* data = MutableData();
+        std::copy(data + AOffset + ACount, data + size_ + 1, data + AOffset);
+        size_ -= static_cast<Integer>(ACount);
+    }
+
+    void Insert(std::size_t AOffset, const Unit* AData, std::size_t ALength) {
+        std::size_t size = Size();
+        StringBuffer result;
+        Unit* data = result.Overwrite(size + ALength);
+        std::copy_n(Data(), AOffset, data);
+        std::copy_n(AData, ALength, data + AOffset);
+        std::copy_n(Data() + AOffset, size - AOffset, data + AOffset + ALength);
+        *this = std::move(result);
+    }
+
+    /**
+     * MakeUnique - Give this buffer its own copy of a shared block
+     */
+    void MakeUnique() {
+        MutableData();
+    }
+
+    // True when both handles refer to the same heap block
+    bool SharesWith(const StringBuffer& other) const {
+        return heap_ && other.heap_ && ptr_ == other.ptr_;
+    }
+
+    // True when the block was made by Intern
+    bool IsInterned() const {
+        return heap_ && HeadOf(ptr_)->refCount.load(std::memory_order_relaxed) == _INTERNED_REFCOUNT;
+    }
+
+    // Hash cached in the block header, or 0 (inline buffers cache nothing)
+    uint64_t CachedHash() const {
+        return heap_ ? HeadOf(ptr_)->hash.load(std::memory_order_relaxed) : 0;
+    }
+
+    void CacheHash(uint64_t AHash) const {
+        if (heap_) {
+            HeadOf(ptr_)->hash.store(AHash, std::memory_order_relaxed);
+        }
+    }
+
+    // Units the buffer holds before its next reallocation
+    std::size_t Capacity() const {
+        return heap_ ? static_cast<std::size_t>(HeadOf(ptr_)->capacity) : InlineUnits;
+    }
+
+    /**
+     * EnsureCapacity - Make room for at least ACapacity units without
+     * changing the contents; a shared block is detached
+     */
+    void EnsureCapacity(std::size_t ACapacity) {
+        if (ACapacity > Size()) {
+            Reserve(ACapacity, Size());
+        }
+    }
+};
+
+// ============================================================================
+// STRING CLASS - 1-based indexing, Delphi semantics
+// ============================================================================
+// A String is a sequence of UTF-16 code units (np::Char) in both storage
+// representations; Length, indexing, Copy, Pos, Delete and Insert all count
+// code units, exactly as in Delphi. The storage is chosen at build time:
+//
+//   default        : UTF-16 code units
+//   NP_STRING_UTF8 : UTF-8 bytes plus the UTF-16 length and an all-ASCII
+//                    flag kept up to date on every change. ASCII strings index
+//                    bytes directly; other strings build a UTF-16 copy on the
+//                    first indexed access and keep it until the next change.
+//
+// Under NP_STRING_UTF8 a lone surrogate (e.g. from Copy splitting a pair)
+// cannot be stored and becomes U+FFFD, and the relational operators order by
+// code point rather than by UTF-16 code unit.
+//
+// Either way the units are kept in a StringBuffer, so assigning a String
+// (to a variable, a function result, a record field or an array element)
+// shares the block instead of copying it, as Delphi's refcounted strings do.
+
+#ifdef NP_STRING_UTF8
+using StringUnit = char;
+#else
+using StringUnit = char16_t;
+#endif
 
 class String {
+public:
+#ifdef NP_STRING_UTF8
+    // Assignable reference to one character, returned by the non-const
+    // operator[] because a UTF-8 buffer has no char16_t to refer to.
+    class CharRef {
+    public:
+        CharRef(String& s, Integer index) : s_(s), index_(index) {}
+        operator char16_t() const { return static_cast<const String&>(s_)[index_]; }
+        CharRef& operator=(char16_t ch) { s_.SetChar(index_, ch); return *this; }
+        CharRef& operator=(const CharRef& other) { return *this = static_cast<char16_t>(other); }
+
+    private:
+        String& s_;
+        Integer index_;
+    };
+#else
+    using CharRef = char16_t&;
+#endif
+
 private:
-    std::u16string data_;
+#ifdef NP_STRING_UTF8
+    StringBuffer<char> data_;
+    Integer            length_ = 0;     // UTF-16 code units
+    bool               ascii_  = true;  // every byte < 0x80: unit index == byte index
+    mutable StringBuffer<char16_t> utf16_;  // lazy, non-ASCII only (never empty when built)
+
+    void Assign(StringBuffer<char>&& bytes);
+    void AssignUtf16(const char16_t* units, size_t n);
+    void SetChar(Integer index, char16_t ch);
+    std::u16string_view Utf16() const;
+#else
+    StringBuffer<char16_t> data_;
+#endif
 
 public:
     String();
@@ -32,42 +465,263 @@ public:
     String(const std::string& s);
     String(const std::u16string& s);
     String(const std::wstring& s);
-    
-    char16_t operator[](Integer index) const;
-    char16_t& operator[](Integer index);
-    
+    // A Char converts to a one-character String, as in Delphi
+    String(Char c);
+
+    // A literal held in a static block of N storage units and ALength
+    // UTF-16 code units; emitted as np::StrLit<u"...">
+    template<std::size_t N>
+    constexpr String(_StringBlock<StringUnit, N>& AStatic, [[maybe_unused]] Integer ALength)
+#ifdef NP_STRING_UTF8
+        : data_(AStatic), length_(ALength), ascii_(static_cast<Integer>(N) == ALength) {
+#else
+        : data_(AStatic) {
+#endif
+    }
+
+    // Builds a String from bytes known to be 7-bit ASCII (number formatting)
+    static String FromAscii(const char* s, size_t n);
+    // Builds a String from UTF-16 code units
+    static String FromUtf16(const char16_t* s, size_t n);
+    // Builds a String from UTF-8 bytes (malformed sequences become U+FFFD)
+    // with one allocation: text file lines, byte buffers
+    static String FromUtf8(const char* s, size_t n);
+    // Takes over a buffer already in the storage encoding
+    static String FromRaw(StringBuffer<StringUnit>&& raw);
+
+    // Raw 1-based character access ({$R-}); np::At() is the checked form.
+#ifdef NP_STRING_UTF8
+    char16_t operator[](Integer index) const {
+        return ascii_ ? static_cast<char16_t>(static_cast<unsigned char>(data_.Data()[index - 1]))
+                      : Utf16()[index - 1];
+    }
+    CharRef operator[](Integer index) { return CharRef(*this, index); }
+#else
+    char16_t operator[](Integer index) const { return data_.Data()[index - 1]; }
+    char16_t& operator[](Integer index) { return data_.MutableData()[index - 1]; }
+#endif
+
     String operator+(const String& other) const;
     String& operator+=(const String& other);
-    
+    String& operator+=(const StringView& other);
+
     bool operator==(const String& other) const;
     bool operator!=(const String& other) const;
     bool operator<(const String& other) const;
     bool operator>(const String& other) const;
     bool operator<=(const String& other) const;
     bool operator>=(const String& other) const;
-    
-    Integer Length() const;
+    // Ordinal order of the UTF-16 code units, as CompareStr
+    std::strong_ordering operator<=>(const String& other) const;
+
+#ifdef NP_STRING_UTF8
+    Integer Length() const { return length_; }
+#else
+    Integer Length() const { return static_cast<Integer>(data_.Size()); }
+#endif
     void SetLength(Integer newLength);
     std::string ToStdString() const;
     std::wstring ToWString() const;
     const wchar_t* c_str_wide() const;
-    
+
     std::string to_ansi() const {
         return ToStdString();
     }
-    
-    const std::u16string& Data() const { return data_; }
-    
+
+    // Storage in its native encoding (UTF-16 units or UTF-8 bytes)
+    const StringUnit* Raw() const { return data_.Data(); }
+    size_t RawSize() const { return data_.Size(); }
+    // Writable storage, detached first; the caller must not change which
+    // characters are ASCII or how many units there are (ASCII case mapping)
+#ifdef NP_STRING_UTF8
+    StringUnit* MutableRaw() { utf16_ = StringBuffer<char16_t>(); return data_.MutableData(); }
+#else
+    StringUnit* MutableRaw() { return data_.MutableData(); }
+#endif
+
+    // UTF-16 code units, zero-terminated; under NP_STRING_UTF8 a cached
+    // transcoded copy
+#ifdef NP_STRING_UTF8
+    std::u16string_view Data() const { return Utf16(); }
+#else
+    std::u16string_view Data() const { return data_.View(); }
+#endif
+
+    // Gives this String its own copy of a shared heap block
+    void MakeUnique() { data_.MakeUnique(); }
+    // Storage units held before the next reallocation, and making room for
+    // ARawSize of them ahead of a run of appends
+    size_t Capacity() const { return data_.Capacity(); }
+    void Reserve(size_t ARawSize) { data_.EnsureCapacity(ARawSize); }
+    // True when both Strings refer to the same heap block
+    bool SharesWith(const String& other) const { return data_.SharesWith(other.data_); }
+    // True when this String is the canonical copy returned by Intern
+    bool IsInterned() const { return data_.IsInterned(); }
+    /**
+     * Hash - 64-bit hash of the storage units (wyhash); never 0. Worked out
+     * once per heap block and kept in its header, so hashing a long key
+     * again, or any interned String, is a load.
+     */
+    uint64_t Hash() const;
+
+    // Code-unit based primitives (0-based offsets, already clamped)
+    String Sub(Integer offset, Integer count) const;
+    void Erase(Integer offset, Integer count);
+    void InsertAt(Integer offset, const String& s);
+    Integer Find(const String& s, Integer offset = 0) const;  // -1 if absent or empty
+
+    // Appends bytes known to be 7-bit ASCII (StringBuilder)
+    void AppendAscii(const char* s, size_t n);
+
     friend std::ostream& operator<<(std::ostream& os, const String& s);
 };
 
 std::ostream& operator<<(std::ostream& os, const String& s);
 
+// ============================================================================
+// UTF-16 TO UTF-8 - shared by the runtime and compile-time string literals
+// ============================================================================
+
+/**
+ * _DecodeUtf16 - Pass each code point of AUnits to AEmit; an unpaired
+ * surrogate becomes U+FFFD
+ */
+template<typename Emit>
+constexpr void _DecodeUtf16(const char16_t* AUnits, std::size_t ACount, Emit&& AEmit) {
+    std::size_t i = 0;
+    while (i < ACount) {
+        uint32_t codepoint = AUnits[i++];
+        if (codepoint >= 0xD800 && codepoint <= 0xDFFF) {
+            if (codepoint <= 0xDBFF && i < ACount &&
+                AUnits[i] >= 0xDC00 && AUnits[i] <= 0xDFFF) {
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (AUnits[i] - 0xDC00);
+                i++;
+            } else {
+                codepoint = 0xFFFD;
+            }
+        }
+        AEmit(codepoint);
+    }
+}
+
+/**
+ * _Utf8Length - Number of UTF-8 bytes AUnits encode to
+ */
+constexpr std::size_t _Utf8Length(const char16_t* AUnits, std::size_t ACount) {
+    std::size_t bytes = 0;
+    _DecodeUtf16(AUnits, ACount, [&](uint32_t codepoint) {
+        bytes += (codepoint <= 0x7F) ? 1 : (codepoint <= 0x7FF) ? 2 : (codepoint <= 0xFFFF) ? 3 : 4;
+    });
+    return bytes;
+}
+
+/**
+ * _EncodeUtf8 - Write AUnits as UTF-8 to AOut, which has _Utf8Length()
+ * bytes of room; returns the end of the output
+ */
+constexpr char* _EncodeUtf8(const char16_t* AUnits, std::size_t ACount, char* AOut) {
+    _DecodeUtf16(AUnits, ACount, [&](uint32_t codepoint) {
+        if (codepoint <= 0x7F) {
+            *AOut++ = static_cast<char>(codepoint);
+        } else if (codepoint <= 0x7FF) {
+            *AOut++ = static_cast<char>(0xC0 | (codepoint >> 6));
+            *AOut++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else if (codepoint <= 0xFFFF) {
+            *AOut++ = static_cast<char>(0xE0 | (codepoint >> 12));
+            *AOut++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            *AOut++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            *AOut++ = static_cast<char>(0xF0 | (codepoint >> 18));
+            *AOut++ = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            *AOut++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            *AOut++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    });
+    return AOut;
+}
+
+// ============================================================================
+// STRING LITERALS
+// ============================================================================
+// A Pascal string literal is emitted as np::StrLit<u"...">: a constant
+// String over a static block whose reference count is -1, filled at compile
+// time in the storage encoding. Evaluating a literal never allocates or
+// transcodes. Comparing against one reads the static units, and assigning
+// one copies the handle without touching the count. A write through such a
+// copy detaches it, as for any shared string.
+
+/**
+ * _StringBlock - A string block with room for N units, laid out like a
+ * heap block; literals use it as static storage with a count of -1
+ */
+template<typename Unit, std::size_t N>
+struct _StringBlock {
+    _StringHeader head;
+    Unit          data[N + 1];
+
+    constexpr _StringBlock(const char16_t* AText, std::size_t AUnits)
+        : head{{-1}, static_cast<Integer>(N), {0}}, data{} {
+        if constexpr (std::is_same_v<Unit, char16_t>) {
+            std::copy_n(AText, AUnits, data);
+        } else {
+            _EncodeUtf8(AText, AUnits, data);
+        }
+    }
+};
+
+static_assert(sizeof(_StringHeader) % alignof(char16_t) == 0,
+              "the units of a block must start right after its header");
+
+// The text of a u"..." literal as a template argument
+template<std::size_t N>
+struct _LiteralText {
+    char16_t units[N];
+
+    constexpr _LiteralText(const char16_t (&AText)[N]) {
+        std::copy_n(AText, N, units);
+    }
+};
+
+template<_LiteralText Text>
+struct _LiteralBlock {
+    static constexpr std::size_t Units = sizeof(Text.units) / sizeof(char16_t) - 1;
+#ifdef NP_STRING_UTF8
+    static constexpr std::size_t Size = _Utf8Length(Text.units, Units);
+#else
+    static constexpr std::size_t Size = Units;
+#endif
+    static constinit inline _StringBlock<StringUnit, Size> block{Text.units, Units};
+};
+
+/**
+ * StrLit - The String for a Pascal literal, e.g. 'END' -> StrLit<u"END">
+ */
+template<_LiteralText Text>
+inline constexpr String StrLit{_LiteralBlock<Text>::block,
+                               static_cast<Integer>(_LiteralBlock<Text>::Units)};
+
 inline std::wostream& operator<<(std::wostream& os, const String& s) {
     os << s.ToWString();
     return os;
 }
 
+/**
+ * At - Range-checked 1-based character access, emitted for s[i] under {$R+}
+ */
+inline String::CharRef At(String& s, Integer index) {
+    if (static_cast<Cardinal>(index - 1) >= static_cast<Cardinal>(s.Length())) {
+        RangeError();
+    }
+    return s[index];
+}
+
+inline char16_t At(const String& s, Integer index) {
+    if (static_cast<Cardinal>(index - 1) >= static_cast<Cardinal>(s.Length())) {
+        RangeError();
+    }
+    return s[index];
+}
+
 // ============================================================================
 // STRING UTILITY FUNCTIONS
 // ============================================================================
@@ -75,13 +729,34 @@ inline std::wostream& operator<<(std::wostream& os, const String& s) {
 Integer Length(const String& s);
 String Copy(const String& s, Integer start, Integer count);
 Integer Pos(const String& substr, const String& s);
+Integer PosEx(const String& substr, const String& s, Integer offset = 1);
+inline Integer Pos(const String& substr, const String& s, Integer offset) {
+    return PosEx(substr, s, offset);
+}
 String IntToStr(Integer value);
+String IntToStr(Int64 value);
+String IntToStr(Cardinal value);
 Integer StrToInt(const String& s);
 Integer StrToIntDef(const String& s, Integer defaultValue);
+Int64 StrToInt64(const String& s);
+Int64 StrToInt64Def(const String& s, Int64 defaultValue);
 String FloatToStr(Double value);
+/**
+ * _FloatToText - AValue as FloatToStr writes it, with APrecision (1..18)
+ * significant digits in place of 15; AOut needs 40 bytes. Returns the
+ * length written.
+ */
+size_t _FloatToText(char* AOut, Double AValue, Integer APrecision);
 Double StrToFloat(const String& s);
 String UpperCase(const String& s);
 String LowerCase(const String& s);
+String AnsiUpperCase(const String& s);
+String AnsiLowerCase(const String& s);
+Integer CompareStr(const String& A, const String& B);
+Integer CompareText(const String& A, const String& B);
+Boolean SameText(const String& A, const String& B);
+Integer AnsiCompareText(const String& A, const String& B);
+Boolean AnsiSameText(const String& A, const String& B);
 String Trim(const String& s);
 void Delete(String& s, Integer index, Integer count);
 void Insert(const String& substr, String& s, Integer index);
@@ -93,8 +768,15 @@ String TrimLeft(const String& s);
 String TrimRight(const String& s);
 void SetLength(String& s, Integer newLength);
 void UniqueString(String& s);
+/**
+ * Intern - The canonical copy of s's text. Equal texts intern to the same
+ * block, so two interned Strings compare in O(1) whatever their length;
+ * the block lives until the program ends
+ */
+String Intern(const String& s);
 void SetString(String& s, const char16_t* buffer, Integer length);
 void Val(const String& s, Integer& value, Integer& errorCode);
+void Val(const String& s, Int64& value, Integer& errorCode);
 void Val(const String& s, Double& value, Integer& errorCode);
 void Str(Integer value, String& s);
 void Str(Double value, String& s);
@@ -107,4 +789,256 @@ String WideCharToString(const wchar_t* buffer, Integer length);
 void StringToWideChar(const String& s, wchar_t* buffer, Integer bufferSize);
 void WideCharToStrVar(const wchar_t* buffer, String& s);
 
+// StringReplace flags, passed as a set: [rfReplaceAll, rfIgnoreCase]
+enum TReplaceFlag : uint8_t {
+    rfReplaceAll,
+    rfIgnoreCase
+};
+
+/**
+ * _StringReplace - StringReplace with its flags unpacked; the result shares
+ * text when oldPattern does not occur in it
+ */
+String _StringReplace(const String& text, const String& oldPattern, const String& newPattern,
+                      Boolean replaceAll, Boolean ignoreCase);
+
+// ============================================================================
+// STRING VIEWS
+// ============================================================================
+// TStringView (np::StringView) is a run of a String's characters that shares
+// the String's block instead of copying it. Copy, Trim, TrimLeft and
+// TrimRight of a view return a view; Length, Pos, PosEx, indexing, StrToInt
+// and comparison read it in place, and Write/WriteLn print it directly. A
+// String converts to a view of all of it, so a tokenizer only needs its
+// working variables declared as TStringView:
+//
+//   Rest := Line;                          // no copy
+//   Tok  := Trim(Copy(Rest, 1, P - 1));    // no copy
+//   Name := Tok;                           // Name: String -- copied here
+//
+// A view is read-only: it becomes a String (copying its run, or sharing
+// the block when it covers all of it) when it is assigned or passed to one.
+// Under NP_STRING_UTF8 a Copy that would split a surrogate pair, which a
+// UTF-8 run cannot hold, copies the characters into a String of its own.
+
+class StringView {
+public:
+    StringView() = default;
+    // A view of all of AText
+    StringView(const String& AText);
+
+    // The characters as a String of their own
+    operator String() const;
+    String ToString() const { return *this; }
+
+    Integer Length() const;
+    // Storage of the run: UTF-16 code units, or bytes under NP_STRING_UTF8
+    const StringUnit* Raw() const { return text_.Raw() + offset_; }
+    size_t RawSize() const { return size_; }
+#ifdef NP_STRING_UTF8
+    bool IsAscii() const { return ascii_; }
+#endif
+    // True when the view reads AText's heap block
+    bool SharesWith(const String& AText) const { return text_.SharesWith(AText); }
+
+    // Raw 1-based character access ({$R-}); np::At() is the checked form.
+#ifdef NP_STRING_UTF8
+    char16_t operator[](Integer index) const {
+        return ascii_ ? static_cast<char16_t>(static_cast<unsigned char>(Raw()[index - 1]))
+                      : text_[start_ + index];
+    }
+#else
+    char16_t operator[](Integer index) const { return Raw()[index - 1]; }
+#endif
+
+    // Code-unit based primitives (0-based offsets, already clamped). The
+    // free functions take views by value and narrow them in place, so a
+    // temporary view is moved along instead of sharing its block again.
+    void Narrow(Integer offset, Integer count);
+    // Keeps the storage units [AOffset, AOffset + ASize) of the run, which
+    // start and end on ASCII characters (Trim)
+    void NarrowAscii(size_t AOffset, size_t ASize);
+    // -1 if absent or empty
+    Integer Find(const StringUnit* AUnits, size_t ASize, Integer offset = 0) const;
+    Integer Find(const StringView& s, Integer offset = 0) const { return Find(s.Raw(), s.size_, offset); }
+
+private:
+    String  text_;        // shares the viewed String's block
+    size_t  offset_ = 0;  // storage units into text_
+    size_t  size_   = 0;
+#ifdef NP_STRING_UTF8
+    Integer start_  = 0;  // UTF-16 code units into text_
+    Integer length_ = 0;
+    bool    ascii_  = true;
+#endif
+};
+
+inline char16_t At(const StringView& s, Integer index) {
+    if (static_cast<Cardinal>(index - 1) >= static_cast<Cardinal>(s.Length())) {
+        RangeError();
+    }
+    return s[index];
+}
+
+Integer Length(const StringView& s);
+StringView Copy(StringView s, Integer start, Integer count);
+StringView Trim(StringView s);
+StringView TrimLeft(StringView s);
+StringView TrimRight(StringView s);
+Integer StrToInt(const StringView& s);
+Integer StrToIntDef(const StringView& s, Integer defaultValue);
+Int64 StrToInt64(const StringView& s);
+Double StrToFloat(const StringView& s);
+
+// Pos and PosEx with a view on either side (a String on both sides keeps
+// the String overloads)
+Integer PosEx(const StringView& substr, const StringView& s, Integer offset = 1);
+inline Integer Pos(const StringView& substr, const StringView& s) {
+    return s.Find(substr) + 1;
+}
+inline Integer Pos(const String& substr, const StringView& s) {
+    return s.Find(substr.Raw(), substr.RawSize()) + 1;
+}
+inline Integer Pos(Char substr, const StringView& s) {
+    if (substr < 0x80) {
+        StringUnit unit = static_cast<StringUnit>(substr);
+        return s.Find(&unit, 1) + 1;
+    }
+    return Pos(String(substr), s);
+}
+inline Integer Pos(Char substr, const String& s) {
+    return Pos(String(substr), s);
+}
+inline Integer Pos(const StringView& substr, const String& s) {
+    return Pos(substr, StringView(s));
+}
+inline Integer PosEx(const String& substr, const StringView& s, Integer offset = 1) {
+    return PosEx(StringView(substr), s, offset);
+}
+inline Integer PosEx(const StringView& substr, const String& s, Integer offset = 1) {
+    return PosEx(substr, StringView(s), offset);
+}
+
+bool operator==(const StringView& a, const StringView& b);
+inline bool operator==(const String& a, const StringView& b) { return StringView(a) == b; }
+inline bool operator==(const StringView& a, const String& b) { return a == StringView(b); }
+inline bool operator!=(const StringView& a, const StringView& b) { return !(a == b); }
+inline bool operator!=(const String& a, const StringView& b) { return !(a == b); }
+inline bool operator!=(const StringView& a, const String& b) { return !(a == b); }
+
+String operator+(const StringView& a, const StringView& b);
+inline String operator+(const String& a, const StringView& b) { return StringView(a) + b; }
+inline String operator+(const StringView& a, const String& b) { return a + StringView(b); }
+
+// ============================================================================
+// STRING BUILDER
+// ============================================================================
+// s := s + a + b + c on a String variable is emitted as
+// np::_AppendAll(s, a, b, c): the operands are evaluated left to right, room
+// for all of them is reserved once and they are appended in place, so a
+// loop that grows a string stays amortised O(1) per append and never builds
+// the intermediate s + a, s + a + b.
+//
+// TStringBuilder (np::StringBuilder) is the explicit form for reports and
+// other long texts: Append(sb, x) formats numbers and Booleans straight into
+// the buffer, EnsureCapacity(sb, n) sizes it up front and ToString(sb)
+// shares the buffer with the result instead of copying it.
+
+// An operand of _AppendAll: a view stays a view, anything else becomes a
+// String. A view into ATarget itself (s := s + Copy(View, 1, 2) with View
+// taken from s) is copied out into a String of its own, so the operand no
+// longer depends on ATarget's block while ATarget grows.
+template<typename Part>
+auto _AppendOperand(const String& ATarget, Part&& APart) {
+    if constexpr (std::is_same_v<std::remove_cvref_t<Part>, StringView>) {
+        StringView view(std::forward<Part>(APart));
+        if (view.SharesWith(ATarget)) {
+            view = StringView(view.ToString());
+        }
+        return view;
+    } else {
+        return String(std::forward<Part>(APart));
+    }
+}
+
+/**
+ * _AppendAll - s := s + a + b ... appended in place
+ */
+template<typename... Parts>
+void _AppendAll(String& ATarget, Parts&&... AParts) {
+    // Snapshot first: an operand may read ATarget itself (s := s + 'x' + s)
+    const std::tuple parts{_AppendOperand(ATarget, std::forward<Parts>(AParts))...};
+    std::apply([&ATarget](const auto&... APart) {
+        ATarget.Reserve(ATarget.RawSize() + (APart.RawSize() + ... + 0));
+        ((ATarget += APart), ...);
+    }, parts);
+}
+
+class StringBuilder {
+public:
+    StringBuilder() = default;
+    explicit StringBuilder(Integer ACapacity);
+
+    StringBuilder& Append(const String& AValue);
+    StringBuilder& Append(const char16_t* AValue);
+    StringBuilder& Append(Char AValue);
+    StringBuilder& Append(Integer AValue);
+    StringBuilder& Append(Cardinal AValue);
+    StringBuilder& Append(Int64 AValue);
+    StringBuilder& Append(Double AValue);
+    StringBuilder& Append(Boolean AValue);   // 'True' / 'False'
+    // Line break as WriteLn writes it (LF)
+    StringBuilder& AppendLine();
+
+    void Clear();
+    void EnsureCapacity(Integer ACapacity);
+    // In storage units: UTF-16 code units, or bytes under NP_STRING_UTF8
+    Integer Capacity() const { return static_cast<Integer>(text_.Capacity()); }
+    Integer Length() const { return text_.Length(); }
+    // Shares the buffer; the next Append detaches it from the result
+    String ToString() const { return text_; }
+
+private:
+    String text_;
+};
+
+template<typename T>
+void Append(StringBuilder& ABuilder, const T& AValue) {
+    ABuilder.Append(AValue);
+}
+
+inline void AppendLine(StringBuilder& ABuilder) {
+    ABuilder.AppendLine();
+}
+
+template<typename T>
+void AppendLine(StringBuilder& ABuilder, const T& AValue) {
+    ABuilder.Append(AValue).AppendLine();
+}
+
+inline String ToString(const StringBuilder& ABuilder) {
+    return ABuilder.ToString();
+}
+
+inline Integer Capacity(const StringBuilder& ABuilder) {
+    return ABuilder.Capacity();
+}
+
+inline void EnsureCapacity(StringBuilder& ABuilder, Integer ACapacity) {
+    ABuilder.EnsureCapacity(ACapacity);
+}
+
+inline Integer Length(const StringBuilder& ABuilder) {
+    return ABuilder.Length();
+}
+
 } // namespace np
+
+// Unordered containers of Strings (np::Set<String>, std::unordered_map)
+// hash through the cached String::Hash
+template<>
+struct std::hash<np::String> {
+    std::size_t operator()(const np::String& AText) const noexcept {
+        return static_cast<std::size_t>(AText.Hash());
+    }
+};
@@ -8,7 +8,25 @@
 #include <cstdint>
 #include <string>
 #include <cstring>
-#include <csetjmp>
+
+// ============================================================================
+// BUILD CONFIGURATION
+// ============================================================================
+// NP_STRING_UTF8 - store np::String as UTF-8 instead of UTF-16 code units
+// (see runtime_string.h). Must be defined for every translation unit alike,
+// i.e. on the C++ compiler command line.
+//
+// NP_FAULT_FRAMES - deliver hardware faults to try statements through a
+// setjmp frame instead of throwing from the fault handler (see
+// runtime_exceptions.h). Throwing needs non-call exceptions, which GCC
+// offers and is switched on for below; other compilers (clang) get fault
+// frames. Defining NP_FAULT_FRAMES forces them for GCC as well.
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(NP_FAULT_FRAMES)
+    #pragma GCC optimize("non-call-exceptions")
+#elif !defined(NP_FAULT_FRAMES)
+    #define NP_FAULT_FRAMES
+#endif
 
 namespace np {
 
@@ -59,6 +77,7 @@ constexpr Integer EXC_STACK_OVERFLOW      = 4;
 constexpr Integer EXC_INTEGER_OVERFLOW    = 5;
 constexpr Integer EXC_ILLEGAL_INSTRUCTION = 6;
 constexpr Integer EXC_BUS_ERROR           = 7;
+constexpr Integer EXC_RANGE_ERROR         = 8;
 constexpr Integer EXC_UNKNOWN             = 99;
 
 // Internal exception object used by RaiseException and hardware handlers.
@@ -68,13 +87,14 @@ struct _Exception {
     std::wstring msg;
 };
 
-// Thread-local exception state -- written by raise/hardware handlers,
+// Raised by range-checked indexing ({$R+}); see np::At.
+[[noreturn]] inline void RangeError() {
+    throw _Exception{EXC_RANGE_ERROR, L"Range check error"};
+}
+
+// Thread-local exception state -- written when an except block is entered,
 // read by GetExceptionCode() and GetExceptionMessage().
 inline thread_local Integer      _g_exc_code   = EXC_NONE;
 inline thread_local std::wstring _g_exc_msg;
 
-// Thread-local longjmp target -- set by TryCatch/TryFinally wrappers,
-// read by the hardware exception handlers.
-inline thread_local jmp_buf* _g_jmp_target = nullptr;
-
 } // namespace np
@@ -0,0 +1,54 @@
+(* EXPECT:
+Line 1 of 3
+Line 2 of 3
+Line 3 of 3
+ab-c
+TRUE FALSE
+Byte: 200
+Total: 5050
+flushed
+before halt
+*)
+
+program test_program_console;
+
+// Console output is collected in one runtime buffer instead of flushing
+// std::cout on every line. It is written out when the buffer fills, on
+// ReadLn, on an explicit Flush() and when the program ends -- including
+// through Halt, so the last line below must still appear.
+// WriteLn(a, b) -> np::WriteLn(a, b)  (appends '\n', no flush)
+// Flush()       -> np::Flush()
+
+var
+  i:     Integer;
+  total: Integer;
+  b:     Byte;
+  c:     Char;
+
+begin
+  for i := 1 to 3 do
+    WriteLn('Line ', i, ' of ', 3);
+
+  // Pieces of one line from several Write calls
+  c := '-';
+  Write('a');
+  Write('b', c);
+  WriteLn('c');
+
+  WriteLn(True, ' ', False);
+
+  b := 200;
+  WriteLn('Byte: ', b);
+
+  total := 0;
+  for i := 1 to 100 do
+    total := total + i;
+  WriteLn('Total: ', total);
+
+  WriteLn('flushed');
+  Flush();
+
+  WriteLn('before halt');
+  Halt(0);
+  WriteLn('not reached');
+end.
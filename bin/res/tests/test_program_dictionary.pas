@@ -0,0 +1,85 @@
+(* EXPECT:
+3
+TRUE
+20
+FALSE 0
+apple=10 banana=20 cherry=30
+apple=11 cherry=30 date=40
+Duplicates not allowed
+Item not found
+1000 332833500
+0
+*)
+
+program test_program_dictionary;
+
+// TDictionary<K, V> is an open-addressing hash table that keeps its pairs
+// in insertion order, so Keys and Values list them in the order they were
+// added. Add raises on a key that is already present and reading an absent
+// key raises; AddOrSetValue inserts or replaces.
+
+type
+  TStock = TDictionary<String, Integer>;
+
+var
+  LStock:   TStock;
+  LSquares: TDictionary<Integer, Integer>;
+  LValue:   Integer;
+  LFound:   Boolean;
+  LSum:     Int64;
+  i:        Integer;
+
+procedure PrintStock(const AStock: TStock);
+var
+  LNames: array of String;
+  j:      Integer;
+begin
+  LNames := AStock.Keys;
+  for j := 0 to High(LNames) do
+  begin
+    if j > 0 then
+      Write(' ');
+    Write(LNames[j], '=', AStock[LNames[j]]);
+  end;
+  WriteLn('');
+end;
+
+begin
+  LStock.Add('apple', 10);
+  LStock.Add('banana', 20);
+  LStock.Add('cherry', 30);
+  WriteLn(LStock.Count);
+  WriteLn(LStock.ContainsKey('banana'));
+  if LStock.TryGetValue('banana', LValue) then
+    WriteLn(LValue);
+  LFound := LStock.TryGetValue('durian', LValue);
+  WriteLn(LFound, ' ', LValue);
+  PrintStock(LStock);
+
+  // Remove keeps the order of the rest; AddOrSetValue replaces in place
+  LStock.Remove('banana');
+  LStock.AddOrSetValue('date', 40);
+  LStock.AddOrSetValue('apple', 11);
+  PrintStock(LStock);
+
+  try
+    LStock.Add('apple', 0);
+  except
+    WriteLn(GetExceptionMessage());
+  end;
+  try
+    LValue := LStock['banana'];
+  except
+    WriteLn(GetExceptionMessage());
+  end;
+
+  // Integer keys; the table grows as pairs are added
+  for i := 0 to 999 do
+    LSquares.Add(i, i * i);
+  LSum := 0;
+  for i := 0 to 999 do
+    LSum := LSum + LSquares[i];
+  WriteLn(LSquares.Count, ' ', LSum);
+  LSquares.Clear;
+  WriteLn(LSquares.Count);
+end.
@@ -0,0 +1,64 @@
+(* EXPECT:
+5
+8
+8
+8
+*)
+
+{$APPTYPE CONSOLE}
+
+program test_program_directives;
+
+// Compiler directives are accepted wherever Delphi allows them. Directives
+// other than {$R} are ignored; {$R+}/{$R-} also work between the program
+// header and the first section, between var entries and between record
+// fields, and take effect from that point on. Names match in any letter
+// case, and a switch may be part of a combined list such as {$O+,R+}.
+
+{$R-}
+{$H+}
+
+type
+  TPair = record
+    A: Integer;
+    {$R+}
+    B: Integer;
+  end;
+
+var
+  LArr:  array[1..3] of Integer;
+  {$R-}
+  i:     Integer;
+  {$WARNINGS OFF}
+  LPair: TPair;
+
+begin
+  i := 2;
+  LArr[i] := 5;
+  LPair.A := LArr[i];
+  WriteLn(LPair.A);                  // 5
+
+  {$R+}
+  i := 4;
+  try
+    LArr[i] := 1;
+  except
+    WriteLn(GetExceptionCode());     // 8
+  end;
+
+  {$R-}
+  {$Rangechecks ON}
+  try
+    LArr[i] := 1;
+  except
+    WriteLn(GetExceptionCode());     // 8
+  end;
+
+  {$Q-,R-}
+  {$O+,R+}
+  try
+    LArr[i] := 1;
+  except
+    WriteLn(GetExceptionCode());     // 8
+  end;
+end.
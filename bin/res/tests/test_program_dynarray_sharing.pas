@@ -0,0 +1,55 @@
+(* EXPECT:
+10
+2
+3
+5
+10
+3
+30
+2
+2
+*)
+
+program test_program_dynarray_sharing;
+
+// Dynamic arrays are reference types, as in Delphi:
+// B := A            -> both names refer to one array, writes show through both
+// SetLength(B, N)   -> B gets its own resized copy; A is left unchanged
+// Copy(A)           -> an independent array
+// Copy(A, I, N)     -> an independent array of N elements from index I
+
+var
+  A: array of Integer;
+  B: array of Integer;
+  C: array of Integer;
+
+begin
+  SetLength(A, 3);
+  A[0] := 1;
+  A[1] := 2;
+  A[2] := 3;
+
+  // Assignment shares the array
+  B := A;
+  B[0] := 10;
+  WriteLn(A[0]);          // 10
+
+  // SetLength detaches the resized reference
+  SetLength(B, 5);
+  B[1] := 20;
+  WriteLn(A[1]);          // 2
+  WriteLn(Length(A));     // 3
+  WriteLn(Length(B));     // 5
+  WriteLn(B[0]);          // 10
+
+  // Copy makes an independent array
+  C := Copy(A);
+  C[2] := 30;
+  WriteLn(A[2]);          // 3
+  WriteLn(C[2]);          // 30
+
+  C := Copy(A, 1, 2);
+  C[0] := 40;
+  WriteLn(A[1]);          // 2
+  WriteLn(Length(C));     // 2
+end.
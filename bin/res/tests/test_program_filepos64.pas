@@ -0,0 +1,49 @@
+(* EXPECT:
+3
+3000000000
+TRUE
+3
+20
+2
+*)
+
+program test_program_filepos64;
+
+// FileSize, FilePos and Seek on a BinaryFile count records as Int64, so a
+// position past 2 GB is kept exactly. The cursor and size are tracked in
+// the file variable: querying them does not touch the file.
+
+var
+  LF:   BinaryFile;
+  LVal: Integer;
+  LPos: Int64;
+  i:    Integer;
+
+begin
+  Assign(LF, 'test_filepos64_tmp.bin');
+  Rewrite(LF, 4);
+  for i := 1 to 3 do
+  begin
+    LVal := i * 10;
+    BlockWrite(LF, LVal, 1);
+  end;
+  WriteLn(FileSize(LF));              // 3
+
+  // --- A cursor past the 32-bit range; nothing is written there ---
+  Seek(LF, 3000000000);
+  LPos := FilePos(LF);
+  WriteLn(LPos);                      // 3000000000
+  WriteLn(Eof(LF));                   // TRUE
+  WriteLn(FileSize(LF));              // 3
+  Close(LF);
+
+  // --- Reopen and read a record back ---
+  Reset(LF, 4);
+  Seek(LF, 1);
+  BlockRead(LF, LVal, 1);
+  WriteLn(LVal);                      // 20
+  WriteLn(FilePos(LF));               // 2
+  Close(LF);
+
+  DeleteFile('test_filepos64_tmp.bin');
+end.
@@ -0,0 +1,73 @@
+(* EXPECT:
+Alice is 30 years old
+[   42|42   |-0042|FFFFFFFF|4294967295]
+1234.57|1,234,567.89|$1,234.57|-$1,234.57
+1.23456780000000E+003|1234.5678
+B=2, A=1, B=2
+[     7] [hél     ]
+100% done
+name=Bob
+Format '%d' invalid or incompatible with argument
+No argument for format '%s %s'
+TRUE
+*)
+
+program test_program_format;
+
+// Format follows Delphi: %[index:][-][width][.prec]type with d u x e f g n m
+// p s, '*' for a width or precision taken from the arguments and %% for a
+// percent sign. A literal format string is split into its specifiers at
+// compile time, so only the arguments are formatted at run time.
+
+var
+  LName:   String;
+  LFmt:    String;
+  LText:   String;
+  LValue:  Double;
+  LAge:    Integer;
+  LBig:    Cardinal;
+  LBefore: Int64;
+  LAfter:  Int64;
+  i:       Integer;
+
+begin
+  // Strings and integers
+  LName := 'Alice';
+  LAge := 30;
+  WriteLn(Format('%s is %d years old', [LName, LAge]));
+  LBig := 4294967295;
+  WriteLn(Format('[%5d|%-5d|%.4d|%x|%u]', [42, 42, -42, -1, LBig]));
+
+  // Floating point
+  LValue := 1234.5678;
+  WriteLn(Format('%f|%n|%m|%m', [LValue, 1234567.891, LValue, -LValue]));
+  WriteLn(Format('%e|%g', [LValue, LValue]));
+
+  // Argument indexes, '*' and %%
+  WriteLn(Format('B=%1:d, A=%0:d, B=%d', [1, 2]));
+  WriteLn(Format('[%*d] [%-*.*s]', [6, 7, 8, 3, 'héllo']));
+  WriteLn(Format('%d%% done', [100]));
+
+  // A format string held in a variable is parsed as it is used
+  LFmt := 'name=%s';
+  WriteLn(Format(LFmt, ['Bob']));
+
+  // Mismatched specifiers and missing arguments raise
+  try
+    LText := Format('%d', [LName]);
+  except
+    WriteLn(GetExceptionMessage());
+  end;
+  try
+    LText := Format('%s %s', [LName]);
+  except
+    WriteLn(GetExceptionMessage());
+  end;
+
+  // One allocation per call: the result
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 100 do
+    LText := Format('item %d of %d: %s', [i, 100, 'a longer string argument']);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore <= 100);
+end.
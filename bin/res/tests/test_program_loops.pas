@@ -0,0 +1,97 @@
+(* EXPECT:
+15
+5 4 3 2 1 
+3
+found at 7
+2
+skip
+10
+-1
+*)
+
+program test_program_loops;
+
+// Native loop lowering: bounds are evaluated once, break inside a case arm
+// leaves the loop (not the C++ switch), and exit inside a loop body returns
+// from the enclosing routine rather than from a loop lambda.
+
+var
+  i:     Integer;
+  n:     Integer;
+  sum:   Integer;
+  LArr:  array[1..10] of Integer;
+
+function FindFirst(AValue: Integer): Integer;
+var
+  k: Integer;
+begin
+  Result := -1;
+  for k := 1 to 10 do
+    if LArr[k] = AValue then
+    begin
+      Result := k;
+      exit;
+    end;
+end;
+
+procedure CountDown(AFrom: Integer);
+var
+  k: Integer;
+begin
+  for k := AFrom downto 1 do
+    Write(k, ' ');
+  WriteLn('');
+end;
+
+begin
+  // Upper bound is evaluated once even if the body changes it
+  n := 5;
+  sum := 0;
+  for i := 1 to n do
+  begin
+    sum := sum + i;
+    n := 100;
+  end;
+  WriteLn(sum);                 // 15
+
+  CountDown(5);                 // 5 4 3 2 1
+
+  // break inside a case arm leaves the loop; control variable keeps its value
+  for i := 1 to 10 do
+  begin
+    case i of
+      3: break;
+    else
+      n := i;
+    end;
+  end;
+  WriteLn(i);                   // 3
+
+  for i := 1 to 10 do
+    LArr[i] := i * 10;
+  WriteLn('found at ', FindFirst(70));
+
+  // continue inside a case arm continues the loop
+  n := 0;
+  repeat
+    n := n + 1;
+    case n of
+      1: continue;
+    end;
+  until n >= 2;
+  WriteLn(n);                   // 2
+
+  i := 0;
+  while i < 10 do
+  begin
+    i := i + 1;
+    if i = 5 then
+    begin
+      WriteLn('skip');
+      continue;
+    end;
+  end;
+  WriteLn(i);                   // 10
+
+  WriteLn(FindFirst(42));       // -1
+end.
@@ -0,0 +1,87 @@
+(* EXPECT:
+TRUE
+3
+alpha
+beta
+gamma
+16
+60
+12
+20
+8
+FALSE
+*)
+
+program test_program_mappedfile;
+
+// MapFile maps a whole file into memory. The usual file routines then read
+// from the mapping: ReadLn takes the next line, Read the next record, and
+// Seek, FilePos and FileSize count bytes.
+
+var
+  LT:   TextFile;
+  LB:   BinaryFile;
+  LM:   TMappedFile;
+  s:    String;
+  n:    Integer;
+  LVal: Integer;
+  LSum: Integer;
+
+begin
+  // --- Lines ---
+  Assign(LT, 'test_mapped_tmp.txt');
+  Rewrite(LT);
+  WriteLn(LT, 'alpha');
+  WriteLn(LT, 'beta');
+  Write(LT, 'gamma');
+  Close(LT);
+
+  WriteLn(MapFile(LM, 'test_mapped_tmp.txt'));   // TRUE
+  n := 0;
+  while not Eof(LM) do
+  begin
+    ReadLn(LM, s);
+    n := n + 1;
+  end;
+  WriteLn(n);                         // 3
+
+  Reset(LM);
+  while not Eof(LM) do
+  begin
+    ReadLn(LM, s);
+    WriteLn(s);
+  end;
+  WriteLn(FileSize(LM));              // 16
+  Close(LM);
+
+  // --- Records ---
+  Assign(LB, 'test_mapped_tmp.bin');
+  Rewrite(LB, 4);
+  for n := 1 to 3 do
+  begin
+    LVal := n * 10;
+    BlockWrite(LB, LVal, 1);
+  end;
+  Close(LB);
+
+  MapFile(LM, 'test_mapped_tmp.bin');
+  LSum := 0;
+  while not Eof(LM) do
+  begin
+    Read(LM, LVal);
+    LSum := LSum + LVal;
+  end;
+  WriteLn(LSum);                      // 60
+  WriteLn(FileSize(LM));              // 12
+
+  Seek(LM, 4);
+  Read(LM, LVal);
+  WriteLn(LVal);                      // 20
+  WriteLn(FilePos(LM));               // 8
+  Close(LM);
+
+  WriteLn(MapFile(LM, 'test_mapped_missing.txt'));   // FALSE
+
+  DeleteFile('test_mapped_tmp.txt');
+  DeleteFile('test_mapped_tmp.bin');
+end.
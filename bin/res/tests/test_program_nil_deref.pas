@@ -0,0 +1,73 @@
+(* EXPECT:
+3
+3
+finally
+3
+4950
+4950
+Done
+*)
+
+program test_program_nil_deref;
+
+// Dereferencing nil is a hardware fault. The runtime turns it into an
+// exception with code 3 (access violation) that the innermost try statement
+// catches: in the same routine, from a called routine, and after the finally
+// code of a nested try..finally has run. The message is platform specific.
+// Locals a try body changed before the fault keep their values in the
+// except block and after the try statement.
+
+var
+  p: ^Integer;
+
+procedure Poke;
+begin
+  p^ := 1;
+end;
+
+function SumBeforeFault: Integer;
+var
+  LSum: Integer;
+  LI:   Integer;
+begin
+  LSum := 0;
+  try
+    for LI := 1 to 99 do
+      LSum := LSum + LI;
+    p^ := LSum;
+  except
+    WriteLn(LSum);
+  end;
+  Result := LSum;
+end;
+
+begin
+  // p is a global and therefore nil
+  try
+    p^ := 5;
+    WriteLn('not reached');
+  except
+    WriteLn(GetExceptionCode());
+  end;
+
+  try
+    Poke;
+    WriteLn('not reached');
+  except
+    WriteLn(GetExceptionCode());
+  end;
+
+  try
+    try
+      WriteLn(p^);
+    finally
+      WriteLn('finally');
+    end;
+  except
+    WriteLn(GetExceptionCode());
+  end;
+
+  WriteLn(SumBeforeFault());
+
+  WriteLn('Done');
+end.
@@ -0,0 +1,70 @@
+(* EXPECT:
+0.3
+1E20
+1.5E-7
+0.333333333333333
+123456.789
+9223372036854775807
+-9223372036854775807
+255
+-1
+123 0
+0 3
+10
+1500 0
+5
+Caught: 'abc' is not a valid integer value
+2.5
+*)
+
+program test_program_number_text;
+
+// Number <-> text conversions. FloatToStr rounds to 15 significant digits
+// and switches to d.dddE[-]x from 1E15 up or below 1E-5, as in Delphi.
+// Val leaves 0 in the value on error and puts the 1-based position of the
+// first character that is not part of the number in the error code.
+
+var
+  LInt:  Integer;
+  LBig:  Int64;
+  LReal: Double;
+  LCode: Integer;
+
+begin
+  WriteLn(FloatToStr(0.1 + 0.2));                 // 0.3
+  WriteLn(FloatToStr(1E20));                      // 1E20
+  WriteLn(FloatToStr(1.5E-7));                    // 1.5E-7
+  WriteLn(FloatToStr(1.0 / 3.0));                 // 0.333333333333333
+  WriteLn(FloatToStr(StrToFloat('123456.789')));  // round trip
+
+  // Int64 text keeps all digits
+  LBig := StrToInt64('9223372036854775807');
+  WriteLn(IntToStr(LBig));
+  LBig := StrToInt64Def('-9223372036854775807', 0);
+  WriteLn(IntToStr(LBig));
+
+  // $ hex prefix, and no partial numbers
+  WriteLn(StrToInt('$FF'));                       // 255
+  WriteLn(StrToIntDef('12abc', -1));              // -1
+
+  // Val error positions
+  Val('123', LInt, LCode);
+  WriteLn(LInt, ' ', LCode);                      // 123 0
+  Val('12x4', LInt, LCode);
+  WriteLn(LInt, ' ', LCode);                      // 0 3
+  Val('2147483648', LInt, LCode);
+  WriteLn(LCode);                                 // 10 (overflow)
+  Val('1.5e3', LReal, LCode);
+  WriteLn(LReal, ' ', LCode);                     // 1500 0
+  Val('1.5e', LReal, LCode);
+  WriteLn(LCode);                                 // 5 (no exponent digits)
+
+  try
+    LInt := StrToInt('abc');
+  except
+    WriteLn('Caught: ', getexceptionmessage());
+  end;
+
+  // StrToFloat ignores surrounding spaces
+  WriteLn(StrToFloat('  2.5  '));
+end.
@@ -0,0 +1,171 @@
+(* EXPECT:
+6
+hello world
+HELLO
+hello
+14
+3
+abc
+abc
+abc
+rec
+3
+TRUE
+*)
+
+program test_program_params;
+
+// Parameter passing: const and unmodified value parameters of strings and
+// records are emitted as const T& (no copy per call); value parameters the
+// routine modifies keep their by-value copy, so the caller's variable is
+// never changed. So do value parameters of routines that write a global or
+// call a routine that does: the argument may be that global. Calls to
+// routines that only touch their own locals and var parameters keep the
+// const reference.
+// const s: string        -> const np::String& s
+// s: string (read only)  -> const np::String& s
+// s: string (assigned)   -> np::String s
+
+type
+  TBox = record
+    W: Integer;
+    H: Integer;
+  end;
+
+  TNamed = record
+    Name: string;
+  end;
+
+var
+  gText: string;
+  gBox:  TBox;
+  gPos:  Integer;
+  gNamed: TNamed;
+  gConstRef: Boolean;
+
+// Recursive descent over a const string: counts letters
+function CountLetters(const AText: string; AIndex: Integer): Integer;
+begin
+  if AIndex > Length(AText) then
+    Result := 0
+  else if AText[AIndex] = ' ' then
+    Result := CountLetters(AText, AIndex + 1)
+  else
+    Result := 1 + CountLetters(AText, AIndex + 1);
+end;
+
+// Value parameter only read -- passed by const reference
+function Greet(AName: string): string;
+begin
+  Result := AName + ' world';
+end;
+
+// Value parameter modified locally -- keeps its own copy
+function Shout(AText: string): string;
+begin
+  AText := UpperCase(AText);
+  Result := AText;
+end;
+
+// Const record
+function Perimeter(const ABox: TBox): Integer;
+begin
+  Result := 2 * (ABox.W + ABox.H);
+end;
+
+// Value record passed on to a var parameter -- must stay a copy
+procedure Grow(var ABox: TBox);
+begin
+  ABox.W := ABox.W + 1;
+end;
+
+function GrownWidth(ABox: TBox): Integer;
+begin
+  Grow(ABox);
+  Result := ABox.W;
+end;
+
+// Value string read while a global of the same type is assigned
+function Swap(AText: string): string;
+begin
+  gText := 'changed';
+  Result := AText;
+end;
+
+// Value string read while an intrinsic writes a global
+function Trimmed(AText: string): string;
+begin
+  Delete(gText, 1, 1);
+  Result := AText;
+end;
+
+// Value string read while a called routine writes a global
+procedure Clobber;
+begin
+  gText := 'x';
+end;
+
+function Kept(AText: string): string;
+begin
+  Clobber;
+  Result := AText;
+end;
+
+// Value string read while a field of a global record is written
+function NameOf(AName: string): string;
+begin
+  gNamed.Name := '';
+  Result := AName;
+end;
+
+// Value string read by a routine that calls helpers which write only
+// their locals and a local var parameter -- passed by const reference
+procedure SkipBlanks(const AText: string; var APos: Integer);
+begin
+  while (APos <= Length(AText)) and (AText[APos] = ' ') do
+    APos := APos + 1;
+end;
+
+function IsDigit(AChar: Char): Boolean;
+begin
+  Result := (AChar >= '0') and (AChar <= '9');
+end;
+
+function CountDigits(AText: string): Integer;
+var
+  LPos: Integer;
+begin
+  Result := 0;
+  LPos := 1;
+  while LPos <= Length(AText) do
+  begin
+    SkipBlanks(AText, LPos);
+    if (LPos <= Length(AText)) and IsDigit(AText[LPos]) then
+      Result := Result + 1;
+    LPos := LPos + 1;
+  end;
+end;
+
+begin
+  writeln(CountLetters('ab c  def', 1));
+  writeln(Greet('hello'));
+  gText := 'hello';
+  writeln(Shout(gText));
+  writeln(gText);
+  gBox.W := 3;
+  gBox.H := 4;
+  writeln(Perimeter(gBox));
+  gPos := GrownWidth(gBox);
+  writeln(gBox.W);
+  gText := 'abc';
+  writeln(Swap(gText));
+  gText := 'abc';
+  writeln(Trimmed(gText));
+  gText := 'abc';
+  writeln(Kept(gText));
+  gNamed.Name := 'rec';
+  writeln(NameOf(gNamed.Name));
+  writeln(CountDigits(' 1 a2  3'));
+  gConstRef := cpp('std::is_same_v<decltype(&CountDigits), np::Integer (*)(const np::String&)>');
+  writeln(gConstRef);
+end.
@@ -0,0 +1,62 @@
+(* EXPECT:
+Static: code=8 msg=Range check error
+Dynamic: code=8 msg=Range check error
+String: code=8 msg=Range check error
+Unchecked sum: 15
+Checked again: code=8
+*)
+
+program test_program_range_checks;
+
+// Range checking ({$R+} / {$RANGECHECKS ON}) applies to every indexed type:
+// static arrays, dynamic arrays and strings raise code 8 (range error).
+// Under {$R-} indexing is emitted as raw C++ operator[] with no check.
+// a[i] maps to np::At(a, i) when checks are on and a[i] when off.
+
+{$R+}
+
+var
+  LStatic:  array[1..5] of Integer;
+  LDynamic: array of Integer;
+  LStr:     string;
+  i:        Integer;
+  n:        Integer;
+  sum:      Integer;
+
+begin
+  n := 6;
+  try
+    LStatic[n] := 1;
+  except
+    writeln('Static: code=', getexceptioncode(), ' msg=', getexceptionmessage());
+  end;
+
+  SetLength(LDynamic, 5);
+  try
+    LDynamic[n - 1] := 1;
+  except
+    writeln('Dynamic: code=', getexceptioncode(), ' msg=', getexceptionmessage());
+  end;
+
+  LStr := 'hello';
+  try
+    writeln(LStr[n]);
+  except
+    writeln('String: code=', getexceptioncode(), ' msg=', getexceptionmessage());
+  end;
+
+  {$RANGECHECKS OFF}
+  for i := 1 to 5 do
+    LStatic[i] := i;
+  sum := 0;
+  for i := 1 to 5 do
+    sum := sum + LStatic[i];
+  writeln('Unchecked sum: ', sum);
+
+  {$R+}
+  try
+    LDynamic[n] := 1;
+  except
+    writeln('Checked again: code=', getexceptioncode());
+  end;
+end.
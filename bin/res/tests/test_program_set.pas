@@ -16,7 +16,7 @@ program test_program_set;
 // Test set of T: declaration, type alias, set literal assignment,
 // Include, Exclude, and the 'in' membership operator.
 // set of Integer maps to np::Set<np::Integer>
-// [a, b, c] maps to np::MakeSet({a, b, c})
+// [a, b, c] with constant elements maps to np::SetLit<np::Integer, a, b, c>
 // Include(s, e) maps to np::Include(s, e)
 // Exclude(s, e) maps to np::Exclude(s, e)
 // x in s maps to np::In(x, s)
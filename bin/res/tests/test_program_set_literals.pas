@@ -0,0 +1,57 @@
+(* EXPECT:
+TRUE
+FALSE
+TRUE
+FALSE
+TRUE
+TRUE
+TRUE
+TRUE
+FALSE
+TRUE
+TRUE
+FALSE
+*)
+
+program test_program_set_literals;
+
+// Constant set constructors take the type of the set they meet, so they
+// combine and compare with a hash-backed set of Integer as well as with a
+// bitset. The result of +, -, * keeps every member of both sides:
+// [1, 2] + nums keeps members of nums above 255, and lower + ['0'] keeps
+// '0' although it lies outside 'a'..'z'.
+
+type
+  TLower = set of 'a'..'z';
+
+var
+  nums:  set of Integer;
+  lower: TLower;
+  chars: set of Char;
+
+begin
+  // Compare a literal with a set of Integer
+  nums := [3];
+  WriteLn(nums = [3]);        // TRUE
+  WriteLn(nums <> [3]);       // FALSE
+  Include(nums, 1000);
+  WriteLn([3] = nums);        // FALSE
+  WriteLn(nums <= [3]);       // FALSE
+  WriteLn([3] <= nums);       // TRUE
+
+  // Union with the literal on either side
+  nums := [1, 2] + nums;
+  WriteLn(1000 in nums);      // TRUE
+  WriteLn(2 in nums);         // TRUE
+  nums := nums + [4];
+  WriteLn(4 in nums);         // TRUE
+  nums := nums - [1000];
+  WriteLn(1000 in nums);      // FALSE
+
+  // A literal wider than a subrange set
+  lower := ['a', 'b'];
+  chars := lower + ['0'];
+  WriteLn('0' in chars);      // TRUE
+  WriteLn('b' in chars);      // TRUE
+  WriteLn(lower = ['a']);     // FALSE
+end.
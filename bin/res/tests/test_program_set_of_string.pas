@@ -0,0 +1,43 @@
+(* EXPECT:
+TRUE
+FALSE
+TRUE
+FALSE
+TRUE
+-1 0 1
+TRUE
+*)
+
+program test_program_set_of_string;
+
+// A set of String is a hash set. A String's hash is kept in its block once
+// worked out, so testing the same key again skips hashing it. Strings order
+// by their UTF-16 code units, as CompareStr does.
+
+type
+  TKeywords = set of String;
+
+var
+  LKeywords: TKeywords;
+  LExtra:    TKeywords;
+  LWord:     String;
+
+begin
+  LKeywords := ['begin', 'end', 'var'];
+  LWord := 'be';
+  LWord := LWord + 'gin';
+  WriteLn(LWord in LKeywords);
+
+  WriteLn('type' in LKeywords);
+  Include(LKeywords, 'type');
+  WriteLn('type' in LKeywords);
+  Exclude(LKeywords, 'var');
+  WriteLn('var' in LKeywords);
+
+  LExtra := LKeywords + ['program'];
+  WriteLn(('program' in LExtra) and not ('program' in LKeywords));
+
+  WriteLn(CompareStr('apple', 'banana'), ' ', CompareStr(LWord, 'begin'), ' ',
+    CompareStr('banana', 'apple'));
+  WriteLn(('abc' < 'abd') and ('Zebra' < 'apple'));
+end.
@@ -0,0 +1,70 @@
+(* EXPECT:
+TRUE
+FALSE
+TRUE
+TRUE
+FALSE
+5
+TRUE
+FALSE
+TRUE
+3
+*)
+
+program test_program_set_ordinal;
+
+// Small ordinal sets use the bitset backend of np::Set.
+// set of Char / set of Byte / set of lo..hi map to fixed-size bit arrays
+// ['a'..'z', '_'] with constant elements maps to a compile-time np::SetLit
+// [lo..hi] with variable bounds maps to np::MakeSetRange(lo, hi)
+
+type
+  TDigits = set of '0'..'9';
+
+var
+  letters: set of Char;
+  digits:  TDigits;
+  small:   set of 0..63;
+  bytes:   set of Byte;
+  c:       Char;
+  i:       Integer;
+  lo:      Integer;
+  count:   Integer;
+
+begin
+  // Constant constructor with a range
+  letters := ['a'..'z', 'A'..'Z', '_'];
+  WriteLn('q' in letters);   // TRUE
+  WriteLn('5' in letters);   // FALSE
+  WriteLn('_' in letters);   // TRUE
+
+  // Subrange set type alias
+  digits := ['0'..'9'];
+  WriteLn('7' in digits);    // TRUE
+  WriteLn('x' in digits);    // FALSE
+
+  // Constructor tested directly, counting matches
+  count := 0;
+  for c := 'a' to 'z' do
+    if c in ['a', 'e', 'i', 'o', 'u'] then
+      count := count + 1;
+  WriteLn(count);            // 5
+
+  // Subrange integer set with Include/Exclude
+  small := [];
+  Include(small, 10);
+  Include(small, 63);
+  Exclude(small, 10);
+  WriteLn(63 in small);      // TRUE
+  WriteLn(10 in small);      // FALSE
+
+  // Run-time range bounds
+  lo := 100;
+  bytes := [lo..lo + 2];
+  WriteLn(101 in bytes);     // TRUE
+  count := 0;
+  for i := 0 to 255 do
+    if i in bytes then
+      count := count + 1;
+  WriteLn(count);            // 3
+end.
@@ -0,0 +1,96 @@
+(* EXPECT:
+0
+0
+0
+1
+xxxxx
+yxxxx
+0
+1
+TRUE
+*)
+
+program test_program_string_alloc;
+
+// Strings are refcounted copy-on-write with an inline buffer for short
+// contents. np::StringAllocCount() counts string heap blocks, so each
+// number below is how many blocks the code above it allocated.
+// Assigning a string shares its block (0 allocations)
+// Short strings (up to 11 UTF-16 units) never touch the heap
+// Writing through a shared copy detaches it first (1 allocation)
+// UniqueString only copies when the block is shared
+
+type
+  TItem = record
+    Name: String;
+  end;
+
+var
+  LLong:   String;
+  LCopy:   String;
+  LShort:  String;
+  LPrefix: String;
+  LNames:  array of String;
+  LItem:   TItem;
+  LBefore: Int64;
+  LAfter:  Int64;
+  i:       Integer;
+
+function Echo(const AValue: String): String;
+begin
+  Result := AValue;
+end;
+
+begin
+  LLong := StringOfChar('x', 100);
+  SetLength(LNames, 100);
+
+  // Array elements share the block
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 0 to 99 do
+    LNames[i] := LLong;
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  // Function results and record fields share the block
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 100 do
+  begin
+    LCopy := Echo(LLong);
+    LItem.Name := LCopy;
+  end;
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  // Short identifiers stay in the inline buffer
+  LPrefix := 'item_';
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 100 do
+    LShort := LPrefix + IntToStr(i);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  // Writing to a shared copy detaches it, the original is unchanged
+  LCopy := LLong;
+  LBefore := cpp('np::StringAllocCount()');
+  LCopy[1] := 'y';
+  LCopy[2] := 'x';
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 1
+  WriteLn(Copy(LLong, 1, 5));             // xxxxx
+  WriteLn(Copy(LCopy, 1, 5));             // yxxxx
+
+  // UniqueString on an unshared string is free
+  LBefore := cpp('np::StringAllocCount()');
+  UniqueString(LCopy);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  // ... and copies a shared one
+  LCopy := LLong;
+  LBefore := cpp('np::StringAllocCount()');
+  UniqueString(LCopy);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 1
+  WriteLn(LCopy = LLong);                 // TRUE
+end.
@@ -0,0 +1,108 @@
+(* EXPECT:
+item 1 = 0.5, item 2 = 1, item 3 = 1.5
+9000
+0
+x+x+x+x
+abcdefab
+abcdefabcde
+abcdefabcdeabcdefabcde
+abcabc
+id=42;ok=True;big=4294967295
+TRUE
+0
+TRUE
+*)
+
+program test_program_string_builder;
+
+// s := s + a + b on a String variable appends to s in place, reserving room
+// for all the operands at once, so growing a string in a loop does not copy
+// it on every pass. TStringBuilder is the explicit form: Append formats
+// numbers and Booleans straight into its buffer, EnsureCapacity sizes it up
+// front and ToString hands the text over without copying it.
+
+var
+  LReport:  String;
+  LText:    String;
+  LView:    TStringView;
+  LBuilder: TStringBuilder;
+  LFields:  TStringBuilder;
+  LLines:   TStringBuilder;
+  LSized:   TStringBuilder;
+  LBefore:  Int64;
+  LAfter:   Int64;
+  LBig:     Cardinal;
+  i:        Integer;
+
+begin
+  // s := s + ... chains
+  LReport := '';
+  for i := 1 to 3 do
+  begin
+    if i > 1 then
+      LReport := LReport + ', ';
+    LReport := LReport + 'item ' + IntToStr(i) + ' = ' + FloatToStr(i / 2);
+  end;
+  WriteLn(LReport);
+
+  // Appending to a reserved string allocates nothing
+  LText := '';
+  for i := 1 to 1000 do
+    LText := LText + 'abcdefghi';
+  WriteLn(Length(LText));                 // 9000
+  SetLength(LText, 0);
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 1000 do
+    LText := LText + 'abc' + 'def' + 'ghi';
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  // Operands may read the target
+  LText := 'x';
+  LText := LText + '+' + LText;
+  LText := LText + '+' + LText;
+  WriteLn(LText);
+  LText := 'abcdef';
+  LText := LText + Copy(LText, 1, 2);
+  WriteLn(LText);                          // abcdefab
+  LView := LText;
+  LText := LText + Copy(LView, 3, 3);
+  WriteLn(LText);                          // abcdefabcde
+  LView := LText;
+  LText := LText + LView;
+  WriteLn(LText);
+
+  // TStringBuilder
+  Append(LBuilder, 'abc');
+  Append(LBuilder, ToString(LBuilder));
+  WriteLn(ToString(LBuilder));
+
+  // Numbers and Booleans are formatted in place
+  LBig := 4294967295;
+  Append(LFields, 'id=');
+  Append(LFields, 42);
+  Append(LFields, ';ok=');
+  Append(LFields, True);
+  Append(LFields, ';big=');
+  Append(LFields, LBig);
+  WriteLn(ToString(LFields));
+
+  // AppendLine ends a line as WriteLn does (#10)
+  AppendLine(LLines, 'one');
+  AppendLine(LLines);
+  WriteLn(Length(LLines) = 5);
+
+  // EnsureCapacity reserves once; ToString shares the buffer
+  EnsureCapacity(LSized, 100000);
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 10000 do
+  begin
+    Append(LSized, i mod 10);
+    Append(LSized, 'abcdefgh');
+    Append(LSized, ';');
+  end;
+  LText := ToString(LSized);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+  WriteLn(Capacity(LSized) >= Length(LText));
+end.
@@ -0,0 +1,74 @@
+(* EXPECT:
+HéLLO WORLD
+hÉllo world
+HÉLLO WORLD
+привет, мир
+[abc]
+[abc ]
+[ abc]
+TRUE
+FALSE
+TRUE
+-1
+1
+1
+0
+0
+*)
+
+program test_program_string_case;
+
+// UpperCase, LowerCase, SameText and CompareText only map 'a'..'z', as in
+// Delphi; the Ansi* forms map every character that has a one-to-one case
+// mapping. Trim removes the space and every control character. None of
+// them allocates when the result equals the argument.
+
+var
+  LText:   String;
+  LUpper:  String;
+  LBefore: Int64;
+  LAfter:  Int64;
+  i:       Integer;
+
+begin
+  // ASCII-only and Unicode case mapping
+  WriteLn(UpperCase('héllo World'));
+  WriteLn(LowerCase('HÉLLO WORLD'));
+  WriteLn(AnsiUpperCase('héllo World'));
+  WriteLn(AnsiLowerCase('ПРИВЕТ, Мир'));
+
+  // Trimming control characters and spaces
+  LText := StringOfChar(Chr(9), 1) + ' abc ' + Chr(13) + Chr(10);
+  WriteLn('[', Trim(LText), ']');
+  WriteLn('[', TrimLeft(Copy(LText, 1, 6)), ']');
+  LText := ' abc' + Chr(1) + Chr(31);
+  WriteLn('[', TrimRight(LText), ']');
+
+  // Case-insensitive comparison
+  WriteLn(SameText('Hello, World', 'hELLO, wORLD'));
+  WriteLn(SameText('É', 'é'));
+  WriteLn(AnsiSameText('Élan VITAL', 'élan vital'));
+  WriteLn(CompareText('abc', 'ABD'));     // -1
+  WriteLn(CompareText('_', 'a'));         // 1: '_' sorts after 'A'
+  WriteLn(CompareStr('a', 'B'));          // 1
+
+  // Nothing to change: the result shares the argument
+  LUpper := 'ALREADY UPPER CASE TEXT';
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 100 do
+  begin
+    LText := UpperCase(LUpper);
+    LText := AnsiUpperCase(LUpper);
+    LText := Trim(LUpper);
+  end;
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 100 do
+    if SameText(LUpper, 'already upper case text') and
+       AnsiSameText(LUpper, 'Already Upper Case Text') then
+      LText := LUpper;
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+end.
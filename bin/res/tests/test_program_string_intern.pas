@@ -0,0 +1,59 @@
+(* EXPECT:
+TRUE
+TRUE
+FALSE
+3
+0
+begin=1 end=2 var=3
+*)
+
+program test_program_string_intern;
+
+// Intern returns the canonical copy of a text: equal texts intern to the
+// same block, so comparing two interned Strings is O(1) however long they
+// are, and interning a text that is already in the table allocates nothing.
+
+var
+  LSymbols: array[1..3] of String;
+  LText:    String;
+  LLong:    String;
+  LOther:   String;
+  LBefore:  Int64;
+  LAfter:   Int64;
+  LHits:    Integer;
+  i:        Integer;
+  j:        Integer;
+
+begin
+  // Texts built at run time intern to the same String
+  LLong := Intern(StringOfChar('x', 100) + 'a');
+  LText := StringOfChar('x', 100);
+  LText := LText + 'a';
+  WriteLn(Intern(LText) = LLong);
+  WriteLn(Intern(Copy(LText, 1, Length(LText))) = LLong);
+  LOther := Intern(StringOfChar('x', 100) + 'b');
+  WriteLn(LOther = LLong);
+
+  // A small symbol table keyed by interned names
+  LSymbols[1] := Intern('begin');
+  LSymbols[2] := Intern('end');
+  LSymbols[3] := Intern('var');
+  LHits := 0;
+  for i := 1 to 3 do
+    for j := 1 to 3 do
+      if Intern(LowerCase(UpperCase(LSymbols[j]))) = LSymbols[i] then
+        Inc(LHits);
+  WriteLn(LHits);                         // 3
+
+  // Interning a text already in the table allocates nothing
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 1000 do
+    LText := Intern(LLong);
+  for i := 1 to 1000 do
+    LText := Intern(LSymbols[i mod 3 + 1]);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+
+  // Interned Strings are ordinary Strings everywhere else
+  WriteLn(LSymbols[1], '=1 ', LSymbols[2], '=2 ', LSymbols[3], '=3');
+end.
@@ -0,0 +1,68 @@
+(* EXPECT:
+it's
+C:\temp\"new"
+'
+prefix-value
+abcdef
+1000
+0
+NitroPascal 11
+5
+Xnother literal, long enough for the heap
+another literal, long enough for the heap
+*)
+
+program test_program_string_literal;
+
+// String literals are emitted as np::StrLit<u"...">, a constant String
+// built at compile time. Comparing with, assigning or concatenating a
+// literal never transcodes it, and only the result of + allocates.
+// '' inside a literal is a single quote; \ and " are ordinary characters
+
+const
+  APP_NAME = 'NitroPascal';
+
+var
+  LLine:   String;
+  LValue:  String;
+  LCopy:   String;
+  LBefore: Int64;
+  LAfter:  Int64;
+  LCount:  Integer;
+  i:       Integer;
+
+begin
+  // Escaping
+  WriteLn('it''s');
+  WriteLn('C:\temp\"new"');
+  WriteLn('''');
+
+  // A literal on either side of +
+  LValue := 'value';
+  WriteLn('prefix-' + LValue);
+  WriteLn('abc' + 'def');
+
+  // Comparing with and assigning literals in a loop does not allocate
+  LLine := 'END OF THE INPUT STREAM';
+  LCount := 0;
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 1000 do
+  begin
+    if LLine = 'END OF THE INPUT STREAM' then
+      LCount := LCount + 1;
+    LCopy := 'another literal, long enough for the heap';
+  end;
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LCount);                        // 1000
+  WriteLn(LAfter - LBefore);              // 0
+
+  // Constants and non-ASCII text
+  WriteLn(APP_NAME, ' ', Length(APP_NAME));
+  WriteLn(Length('héllo'));
+
+  // Writing to a copy of a literal detaches it
+  LCopy[1] := 'X';
+  WriteLn(LCopy);
+  LCopy := 'another literal, long enough for the heap';
+  WriteLn(LCopy);
+end.
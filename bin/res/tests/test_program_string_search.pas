@@ -0,0 +1,75 @@
+(* EXPECT:
+5
+0
+0
+16
+0
+101
+3
+baz bar baz
+Hello, World, hello
+Hi, World, Hi
+Hi, World, hello
+[aXbXc]
+Straße x x
+0
+*)
+
+program test_program_string_search;
+
+// Pos, PosEx and StringReplace share one substring search. StringReplace
+// takes Delphi's flags: [] replaces the first match, rfReplaceAll every
+// match and rfIgnoreCase compares as AnsiUpperCase does. The result is
+// built in one pass and, for a case-sensitive search, shares the text when
+// nothing matches.
+
+var
+  LText:   String;
+  LLong:   String;
+  LCopy:   String;
+  LBefore: Int64;
+  LAfter:  Int64;
+  LPos:    Integer;
+  LCount:  Integer;
+  i:       Integer;
+
+begin
+  LText := 'the cat sat on the mat';
+  WriteLn(Pos('cat', LText));             // 5
+  WriteLn(Pos('dog', LText));             // 0
+  WriteLn(Pos('', LText));                // 0
+  WriteLn(PosEx('the', LText, 2));        // 16
+  WriteLn(PosEx('the', LText, 100));      // 0
+
+  // A needle long enough for the skip-table search
+  LLong := '';
+  for i := 1 to 10 do
+    LLong := LLong + 'abcdefghij';
+  WriteLn(Pos(Copy(LLong, 11, 40) + 'Z', LLong + Copy(LLong, 11, 40) + 'Z'));
+
+  // Count the matches with PosEx
+  LCount := 0;
+  LPos := PosEx('at', LText, 1);
+  while LPos > 0 do
+  begin
+    Inc(LCount);
+    LPos := PosEx('at', LText, LPos + 2);
+  end;
+  WriteLn(LCount);                        // 3
+
+  WriteLn(StringReplace('foo bar foo', 'foo', 'baz'));
+  LText := 'Hello, World, hello';
+  WriteLn(StringReplace(LText, 'HELLO', 'Hi', [rfReplaceAll]));
+  WriteLn(StringReplace(LText, 'HELLO', 'Hi', [rfReplaceAll, rfIgnoreCase]));
+  WriteLn(StringReplace(LText, 'hello', 'Hi', [rfIgnoreCase]));
+  WriteLn('[', StringReplace('a, b, c', ', ', 'X', [rfReplaceAll]), ']');
+  WriteLn(StringReplace('Strasse', 'SSE', 'ße', [rfIgnoreCase]), ' ',
+          StringReplace('ü ü', 'Ü', 'x', [rfReplaceAll, rfIgnoreCase]));
+
+  // Nothing to replace: the result is the text itself
+  LBefore := cpp('np::StringAllocCount()');
+  for i := 1 to 100 do
+    LCopy := StringReplace(LText, 'xyz', 'abc', [rfReplaceAll]);
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+end.
@@ -0,0 +1,42 @@
+(* EXPECT:
+11
+héllo wörld
+2
+8
+5
+65533
+65533
+33
+2
+65533
+*)
+
+program test_program_string_utf8;
+
+// Text from C++ (std::string, console input, files) is decoded as strict
+// UTF-8. A malformed sequence is not dropped: each invalid subpart of it
+// becomes one U+FFFD (65533), as the Unicode standard recommends.
+
+var
+  LText: String;
+  LBad:  String;
+
+begin
+  LText := 'héllo wörld';
+  WriteLn(Length(LText));                 // 11
+  WriteLn(LText);
+  WriteLn(Length('😀'));                  // 2 (surrogate pair)
+  WriteLn(Pos('ö', LText));               // 8
+
+  // C0 AF is an overlong '/': two invalid subparts
+  LBad := cpp('np::String(std::string("ab\xC0\xAF!"))');
+  WriteLn(Length(LBad));                  // 5
+  WriteLn(Ord(LBad[3]));                  // 65533
+  WriteLn(Ord(LBad[4]));                  // 65533
+  WriteLn(Ord(LBad[5]));                  // 33
+
+  // A sequence cut off at the end is one invalid subpart
+  LBad := cpp('np::String(std::string("x\xE2\x82"))');
+  WriteLn(Length(LBad));                  // 2
+  WriteLn(Ord(LBad[2]));                  // 65533
+end.
@@ -0,0 +1,80 @@
+(* EXPECT:
+4 3
+ü 252
+aübc
+5 1
+c
+çaüb€
+2 5
+üb
+çb€ çaüb€
+çXYb€
+4 €uro
+4
+55357 56832
+a😀b😀
+2 4
+TRUE
+TRUE
+*)
+
+program test_program_string_utf8_storage;
+
+// Strings count UTF-16 code units whatever the storage behind them, so
+// indexing, Copy, Pos, Delete, Insert and SetLength give the same answers
+// on non-ASCII text as on ASCII text. A character write, Insert or Delete
+// shows in every later read, also after the string has been indexed.
+
+var
+  LText:  String;
+  LOther: String;
+  LEmoji: String;
+  i:      Integer;
+  n:      Integer;
+
+begin
+  // An ASCII string turns non-ASCII through a character write
+  LText := 'abcd';
+  LText[2] := 'ü';
+  WriteLn(Length(LText), ' ', Pos('c', LText));            // 4 3
+  WriteLn(Copy(LText, 2, 1), ' ', Ord(LText[2]));          // ü 252
+  LText[3] := 'b';
+  LText[4] := 'c';
+  WriteLn(LText);                                          // aübc
+
+  // Changing the string after an indexed read
+  n := 0;
+  for i := 1 to Length(LText) do
+    if Ord(LText[i]) > 127 then
+      Inc(n);
+  Insert('ç', LText, 1);
+  WriteLn(Length(LText), ' ', n);                          // 5 1
+  WriteLn(LText[5]);                                       // c
+  LText[5] := '€';
+  WriteLn(LText);                                          // çaüb€
+
+  // Copy, Pos, Delete and Insert on non-ASCII text; the copy is separate
+  WriteLn(Pos('a', LText), ' ', Pos('€', LText));          // 2 5
+  WriteLn(Copy(LText, 3, 2));                              // üb
+  LOther := LText;
+  Delete(LOther, 2, 2);
+  WriteLn(LOther, ' ', LText);                             // çb€ çaüb€
+  Insert('XY', LOther, 2);
+  WriteLn(LOther);                                         // çXYb€
+
+  // SetLength cuts by code units
+  LOther := '€uro!';
+  SetLength(LOther, 4);
+  WriteLn(Length(LOther), ' ', LOther);                    // 4 €uro
+
+  // A surrogate pair is two code units
+  LEmoji := 'a😀b';
+  WriteLn(Length(LEmoji));                                 // 4
+  WriteLn(Ord(LEmoji[2]), ' ', Ord(LEmoji[3]));            // 55357 56832
+  WriteLn(LEmoji + Copy(LEmoji, 2, 2));                    // a😀b😀
+  WriteLn(Pos('😀', LEmoji), ' ', Pos('b', LEmoji));       // 2 4
+
+  // Equal text compares equal however it was built
+  WriteLn(Copy(LText, 1, 3) = 'ç' + 'aü');
+  WriteLn(('é' < 'ü') and ('z' < 'é'));
+end.
@@ -0,0 +1,88 @@
+(* EXPECT:
+[id] [name] [city] [qty]
+4 fields, 13 chars
+0
+TRUE
+42
+héllo
+city
+[héllo] [  héllo] [héllo  ] [hél]
+<hé=5
+*)
+
+program test_program_string_view;
+
+// A TStringView shares the buffer of the String it was taken from: Copy
+// and Trim of a view return views, and Length, Pos, StrToInt, indexing and
+// comparison read the characters in place, and Format writes them from
+// there. Only assigning a view to a String copies its characters.
+
+var
+  LLine:   String;
+  LRest:   TStringView;
+  LToken:  TStringView;
+  LFields: String;
+  LName:   String;
+  LBefore: Int64;
+  LAfter:  Int64;
+  LChars:  Integer;
+  LCount:  Integer;
+  p:       Integer;
+  i:       Integer;
+
+begin
+  // Tokenizing with views
+  LLine := ' id ; name;city ;  qty ';
+  LRest := LLine;
+  LFields := '';
+  LChars := 0;
+  LCount := 0;
+  repeat
+    p := Pos(';', LRest);
+    if p > 0 then
+      LToken := Trim(Copy(LRest, 1, p - 1))
+    else
+      LToken := Trim(LRest);
+    if LCount > 0 then
+      LFields := LFields + ' ';
+    LFields := LFields + '[' + LToken + ']';
+    LChars := LChars + Length(LToken);
+    Inc(LCount);
+    LRest := Copy(LRest, p + 1, Length(LRest));
+  until p = 0;
+  WriteLn(LFields);
+  WriteLn(LCount, ' fields, ', LChars, ' chars');
+
+  // A long line splits into views without allocating
+  LLine := '';
+  for i := 1 to 100 do
+    LLine := LLine + ' some field text ;';
+  LBefore := cpp('np::StringAllocCount()');
+  LRest := LLine;
+  LChars := 0;
+  p := Pos(';', LRest);
+  while p > 0 do
+  begin
+    LToken := Trim(Copy(LRest, 1, p - 1));
+    if LToken = 'some field text' then
+      LChars := LChars + Length(LToken);
+    LRest := Copy(LRest, p + 1, Length(LRest));
+    p := Pos(';', LRest);
+  end;
+  LAfter := cpp('np::StringAllocCount()');
+  WriteLn(LAfter - LBefore);              // 0
+  WriteLn(LChars = 1500);
+
+  // Numbers, characters and Strings from views
+  LRest := 'x=  42 ';
+  WriteLn(StrToInt(Trim(Copy(LRest, 3, 10))));
+  LRest := '<héllo>';
+  LToken := Copy(LRest, 2, 5);
+  WriteLn(LToken);
+  LName := Copy(LFields, 14, 4);
+  WriteLn(LName);
+
+  // Views as Format arguments, with width and precision in characters
+  WriteLn(Format('[%s] [%7s] [%-7s] [%.3s]', [LToken, LToken, LToken, LToken]));
+  WriteLn(Format('%s=%d', [Trim(Copy(LRest, 1, 3)), Length(LToken)]));
+end.
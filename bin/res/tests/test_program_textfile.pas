@@ -0,0 +1,72 @@
+(* EXPECT:
+4
+alpha
+10 20
+TRUE
+omega
+30
+TRUE
+FALSE
+TRUE
+*)
+
+program test_program_textfile;
+
+// A TextFile reads and writes UTF-8 through its own buffer. ReadLn takes a
+// line at a time, Read takes the next number or word, and the Seek forms
+// skip white space before testing for the end of the line or file.
+
+var
+  LF:   TextFile;
+  s:    String;
+  i, j: Integer;
+  n:    Integer;
+
+begin
+  Assign(LF, 'test_textfile_tmp.txt');
+  Rewrite(LF);
+  WriteLn(LF, 'alpha');
+  WriteLn(LF, 10, ' ', 20, '   ');
+  Write(LF, True);
+  WriteLn(LF);
+  Close(LF);
+
+  Append(LF);
+  WriteLn(LF, 'omega');
+  Close(LF);
+
+  // --- Count the lines, then echo them ---
+  Reset(LF);
+  n := 0;
+  while not Eof(LF) do
+  begin
+    ReadLn(LF, s);
+    n := n + 1;
+  end;
+  Close(LF);
+  WriteLn(n);                         // 4
+
+  Reset(LF);
+  while not Eof(LF) do
+  begin
+    ReadLn(LF, s);
+    WriteLn(Trim(s));
+  end;
+  Close(LF);
+
+  // --- Read numbers, then SeekEoln/SeekEof ---
+  Reset(LF);
+  ReadLn(LF);
+  Read(LF, i);
+  Read(LF, j);
+  WriteLn(i + j);                     // 30
+  WriteLn(SeekEoln(LF));              // TRUE: only blanks remain
+  WriteLn(SeekEof(LF));               // FALSE
+  ReadLn(LF);
+  ReadLn(LF);
+  ReadLn(LF);
+  WriteLn(SeekEof(LF));               // TRUE
+  Close(LF);
+
+  DeleteFile('test_textfile_tmp.txt');
+end.
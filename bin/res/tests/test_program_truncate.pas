@@ -0,0 +1,57 @@
+(* EXPECT:
+2
+TRUE
+3
+10 20 99
+1
+*)
+
+program test_program_truncate;
+
+// Truncate cuts a binary or typed file at the current position: the
+// records after the cursor are dropped, and the file can be written and
+// read on from there.
+
+var
+  LF:   BinaryFile;
+  LT:   file of Integer;
+  LA:   Integer;
+  LB:   Integer;
+  LC:   Integer;
+  LVal: Integer;
+  i:    Integer;
+
+begin
+  Assign(LF, 'test_truncate_tmp.bin');
+  Rewrite(LF, 4);
+  for i := 1 to 5 do
+  begin
+    LVal := i * 10;
+    BlockWrite(LF, LVal, 1);
+  end;
+  Seek(LF, 2);
+  Truncate(LF);
+  WriteLn(FileSize(LF));              // 2
+  WriteLn(Eof(LF));                   // TRUE
+  LVal := 99;
+  BlockWrite(LF, LVal, 1);
+  Close(LF);
+
+  Reset(LF, 4);
+  WriteLn(FileSize(LF));              // 3
+  BlockRead(LF, LA, 1);
+  BlockRead(LF, LB, 1);
+  BlockRead(LF, LC, 1);
+  WriteLn(LA, ' ', LB, ' ', LC);      // 10 20 99
+  Close(LF);
+
+  // --- A typed file, cut behind records already read ---
+  Assign(LT, 'test_truncate_tmp.bin');
+  Reset(LT);
+  Read(LT, LA);
+  Truncate(LT);
+  WriteLn(FileSize(LT));              // 1
+  Close(LT);
+
+  DeleteFile('test_truncate_tmp.bin');
+end.
@@ -0,0 +1,90 @@
+(* EXPECT:
+FirstOver: 4 finally runs: 4
+Break at 3 finally runs: 3
+Odd sum: 9 handled: 0
+Inner finally
+Outer caught: code=7 msg=from except
+Done
+*)
+
+program test_program_try_flow;
+
+// Try blocks are native C++ try/catch, so exit, break and continue may leave
+// a protected body directly. finally code runs from a scope guard and
+// therefore also runs on those early exits.
+// try ... finally F end -> { np::_FinallyGuard g([&]() { F }); ... }
+// try ... except E end  -> { try { ... } catch (...) { E } }
+
+var
+  gFinally: Integer;
+  i:        Integer;
+  sum:      Integer;
+  handled:  Integer;
+
+// exit from inside try..finally
+function FirstOver(ALimit: Integer): Integer;
+var
+  LI: Integer;
+begin
+  Result := -1;
+  for LI := 1 to 10 do
+  begin
+    try
+      if LI * LI > ALimit then
+      begin
+        Result := LI;
+        exit;
+      end;
+    finally
+      gFinally := gFinally + 1;
+    end;
+  end;
+end;
+
+begin
+  gFinally := 0;
+  writeln('FirstOver: ', FirstOver(10), ' finally runs: ', gFinally);
+
+  // break from inside try..finally
+  gFinally := 0;
+  for i := 1 to 10 do
+  begin
+    try
+      if i = 3 then
+        break;
+    finally
+      gFinally := gFinally + 1;
+    end;
+  end;
+  writeln('Break at ', i, ' finally runs: ', gFinally);
+
+  // continue from inside try..except
+  sum := 0;
+  handled := 0;
+  for i := 1 to 5 do
+  begin
+    try
+      if i mod 2 = 0 then
+        continue;
+      sum := sum + i;
+    except
+      handled := handled + 1;
+    end;
+  end;
+  writeln('Odd sum: ', sum, ' handled: ', handled);
+
+  // An exception raised in an except block still runs the finally block
+  try
+    try
+      raiseexception('first');
+    except
+      raiseexceptioncode(7, 'from except');
+    finally
+      writeln('Inner finally');
+    end;
+  except
+    writeln('Outer caught: code=', getexceptioncode(), ' msg=', getexceptionmessage());
+  end;
+
+  writeln('Done');
+end.
@@ -0,0 +1,81 @@
+(* EXPECT:
+5
+3 30
+3
+TRUE
+150
+Read beyond end of file
+5 4 40
+7
+2
+*)
+
+program test_program_typedfile;
+
+// A file of T holds fixed-size records. Read and Write move one record at a
+// time, Seek, FilePos and FileSize count records, and BlockRead/BlockWrite
+// move a run of records to or from an array in one call.
+
+type
+  TPoint = record
+    X: Integer;
+    Y: Integer;
+  end;
+  TPointFile = file of TPoint;
+
+var
+  LF:    TPointFile;
+  LP:    TPoint;
+  LBuf:  array of TPoint;
+  LRead: Integer;
+  LSum:  Integer;
+  i:     Integer;
+
+begin
+  Assign(LF, 'test_typed_tmp.dat');
+  Rewrite(LF);
+  for i := 1 to 5 do
+  begin
+    LP.X := i;
+    LP.Y := i * 10;
+    Write(LF, LP);
+  end;
+  WriteLn(FileSize(LF));              // 5
+
+  // --- Random access by record number ---
+  Seek(LF, 2);
+  Read(LF, LP);
+  WriteLn(LP.X, ' ', LP.Y);           // 3 30
+  WriteLn(FilePos(LF));               // 3
+  Close(LF);
+
+  // --- Sequential reads to the end ---
+  Reset(LF);
+  LSum := 0;
+  while not Eof(LF) do
+  begin
+    Read(LF, LP);
+    LSum := LSum + LP.Y;
+  end;
+  WriteLn(Eof(LF));                   // TRUE
+  WriteLn(LSum);                      // 150
+  try
+    Read(LF, LP);
+  except
+    WriteLn(GetExceptionMessage());
+  end;
+
+  // --- Bulk transfer through a dynamic array ---
+  SetLength(LBuf, 8);
+  Seek(LF, 0);
+  BlockRead(LF, LBuf, 8, LRead);
+  WriteLn(LRead, ' ', LBuf[3].X, ' ', LBuf[3].Y);   // 5 4 40
+  BlockWrite(LF, LBuf, 2);
+  WriteLn(FileSize(LF));              // 7
+  Seek(LF, 6);
+  Read(LF, LP);
+  WriteLn(LP.X);                      // 2
+  Close(LF);
+
+  DeleteFile('test_typed_tmp.dat');
+end.
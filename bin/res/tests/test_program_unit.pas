@@ -4,6 +4,8 @@
 TRUE
 FALSE
 10
+9
+FALSE
 *)
 
 program test_program_unit;
@@ -26,4 +28,8 @@ begin
 
   // Chained call
   WriteLn(Add(Multiply(2, 3), Multiply(1, 4)));  // 10
+
+  // Calls qualified by the unit name
+  WriteLn(test_unit_mathutils.Add(4, 5));  // 9
+  WriteLn(test_unit_mathutils.IsEven(test_unit_mathutils.Multiply(3, 3)));  // FALSE
 end.
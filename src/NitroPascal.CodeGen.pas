@@ -16,9 +16,78 @@ unit NitroPascal.CodeGen;
 interface
 
 uses
+  System.Generics.Collections,
   Parse;
 
-procedure ConfigCodeGen(const AParse: TParse);
+type
+
+  { TNPCodeGenOptions }
+  // Code generation switches shared by the emitters registered in
+  // ConfigCodeGen, plus the emission state they need while walking the tree
+  // (enclosing loops, current routine kind). Owned by TNitroPascal.
+  TNPCodeGenOptions = class
+  private type
+    TLoopFrame = record
+      Id:          Integer;
+      SwitchDepth: Integer;  // case statements opened inside this loop
+      NeedsLabel:  Boolean;  // a break had to jump out of a switch
+    end;
+  private
+    FNativeLoops:       Boolean;
+    FRangeChecks:       Boolean;
+    FRangeChecksActive: Boolean;
+    FConsoleLineFlush:  Boolean;
+    FLoops:             TList<TLoopFrame>;
+    FNextId:            Integer;
+    FLambdaDepth:       Integer;
+    FRoutineKind:       string;
+  public
+    constructor Create();
+    destructor Destroy(); override;
+
+    // Returns a fresh id used to build unique C++ temporaries and labels
+    function NewId(): Integer;
+
+    // Native loop tracking -- LeaveLoop returns True when the loop's break
+    // label must be emitted after the closing brace
+    procedure EnterLoop(const AId: Integer);
+    function LeaveLoop(): Boolean;
+    procedure EnterSwitch();
+    procedure LeaveSwitch();
+    function BreakTarget(): string;
+
+    // Bodies emitted inside a C++ lambda (lambda loops, try wrappers)
+    procedure EnterLambda();
+    procedure LeaveLambda();
+
+    // Resets per-file switch state to the build defaults
+    procedure BeginFile();
+
+    // Applies a {$...} directive body (e.g. 'R-', 'RANGECHECKS ON', 'R+,Q-').
+    // Switches this code generator does not know about are ignored.
+    procedure ApplyDirective(const AText: string);
+
+    // Lower for/while/repeat to native C++ loops (default) instead of the
+    // np::ForLoop/WhileLoop/RepeatUntil lambda wrappers
+    property NativeLoops: Boolean read FNativeLoops write FNativeLoops;
+
+    // Build default for {$R+}: index expressions are emitted as np::At()
+    // (checked) when on and as raw operator[] when off. Off by default, as
+    // in Delphi. RangeChecksActive is the state at the current point of
+    // emission, after any {$R} directives.
+    property RangeChecks:       Boolean read FRangeChecks write FRangeChecks;
+    property RangeChecksActive: Boolean read FRangeChecksActive;
+
+    // Console output is fully buffered and flushed at exit, on ReadLn and on
+    // Flush(); when set, it is also flushed per WriteLn if stdout is a TTY
+    property ConsoleLineFlush: Boolean read FConsoleLineFlush write FConsoleLineFlush;
+
+    // 'program', 'procedure', 'function' or '' -- drives how exit is emitted
+    property RoutineKind: string  read FRoutineKind write FRoutineKind;
+    property LambdaDepth: Integer read FLambdaDepth;
+  end;
+
+procedure ConfigCodeGen(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 
 implementation
 
@@ -26,6 +95,138 @@ uses
   System.SysUtils,
   System.Rtti;
 
+{ TNPCodeGenOptions }
+
+constructor TNPCodeGenOptions.Create();
+begin
+  inherited Create();
+  FNativeLoops       := True;
+  FRangeChecks       := False;
+  FRangeChecksActive := False;
+  FConsoleLineFlush  := False;
+  FLoops             := TList<TLoopFrame>.Create();
+  FNextId            := 0;
+  FLambdaDepth       := 0;
+  FRoutineKind       := '';
+end;
+
+destructor TNPCodeGenOptions.Destroy();
+begin
+  FreeAndNil(FLoops);
+  inherited Destroy();
+end;
+
+function TNPCodeGenOptions.NewId(): Integer;
+begin
+  Inc(FNextId);
+  Result := FNextId;
+end;
+
+procedure TNPCodeGenOptions.EnterLoop(const AId: Integer);
+var
+  LFrame: TLoopFrame;
+begin
+  LFrame.Id          := AId;
+  LFrame.SwitchDepth := 0;
+  LFrame.NeedsLabel  := False;
+  FLoops.Add(LFrame);
+end;
+
+function TNPCodeGenOptions.LeaveLoop(): Boolean;
+begin
+  Result := FLoops.Last().NeedsLabel;
+  FLoops.Delete(FLoops.Count - 1);
+end;
+
+procedure TNPCodeGenOptions.EnterSwitch();
+var
+  LFrame: TLoopFrame;
+begin
+  if FLoops.Count = 0 then
+    Exit;
+  LFrame := FLoops.Last();
+  Inc(LFrame.SwitchDepth);
+  FLoops[FLoops.Count - 1] := LFrame;
+end;
+
+procedure TNPCodeGenOptions.LeaveSwitch();
+var
+  LFrame: TLoopFrame;
+begin
+  if FLoops.Count = 0 then
+    Exit;
+  LFrame := FLoops.Last();
+  Dec(LFrame.SwitchDepth);
+  FLoops[FLoops.Count - 1] := LFrame;
+end;
+
+// A C++ break inside a switch only leaves the switch, so a Pascal break
+// inside a case arm jumps to a label placed just after the enclosing loop.
+function TNPCodeGenOptions.BreakTarget(): string;
+var
+  LFrame: TLoopFrame;
+begin
+  Result := 'break;';
+  if FLoops.Count = 0 then
+    Exit;
+  LFrame := FLoops.Last();
+  if LFrame.SwitchDepth = 0 then
+    Exit;
+  LFrame.NeedsLabel := True;
+  FLoops[FLoops.Count - 1] := LFrame;
+  Result := Format('goto _np_break%d;', [LFrame.Id]);
+end;
+
+procedure TNPCodeGenOptions.EnterLambda();
+begin
+  Inc(FLambdaDepth);
+end;
+
+procedure TNPCodeGenOptions.LeaveLambda();
+begin
+  Dec(FLambdaDepth);
+end;
+
+procedure TNPCodeGenOptions.BeginFile();
+begin
+  FRangeChecksActive := FRangeChecks;
+end;
+
+procedure TNPCodeGenOptions.ApplyDirective(const AText: string);
+var
+  LSwitch: string;
+  LName:   string;
+  LValue:  string;
+  LSpace:  Integer;
+begin
+  // Switches may be combined ({$Q-,R+}); each is a short form with a +/-
+  // suffix or a long form with an ON/OFF argument, in any letter case.
+  // Directives other than the range-check switch are ignored.
+  for LSwitch in AText.ToUpper().Split([',']) do
+  begin
+    LName := LSwitch.Trim();
+    if LName.EndsWith('+') or LName.EndsWith('-') then
+    begin
+      LValue := LName.Substring(LName.Length - 1);
+      LName  := LName.Substring(0, LName.Length - 1).TrimRight();
+    end
+    else
+    begin
+      LSpace := LName.IndexOfAny([' ', #9]);
+      if LSpace < 0 then
+        Continue;
+      LValue := LName.Substring(LSpace + 1).Trim();
+      LName  := LName.Substring(0, LSpace);
+    end;
+    if (LName <> 'R') and (LName <> 'RANGECHECKS') then
+      Continue;
+    if (LValue = '+') or (LValue = 'ON') then
+      FRangeChecksActive := True
+    else if (LValue = '-') or (LValue = 'OFF') then
+      FRangeChecksActive := False;
+  end;
+end;
+
 // =========================================================================
 // TYPE MAPPING
 // =========================================================================
@@ -65,6 +266,12 @@ begin
         Result := 'np::TextFile'
       else if ATypeKind = 'type.binaryfile' then
         Result := 'np::BinaryFile'
+      else if ATypeKind = 'type.mappedfile' then
+        Result := 'np::MappedFile'
+      else if ATypeKind = 'type.stringbuilder' then
+        Result := 'np::StringBuilder'
+      else if ATypeKind = 'type.stringview' then
+        Result := 'np::StringView'
       else
         Result := 'np::Double';
     end);
@@ -88,17 +295,689 @@ begin
     Result := ATypeText;
 end;
 
+// Returns the value of a Pascal string token: outer quotes stripped and
+// doubled quotes collapsed, e.g. 'it''s' -> it's.
+function PascalStringValue(const AToken: string): string;
+begin
+  Result := AToken;
+  if (Length(Result) >= 2) and
+     (Result[1] = '''') and (Result[Length(Result)] = '''') then
+    Result := Copy(Result, 2, Length(Result) - 2);
+  Result := Result.Replace('''''', '''');
+end;
+
+// Escapes a Pascal string value for a C++ u"..." or u'...' literal. Quotes,
+// backslashes and control characters are escaped and non-ASCII characters
+// become universal character names, so the emitted source stays ASCII.
+function CppLiteralText(const AValue: string): string;
+var
+  LI:    Integer;
+  LCode: Integer;
+begin
+  Result := '';
+  LI := 1;
+  while LI <= Length(AValue) do
+  begin
+    LCode := Ord(AValue[LI]);
+    if (LCode = Ord('\')) or (LCode = Ord('"')) or (LCode = Ord('''')) then
+      Result := Result + '\' + AValue[LI]
+    else if (LCode < 32) or (LCode = 127) then
+      Result := Result + '\' + Chr(48 + (LCode shr 6)) +
+        Chr(48 + ((LCode shr 3) and 7)) + Chr(48 + (LCode and 7))
+    else if LCode < 128 then
+      Result := Result + AValue[LI]
+    else if (LCode >= $D800) and (LCode <= $DBFF) and (LI < Length(AValue)) and
+            (Ord(AValue[LI + 1]) >= $DC00) and (Ord(AValue[LI + 1]) <= $DFFF) then
+    begin
+      Result := Result + '\U' + IntToHex($10000 + ((LCode - $D800) shl 10) +
+        (Ord(AValue[LI + 1]) - $DC00), 8);
+      Inc(LI);
+    end
+    else if (LCode >= $D800) and (LCode <= $DFFF) then
+      Result := Result + '\uFFFD'  // unpaired surrogate
+    else
+      Result := Result + '\u' + IntToHex(LCode, 4);
+    Inc(LI);
+  end;
+end;
+
+// Resolves a constant ordinal literal (integer, $hex, #nn, single-char string).
+// AIsChar reports whether the literal denotes a Char.
+function TryLiteralOrdinal(const ANode: TParseASTNodeBase; out AValue: Int64;
+  out AIsChar: Boolean): Boolean;
+var
+  LAttr: TValue;
+  LKind: string;
+  LText: string;
+begin
+  Result  := False;
+  AValue  := 0;
+  AIsChar := False;
+  LKind   := ANode.GetNodeKind();
+  if LKind = 'expr.integer' then
+    Result := TryStrToInt64(ANode.GetToken().Text, AValue)
+  else if LKind = 'expr.hex_literal' then
+  begin
+    ANode.GetAttr('hex.digits', LAttr);
+    Result := TryStrToInt64('$' + LAttr.AsString, AValue);
+  end
+  else if LKind = 'expr.char_literal' then
+  begin
+    ANode.GetAttr('char.ordinal', LAttr);
+    Result  := TryStrToInt64(LAttr.AsString, AValue);
+    AIsChar := True;
+  end
+  else if LKind = 'expr.string' then
+  begin
+    LText := PascalStringValue(ANode.GetToken().Text);
+    if Length(LText) = 1 then
+    begin
+      AValue  := Ord(LText[1]);
+      AIsChar := True;
+      Result  := True;
+    end;
+  end;
+end;
+
+// Resolves a set type to C++. ALow/AHigh are the bound tokens of a subrange
+// base type (set of 0..63, set of 'a'..'z'); both are empty otherwise.
+// Small ordinal bases map to the bitset backend of np::Set automatically.
+function ResolveSetIR(const AParse: TParse; const AElemText, ALow,
+  AHigh: string): string;
+begin
+  if (ALow = '') or (AHigh = '') then
+    Result := Format('np::Set<%s>', [ResolveTypeIR(AParse, AElemText)])
+  else if ALow.StartsWith('''') then
+    Result := Format('np::Set<np::Char, %d, %d>', [
+      Ord(PascalStringValue(ALow)[1]), Ord(PascalStringValue(AHigh)[1])])
+  else
+    Result := Format('np::Set<np::Integer, %s, %s>', [ALow, AHigh]);
+end;
+
+// =========================================================================
+// DICTIONARIES
+// =========================================================================
+
+const
+  // TDictionary methods, spelled as np::Dictionary declares them
+  DICTIONARY_METHODS: array[0..10] of string = (
+    'Add', 'TryAdd', 'AddOrSetValue', 'TryGetValue', 'ContainsKey',
+    'ContainsValue', 'Remove', 'Clear', 'Count', 'Keys', 'Values');
+
+  // Methods that change the dictionary they are called on
+  MUTATING_DICTIONARY_METHODS: array[0..4] of string = (
+    'Add', 'TryAdd', 'AddOrSetValue', 'Remove', 'Clear');
+
+// Resolves TDictionary<K, V> to C++
+function ResolveDictionaryIR(const AParse: TParse; const AKeyText,
+  AValueText: string): string;
+begin
+  Result := Format('np::Dictionary<%s, %s>', [
+    ResolveTypeIR(AParse, AKeyText), ResolveTypeIR(AParse, AValueText)]);
+end;
+
+// True when ANode is a variable or parameter of a TDictionary type
+function IsDictionaryExpr(const ANode: TParseASTNodeBase): Boolean;
+var
+  LAttr: TValue;
+begin
+  Result := ANode.GetAttr(PARSE_ATTR_TYPE_KIND, LAttr) and
+            (LAttr.AsString = 'type.dictionary');
+end;
+
+// True for X.Y(args) that the semantic pass resolved to a call of routine Y
+// qualified by X, e.g. MathUtils.Add(1, 2): an expr.method_call with a
+// call.name, emitted and analysed like expr.call. Its arguments start at
+// child 1.
+function IsQualifiedCall(const ANode: TParseASTNodeBase): Boolean;
+var
+  LAttr: TValue;
+begin
+  Result := (ANode.GetNodeKind() = 'expr.method_call') and
+            ANode.GetAttr('call.name', LAttr);
+end;
+
+// C++ spelling of a TDictionary method (Pascal names are case-insensitive);
+// other names are returned unchanged
+function DictionaryMethodIR(const AName: string): string;
+var
+  LI: Integer;
+begin
+  for LI := Low(DICTIONARY_METHODS) to High(DICTIONARY_METHODS) do
+    if SameText(AName, DICTIONARY_METHODS[LI]) then
+      Exit(DICTIONARY_METHODS[LI]);
+  Result := AName;
+end;
+
+function IsMutatingDictionaryMethod(const AName: string): Boolean;
+var
+  LI: Integer;
+begin
+  for LI := Low(MUTATING_DICTIONARY_METHODS) to High(MUTATING_DICTIONARY_METHODS) do
+    if SameText(AName, MUTATING_DICTIONARY_METHODS[LI]) then
+      Exit(True);
+  Result := False;
+end;
+
+// =========================================================================
+// PARAMETER PASSING
+// =========================================================================
+
+const
+  // Intrinsics that write through one of their arguments
+  MUTATING_INTRINSICS: array[0..26] of string = (
+    'np::Inc', 'np::Dec', 'np::Delete', 'np::Insert', 'np::UniqueString', 'np::Val', 'np::New',
+    'np::Dispose', 'np::GetMem', 'np::FreeMem', 'np::ReallocMem',
+    'np::FillChar', 'np::Move', 'np::Assign', 'np::Reset', 'np::Rewrite',
+    'np::Append', 'np::Close', 'np::Seek', 'np::Flush', 'np::SeekEof',
+    'np::SeekEoln', 'np::Read', 'np::ReadLn',
+    'np::AppendLine', 'np::EnsureCapacity', 'np::MapFile');
+
+// True for types that are cheap to copy: ordinals, floats, Boolean, Char
+// and pointers. Strings, string views, files, string builders, dictionaries
+// and user types (records, array/set aliases) are not.
+function IsCheapParamType(const AParse: TParse; const ATypeText: string): Boolean;
+var
+  LKind: string;
+begin
+  LKind  := AParse.Config().TypeTextToKind(ATypeText);
+  Result := (LKind <> 'type.unknown') and (LKind <> 'type.string') and
+            (LKind <> 'type.textfile') and (LKind <> 'type.binaryfile') and
+            (LKind <> 'type.mappedfile') and (LKind <> 'type.stringbuilder') and
+            (LKind <> 'type.stringview') and (LKind <> 'type.dictionary');
+end;
+
+// Root variable name of an l-value: a, a[i], a.f, a[i].f -> 'a'
+function LValueRoot(const ANode: TParseASTNodeBase): string;
+var
+  LKind: string;
+begin
+  Result := '';
+  LKind  := ANode.GetNodeKind();
+  if LKind = 'expr.ident' then
+    Result := ANode.GetToken().Text
+  else if ((LKind = 'expr.array_index') or (LKind = 'expr.field_access') or
+           (LKind = 'expr.grouped')) and (ANode.ChildCount() > 0) then
+    Result := LValueRoot(ANode.GetChild(0));
+end;
+
+// True when a call may write through argument AIndex: a var/out parameter
+// of a user routine, any argument of a mutating intrinsic, or any argument
+// of a call that cannot be resolved (overloads, external routines).
+function CallMayWriteArg(const ACall: TParseASTNodeBase;
+  const AIndex: Integer): Boolean;
+var
+  LAttr:     TValue;
+  LDeclNode: TParseASTNodeBase;
+  LChild:    TParseASTNodeBase;
+  LName:     string;
+  LParam:    Integer;
+  LI:        Integer;
+begin
+  ACall.GetAttr('call.name', LAttr);
+  LName := LAttr.AsString;
+  if not ACall.GetAttr(PARSE_ATTR_DECL_NODE, LAttr) then
+  begin
+    // Intrinsic (np::Foo / std::exit / sizeof) or unknown external routine
+    if not (LName.StartsWith('np::') or LName.StartsWith('std::') or
+            (LName = 'sizeof')) then
+      Exit(True);
+    for LI := Low(MUTATING_INTRINSICS) to High(MUTATING_INTRINSICS) do
+      if LName = MUTATING_INTRINSICS[LI] then
+        Exit(True);
+    Exit(False);
+  end;
+  LDeclNode := TParseASTNodeBase(LAttr.AsObject);
+  // Overloads share one symbol; the linked declaration may not be the callee
+  if LDeclNode.GetAttr('decl.overload', LAttr) and LAttr.IsType<Boolean> and
+     LAttr.AsBoolean then
+    Exit(True);
+  LParam := 0;
+  for LI := 0 to LDeclNode.ChildCount() - 1 do
+  begin
+    LChild := LDeclNode.GetChild(LI);
+    if LChild.GetNodeKind() <> 'stmt.param_decl' then
+      Continue;
+    if LParam = AIndex then
+    begin
+      LChild.GetAttr('param.modifier', LAttr);
+      Exit((LAttr.AsString = 'var') or (LAttr.AsString = 'out'));
+    end;
+    Inc(LParam);
+  end;
+  Result := True;
+end;
+
+// True when writing the l-value ATarget may change the value parameter
+// AName: ATarget is AName or part of it, or lies outside the routine's own
+// locals and value parameters -- in a global, a var/out parameter, a name
+// that does not resolve, or behind a pointer. Any of those may be the
+// argument a caller passed for AName. An expression that is not an l-value
+// is never written.
+// With AName = '' the routine is a callee (see RoutineMayWriteOutside):
+// writes through its own var/out parameters are then left to the call
+// site, which knows what was passed for them.
+function WriteMayAlias(const ATarget: TParseASTNodeBase;
+  const AName: string): Boolean;
+var
+  LNode:     TParseASTNodeBase;
+  LKind:     string;
+  LAttr:     TValue;
+  LDeclNode: TParseASTNodeBase;
+begin
+  if (AName <> '') and SameText(LValueRoot(ATarget), AName) then
+    Exit(True);
+  LNode := ATarget;
+  LKind := LNode.GetNodeKind();
+  while (LKind = 'expr.array_index') or (LKind = 'expr.field_access') or
+        (LKind = 'expr.grouped') do
+  begin
+    if LNode.ChildCount() = 0 then
+      Exit(True);
+    LNode := LNode.GetChild(0);
+    LKind := LNode.GetNodeKind();
+  end;
+  if LKind = 'expr.deref' then
+    Exit(True);
+  if LKind <> 'expr.ident' then
+    Exit(False);
+  if not LNode.GetAttr(PARSE_ATTR_DECL_NODE, LAttr) or (LAttr.AsObject = nil) then
+    Exit(True);
+  LDeclNode := TParseASTNodeBase(LAttr.AsObject);
+  if not LDeclNode.GetAttr(PARSE_ATTR_STORAGE_CLASS, LAttr) then
+    Exit(True);
+  if LAttr.AsString = 'local' then
+    Exit(False);
+  if LAttr.AsString = 'param' then
+  begin
+    LDeclNode.GetAttr('param.modifier', LAttr);
+    Exit((AName <> '') and
+         ((LAttr.AsString = 'var') or (LAttr.AsString = 'out')));
+  end;
+  Result := True;
+end;
+
+function ParamMayBeModified(const ANode: TParseASTNodeBase;
+  const AName: string; const AVisited: TList<TParseASTNodeBase>): Boolean; forward;
+
+// True when a call to ADecl may write state outside the routine: a global,
+// something behind a pointer, or anything reachable through a routine it
+// calls in turn. Writes through its var/out parameters are not counted; the
+// caller checks what it passes for them (CallMayWriteArg). Routines without
+// a body here (forward or imported) and overloads may write anything.
+// AVisited holds the routines on the current search: a routine met again
+// adds nothing new, which makes recursion safe. Since a False answer may
+// rest on that cut, only the outermost search caches it on the declaration
+// ('decl.writes_outside'); True is cached at any depth.
+function RoutineMayWriteOutside(const ADecl: TParseASTNodeBase;
+  const AVisited: TList<TParseASTNodeBase>): Boolean;
+var
+  LKind:  string;
+  LAttr:  TValue;
+  LOuter: Boolean;
+  LI:     Integer;
+begin
+  LKind := ADecl.GetNodeKind();
+  if (LKind <> 'stmt.proc_decl') and (LKind <> 'stmt.func_decl') then
+    Exit(True);
+  if ADecl.GetAttr('decl.overload', LAttr) and LAttr.IsType<Boolean> and
+     LAttr.AsBoolean then
+    Exit(True);
+  if ADecl.GetAttr('decl.writes_outside', LAttr) and LAttr.IsType<Boolean> then
+    Exit(LAttr.AsBoolean);
+  if AVisited.Contains(ADecl) then
+    Exit(False);
+  LOuter := AVisited.Count = 0;
+  AVisited.Add(ADecl);
+  Result := False;
+  for LI := 0 to ADecl.ChildCount() - 1 do
+    if ParamMayBeModified(ADecl.GetChild(LI), '', AVisited) then
+    begin
+      Result := True;
+      Break;
+    end;
+  if Result or LOuter then
+    TParseASTNode(ADecl).SetAttr('decl.writes_outside',
+      TValue.From<Boolean>(Result));
+end;
+
+// True when ANode (a routine body) may change the value parameter AName
+// while the routine runs. The parameter itself must not be written, and
+// since the caller may have passed any variable it can reach, neither may
+// anything outside the routine (see WriteMayAlias). A user routine it calls
+// must not write outside state either (RoutineMayWriteOutside), nor receive
+// AName or an outside variable as a var/out argument. External routines may
+// write anything. Raw C++ blocks are opaque and always count as a
+// modification. With AName = '' this checks a callee's body for writes to
+// outside state.
+function ParamMayBeModified(const ANode: TParseASTNodeBase;
+  const AName: string; const AVisited: TList<TParseASTNodeBase>): Boolean;
+var
+  LKind:     string;
+  LAttr:     TValue;
+  LDeclNode: TParseASTNodeBase;
+  LObject:   TParseASTNodeBase;
+  LMethod:   string;
+  LName:     string;
+  LFirst:    Integer;
+  LI:        Integer;
+begin
+  LKind := ANode.GetNodeKind();
+  if (LKind = 'stmt.cpp_block') or (LKind = 'expr.cpp_inline') then
+    Exit(True);
+  if (LKind = 'expr.ident') and ANode.GetAttr(PARSE_ATTR_DECL_NODE, LAttr) and
+     (LAttr.AsObject <> nil) then
+  begin
+    // A routine called without parentheses
+    LDeclNode := TParseASTNodeBase(LAttr.AsObject);
+    LKind     := LDeclNode.GetNodeKind();
+    if ((LKind = 'stmt.func_decl') or (LKind = 'stmt.func_forward') or
+        (LKind = 'stmt.proc_decl') or (LKind = 'stmt.proc_forward')) and
+       RoutineMayWriteOutside(LDeclNode, AVisited) then
+      Exit(True);
+  end
+  else if ((LKind = 'expr.assign') or (LKind = 'expr.addr')) and
+          (ANode.ChildCount() > 0) then
+  begin
+    if WriteMayAlias(ANode.GetChild(0), AName) then
+      Exit(True);
+  end
+  else if (LKind = 'stmt.setlength') or (LKind = 'stmt.include') or
+          (LKind = 'stmt.exclude') or (LKind = 'stmt.readln') or
+          (LKind = 'stmt.read') then
+  begin
+    for LI := 0 to ANode.ChildCount() - 1 do
+      if WriteMayAlias(ANode.GetChild(LI), AName) then
+        Exit(True);
+  end
+  else if (LKind = 'expr.call') or IsQualifiedCall(ANode) then
+  begin
+    ANode.GetAttr('call.name', LAttr);
+    LName  := LAttr.AsString;
+    LFirst := Ord(LKind = 'expr.method_call');
+    if ANode.GetAttr(PARSE_ATTR_DECL_NODE, LAttr) then
+    begin
+      if (LAttr.AsObject = nil) or
+         RoutineMayWriteOutside(TParseASTNodeBase(LAttr.AsObject), AVisited) then
+        Exit(True);
+    end
+    else if not (LName.StartsWith('np::') or LName.StartsWith('std::') or
+                 (LName = 'sizeof')) then
+      Exit(True);
+    for LI := LFirst to ANode.ChildCount() - 1 do
+      if CallMayWriteArg(ANode, LI - LFirst) and
+         WriteMayAlias(ANode.GetChild(LI), AName) then
+        Exit(True);
+  end
+  else if LKind = 'expr.method_call' then
+  begin
+    // Lookups leave a dictionary alone; TryGetValue writes its value
+    // argument. Methods of anything else may write everything.
+    ANode.GetAttr('method.name', LAttr);
+    LMethod := DictionaryMethodIR(LAttr.AsString);
+    LObject := ANode.GetChild(0).GetChild(0);
+    if (not IsDictionaryExpr(LObject) or IsMutatingDictionaryMethod(LMethod)) and
+       WriteMayAlias(LObject, AName) then
+      Exit(True);
+    for LI := 1 to ANode.ChildCount() - 1 do
+      if (not IsDictionaryExpr(LObject) or
+          ((LMethod = 'TryGetValue') and (LI = 2))) and
+         WriteMayAlias(ANode.GetChild(LI), AName) then
+        Exit(True);
+  end
+  else if (LKind = 'expr.field_access') and (ANode.ChildCount() > 0) and
+          IsDictionaryExpr(ANode.GetChild(0)) then
+  begin
+    // D.Clear; without parentheses
+    ANode.GetAttr('field.name', LAttr);
+    if IsMutatingDictionaryMethod(LAttr.AsString) and
+       WriteMayAlias(ANode.GetChild(0), AName) then
+      Exit(True);
+  end;
+  for LI := 0 to ANode.ChildCount() - 1 do
+    if ParamMayBeModified(ANode.GetChild(LI), AName, AVisited) then
+      Exit(True);
+  Result := False;
+end;
+
+// Parameter name of a stmt.param_decl node
+function ParamName(const AParam: TParseASTNodeBase): string;
+var
+  LAttr: TValue;
+begin
+  AParam.GetAttr('param.name', LAttr);
+  Result := LAttr.AsString;
+  if Result = '' then
+    Result := AParam.GetToken().Text;
+end;
+
+// Resolves the C++ type of a parameter declaration:
+//   var/out                          -> T&
+//   const, non-trivial T             -> const T&
+//   value, non-trivial T, never
+//   modified by ABody                -> const T&
+//   otherwise                        -> T
+// ABody is nil when the signature must not depend on the body, i.e. when a
+// separate interface prototype is emitted from the signature alone.
+function ResolveParamIR(const AParse: TParse; const AParam: TParseASTNodeBase;
+  const ABody: TParseASTNodeBase): string;
+var
+  LAttr:     TValue;
+  LModifier: string;
+  LTypeText: string;
+  LVisited:  TList<TParseASTNodeBase>;
+begin
+  AParam.GetAttr('param.modifier', LAttr);
+  LModifier := LAttr.AsString;
+  AParam.GetAttr('param.type_text', LAttr);
+  LTypeText := LAttr.AsString;
+  Result    := ResolveTypeIR(AParse, LTypeText);
+  if (LModifier = 'var') or (LModifier = 'out') then
+    Exit(Result + '&');
+  if IsCheapParamType(AParse, LTypeText) then
+    Exit;
+  if LModifier = 'const' then
+    Exit('const ' + Result + '&');
+  if ABody = nil then
+    Exit;
+  LVisited := TList<TParseASTNodeBase>.Create();
+  try
+    if not ParamMayBeModified(ABody, ParamName(AParam), LVisited) then
+      Result := 'const ' + Result + '&';
+  finally
+    LVisited.Free();
+  end;
+end;
+
+// Analysis scope for value parameters of a proc/func declaration: the whole
+// declaration node, or nil when its prototype also comes from a unit
+// interface forward declaration (which has no body to look at).
+function ParamAnalysisScope(const ANode: TParseASTNodeBase): TParseASTNodeBase;
+var
+  LAttr: TValue;
+begin
+  Result := ANode;
+  if ANode.GetAttr('decl.suppress_forward', LAttr) and
+     LAttr.IsType<Boolean> and LAttr.AsBoolean then
+    Result := nil;
+end;
+
+// --- Locals written under a fault frame ---
+// Where the C++ compiler has no non-call exceptions (NP_FAULT_FRAMES, see
+// runtime_exceptions.h) a hardware fault longjmps back to the start of the
+// try statement, and a non-volatile local changed since then is
+// indeterminate afterwards. A scalar local, value parameter or Result that a
+// try body writes and code outside that body reads is therefore declared
+// with NP_FAULT_VOLATILE, which is volatile under fault frames and nothing
+// otherwise. Strings, arrays and records change through calls and are not
+// cached in registers across them.
+
+// True for types held in a single register: ordinals, floats, Boolean,
+// Char and pointers
+function IsScalarTypeKind(const AKind: string): Boolean;
+begin
+  Result := (AKind = 'type.integer') or (AKind = 'type.int64') or
+            (AKind = 'type.cardinal') or (AKind = 'type.byte') or
+            (AKind = 'type.word') or (AKind = 'type.shortint') or
+            (AKind = 'type.smallint') or (AKind = 'type.boolean') or
+            (AKind = 'type.char') or (AKind = 'type.double') or
+            (AKind = 'type.single') or (AKind = 'type.real') or
+            (AKind = 'type.pointer');
+end;
+
+// Adds the lower-cased root names of the l-values ANode may write to AWritten
+procedure CollectWrittenRoots(const ANode: TParseASTNodeBase;
+  const AWritten: TList<string>);
+var
+  LKind:  string;
+  LAttr:  TValue;
+  LFirst: Integer;
+  LI:     Integer;
+
+  procedure Add(const AName: string);
+  begin
+    if (AName <> '') and not AWritten.Contains(LowerCase(AName)) then
+      AWritten.Add(LowerCase(AName));
+  end;
+
+begin
+  LKind := ANode.GetNodeKind();
+  if ((LKind = 'expr.assign') or (LKind = 'expr.addr')) and
+     (ANode.ChildCount() > 0) then
+    Add(LValueRoot(ANode.GetChild(0)))
+  else if (LKind = 'stmt.setlength') or (LKind = 'stmt.include') or
+          (LKind = 'stmt.exclude') or (LKind = 'stmt.readln') or
+          (LKind = 'stmt.read') then
+  begin
+    for LI := 0 to ANode.ChildCount() - 1 do
+      Add(LValueRoot(ANode.GetChild(LI)));
+  end
+  else if (LKind = 'expr.call') or IsQualifiedCall(ANode) then
+  begin
+    LFirst := Ord(LKind = 'expr.method_call');
+    for LI := LFirst to ANode.ChildCount() - 1 do
+      if CallMayWriteArg(ANode, LI - LFirst) then
+        Add(LValueRoot(ANode.GetChild(LI)));
+  end
+  else if (LKind = 'stmt.for') and ANode.GetAttr('for.var', LAttr) then
+    Add(LAttr.AsString);
+  for LI := 0 to ANode.ChildCount() - 1 do
+    CollectWrittenRoots(ANode.GetChild(LI), AWritten);
+end;
+
+// Number of identifiers in ANode that name AName
+function CountIdentRefs(const ANode: TParseASTNodeBase;
+  const AName: string): Integer;
+var
+  LI: Integer;
+begin
+  Result := 0;
+  if (ANode.GetNodeKind() = 'expr.ident') and
+     SameText(ANode.GetToken().Text, AName) then
+    Inc(Result);
+  for LI := 0 to ANode.ChildCount() - 1 do
+    Inc(Result, CountIdentRefs(ANode.GetChild(LI), AName));
+end;
+
+// Adds to ANames the names written by a try body within ANode and read
+// somewhere else in ABody, the whole routine body
+procedure CollectFaultVolatile(const ABody: TParseASTNodeBase;
+  const ANode: TParseASTNodeBase; const ANames: TList<string>);
+var
+  LWritten: TList<string>;
+  LName:    string;
+  LI:       Integer;
+begin
+  if ANode.GetNodeKind() = 'stmt.try_body' then
+  begin
+    LWritten := TList<string>.Create();
+    try
+      CollectWrittenRoots(ANode, LWritten);
+      for LName in LWritten do
+        if not ANames.Contains(LName) and
+           (CountIdentRefs(ABody, LName) > CountIdentRefs(ANode, LName)) then
+          ANames.Add(LName);
+    finally
+      LWritten.Free();
+    end;
+  end;
+  for LI := 0 to ANode.ChildCount() - 1 do
+    CollectFaultVolatile(ABody, ANode.GetChild(LI), ANames);
+end;
+
+// Marks the scalar locals ('var.fault_volatile'), value parameters
+// ('param.fault_volatile') and Result ('decl.result_volatile') of the
+// proc/func declaration ADecl that must be NP_FAULT_VOLATILE
+procedure MarkFaultVolatile(const AParse: TParse; const ADecl: TParseASTNodeBase);
+var
+  LNames:  TList<string>;
+  LAttr:   TValue;
+  LChild:  TParseASTNodeBase;
+  LVar:    TParseASTNodeBase;
+  LI:      Integer;
+  LJ:      Integer;
+begin
+  LNames := TList<string>.Create();
+  try
+    CollectFaultVolatile(ADecl.GetChild(ADecl.ChildCount() - 1),
+      ADecl.GetChild(ADecl.ChildCount() - 1), LNames);
+    if LNames.Count = 0 then
+      Exit;
+    ADecl.GetAttr('decl.name', LAttr);
+    if LNames.Contains('result') or LNames.Contains(LowerCase(LAttr.AsString)) then
+      TParseASTNode(ADecl).SetAttr('decl.result_volatile', TValue.From<Boolean>(True));
+    for LI := 0 to ADecl.ChildCount() - 2 do
+    begin
+      LChild := ADecl.GetChild(LI);
+      if LChild.GetNodeKind() = 'stmt.param_decl' then
+      begin
+        LChild.GetAttr('param.modifier', LAttr);
+        if (LAttr.AsString = '') and
+           LNames.Contains(LowerCase(ParamName(LChild))) then
+          TParseASTNode(LChild).SetAttr('param.fault_volatile',
+            TValue.From<Boolean>(True));
+      end
+      else if LChild.GetNodeKind() = 'stmt.var_block' then
+        for LJ := 0 to LChild.ChildCount() - 1 do
+        begin
+          LVar := LChild.GetChild(LJ);
+          if (LVar.GetNodeKind() = 'stmt.var_decl') and
+             LNames.Contains(LowerCase(LVar.GetToken().Text)) then
+            TParseASTNode(LVar).SetAttr('var.fault_volatile',
+              TValue.From<Boolean>(True));
+        end;
+    end;
+  finally
+    LNames.Free();
+  end;
+end;
+
+// C++ type of a value parameter or Result of scalar type ATypeText, with
+// NP_FAULT_VOLATILE when ANode carries the Boolean attribute AMarkAttr
+function FaultVolatileIR(const AParse: TParse; const ANode: TParseASTNodeBase;
+  const AMarkAttr: string; const ATypeText: string; const ACppType: string): string;
+var
+  LAttr: TValue;
+begin
+  Result := ACppType;
+  if ANode.GetAttr(AMarkAttr, LAttr) and LAttr.IsType<Boolean> and
+     LAttr.AsBoolean and
+     IsScalarTypeKind(AParse.Config().TypeTextToKind(ATypeText)) then
+    Result := Result + ' NP_FAULT_VOLATILE';
+end;
+
 // =========================================================================
 // PROGRAM STRUCTURE
 // =========================================================================
 
 // --- Program Root ---
 
-procedure RegisterProgramRoot(const AParse: TParse);
+procedure RegisterProgramRoot(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('program.root',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
     begin
+      AOptions.BeginFile();
       AGen.EmitLine('#pragma once', sfHeader);
       AGen.EmitLine('#include "runtime.h"', sfHeader);
       AGen.EmitChildren(ANode);
@@ -107,7 +986,7 @@ end;
 
 // --- Pascal Program ---
 
-procedure RegisterPascalProgram(const AParse: TParse);
+procedure RegisterPascalProgram(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.pascal_program',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
@@ -149,9 +1028,17 @@ begin
       AGen.Func('main', 'int');
       AGen.Param('argc', 'int');
       AGen.Param('argv', 'char**');
-      // Initialise command-line parameter support
+      // Initialise command-line parameter support, hardware fault handlers
+      // and the console buffer
       AGen.Stmt('np::InitCommandLine(argc, argv);');
+      AGen.Stmt('np::_InstallHardwareHandlers();');
+      if AOptions.ConsoleLineFlush then
+        AGen.Stmt('np::InitializeConsole(np::ConsoleBuffering::LineOnTTY);')
+      else
+        AGen.Stmt('np::InitializeConsole();');
+      AOptions.RoutineKind := 'program';
       AGen.EmitNode(ANode.GetChild(ANode.ChildCount() - 1));
+      AOptions.RoutineKind := '';
       AGen.Return(AGen.Lit(0));
       AGen.EndFunc();
     end);
@@ -219,11 +1106,16 @@ begin
       end
       else if LTypeKind = 'type.set' then
       begin
-        // np::Set<ElemType>
+        // np::Set<ElemType>, or np::Set<T, Lo, Hi> for a subrange base type
         ANode.GetAttr('var.elem_type_text', LTypeAttr);
         LElemType    := LTypeAttr.AsString;
-        LElemCppType := ResolveTypeIR(AParse, LElemType);
-        LCppType     := Format('np::Set<%s>', [LElemCppType]);
+        LArrayLow    := '';
+        LArrayHigh   := '';
+        if ANode.GetAttr('var.set_low', LTypeAttr) then
+          LArrayLow  := LTypeAttr.AsString;
+        if ANode.GetAttr('var.set_high', LTypeAttr) then
+          LArrayHigh := LTypeAttr.AsString;
+        LCppType     := ResolveSetIR(AParse, LElemType, LArrayLow, LArrayHigh);
       end
       else if LTypeKind = 'type.pointer' then
       begin
@@ -233,6 +1125,26 @@ begin
         LElemCppType := ResolveTypeIR(AParse, LElemType);
         LCppType     := LElemCppType + '*';
       end
+      else if (LTypeKind = 'type.dictionary') and
+              ANode.GetAttr('var.key_type_text', LTypeAttr) then
+      begin
+        // np::Dictionary<KeyType, ValueType>
+        LElemType    := LTypeAttr.AsString;
+        ANode.GetAttr('var.elem_type_text', LTypeAttr);
+        LCppType     := ResolveDictionaryIR(AParse, LElemType, LTypeAttr.AsString);
+      end
+      else if LTypeKind = 'type.dictionary' then
+      begin
+        // Alias of a TDictionary type: the alias is a C++ using declaration
+        ANode.GetAttr('var.type_text', LTypeAttr);
+        LCppType := LTypeAttr.AsString;
+      end
+      else if LTypeKind = 'type.typedfile' then
+      begin
+        // np::TypedFile<RecordType>
+        ANode.GetAttr('var.elem_type_text', LTypeAttr);
+        LCppType := Format('np::TypedFile<%s>', [ResolveTypeIR(AParse, LTypeAttr.AsString)]);
+      end
       else if LTypeKind <> 'type.unknown' then
         // Known primitive or built-in type
         LCppType := AParse.Config().TypeToIR(LTypeKind)
@@ -244,6 +1156,10 @@ begin
         LCppType := LTypeAttr.AsString;
       end;
       LVarName  := ANode.GetToken().Text;
+      if ANode.GetAttr('var.fault_volatile', LTypeAttr) and
+         LTypeAttr.IsType<Boolean> and LTypeAttr.AsBoolean and
+         IsScalarTypeKind(LTypeKind) then
+        LCppType := LCppType + ' NP_FAULT_VOLATILE';
       if LStorage = 'global' then
         AGen.Global(LVarName, LCppType, '')
       else
@@ -348,8 +1264,14 @@ begin
         // Set type alias: using TName = np::Set<ElemType>;
         ANode.GetAttr('type.elem_type_text', LAttr);
         LFieldType := LAttr.AsString;
-        LCppType   := ResolveTypeIR(AParse, LFieldType);
-        AGen.EmitLine('using %s = np::Set<%s>;',
+        LArrayLow  := '';
+        LArrayHigh := '';
+        if ANode.GetAttr('type.set_low', LAttr) then
+          LArrayLow  := LAttr.AsString;
+        if ANode.GetAttr('type.set_high', LAttr) then
+          LArrayHigh := LAttr.AsString;
+        LCppType   := ResolveSetIR(AParse, LFieldType, LArrayLow, LArrayHigh);
+        AGen.EmitLine('using %s = %s;',
           [LDeclName, LCppType], sfHeader);
         AGen.EmitLine('', sfHeader);
       end
@@ -362,6 +1284,25 @@ begin
         AGen.EmitLine('using %s = %s*;',
           [LDeclName, LCppType], sfHeader);
         AGen.EmitLine('', sfHeader);
+      end
+      else if LTypeKind = 'dictionary' then
+      begin
+        // Dictionary type alias: using TName = np::Dictionary<KeyType, ValueType>;
+        ANode.GetAttr('type.key_type_text', LAttr);
+        LFieldType := LAttr.AsString;
+        ANode.GetAttr('type.elem_type_text', LAttr);
+        LCppType   := ResolveDictionaryIR(AParse, LFieldType, LAttr.AsString);
+        AGen.EmitLine('using %s = %s;', [LDeclName, LCppType], sfHeader);
+        AGen.EmitLine('', sfHeader);
+      end
+      else if LTypeKind = 'file' then
+      begin
+        // Typed file alias: using TName = np::TypedFile<RecordType>;
+        ANode.GetAttr('type.elem_type_text', LAttr);
+        LCppType   := ResolveTypeIR(AParse, LAttr.AsString);
+        AGen.EmitLine('using %s = np::TypedFile<%s>;',
+          [LDeclName, LCppType], sfHeader);
+        AGen.EmitLine('', sfHeader);
       end;
     end);
 
@@ -405,6 +1346,10 @@ begin
         LCppType := 'auto'
       else
         LCppType := ResolveTypeIR(AParse, LTypeText);
+      // String constants name their np::StrLit instead of copying it
+      if (LCppType = 'np::String') or
+         (LValueStr.StartsWith('np::StrLit<') and (LCppType = 'auto')) then
+        LCppType := 'const np::String&';
       if LStorage = 'global' then
         AGen.EmitLine('constexpr %s %s = %s;', [LCppType, LConstName, LValueStr])
       else
@@ -414,7 +1359,7 @@ end;
 
 // --- Procedure Declaration ---
 
-procedure RegisterProcDecl(const AParse: TParse);
+procedure RegisterProcDecl(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.proc_decl',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
@@ -424,33 +1369,24 @@ begin
       LParams:       string;
       LI:            Integer;
       LChild:        TParseASTNodeBase;
-      LParamAttr:    TValue;
-      LModifierAttr: TValue;
-      LParamType:    string;
-      LModifier:     string;
+      LScope:        TParseASTNodeBase;
       LCppType:      string;
       LParamName:    string;
     begin
       ANode.GetAttr('decl.name', LAttr);
       LNodeName := LAttr.AsString;
+      MarkFaultVolatile(AParse, ANode);
       // Build param string for forward declaration
+      LScope  := ParamAnalysisScope(ANode);
       LParams := '';
       for LI := 0 to ANode.ChildCount() - 2 do
       begin
         LChild := ANode.GetChild(LI);
         if LChild.GetNodeKind() <> 'stmt.param_decl' then
           Continue;
-        LChild.GetAttr('param.type_text', LParamAttr);
-        LChild.GetAttr('param.modifier', LModifierAttr);
-        LParamType := LParamAttr.AsString;
-        LModifier  := LModifierAttr.AsString;
-        LCppType   := ResolveTypeIR(AParse, LParamType);
-        // var/out params are passed by reference in C++
-        if (LModifier = 'var') or (LModifier = 'out') then
-          LCppType := LCppType + '&';
-        LChild.GetAttr('param.name', LAttr);
-        LParamName := LAttr.AsString;
-        if LParamName = '' then LParamName := LChild.GetToken().Text;
+        // var/out -> T&; const or unmodified non-trivial params -> const T&
+        LCppType   := ResolveParamIR(AParse, LChild, LScope);
+        LParamName := ParamName(LChild);
         if LParams <> '' then
           LParams := LParams + ', ';
         LParams := LParams + LCppType + ' ' + LParamName;
@@ -466,36 +1402,31 @@ begin
         LChild := ANode.GetChild(LI);
         if LChild.GetNodeKind() <> 'stmt.param_decl' then
           Continue;
-        LChild.GetAttr('param.type_text', LParamAttr);
-        LChild.GetAttr('param.modifier', LModifierAttr);
-        LParamType := LParamAttr.AsString;
-        LModifier  := LModifierAttr.AsString;
-        LCppType   := ResolveTypeIR(AParse, LParamType);
-        // var/out params are passed by reference in C++
-        if (LModifier = 'var') or (LModifier = 'out') then
-          LCppType := LCppType + '&';
-        LChild.GetAttr('param.name', LAttr);
-        LParamName := LAttr.AsString;
-        if LParamName = '' then LParamName := LChild.GetToken().Text;
-        AGen.Param(LParamName, LCppType);
+        LChild.GetAttr('param.type_text', LAttr);
+        AGen.Param(ParamName(LChild), FaultVolatileIR(AParse, LChild,
+          'param.fault_volatile', LAttr.AsString,
+          ResolveParamIR(AParse, LChild, LScope)));
       end;
       // Emit any var/const declaration blocks (children between params and body)
       for LI := 0 to ANode.ChildCount() - 2 do
       begin
         LChild := ANode.GetChild(LI);
         if (LChild.GetNodeKind() = 'stmt.var_block') or
-           (LChild.GetNodeKind() = 'stmt.const_block') then
+           (LChild.GetNodeKind() = 'stmt.const_block') or
+           (LChild.GetNodeKind() = 'stmt.directive') then
           AGen.EmitNode(LChild);
       end;
       // Body is last child
+      AOptions.RoutineKind := 'procedure';
       AGen.EmitNode(ANode.GetChild(ANode.ChildCount() - 1));
+      AOptions.RoutineKind := '';
       AGen.EndFunc();
     end);
 end;
 
 // --- Function Declaration ---
 
-procedure RegisterFuncDecl(const AParse: TParse);
+procedure RegisterFuncDecl(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.func_decl',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
@@ -507,10 +1438,7 @@ begin
       LParams:       string;
       LI:            Integer;
       LChild:        TParseASTNodeBase;
-      LParamAttr:    TValue;
-      LModifierAttr: TValue;
-      LParamType:    string;
-      LModifier:     string;
+      LScope:        TParseASTNodeBase;
       LCppType:      string;
       LParamName:    string;
     begin
@@ -519,24 +1447,18 @@ begin
       ANode.GetAttr('decl.return_type', LAttr);
       LReturnText := LAttr.AsString;
       LCppReturn  := ResolveTypeIR(AParse, LReturnText);
+      MarkFaultVolatile(AParse, ANode);
       // Build param string for forward declaration
+      LScope  := ParamAnalysisScope(ANode);
       LParams := '';
       for LI := 0 to ANode.ChildCount() - 2 do
       begin
         LChild := ANode.GetChild(LI);
         if LChild.GetNodeKind() <> 'stmt.param_decl' then
           Continue;
-        LChild.GetAttr('param.type_text', LParamAttr);
-        LChild.GetAttr('param.modifier', LModifierAttr);
-        LParamType := LParamAttr.AsString;
-        LModifier  := LModifierAttr.AsString;
-        LCppType   := ResolveTypeIR(AParse, LParamType);
-        // var/out params are passed by reference in C++
-        if (LModifier = 'var') or (LModifier = 'out') then
-          LCppType := LCppType + '&';
-        LChild.GetAttr('param.name', LAttr);
-        LParamName := LAttr.AsString;
-        if LParamName = '' then LParamName := LChild.GetToken().Text;
+        // var/out -> T&; const or unmodified non-trivial params -> const T&
+        LCppType   := ResolveParamIR(AParse, LChild, LScope);
+        LParamName := ParamName(LChild);
         if LParams <> '' then
           LParams := LParams + ', ';
         LParams := LParams + LCppType + ' ' + LParamName;
@@ -552,31 +1474,27 @@ begin
         LChild := ANode.GetChild(LI);
         if LChild.GetNodeKind() <> 'stmt.param_decl' then
           Continue;
-        LChild.GetAttr('param.type_text', LParamAttr);
-        LChild.GetAttr('param.modifier', LModifierAttr);
-        LParamType := LParamAttr.AsString;
-        LModifier  := LModifierAttr.AsString;
-        LCppType   := ResolveTypeIR(AParse, LParamType);
-        // var/out params are passed by reference in C++
-        if (LModifier = 'var') or (LModifier = 'out') then
-          LCppType := LCppType + '&';
-        LChild.GetAttr('param.name', LAttr);
-        LParamName := LAttr.AsString;
-        if LParamName = '' then LParamName := LChild.GetToken().Text;
-        AGen.Param(LParamName, LCppType);
+        LChild.GetAttr('param.type_text', LAttr);
+        AGen.Param(ParamName(LChild), FaultVolatileIR(AParse, LChild,
+          'param.fault_volatile', LAttr.AsString,
+          ResolveParamIR(AParse, LChild, LScope)));
       end;
       // Declare Result variable
-      AGen.DeclVar('Result', LCppReturn, '{}');
+      AGen.DeclVar('Result', FaultVolatileIR(AParse, ANode,
+        'decl.result_volatile', LReturnText, LCppReturn), '{}');
       // Emit any var/const declaration blocks (children between params and body)
       for LI := 0 to ANode.ChildCount() - 2 do
       begin
         LChild := ANode.GetChild(LI);
         if (LChild.GetNodeKind() = 'stmt.var_block') or
-           (LChild.GetNodeKind() = 'stmt.const_block') then
+           (LChild.GetNodeKind() = 'stmt.const_block') or
+           (LChild.GetNodeKind() = 'stmt.directive') then
           AGen.EmitNode(LChild);
       end;
       // Body
+      AOptions.RoutineKind := 'function';
       AGen.EmitNode(ANode.GetChild(ANode.ChildCount() - 1));
+      AOptions.RoutineKind := '';
       AGen.Return(AGen.Get('Result'));
       AGen.EndFunc();
     end);
@@ -658,21 +1576,48 @@ begin
     end);
 end;
 
+// --- Native loop helper ---
+// Closes the loop frame opened with AOptions.EnterLoop. When a break inside a
+// case arm had to jump out of the switch, its goto label follows the loop.
+
+procedure EndNativeLoop(const AOptions: TNPCodeGenOptions; const AId: Integer;
+  const AGen: TParseIRBase);
+begin
+  if AOptions.LeaveLoop() then
+    AGen.Stmt('_np_break%d:;', [AId]);
+end;
+
 // --- While ---
-// Emits np::WhileLoop([&]() { return cond; }, [&]() { body });
-// break/continue inside the body lambda return LoopControl values.
+// Native:  while (cond) { body }
+// Lambda:  np::WhileLoop([&]() { return cond; }, [&]() { body });
+//          break/continue inside the body lambda return LoopControl values.
 
-procedure RegisterWhileStmt(const AParse: TParse);
+procedure RegisterWhileStmt(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.while',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
     var
       LCondStr: string;
+      LId:      Integer;
     begin
       LCondStr := AParse.Config().ExprToString(ANode.GetChild(0));
+      if AOptions.NativeLoops then
+      begin
+        LId := AOptions.NewId();
+        AOptions.EnterLoop(LId);
+        AGen.Stmt('while (%s) {', [LCondStr]);
+        AGen.IndentIn();
+        AGen.EmitNode(ANode.GetChild(1));
+        AGen.IndentOut();
+        AGen.Stmt('}');
+        EndNativeLoop(AOptions, LId, AGen);
+        Exit;
+      end;
       AGen.Stmt('np::WhileLoop([&]() { return %s; }, [&]() {', [LCondStr]);
       AGen.IndentIn();
+      AOptions.EnterLambda();
       AGen.EmitNode(ANode.GetChild(1));
+      AOptions.LeaveLambda();
       // If the body contains break/continue the lambda return type is deduced
       // as LoopControl -- all fallthrough paths must also return LoopControl.
       if HasLoopControl(ANode.GetChild(1)) then
@@ -683,10 +1628,17 @@ begin
 end;
 
 // --- For ---
-// Emits np::ForLoop / np::ForLoopDownto with lambda body.
-// The loop variable is declared before the call so it is visible inside.
-
-procedure RegisterForStmt(const AParse: TParse);
+// Native: both bounds are evaluated once into an Int64 counter, so a loop
+// that ends at the top of the control variable's range cannot overflow, and
+// the Pascal control variable is assigned on every iteration:
+//   for (np::Int64 _np_i1 = (start), _np_end1 = (end); _np_i1 <= _np_end1; ++_np_i1) {
+//     i = static_cast<decltype(i)>(_np_i1);
+//     body
+//   }
+// Lambda: np::ForLoop / np::ForLoopDownto with the loop variable as the
+// lambda parameter.
+
+procedure RegisterForStmt(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.for',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
@@ -696,6 +1648,7 @@ begin
       LDir:      string;
       LStartStr: string;
       LEndStr:   string;
+      LId:       Integer;
     begin
       ANode.GetAttr('for.var', LAttr);
       LVarName  := LAttr.AsString;
@@ -703,6 +1656,24 @@ begin
       LDir      := LAttr.AsString;
       LStartStr := AParse.Config().ExprToString(ANode.GetChild(0));
       LEndStr   := AParse.Config().ExprToString(ANode.GetChild(1));
+      if AOptions.NativeLoops then
+      begin
+        LId := AOptions.NewId();
+        AOptions.EnterLoop(LId);
+        if LDir = 'to' then
+          AGen.Stmt('for (np::Int64 _np_i%d = (%s), _np_end%d = (%s); _np_i%d <= _np_end%d; ++_np_i%d) {',
+            [LId, LStartStr, LId, LEndStr, LId, LId, LId])
+        else
+          AGen.Stmt('for (np::Int64 _np_i%d = (%s), _np_end%d = (%s); _np_i%d >= _np_end%d; --_np_i%d) {',
+            [LId, LStartStr, LId, LEndStr, LId, LId, LId]);
+        AGen.IndentIn();
+        AGen.Stmt('%s = static_cast<decltype(%s)>(_np_i%d);', [LVarName, LVarName, LId]);
+        AGen.EmitNode(ANode.GetChild(2));
+        AGen.IndentOut();
+        AGen.Stmt('}');
+        EndNativeLoop(AOptions, LId, AGen);
+        Exit;
+      end;
       if LDir = 'to' then
         AGen.Stmt('np::ForLoop(%s, %s, [&](np::Integer %s) {',
           [LStartStr, LEndStr, LVarName])
@@ -710,7 +1681,9 @@ begin
         AGen.Stmt('np::ForLoopDownto(%s, %s, [&](np::Integer %s) {',
           [LStartStr, LEndStr, LVarName]);
       AGen.IndentIn();
+      AOptions.EnterLambda();
       AGen.EmitNode(ANode.GetChild(2));
+      AOptions.LeaveLambda();
       // If the body contains break/continue the lambda return type is deduced
       // as LoopControl -- all fallthrough paths must also return LoopControl.
       if HasLoopControl(ANode.GetChild(2)) then
@@ -722,9 +1695,10 @@ end;
 
 // --- Repeat..Until ---
 // Children: [stmt0..stmtN-1, condition_expr]
-// Emits: np::RepeatUntil([&]() { body }, [&]() { return cond; });
+// Native: do { body } while (!(cond));   -- continue re-tests the condition
+// Lambda: np::RepeatUntil([&]() { body }, [&]() { return cond; });
 
-procedure RegisterRepeatStmt(const AParse: TParse);
+procedure RegisterRepeatStmt(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.repeat',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
@@ -732,13 +1706,29 @@ begin
       LCondStr: string;
       LLast:    Integer;
       LI:       Integer;
+      LId:      Integer;
     begin
       LLast    := ANode.ChildCount() - 1;
       LCondStr := AParse.Config().ExprToString(ANode.GetChild(LLast));
+      if AOptions.NativeLoops then
+      begin
+        LId := AOptions.NewId();
+        AOptions.EnterLoop(LId);
+        AGen.Stmt('do {');
+        AGen.IndentIn();
+        for LI := 0 to LLast - 1 do
+          AGen.EmitNode(ANode.GetChild(LI));
+        AGen.IndentOut();
+        AGen.Stmt('} while (!(%s));', [LCondStr]);
+        EndNativeLoop(AOptions, LId, AGen);
+        Exit;
+      end;
       AGen.Stmt('np::RepeatUntil([&]() {');
       AGen.IndentIn();
+      AOptions.EnterLambda();
       for LI := 0 to LLast - 1 do
         AGen.EmitNode(ANode.GetChild(LI));
+      AOptions.LeaveLambda();
       // If the body contains break/continue the lambda return type is deduced
       // as LoopControl -- all fallthrough paths must also return LoopControl.
       if HasLoopControl(ANode) then
@@ -753,8 +1743,10 @@ end;
 // Multiple labels on one arm emit multiple consecutive C++ case labels.
 // Each arm emits a break to prevent C++ fallthrough.
 // The else branch emits as default:.
+// The switch is registered with the enclosing native loop so a Pascal break
+// inside an arm still leaves the loop rather than the switch.
 
-procedure RegisterCaseStmt(const AParse: TParse);
+procedure RegisterCaseStmt(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   // --- stmt.case ---
   AParse.Config().RegisterEmitter('stmt.case',
@@ -766,8 +1758,10 @@ begin
       LSelectorStr := AParse.Config().ExprToString(ANode.GetChild(0));
       AGen.Stmt('switch (%s) {', [LSelectorStr]);
       AGen.IndentIn();
+      AOptions.EnterSwitch();
       for LI := 1 to ANode.ChildCount() - 1 do
         AGen.EmitNode(ANode.GetChild(LI));
+      AOptions.LeaveSwitch();
       AGen.IndentOut();
       AGen.Stmt('}');
     end);
@@ -814,18 +1808,30 @@ begin
 end;
 
 // --- Exit / Break / Continue ---
-// exit        -> return;
+// exit        -> return;  (return Result; in a function, return 0; in main)
 // exit(value) -> return value;
-// break       -> return np::LoopControl::Break;
-// continue    -> return np::LoopControl::Continue;
-
-procedure RegisterExitBreakContinue(const AParse: TParse);
+// Native loops:
+//   break     -> break;   (goto past the loop when inside a case arm)
+//   continue  -> continue;
+// Lambda loops:
+//   break     -> return np::LoopControl::Break;
+//   continue  -> return np::LoopControl::Continue;
+
+procedure RegisterExitBreakContinue(const AParse: TParse;
+  const AOptions: TNPCodeGenOptions);
 begin
   AParse.Config().RegisterEmitter('stmt.exit',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
     begin
       if ANode.ChildCount() > 0 then
         AGen.Return(AParse.Config().ExprToString(ANode.GetChild(0)))
+      else if AOptions.LambdaDepth > 0 then
+        // Inside a lambda wrapper the return only leaves the lambda
+        AGen.Return()
+      else if AOptions.RoutineKind = 'function' then
+        AGen.Return(AGen.Get('Result'))
+      else if AOptions.RoutineKind = 'program' then
+        AGen.Return(AGen.Lit(0))
       else
         AGen.Return();
     end);
@@ -833,13 +1839,19 @@ begin
   AParse.Config().RegisterEmitter('stmt.break',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
     begin
-      AGen.Return('np::LoopControl::Break');
+      if AOptions.NativeLoops then
+        AGen.Stmt(AOptions.BreakTarget())
+      else
+        AGen.Return('np::LoopControl::Break');
     end);
 
   AParse.Config().RegisterEmitter('stmt.continue',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
     begin
-      AGen.Return('np::LoopControl::Continue');
+      if AOptions.NativeLoops then
+        AGen.Stmt('continue;')
+      else
+        AGen.Return('np::LoopControl::Continue');
     end);
 end;
 
@@ -849,7 +1861,9 @@ end;
 
 // --- String Literal ---
 // A single-character Pascal string literal (e.g. '*') is a np::Char (char16_t)
-// and must be emitted as u'*'. Multi-character literals are np::String.
+// and is emitted as u'*'. Longer literals are emitted as np::StrLit<u"...">,
+// a constant String built at compile time, so evaluating one (e.g. in
+// `if s = 'END' then` inside a loop) never allocates or transcodes.
 
 procedure RegisterStringLiteral(const AParse: TParse);
 begin
@@ -859,19 +1873,12 @@ begin
     var
       LText: string;
     begin
-      // GetToken().Text holds the raw Pascal token including surrounding quotes,
-      // e.g. '*' -> text is '*' (3 chars). Strip the outer single quotes first.
-      LText := ANode.GetToken().Text;
-      if (Length(LText) >= 2) and
-         (LText[1] = '''') and (LText[Length(LText)] = '''') then
-        LText := Copy(LText, 2, Length(LText) - 2);
+      // Do NOT call ADefault here -- it re-enters this override causing a stack overflow.
+      LText := PascalStringValue(ANode.GetToken().Text);
       if Length(LText) = 1 then
-        // Single character: emit as char16_t literal for np::Char compatibility
-        Result := 'u''' + LText + ''''
+        Result := 'u''' + CppLiteralText(LText) + ''''
       else
-        // Multi-character string: emit as a standard quoted C++ string literal.
-        // Do NOT call ADefault here -- it re-enters this override causing a stack overflow.
-        Result := '"' + LText + '"';
+        Result := 'np::StrLit<u"' + CppLiteralText(LText) + '">';
     end);
 end;
 
@@ -902,6 +1909,54 @@ begin
     end);
 end;
 
+procedure RegisterReplaceFlag(const AParse: TParse);
+begin
+  AParse.Config().RegisterExprOverride('expr.replace_flag',
+    function(const ANode: TParseASTNodeBase;
+      const ADefault: TParseExprToStringFunc): string
+    begin
+      // rfReplaceAll / rfIgnoreCase -> np::TReplaceFlag enumerators
+      if SameText(ANode.GetToken().Text, 'rfreplaceall') then
+        Result := 'np::rfReplaceAll'
+      else
+        Result := 'np::rfIgnoreCase';
+    end);
+end;
+
+// --- Format ---
+// A literal format string is passed as a template argument, so its
+// specifiers are split out at compile time:
+//   Format('%s=%d', [K, V]) -> np::FormatLit<u"%s=%d">(K, V)
+//   Format(LFmt, [K, V])    -> np::Format(LFmt, K, V)
+
+procedure RegisterFormatCall(const AParse: TParse);
+begin
+  AParse.Config().RegisterExprOverride('expr.format',
+    function(const ANode: TParseASTNodeBase;
+      const ADefault: TParseExprToStringFunc): string
+    var
+      LFmt:  TParseASTNodeBase;
+      LArgs: string;
+      LI:    Integer;
+    begin
+      LArgs := '';
+      for LI := 1 to ANode.ChildCount() - 1 do
+      begin
+        if LArgs <> '' then
+          LArgs := LArgs + ', ';
+        LArgs := LArgs + ADefault(ANode.GetChild(LI));
+      end;
+      LFmt := ANode.GetChild(0);
+      if LFmt.GetNodeKind() = 'expr.string' then
+        Result := 'np::FormatLit<u"' +
+          CppLiteralText(PascalStringValue(LFmt.GetToken().Text)) + '">(' + LArgs + ')'
+      else if LArgs <> '' then
+        Result := 'np::Format(' + ADefault(LFmt) + ', ' + LArgs + ')'
+      else
+        Result := 'np::Format(' + ADefault(LFmt) + ')';
+    end);
+end;
+
 // --- Runtime Operator Overrides ---
 // div, mod, shl, shr emit np:: calls instead of raw C++ operators
 
@@ -951,12 +2006,15 @@ end;
 // --- Structure Expression Overrides ---
 // arr[i], rec.field, p^, @x, set literal, in, char literal, hex literal
 
-procedure RegisterStructureExprOverrides(const AParse: TParse);
+procedure RegisterStructureExprOverrides(const AParse: TParse;
+  const AOptions: TNPCodeGenOptions);
 begin
   // arr[i] -- subtract the array's declared low bound so Delphi 1-based
   // (or any-based) indexing maps correctly to 0-based C++ storage.
   // The low bound is read from the var decl node stored on the ident's
   // PARSE_ATTR_DECL_NODE attribute, which is populated by the semantic pass.
+  // Under {$R+} the access is emitted as np::At(arr, i), which bounds-checks
+  // static arrays, dynamic arrays and strings alike; under {$R-} it is raw.
   AParse.Config().RegisterExprOverride('expr.array_index',
     function(const ANode: TParseASTNodeBase;
       const ADefault: TParseExprToStringFunc): string
@@ -981,22 +2039,71 @@ begin
           LLow := StrToIntDef(LLowAttr.AsString, 0);
       end;
       if LLow <> 0 then
-        Result := Format('%s[(%s) - %d]', [LArrayStr, LIndexStr, LLow])
+        LIndexStr := Format('(%s) - %d', [LIndexStr, LLow]);
+      if AOptions.RangeChecksActive then
+        Result := Format('np::At(%s, %s)', [LArrayStr, LIndexStr])
       else
         Result := Format('%s[%s]', [LArrayStr, LIndexStr]);
     end);
 
-  // rec.field -- dot access
+  // rec.field -- dot access. On a dictionary the parameterless methods
+  // are called (D.Count -> D.Count()), D.Items[k] indexes D itself and
+  // D.Keys.ToArray is D.Keys, which already returns an array.
   AParse.Config().RegisterExprOverride('expr.field_access',
     function(const ANode: TParseASTNodeBase;
       const ADefault: TParseExprToStringFunc): string
     var
       LAttr:      TValue;
       LFieldName: string;
+      LObject:    TParseASTNodeBase;
     begin
       ANode.GetAttr('field.name', LAttr);
       LFieldName := LAttr.AsString;
-      Result := Format('%s.%s', [ADefault(ANode.GetChild(0)), LFieldName]);
+      LObject    := ANode.GetChild(0);
+      if IsDictionaryExpr(LObject) then
+      begin
+        if SameText(LFieldName, 'Items') then
+          Exit(ADefault(LObject));
+        Exit(Format('%s.%s()', [ADefault(LObject), DictionaryMethodIR(LFieldName)]));
+      end;
+      if SameText(LFieldName, 'ToArray') and
+         (LObject.GetNodeKind() = 'expr.field_access') and
+         IsDictionaryExpr(LObject.GetChild(0)) then
+        Exit(ADefault(LObject));
+      Result := Format('%s.%s', [ADefault(LObject), LFieldName]);
+    end);
+
+  // obj.Method(args) -- method call; TDictionary method names are
+  // normalised to the spelling np::Dictionary uses
+  AParse.Config().RegisterExprOverride('expr.method_call',
+    function(const ANode: TParseASTNodeBase;
+      const ADefault: TParseExprToStringFunc): string
+    var
+      LAttr:   TValue;
+      LObject: TParseASTNodeBase;
+      LMethod: string;
+      LArgs:   string;
+      LI:      Integer;
+    begin
+      LArgs := '';
+      for LI := 1 to ANode.ChildCount() - 1 do
+      begin
+        if LI > 1 then
+          LArgs := LArgs + ', ';
+        LArgs := LArgs + ADefault(ANode.GetChild(LI));
+      end;
+      // Unit.Routine(args) -- the qualifier is dropped
+      if IsQualifiedCall(ANode) then
+      begin
+        ANode.GetAttr('call.name', LAttr);
+        Exit(Format('%s(%s)', [LAttr.AsString, LArgs]));
+      end;
+      ANode.GetAttr('method.name', LAttr);
+      LMethod := LAttr.AsString;
+      LObject := ANode.GetChild(0).GetChild(0);
+      if IsDictionaryExpr(LObject) then
+        LMethod := DictionaryMethodIR(LMethod);
+      Result := Format('%s.%s(%s)', [ADefault(LObject), LMethod, LArgs]);
     end);
 
   // p^ -- pointer dereference
@@ -1015,23 +2122,92 @@ begin
       Result := Format('(&%s)', [ADefault(ANode.GetChild(0))]);
     end);
 
-  // [a, b, c] set literal -- np::MakeSet({a, b, c})
+  // [a, b, c] set literal.
+  // A constructor whose elements are all literals with ordinals in 0..255 is
+  // folded into a constant that takes the type of the set it is combined
+  // with, compared with or assigned to (a compile-time bitset for bitset
+  // types):
+  //   ['a'..'c', '_'] -> np::SetLit<np::Char, 97, 98, 99, 95>
+  // Anything else is built at run time:
+  //   [a, b, lo..hi]  -> np::MakeSet({a, b}).IncludeRange(lo, hi)
   // Note: type parameter T is inferred by C++ from the brace-enclosed elements.
   AParse.Config().RegisterExprOverride('expr.set_literal',
     function(const ANode: TParseASTNodeBase;
       const ADefault: TParseExprToStringFunc): string
     var
-      LElems: string;
-      LI:     Integer;
+      LChild:    TParseASTNodeBase;
+      LElems:    string;
+      LRanges:   string;
+      LOrdinals: string;
+      LConstant: Boolean;
+      LAnyChar:  Boolean;
+      LIsChar:   Boolean;
+      LLow:      Int64;
+      LHigh:     Int64;
+      LOrd:      Int64;
+      LI:        Integer;
     begin
-      LElems := '';
+      // Try to fold the whole constructor into a constant first
+      LConstant := True;
+      LAnyChar  := False;
+      LOrdinals := '';
+      for LI := 0 to ANode.ChildCount() - 1 do
+      begin
+        LChild := ANode.GetChild(LI);
+        if LChild.GetNodeKind() = 'expr.set_range' then
+          LConstant := TryLiteralOrdinal(LChild.GetChild(0), LLow, LIsChar) and
+                       TryLiteralOrdinal(LChild.GetChild(1), LHigh, LIsChar)
+        else
+        begin
+          LConstant := TryLiteralOrdinal(LChild, LLow, LIsChar);
+          LHigh     := LLow;
+        end;
+        LConstant := LConstant and (LLow >= 0) and (LHigh <= 255);
+        if not LConstant then
+          Break;
+        LAnyChar := LAnyChar or LIsChar;
+        for LOrd := LLow to LHigh do
+          LOrdinals := LOrdinals + Format(', %d', [LOrd]);
+      end;
+      if LConstant then
+      begin
+        if LAnyChar then
+          Result := 'np::SetLit<np::Char' + LOrdinals + '>'
+        else
+          Result := 'np::SetLit<np::Integer' + LOrdinals + '>';
+        Exit;
+      end;
+      // Run-time constructor: single elements seed the set, ranges are appended
+      LElems  := '';
+      LRanges := '';
       for LI := 0 to ANode.ChildCount() - 1 do
       begin
-        if LElems <> '' then
-          LElems := LElems + ', ';
-        LElems := LElems + ADefault(ANode.GetChild(LI));
+        LChild := ANode.GetChild(LI);
+        if LChild.GetNodeKind() = 'expr.set_range' then
+          LRanges := LRanges + Format('.IncludeRange(%s, %s)', [
+            ADefault(LChild.GetChild(0)), ADefault(LChild.GetChild(1))])
+        else
+        begin
+          if LElems <> '' then
+            LElems := LElems + ', ';
+          LElems := LElems + ADefault(LChild);
+        end;
+      end;
+      if LElems <> '' then
+        Result := Format('np::MakeSet({%s})', [LElems]) + LRanges
+      else
+      begin
+        // Ranges only: the first range seeds the set
+        LChild := ANode.GetChild(0);
+        Result := Format('np::MakeSetRange(%s, %s)', [
+          ADefault(LChild.GetChild(0)), ADefault(LChild.GetChild(1))]);
+        for LI := 1 to ANode.ChildCount() - 1 do
+        begin
+          LChild := ANode.GetChild(LI);
+          Result := Result + Format('.IncludeRange(%s, %s)', [
+            ADefault(LChild.GetChild(0)), ADefault(LChild.GetChild(1))]);
+        end;
       end;
-      Result := Format('np::MakeSet({%s})', [LElems]);
     end);
 
   // x in mySet -- np::In(x, mySet)
@@ -1147,11 +2323,92 @@ end;
 
 // --- Assignment Expression ---
 
+// Collects a, b, c of `ATarget + a + b + c` into AOperands. False when the
+// left-most operand of the + chain is not the identifier ATarget.
+function CollectAppendOperands(const ATarget: string;
+  const AExpr: TParseASTNodeBase;
+  var AOperands: TArray<TParseASTNodeBase>): Boolean;
+var
+  LAttr: TValue;
+begin
+  if AExpr.GetNodeKind() = 'expr.ident' then
+    Exit(SameText(AExpr.GetToken().Text, ATarget));
+  if (AExpr.GetNodeKind() <> 'expr.binary') or (AExpr.ChildCount() <> 2) or
+     not AExpr.GetAttr('op', LAttr) or (LAttr.AsString <> '+') then
+    Exit(False);
+  Result := CollectAppendOperands(ATarget, AExpr.GetChild(0), AOperands);
+  if Result then
+    AOperands := AOperands + [AExpr.GetChild(1)];
+end;
+
+// True when ANode may run user code: a call to a user routine (with or
+// without parentheses) or a raw C++ expression
+function HasUserCall(const ANode: TParseASTNodeBase): Boolean;
+var
+  LAttr: TValue;
+  LKind: string;
+  LI:    Integer;
+begin
+  LKind := ANode.GetNodeKind();
+  if LKind = 'expr.cpp_inline' then
+    Exit(True);
+  if ((LKind = 'expr.call') or (LKind = 'expr.ident') or IsQualifiedCall(ANode)) and
+     ANode.GetAttr(PARSE_ATTR_DECL_NODE, LAttr) and (LAttr.AsObject <> nil) then
+  begin
+    LKind := TParseASTNodeBase(LAttr.AsObject).GetNodeKind();
+    if (LKind = 'stmt.func_decl') or (LKind = 'stmt.func_forward') or
+       (LKind = 'stmt.proc_decl') or (LKind = 'stmt.proc_forward') then
+      Exit(True);
+  end;
+  for LI := 0 to ANode.ChildCount() - 1 do
+    if HasUserCall(ANode.GetChild(LI)) then
+      Exit(True);
+  Result := False;
+end;
+
+// s := s + a + b on a String variable appends in place:
+//   np::_AppendAll(s, a, b);
+// The operands are evaluated before s changes, so they may read s. With
+// more than one operand, user calls keep the plain form: one of them could
+// write s after the original value had been read.
+function TryEmitAppend(const AParse: TParse; const ANode: TParseASTNodeBase;
+  const AGen: TParseIRBase): Boolean;
+var
+  LTarget:   TParseASTNodeBase;
+  LAttr:     TValue;
+  LOperands: TArray<TParseASTNodeBase>;
+  LArgs:     TArray<string>;
+  LI:        Integer;
+begin
+  Result  := False;
+  LTarget := ANode.GetChild(0);
+  if (LTarget.GetNodeKind() <> 'expr.ident') or
+     not LTarget.GetAttr(PARSE_ATTR_TYPE_KIND, LAttr) or
+     (LAttr.AsString <> 'type.string') then
+    Exit;
+  LOperands := nil;
+  if not CollectAppendOperands(LTarget.GetToken().Text, ANode.GetChild(1),
+    LOperands) or (Length(LOperands) = 0) then
+    Exit;
+  if Length(LOperands) > 1 then
+    for LI := 0 to High(LOperands) do
+      if HasUserCall(LOperands[LI]) then
+        Exit;
+  SetLength(LArgs, Length(LOperands) + 1);
+  LArgs[0] := AParse.Config().ExprToString(LTarget);
+  for LI := 0 to High(LOperands) do
+    LArgs[LI + 1] := AParse.Config().ExprToString(LOperands[LI]);
+  AGen.Call('np::_AppendAll', LArgs);
+  Result := True;
+end;
+
 procedure RegisterAssignEmitter(const AParse: TParse);
 begin
   AParse.Config().RegisterEmitter('expr.assign',
     procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
     begin
+      if TryEmitAppend(AParse, ANode, AGen) then
+        Exit;
       AGen.Assign(
         AParse.Config().ExprToString(ANode.GetChild(0)),
         AParse.Config().ExprToString(ANode.GetChild(1)));
@@ -1178,6 +2435,20 @@ begin
         LArgs[LI] := AParse.Config().ExprToString(ANode.GetChild(LI));
       AGen.Call(LCallName, LArgs);
     end);
+
+  // obj.Method(args); as a statement
+  AParse.Config().RegisterEmitter('expr.method_call',
+    procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
+    begin
+      AGen.Stmt('%s;', [AParse.Config().ExprToString(ANode)]);
+    end);
+
+  // D.Clear; -- a parameterless dictionary method called without parentheses
+  AParse.Config().RegisterEmitter('expr.field_access',
+    procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
+    begin
+      AGen.Stmt('%s;', [AParse.Config().ExprToString(ANode)]);
+    end);
 end;
 
 // --- SetLength ---
@@ -1197,13 +2468,23 @@ begin
 end;
 
 // --- Try..Except..Finally ---
-// Emit strategy:
-//   try..except          -> try { body } catch (...) { np::CatchException(); handler }
-//   try..finally         -> try { body } catch (...) { finally_body; throw; } finally_body
-//   try..except..finally -> try { body } catch (...) { np::CatchException(); handler }
-//                           finally_body
+// Emit strategy (each inside its own { } scope):
+//   try..except          -> try { frame; body } catch (...) { np::_CaptureException(); handler }
+//   try..finally         -> np::_FinallyGuard _np_finN([&]() { finally_body }); frame; body
+//   try..except..finally -> np::_FinallyGuard _np_finN([&]() { finally_body });
+//                           try { frame; body } catch (...) { np::_CaptureException(); handler }
+// where frame is NP_FAULT_FRAME(_np_fltN): the setjmp frame hardware faults
+// jump back to in builds without non-call exceptions, nothing otherwise
+// (see runtime_exceptions.h and MarkFaultVolatile).
+
+// Declares the fault frame of a try statement at the start of its body
+procedure EmitFaultFrame(const AGen: TParseIRBase;
+  const AOptions: TNPCodeGenOptions);
+begin
+  AGen.Stmt(Format('NP_FAULT_FRAME(_np_flt%d);', [AOptions.NewId()]));
+end;
 
-procedure RegisterTryStmt(const AParse: TParse);
+procedure RegisterTryStmt(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   // Sub-block emitters -- simply emit their children
   AParse.Config().RegisterEmitter('stmt.try_body',
@@ -1249,53 +2530,46 @@ begin
       end;
       LHasExcept  := LExceptBody  <> nil;
       LHasFinally := LFinallyBody <> nil;
-      // Emit the appropriate lambda-based wrapper. The runtime functions
-      // (TryCatch, TryFinally, TryCatchFinally) install hardware exception
-      // handlers and use setjmp/longjmp to catch hardware faults in addition
-      // to C++ software exceptions.
-      if LHasExcept and LHasFinally then
+      // Native C++ try/catch: exit/break/continue in the body keep their
+      // meaning. finally code runs from a scope guard declared ahead of the
+      // body, so it also runs when the body leaves early. Only the finally
+      // body lives in a lambda. Where the build needs it, the fault frame
+      // lets a hardware fault in the body resume here and be rethrown as a
+      // C++ exception.
+      AGen.Stmt('{');
+      AGen.IndentIn();
+      if LHasFinally then
       begin
-        // np::TryCatchFinally(tryFn, catchFn, finallyFn)
-        AGen.Stmt('np::TryCatchFinally([&]() {');
-        AGen.IndentIn();
-        if LTryBody <> nil then AGen.EmitNode(LTryBody);
-        AGen.IndentOut();
-        AGen.Stmt('}, [&]() {');
-        AGen.IndentIn();
-        AGen.EmitNode(LExceptBody);
-        AGen.IndentOut();
-        AGen.Stmt('}, [&]() {');
+        AGen.Stmt(Format('np::_FinallyGuard _np_fin%d([&]() {',
+          [AOptions.NewId()]));
         AGen.IndentIn();
+        AOptions.EnterLambda();
         AGen.EmitNode(LFinallyBody);
+        AOptions.LeaveLambda();
         AGen.IndentOut();
         AGen.Stmt('});');
-      end
-      else if LHasExcept then
+      end;
+      if LHasExcept then
       begin
-        // np::TryCatch(tryFn, catchFn)
-        AGen.Stmt('np::TryCatch([&]() {');
+        AGen.Stmt('try {');
         AGen.IndentIn();
+        EmitFaultFrame(AGen, AOptions);
         if LTryBody <> nil then AGen.EmitNode(LTryBody);
         AGen.IndentOut();
-        AGen.Stmt('}, [&]() {');
+        AGen.Stmt('} catch (...) {');
         AGen.IndentIn();
+        AGen.Stmt('np::_CaptureException();');
         AGen.EmitNode(LExceptBody);
         AGen.IndentOut();
-        AGen.Stmt('});');
+        AGen.Stmt('}');
       end
-      else if LHasFinally then
+      else
       begin
-        // np::TryFinally(tryFn, finallyFn) -- exception re-propagates after finally
-        AGen.Stmt('np::TryFinally([&]() {');
-        AGen.IndentIn();
+        EmitFaultFrame(AGen, AOptions);
         if LTryBody <> nil then AGen.EmitNode(LTryBody);
-        AGen.IndentOut();
-        AGen.Stmt('}, [&]() {');
-        AGen.IndentIn();
-        AGen.EmitNode(LFinallyBody);
-        AGen.IndentOut();
-        AGen.Stmt('});');
       end;
+      AGen.IndentOut();
+      AGen.Stmt('}');
     end);
 end;
 
@@ -1406,6 +2680,8 @@ begin
         if LChild.GetNodeKind() = 'stmt.unit_interface' then
           AGen.EmitNode(LChild)
         else if LChild.GetNodeKind() = 'stmt.unit_implementation' then
+          AGen.EmitNode(LChild)
+        else if LChild.GetNodeKind() = 'stmt.directive' then
           AGen.EmitNode(LChild);
         // uses_clause already handled above — skip
       end;
@@ -1457,7 +2733,6 @@ begin
       LName:      string;
       LParamName: string;
       LParamType: string;
-      LModifier:  string;
       LSig:       string;
       LAttr:      TValue;
     begin
@@ -1470,18 +2745,10 @@ begin
         if LParamNode.GetNodeKind() = 'stmt.param_decl' then
         begin
           if LI > 0 then LSig := LSig + ', ';
-          LParamNode.GetAttr('param.modifier', LAttr);
-          LModifier  := LAttr.AsString;
-          LParamNode.GetAttr('param.type_text', LAttr);
-          LParamType := ResolveTypeIR(AParse, LAttr.AsString);
-          LParamNode.GetAttr('param.name', LAttr);
-          LParamName := LAttr.AsString;
-          if LParamName = '' then
-            LParamName := LParamNode.GetToken().Text;
-          if LModifier = 'var' then
-            LSig := LSig + LParamType + '& ' + LParamName
-          else
-            LSig := LSig + LParamType + ' ' + LParamName;
+          // Signature-only rule; must match the implementation's definition
+          LParamType := ResolveParamIR(AParse, LParamNode, nil);
+          LParamName := ParamName(LParamNode);
+          LSig := LSig + LParamType + ' ' + LParamName;
         end;
       end;
       LSig := LSig + ');';
@@ -1502,7 +2769,6 @@ begin
       LRetType:   string;
       LParamName: string;
       LParamType: string;
-      LModifier:  string;
       LSig:       string;
       LAttr:      TValue;
     begin
@@ -1517,18 +2783,10 @@ begin
         if LParamNode.GetNodeKind() = 'stmt.param_decl' then
         begin
           if LI > 0 then LSig := LSig + ', ';
-          LParamNode.GetAttr('param.modifier', LAttr);
-          LModifier  := LAttr.AsString;
-          LParamNode.GetAttr('param.type_text', LAttr);
-          LParamType := ResolveTypeIR(AParse, LAttr.AsString);
-          LParamNode.GetAttr('param.name', LAttr);
-          LParamName := LAttr.AsString;
-          if LParamName = '' then
-            LParamName := LParamNode.GetToken().Text;
-          if LModifier = 'var' then
-            LSig := LSig + LParamType + '& ' + LParamName
-          else
-            LSig := LSig + LParamType + ' ' + LParamName;
+          // Signature-only rule; must match the implementation's definition
+          LParamType := ResolveParamIR(AParse, LParamNode, nil);
+          LParamName := ParamName(LParamNode);
+          LSig := LSig + LParamType + ' ' + LParamName;
         end;
       end;
       LSig := LSig + ');';
@@ -1613,6 +2871,21 @@ begin
     end);
 end;
 
+// --- Compiler Directives ---
+// stmt.directive -- emits nothing; switch state is consumed by later emitters
+
+procedure RegisterDirective(const AParse: TParse; const AOptions: TNPCodeGenOptions);
+begin
+  AParse.Config().RegisterEmitter('stmt.directive',
+    procedure(ANode: TParseASTNodeBase; AGen: TParseIRBase)
+    var
+      LAttr: TValue;
+    begin
+      ANode.GetAttr('directive.text', LAttr);
+      AOptions.ApplyDirective(LAttr.AsString);
+    end);
+end;
+
 // --- C++ Interop Emitters ---
 // stmt.cpp_block  — emits raw captured text to header or source
 // expr.cpp_inline — emits the raw string verbatim as a C++ expression
@@ -1648,14 +2921,14 @@ begin
 end;
 
 
-procedure ConfigCodeGen(const AParse: TParse);
+procedure ConfigCodeGen(const AParse: TParse; const AOptions: TNPCodeGenOptions);
 begin
   // Type mapping -- np:: aliases for all Delphi types
   RegisterTypeToIR(AParse);
 
   // Program structure
-  RegisterProgramRoot(AParse);
-  RegisterPascalProgram(AParse);
+  RegisterProgramRoot(AParse, AOptions);
+  RegisterPascalProgram(AParse, AOptions);
   RegisterPascalUnit(AParse);
   RegisterUnitInterface(AParse);
   RegisterProcForward(AParse);
@@ -1668,40 +2941,43 @@ begin
   RegisterVarDecl(AParse);
   RegisterConstBlock(AParse);
   RegisterTypeDecl(AParse);
-  RegisterProcDecl(AParse);
-  RegisterFuncDecl(AParse);
+  RegisterProcDecl(AParse, AOptions);
+  RegisterFuncDecl(AParse, AOptions);
   RegisterParamDecl(AParse);
 
   // Control flow
   RegisterBeginBlock(AParse);
   RegisterIfStmt(AParse);
-  RegisterWhileStmt(AParse);
-  RegisterForStmt(AParse);
+  RegisterWhileStmt(AParse, AOptions);
+  RegisterForStmt(AParse, AOptions);
 
   // I/O
   RegisterStringLiteral(AParse);
   RegisterNilLiteral(AParse);
   RegisterBoolLiteral(AParse);
+  RegisterReplaceFlag(AParse);
+  RegisterFormatCall(AParse);
   RegisterRuntimeOperators(AParse);
-  RegisterStructureExprOverrides(AParse);
+  RegisterStructureExprOverrides(AParse, AOptions);
   RegisterWriteln(AParse);
   RegisterWrite(AParse);
   RegisterReadln(AParse);
   RegisterRead(AParse);
 
   // Additional control flow
-  RegisterRepeatStmt(AParse);
-  RegisterCaseStmt(AParse);
-  RegisterExitBreakContinue(AParse);
+  RegisterRepeatStmt(AParse, AOptions);
+  RegisterCaseStmt(AParse, AOptions);
+  RegisterExitBreakContinue(AParse, AOptions);
 
   // Expressions as statements
   RegisterAssignEmitter(AParse);
   RegisterCallEmitter(AParse);
   RegisterSetLength(AParse);
   RegisterIncludeExclude(AParse);
-  RegisterTryStmt(AParse);
+  RegisterTryStmt(AParse, AOptions);
   RegisterRaiseStmt(AParse);
   RegisterCppInterop(AParse);
+  RegisterDirective(AParse, AOptions);
 end;
 
 end.
@@ -80,6 +80,32 @@ begin
     end);
 end;
 
+// --- StringReplace Flags ---
+
+procedure RegisterReplaceFlags(const AParse: TParse);
+begin
+  // rfReplaceAll, rfIgnoreCase -- elements of StringReplace's flag set
+  AParse.Config().RegisterPrefix('keyword.rfreplaceall', 'expr.replace_flag',
+    function(AParser: TParseParserBase): TParseASTNodeBase
+    var
+      LNode: TParseASTNode;
+    begin
+      LNode := AParser.CreateNode();
+      AParser.Consume();
+      Result := LNode;
+    end);
+
+  AParse.Config().RegisterPrefix('keyword.rfignorecase', 'expr.replace_flag',
+    function(AParser: TParseParserBase): TParseASTNodeBase
+    var
+      LNode: TParseASTNode;
+    begin
+      LNode := AParser.CreateNode();
+      AParser.Consume();
+      Result := LNode;
+    end);
+end;
+
 // --- Unary Not ---
 
 procedure RegisterUnaryNot(const AParse: TParse);
@@ -205,7 +231,27 @@ begin
     end);
 end;
 
-// --- Set Literal: [a, b, c] ---
+// --- Set Literal: [a, b, c] / [lo..hi] ---
+
+// Parses one set constructor element. A lo..hi range becomes an
+// expr.set_range node holding the two bounds as children.
+function ParseSetElement(AParser: TParseParserBase): TParseASTNode;
+var
+  LLow:   TParseASTNode;
+  LRange: TParseASTNode;
+begin
+  LLow := TParseASTNode(AParser.ParseExpression(0));
+  if AParser.Check('op.range') then
+  begin
+    LRange := AParser.CreateNode('expr.set_range', AParser.CurrentToken());
+    AParser.Consume();  // consume '..'
+    LRange.AddChild(LLow);
+    LRange.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+    Result := LRange;
+  end
+  else
+    Result := LLow;
+end;
 
 procedure RegisterSetLiteral(const AParse: TParse);
 begin
@@ -218,9 +264,9 @@ begin
       AParser.Consume();  // consume '['
       if not AParser.Check('delimiter.rbracket') then
       begin
-        LNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+        LNode.AddChild(ParseSetElement(AParser));
         while AParser.Match('delimiter.comma') do
-          LNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+          LNode.AddChild(ParseSetElement(AParser));
       end;
       AParser.Expect('delimiter.rbracket');
       Result := LNode;
@@ -372,6 +418,10 @@ begin
 end;
 
 // --- Function/Procedure Call (infix lparen) ---
+// f(args) becomes expr.call; obj.Method(args) becomes expr.method_call.
+// Which X.Y(args) are methods is only known once X is resolved: the semantic
+// pass treats those whose X is not a dictionary variable as a call of Y
+// qualified by a unit name (see IsQualifiedCall in the code generator).
 
 procedure RegisterCallExpr(const AParse: TParse);
 begin
@@ -381,10 +431,23 @@ begin
       ALeft: TParseASTNodeBase): TParseASTNodeBase
     var
       LNode: TParseASTNode;
+      LAttr: TValue;
     begin
-      LNode := AParser.CreateNode('expr.call', ALeft.GetToken());
-      LNode.SetAttr('call.name',
-        TValue.From<string>(ALeft.GetToken().Text));
+      if ALeft.GetNodeKind() = 'expr.field_access' then
+      begin
+        // obj.Method(args): the field access (object + method name) stays
+        // the first child, followed by the arguments
+        LNode := AParser.CreateNode('expr.method_call', ALeft.GetToken());
+        ALeft.GetAttr('field.name', LAttr);
+        LNode.SetAttr('method.name', LAttr);
+        LNode.AddChild(TParseASTNode(ALeft));
+      end
+      else
+      begin
+        LNode := AParser.CreateNode('expr.call', ALeft.GetToken());
+        LNode.SetAttr('call.name',
+          TValue.From<string>(ALeft.GetToken().Text));
+      end;
       AParser.Consume();  // consume '('
       if not AParser.Check('delimiter.rparen') then
       begin
@@ -483,6 +546,17 @@ end;
 // STATEMENT HANDLERS
 // =========================================================================
 
+// --- Switch Directives Between Declarations ---
+
+// Parses any run of {$...} directives into AParent. Called where a
+// declaration list would otherwise stop at one: after a program or unit
+// header, after a uses clause, and between var/const/type entries.
+procedure ParseDirectives(AParser: TParseParserBase; AParent: TParseASTNode);
+begin
+  while AParser.Check('literal.directive') do
+    AParent.AddChild(TParseASTNode(AParser.ParseStatement()));
+end;
+
 // --- Program Header ---
 // BNF: ProgramDecl = "program" Identifier ";"
 //                    [ "uses" UnitList ";" ]
@@ -509,6 +583,7 @@ begin
         TValue.From<string>(AParser.CurrentToken().Text));
       AParser.Consume();  // consume program name
       AParser.Expect('delimiter.semicolon');
+      ParseDirectives(AParser, LNode);
       // Optional uses clause: uses UnitA, UnitB;
       if AParser.Match('keyword.uses') then
       begin
@@ -522,6 +597,7 @@ begin
         until not AParser.Match('delimiter.comma');
         AParser.Expect('delimiter.semicolon');
         LNode.AddChild(LUsesNode);
+        ParseDirectives(AParser, LNode);
       end;
       // Any number of var/const/type/procedure/function/cppblock declarations in any order
       while AParser.Check('keyword.var') or
@@ -530,7 +606,8 @@ begin
             AParser.Check('keyword.procedure') or
             AParser.Check('keyword.function') or
             AParser.Check('literal.cpp_block_header') or
-            AParser.Check('literal.cpp_block_source') do
+            AParser.Check('literal.cpp_block_source') or
+            AParser.Check('literal.directive') do
         LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
       // Main begin..end. block
       LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
@@ -539,6 +616,49 @@ begin
     end);
 end;
 
+// --- Generic Dictionary Type: TDictionary<K, V> ---
+
+// True when the current token starts a TDictionary<K, V> type
+function CheckDictionaryType(AParser: TParseParserBase): Boolean;
+begin
+  Result := SameText(AParser.CurrentToken().Text, 'TDictionary');
+end;
+
+// Parses TDictionary<K, V>; the key and value types are single type names
+procedure ParseDictionaryType(AParser: TParseParserBase; out AKeyType,
+  AValueType: string);
+begin
+  AParser.Consume();   // consume 'TDictionary'
+  AParser.Expect('op.lt');
+  AKeyType := AParser.CurrentToken().Text;
+  AParser.Consume();   // consume key type
+  AParser.Expect('delimiter.comma');
+  AValueType := AParser.CurrentToken().Text;
+  AParser.Consume();   // consume value type
+  AParser.Expect('op.gt');
+end;
+
+// --- File Types: file of T / file ---
+
+// True when the current token starts a file type. 'file' is matched by text
+// so that it stays usable as an identifier elsewhere.
+function CheckFileType(AParser: TParseParserBase): Boolean;
+begin
+  Result := SameText(AParser.CurrentToken().Text, 'file');
+end;
+
+// Parses 'file of T' (AElemType = T) or an untyped 'file' (AElemType = '')
+procedure ParseFileType(AParser: TParseParserBase; out AElemType: string);
+begin
+  AParser.Consume();   // consume 'file'
+  AElemType := '';
+  if AParser.Match('keyword.of') then
+  begin
+    AElemType := AParser.CurrentToken().Text;
+    AParser.Consume();   // consume record type
+  end;
+end;
+
 // --- Var Block ---
 
 procedure RegisterVarBlock(const AParse: TParse);
@@ -557,10 +677,14 @@ begin
       LArrayHigh:   string;
       LSetKind:     string;
       LPointerKind: string;
+      LDictKind:    string;
+      LKeyType:     string;
+      LFileKind:    string;
       LI:           Integer;
     begin
       LNode := AParser.CreateNode();
       AParser.Consume();  // consume 'var'
+      ParseDirectives(AParser, LNode);
       // Parse one or more "a, b, c : type ;" declarations
       while AParser.Check(PARSE_KIND_IDENTIFIER) do
       begin
@@ -583,6 +707,9 @@ begin
         LArrayHigh   := '';
         LSetKind     := '';
         LPointerKind := '';
+        LDictKind    := '';
+        LKeyType     := '';
+        LFileKind    := '';
         if AParser.Check('keyword.array') then
         begin
           AParser.Consume();  // consume 'array'
@@ -612,6 +739,13 @@ begin
           LSetKind  := 'set';
           LElemType := AParser.CurrentToken().Text;
           AParser.Consume();   // consume element type keyword
+          if AParser.Match('op.range') then
+          begin
+            // Subrange base type: set of 0..63 / set of 'a'..'z'
+            LArrayLow  := LElemType;
+            LArrayHigh := AParser.CurrentToken().Text;
+            AParser.Consume();   // consume high bound
+          end;
         end
         else if AParser.Check('op.deref') then
         begin
@@ -622,6 +756,25 @@ begin
           LElemType    := AParser.CurrentToken().Text;
           AParser.Consume();    // consume pointee type
         end
+        else if CheckDictionaryType(AParser) then
+        begin
+          // Dictionary type: TDictionary<K, V>
+          LTypeText := 'dictionary';
+          LDictKind := 'dictionary';
+          ParseDictionaryType(AParser, LKeyType, LElemType);
+        end
+        else if CheckFileType(AParser) then
+        begin
+          // Typed file: file of T; an untyped file is a BinaryFile
+          ParseFileType(AParser, LElemType);
+          if LElemType <> '' then
+          begin
+            LTypeText := 'file';
+            LFileKind := 'typed';
+          end
+          else
+            LTypeText := 'binaryfile';
+        end
         else
         begin
           // Simple type: single keyword
@@ -648,14 +801,31 @@ begin
           begin
             LVarNode.SetAttr('var.set_kind',       TValue.From<string>(LSetKind));
             LVarNode.SetAttr('var.elem_type_text', TValue.From<string>(LElemType));
+            if LArrayLow <> '' then
+            begin
+              LVarNode.SetAttr('var.set_low',  TValue.From<string>(LArrayLow));
+              LVarNode.SetAttr('var.set_high', TValue.From<string>(LArrayHigh));
+            end;
           end
           else if LPointerKind <> '' then
           begin
             LVarNode.SetAttr('var.pointer_kind',   TValue.From<string>(LPointerKind));
             LVarNode.SetAttr('var.elem_type_text', TValue.From<string>(LElemType));
+          end
+          else if LDictKind <> '' then
+          begin
+            LVarNode.SetAttr('var.dict_kind',      TValue.From<string>(LDictKind));
+            LVarNode.SetAttr('var.key_type_text',  TValue.From<string>(LKeyType));
+            LVarNode.SetAttr('var.elem_type_text', TValue.From<string>(LElemType));
+          end
+          else if LFileKind <> '' then
+          begin
+            LVarNode.SetAttr('var.file_kind',      TValue.From<string>(LFileKind));
+            LVarNode.SetAttr('var.elem_type_text', TValue.From<string>(LElemType));
           end;
           LNode.AddChild(LVarNode);
         end;
+        ParseDirectives(AParser, LNode);
       end;
       Result := LNode;
     end);
@@ -735,7 +905,8 @@ begin
       // Optional var/const/type declaration section before body
       while AParser.Check('keyword.var') or
             AParser.Check('keyword.const') or
-            AParser.Check('keyword.type') do
+            AParser.Check('keyword.type') or
+            AParser.Check('literal.directive') do
         LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
       // Body
       LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
@@ -825,7 +996,8 @@ begin
       // Optional var/const/type declaration section before body
       while AParser.Check('keyword.var') or
             AParser.Check('keyword.const') or
-            AParser.Check('keyword.type') do
+            AParser.Check('keyword.type') or
+            AParser.Check('literal.directive') do
         LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
       // Body
       LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
@@ -1107,6 +1279,7 @@ begin
     begin
       LNode := AParser.CreateNode();
       AParser.Consume();  // consume 'const'
+      ParseDirectives(AParser, LNode);
       while AParser.Check(PARSE_KIND_IDENTIFIER) do
       begin
         LNameTok := AParser.CurrentToken();
@@ -1125,6 +1298,7 @@ begin
         LConstNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
         AParser.Expect('delimiter.semicolon');
         LNode.AddChild(LConstNode);
+        ParseDirectives(AParser, LNode);
       end;
       Result := LNode;
     end);
@@ -1225,9 +1399,13 @@ begin
       LFieldNames:   array[0..31] of TParseToken;
       LFieldCount:   Integer;
       LFI:           Integer;
+      LKeyType:      string;
+      LValueType:    string;
+      LElemType:     string;
     begin
       LNode := AParser.CreateNode();
       AParser.Consume();  // consume 'type'
+      ParseDirectives(AParser, LNode);
       while AParser.Check(PARSE_KIND_IDENTIFIER) do
       begin
         LNameTok := AParser.CurrentToken();
@@ -1243,6 +1421,13 @@ begin
           while not AParser.Check('keyword.end') and
                 not AParser.Check(PARSE_KIND_EOF) do
           begin
+            // A switch between fields goes to the type block: fields hold no
+            // code for it to change, and it still applies from here on
+            if AParser.Check('literal.directive') then
+            begin
+              ParseDirectives(AParser, LNode);
+              Continue;
+            end;
             // Collect comma-separated field names before the colon
             LFieldCount    := 0;
             LFieldNames[0] := AParser.CurrentToken();
@@ -1301,7 +1486,16 @@ begin
             TValue.From<string>('set'));
           LDeclNode.SetAttr('type.elem_type_text',
             TValue.From<string>(AParser.CurrentToken().Text));
+          LDeclNode.SetAttr('type.set_low',
+            TValue.From<string>(AParser.CurrentToken().Text));
           AParser.Consume();   // consume element type keyword
+          if AParser.Match('op.range') then
+          begin
+            // Subrange base type: type TDigits = set of '0'..'9';
+            LDeclNode.SetAttr('type.set_high',
+              TValue.From<string>(AParser.CurrentToken().Text));
+            AParser.Consume();   // consume high bound
+          end;
         end
         else if AParser.Check('op.deref') then
         begin
@@ -1312,6 +1506,31 @@ begin
             TValue.From<string>(AParser.CurrentToken().Text));
           AParser.Consume();   // consume pointee type
         end
+        else if CheckDictionaryType(AParser) then
+        begin
+          // Dictionary type alias: type TScores = TDictionary<String, Integer>;
+          ParseDictionaryType(AParser, LKeyType, LValueType);
+          LDeclNode.SetAttr('type.kind', TValue.From<string>('dictionary'));
+          LDeclNode.SetAttr('type.key_type_text',
+            TValue.From<string>(LKeyType));
+          LDeclNode.SetAttr('type.elem_type_text',
+            TValue.From<string>(LValueType));
+        end
+        else if CheckFileType(AParser) then
+        begin
+          // Typed file alias: type TRecFile = file of TRec;
+          ParseFileType(AParser, LElemType);
+          if LElemType <> '' then
+          begin
+            LDeclNode.SetAttr('type.kind', TValue.From<string>('file'));
+            LDeclNode.SetAttr('type.elem_type_text', TValue.From<string>(LElemType));
+          end
+          else
+          begin
+            LDeclNode.SetAttr('type.kind', TValue.From<string>('alias'));
+            LDeclNode.SetAttr('type.alias_text', TValue.From<string>('binaryfile'));
+          end;
+        end
         else
         begin
           // Simple type alias: type TMyInt = Integer;
@@ -1322,6 +1541,7 @@ begin
         end;
         AParser.Expect('delimiter.semicolon');
         LNode.AddChild(LDeclNode);
+        ParseDirectives(AParser, LNode);
       end;
       Result := LNode;
     end);
@@ -1419,6 +1639,42 @@ begin
     end);
 end;
 
+// --- Format ---
+// Format(Fmt, [Args]) -> expr.format: the format string, then the arguments.
+// The array-of-const brackets are dropped, so codegen sees the arguments
+// directly; Format(Fmt, A, B) without them is accepted as before.
+
+procedure RegisterFormatCall(const AParse: TParse);
+begin
+  AParse.Config().RegisterPrefix('keyword.format', 'expr.format',
+    function(AParser: TParseParserBase): TParseASTNodeBase
+    var
+      LNode: TParseASTNode;
+    begin
+      LNode := AParser.CreateNode();
+      AParser.Consume();  // consume 'Format'
+      AParser.Expect('delimiter.lparen');
+      LNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+      while AParser.Match('delimiter.comma') do
+      begin
+        if AParser.Match('delimiter.lbracket') then
+        begin
+          if not AParser.Check('delimiter.rbracket') then
+          begin
+            LNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+            while AParser.Match('delimiter.comma') do
+              LNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+          end;
+          AParser.Expect('delimiter.rbracket');
+        end
+        else
+          LNode.AddChild(TParseASTNode(AParser.ParseExpression(0)));
+      end;
+      AParser.Expect('delimiter.rparen');
+      Result := LNode;
+    end);
+end;
+
 procedure RegisterIntrinsicCalls(const AParse: TParse);
 begin
   // Ordinal
@@ -1434,11 +1690,15 @@ begin
   RegisterOneIntrinsic(AParse, 'keyword.length',       'np::Length');
   RegisterOneIntrinsic(AParse, 'keyword.copy',         'np::Copy');
   RegisterOneIntrinsic(AParse, 'keyword.pos',          'np::Pos');
+  RegisterOneIntrinsic(AParse, 'keyword.posex',        'np::PosEx');
   RegisterOneIntrinsic(AParse, 'keyword.inttostr',     'np::IntToStr');
   RegisterOneIntrinsic(AParse, 'keyword.strtoint',     'np::StrToInt');
   RegisterOneIntrinsic(AParse, 'keyword.strtointdef',  'np::StrToIntDef');
+  RegisterOneIntrinsic(AParse, 'keyword.strtoint64',   'np::StrToInt64');
+  RegisterOneIntrinsic(AParse, 'keyword.strtoint64def','np::StrToInt64Def');
   RegisterOneIntrinsic(AParse, 'keyword.floattostr',   'np::FloatToStr');
   RegisterOneIntrinsic(AParse, 'keyword.strtofloat',   'np::StrToFloat');
+  RegisterOneIntrinsic(AParse, 'keyword.val',          'np::Val');
   RegisterOneIntrinsic(AParse, 'keyword.uppercase',    'np::UpperCase');
   RegisterOneIntrinsic(AParse, 'keyword.lowercase',    'np::LowerCase');
   RegisterOneIntrinsic(AParse, 'keyword.trim',         'np::Trim');
@@ -1447,8 +1707,15 @@ begin
   RegisterOneIntrinsic(AParse, 'keyword.delete',       'np::Delete');
   RegisterOneIntrinsic(AParse, 'keyword.insert',       'np::Insert');
   RegisterOneIntrinsic(AParse, 'keyword.stringofchar', 'np::StringOfChar');
+  RegisterOneIntrinsic(AParse, 'keyword.uniquestring', 'np::UniqueString');
+  RegisterOneIntrinsic(AParse, 'keyword.intern',       'np::Intern');
   RegisterOneIntrinsic(AParse, 'keyword.upcase',       'np::UpCase');
   RegisterOneIntrinsic(AParse, 'keyword.booltostr',    'np::BoolToStr');
+  // TStringBuilder
+  RegisterOneIntrinsic(AParse, 'keyword.appendline',     'np::AppendLine');
+  RegisterOneIntrinsic(AParse, 'keyword.tostring',       'np::ToString');
+  RegisterOneIntrinsic(AParse, 'keyword.capacity',       'np::Capacity');
+  RegisterOneIntrinsic(AParse, 'keyword.ensurecapacity', 'np::EnsureCapacity');
   // Math
   RegisterOneIntrinsic(AParse, 'keyword.abs',          'np::Abs');
   RegisterOneIntrinsic(AParse, 'keyword.sqr',          'np::Sqr');
@@ -1482,9 +1749,14 @@ begin
   RegisterOneIntrinsic(AParse, 'keyword.halt',         'std::exit');
   // Additional string/conversion intrinsics
   RegisterOneIntrinsic(AParse, 'keyword.stringreplace', 'np::StringReplace');
-  RegisterOneIntrinsic(AParse, 'keyword.format',        'np::Format');
+  RegisterFormatCall(AParse);
   RegisterOneIntrinsic(AParse, 'keyword.comparestr',    'np::CompareStr');
   RegisterOneIntrinsic(AParse, 'keyword.sametext',      'np::SameText');
+  RegisterOneIntrinsic(AParse, 'keyword.comparetext',   'np::CompareText');
+  RegisterOneIntrinsic(AParse, 'keyword.ansiuppercase', 'np::AnsiUpperCase');
+  RegisterOneIntrinsic(AParse, 'keyword.ansilowercase', 'np::AnsiLowerCase');
+  RegisterOneIntrinsic(AParse, 'keyword.ansisametext',  'np::AnsiSameText');
+  RegisterOneIntrinsic(AParse, 'keyword.ansicomparetext', 'np::AnsiCompareText');
   RegisterOneIntrinsic(AParse, 'keyword.quotedstr',     'np::QuotedStr');
   RegisterOneIntrinsic(AParse, 'keyword.low',           'np::Low');
   RegisterOneIntrinsic(AParse, 'keyword.high',          'np::High');
@@ -1502,9 +1774,14 @@ begin
   RegisterOneIntrinsic(AParse, 'keyword.append',          'np::Append');
   RegisterOneIntrinsic(AParse, 'keyword.close',           'np::Close');
   RegisterOneIntrinsic(AParse, 'keyword.eof',             'np::Eof');
+  RegisterOneIntrinsic(AParse, 'keyword.eoln',            'np::Eoln');
+  RegisterOneIntrinsic(AParse, 'keyword.seekeof',         'np::SeekEof');
+  RegisterOneIntrinsic(AParse, 'keyword.seekeoln',        'np::SeekEoln');
   RegisterOneIntrinsic(AParse, 'keyword.filesize',        'np::FileSize');
   RegisterOneIntrinsic(AParse, 'keyword.filepos',         'np::FilePos');
   RegisterOneIntrinsic(AParse, 'keyword.seek',            'np::Seek');
+  RegisterOneIntrinsic(AParse, 'keyword.flush',           'np::Flush');
+  RegisterOneIntrinsic(AParse, 'keyword.mapfile',         'np::MapFile');
   RegisterOneIntrinsic(AParse, 'keyword.fileexists',      'np::FileExists');
   RegisterOneIntrinsic(AParse, 'keyword.directoryexists', 'np::DirectoryExists');
   RegisterOneIntrinsic(AParse, 'keyword.deletefile',      'np::DeleteFile');
@@ -1694,6 +1971,33 @@ begin
     end);
 end;
 
+// --- Compiler Directives ---
+// {$...} directives are lexed as literal.directive tokens so that switches
+// such as {$R+} can be honoured positionally by the code generator, which
+// ignores the directives it does not know. A directive is a statement, and
+// is also accepted between declarations (see ParseDirectives).
+//
+// AST: stmt.directive  attr: directive.text (string, e.g. 'R+', 'Q-,R-',
+//                                             'RANGECHECKS OFF')
+
+procedure RegisterDirective(const AParse: TParse);
+begin
+  AParse.Config().RegisterStatement('literal.directive', 'stmt.directive',
+    function(AParser: TParseParserBase): TParseASTNodeBase
+    var
+      LNode:    TParseASTNode;
+      LRawText: string;
+    begin
+      LNode    := AParser.CreateNode();
+      LRawText := AParser.CurrentToken().Text;
+      // Strip the '{$' open tag and '}' close tag
+      LRawText := LRawText.Substring(2, LRawText.Length - 3).Trim();
+      LNode.SetAttr('directive.text', TValue.From<string>(LRawText));
+      AParser.Consume();
+      Result := LNode;
+    end);
+end;
+
 
 // --- Unit Declaration ---
 // BNF: UnitDecl = "unit" Identifier ";"
@@ -1734,6 +2038,7 @@ begin
         TValue.From<string>(AParser.CurrentToken().Text));
       AParser.Consume();  // consume unit name
       AParser.Expect('delimiter.semicolon');
+      ParseDirectives(AParser, LNode);
       // Optional uses clause
       if AParser.Match('keyword.uses') then
       begin
@@ -1747,6 +2052,7 @@ begin
         until not AParser.Match('delimiter.comma');
         AParser.Expect('delimiter.semicolon');
         LNode.AddChild(LUsesNode);
+        ParseDirectives(AParser, LNode);
       end;
       // Interface section -- forward declarations only (no bodies)
       AParser.Expect('keyword.interface');
@@ -1757,13 +2063,15 @@ begin
             AParser.Check('keyword.procedure') or
             AParser.Check('keyword.function') or
             AParser.Check('literal.cpp_block_header') or
-            AParser.Check('literal.cpp_block_source') do
+            AParser.Check('literal.cpp_block_source') or
+            AParser.Check('literal.directive') do
       begin
         if AParser.Check('keyword.var') or
            AParser.Check('keyword.const') or
            AParser.Check('keyword.type') or
            AParser.Check('literal.cpp_block_header') or
-           AParser.Check('literal.cpp_block_source') then
+           AParser.Check('literal.cpp_block_source') or
+           AParser.Check('literal.directive') then
           LIntfNode.AddChild(TParseASTNode(AParser.ParseStatement()))
         else if AParser.Check('keyword.procedure') then
         begin
@@ -1888,7 +2196,8 @@ begin
             AParser.Check('keyword.procedure') or
             AParser.Check('keyword.function') or
             AParser.Check('literal.cpp_block_header') or
-            AParser.Check('literal.cpp_block_source') do
+            AParser.Check('literal.cpp_block_source') or
+            AParser.Check('literal.directive') do
         LImplNode.AddChild(TParseASTNode(AParser.ParseStatement()));
       LNode.AddChild(LImplNode);
       AParser.Expect('keyword.end');
@@ -1930,6 +2239,7 @@ begin
         TValue.From<string>(AParser.CurrentToken().Text));
       AParser.Consume();  // consume library name
       AParser.Expect('delimiter.semicolon');
+      ParseDirectives(AParser, LNode);
       // Optional uses clause
       if AParser.Match('keyword.uses') then
       begin
@@ -1943,13 +2253,15 @@ begin
         until not AParser.Match('delimiter.comma');
         AParser.Expect('delimiter.semicolon');
         LNode.AddChild(LUsesNode);
+        ParseDirectives(AParser, LNode);
       end;
       // Optional var/const/type/cppblock declarations
       while AParser.Check('keyword.var') or
             AParser.Check('keyword.const') or
             AParser.Check('keyword.type') or
             AParser.Check('literal.cpp_block_header') or
-            AParser.Check('literal.cpp_block_source') do
+            AParser.Check('literal.cpp_block_source') or
+            AParser.Check('literal.directive') do
         LNode.AddChild(TParseASTNode(AParser.ParseStatement()));
       // Zero or more procedure/function declarations
       while AParser.Check('keyword.procedure') or
@@ -1986,6 +2298,7 @@ begin
   RegisterLiteralPrefixes(AParse);
   RegisterNilLiteral(AParse);
   RegisterBooleanLiterals(AParse);
+  RegisterReplaceFlags(AParse);
   RegisterUnaryNot(AParse);
   RegisterGroupedExpr(AParse);
   RegisterAddrOf(AParse);
@@ -2034,6 +2347,7 @@ begin
   RegisterTryStmt(AParse);
   RegisterRaiseStmt(AParse);
   RegisterCppBlocks(AParse);
+  RegisterDirective(AParse);
 end;
 
 end.
@@ -108,11 +108,15 @@ begin
     .AddKeyword('length',      'keyword.length')
     .AddKeyword('copy',        'keyword.copy')
     .AddKeyword('pos',         'keyword.pos')
+    .AddKeyword('posex',       'keyword.posex')
     .AddKeyword('inttostr',    'keyword.inttostr')
     .AddKeyword('strtoint',    'keyword.strtoint')
     .AddKeyword('strtointdef', 'keyword.strtointdef')
+    .AddKeyword('strtoint64',  'keyword.strtoint64')
+    .AddKeyword('strtoint64def','keyword.strtoint64def')
     .AddKeyword('floattostr',  'keyword.floattostr')
     .AddKeyword('strtofloat',  'keyword.strtofloat')
+    .AddKeyword('val',         'keyword.val')
     .AddKeyword('uppercase',   'keyword.uppercase')
     .AddKeyword('lowercase',   'keyword.lowercase')
     .AddKeyword('trim',        'keyword.trim')
@@ -121,8 +125,15 @@ begin
     .AddKeyword('delete',      'keyword.delete')
     .AddKeyword('insert',      'keyword.insert')
     .AddKeyword('stringofchar','keyword.stringofchar')
+    .AddKeyword('uniquestring','keyword.uniquestring')
+    .AddKeyword('intern',      'keyword.intern')
     .AddKeyword('upcase',      'keyword.upcase')
     .AddKeyword('booltostr',   'keyword.booltostr')
+    // TStringBuilder intrinsics (Append and Length are shared)
+    .AddKeyword('appendline',  'keyword.appendline')
+    .AddKeyword('tostring',    'keyword.tostring')
+    .AddKeyword('capacity',    'keyword.capacity')
+    .AddKeyword('ensurecapacity','keyword.ensurecapacity')
     // Math intrinsics
     .AddKeyword('abs',         'keyword.abs')
     .AddKeyword('sqr',         'keyword.sqr')
@@ -164,9 +175,16 @@ begin
     .AddKeyword('getexceptionmessage','keyword.getexceptionmessage')
     // Additional string/conversion intrinsics
     .AddKeyword('stringreplace',  'keyword.stringreplace')
+    .AddKeyword('rfreplaceall',   'keyword.rfreplaceall')
+    .AddKeyword('rfignorecase',   'keyword.rfignorecase')
     .AddKeyword('format',         'keyword.format')
     .AddKeyword('comparestr',     'keyword.comparestr')
     .AddKeyword('sametext',       'keyword.sametext')
+    .AddKeyword('comparetext',    'keyword.comparetext')
+    .AddKeyword('ansiuppercase',  'keyword.ansiuppercase')
+    .AddKeyword('ansilowercase',  'keyword.ansilowercase')
+    .AddKeyword('ansisametext',   'keyword.ansisametext')
+    .AddKeyword('ansicomparetext','keyword.ansicomparetext')
     .AddKeyword('quotedstr',      'keyword.quotedstr')
     .AddKeyword('low',            'keyword.low')
     .AddKeyword('high',           'keyword.high')
@@ -181,9 +199,14 @@ begin
     .AddKeyword('append',          'keyword.append')
     .AddKeyword('close',           'keyword.close')
     .AddKeyword('eof',             'keyword.eof')
+    .AddKeyword('eoln',            'keyword.eoln')
+    .AddKeyword('seekeof',         'keyword.seekeof')
+    .AddKeyword('seekeoln',        'keyword.seekeoln')
     .AddKeyword('filesize',        'keyword.filesize')
     .AddKeyword('filepos',         'keyword.filepos')
     .AddKeyword('seek',            'keyword.seek')
+    .AddKeyword('flush',           'keyword.flush')
+    .AddKeyword('mapfile',         'keyword.mapfile')
     .AddKeyword('fileexists',      'keyword.fileexists')
     .AddKeyword('directoryexists', 'keyword.directoryexists')
     .AddKeyword('deletefile',      'keyword.deletefile')
@@ -240,6 +263,9 @@ procedure RegisterComments(const AParse: TParse);
 begin
   AParse.Config()
     .AddLineComment('//')
+    // {$...} directives are kept as tokens so the code generator can honour
+    // switches positionally; the directive name is matched there
+    .AddBlockComment('{$', '}', 'literal.directive')
     .AddBlockComment('{', '}')
     .AddBlockComment('(*', '*)')
     // cppstart/cppend blocks — raw C++ text captured verbatim, targeting header or source
@@ -283,6 +309,13 @@ begin
     // File types
     .AddTypeKeyword('textfile',   'type.textfile')
     .AddTypeKeyword('binaryfile', 'type.binaryfile')
+    .AddTypeKeyword('tmappedfile', 'type.mappedfile')
+    // String builder
+    .AddTypeKeyword('tstringbuilder', 'type.stringbuilder')
+    // String view
+    .AddTypeKeyword('tstringview',    'type.stringview')
+    // Generic dictionary: TDictionary<K, V>
+    .AddTypeKeyword('tdictionary',    'type.dictionary')
     .AddLiteralType('expr.integer', 'type.integer')
     .AddLiteralType('expr.real',    'type.double')
     .AddLiteralType('expr.string',  'type.string')
@@ -124,6 +124,21 @@ end;
 
 // --- Var Declaration ---
 
+// Type kind of a type name. Aliases of TDictionary<K, V> resolve to
+// 'type.dictionary' so that method calls on their variables are recognised.
+function ResolveTypeKind(const AParse: TParse; const ASem: TParseSemanticBase;
+  const ATypeText: string): string;
+var
+  LDeclNode: TParseASTNodeBase;
+  LAttr:     TValue;
+begin
+  Result := AParse.Config().TypeTextToKind(ATypeText);
+  if (Result = 'type.unknown') and ASem.LookupSymbol(ATypeText, LDeclNode) and
+     (LDeclNode.GetNodeKind() = 'stmt.type_decl') and
+     LDeclNode.GetAttr('type.kind', LAttr) and (LAttr.AsString = 'dictionary') then
+    Result := 'type.dictionary';
+end;
+
 procedure RegisterVarDecl(const AParse: TParse);
 begin
   AParse.Config().RegisterSemanticRule('stmt.var_decl',
@@ -155,8 +170,14 @@ begin
       else if ANode.GetAttr('var.pointer_kind', LArrayKindAttr) then
         // Pointer type: tag with a dedicated kind so the emitter can pick it up
         LTypeKind := 'type.pointer'
+      else if ANode.GetAttr('var.dict_kind', LArrayKindAttr) then
+        // TDictionary<K, V>: the emitter reads the key/value types from attrs
+        LTypeKind := 'type.dictionary'
+      else if ANode.GetAttr('var.file_kind', LArrayKindAttr) then
+        // file of T: the emitter reads the record type from attrs
+        LTypeKind := 'type.typedfile'
       else
-        LTypeKind := AParse.Config().TypeTextToKind(LTypeText);
+        LTypeKind := ResolveTypeKind(AParse, ASem, LTypeText);
       TParseASTNode(ANode).SetAttr(PARSE_ATTR_TYPE_KIND,
         TValue.From<string>(LTypeKind));
       // Storage class: global unless inside a routine scope
@@ -344,7 +365,7 @@ begin
     begin
       ANode.GetAttr('param.type_text', LTypeAttr);
       LTypeText := LTypeAttr.AsString;
-      LTypeKind := AParse.Config().TypeTextToKind(LTypeText);
+      LTypeKind := ResolveTypeKind(AParse, ASem, LTypeText);
       TParseASTNode(ANode).SetAttr(PARSE_ATTR_TYPE_KIND,
         TValue.From<string>(LTypeKind));
       TParseASTNode(ANode).SetAttr(PARSE_ATTR_STORAGE_CLASS,
@@ -534,13 +555,53 @@ begin
       ASem.VisitChildren(ANode);
     end);
 
-  // call — visit children
+  // call — visit children; link user routines to their declaration so the
+  // code generator can see which arguments are passed by var/out.
+  // Intrinsics (np::Foo) are not declared symbols and stay unlinked.
   AParse.Config().RegisterSemanticRule('expr.call',
     procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
+    var
+      LAttr:     TValue;
+      LDeclNode: TParseASTNodeBase;
     begin
+      ANode.GetAttr('call.name', LAttr);
+      if ASem.LookupSymbol(LAttr.AsString, LDeclNode) then
+        TParseASTNode(ANode).SetAttr(PARSE_ATTR_DECL_NODE,
+          TValue.From<TObject>(LDeclNode));
       ASem.VisitChildren(ANode);
     end);
 
+  // method_call — obj.Method(args) on a dictionary variable: visit children
+  // (the field access naming object and method, then the arguments). Any
+  // other X.Y(args) with a plain name X calls routine Y qualified by X, as
+  // in MathUtils.Add(1, 2): like expr.call it gets call.name and the linked
+  // declaration, and only the arguments are visited.
+  AParse.Config().RegisterSemanticRule('expr.method_call',
+    procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
+    var
+      LObject:   TParseASTNodeBase;
+      LAttr:     TValue;
+      LDeclNode: TParseASTNodeBase;
+      LI:        Integer;
+    begin
+      LObject := ANode.GetChild(0).GetChild(0);
+      if (LObject.GetNodeKind() = 'expr.ident') and
+         not (ASem.LookupSymbol(LObject.GetToken().Text, LDeclNode) and
+              LDeclNode.GetAttr(PARSE_ATTR_TYPE_KIND, LAttr) and
+              (LAttr.AsString = 'type.dictionary')) then
+      begin
+        ANode.GetAttr('method.name', LAttr);
+        TParseASTNode(ANode).SetAttr('call.name', LAttr);
+        if ASem.LookupSymbol(LAttr.AsString, LDeclNode) then
+          TParseASTNode(ANode).SetAttr(PARSE_ATTR_DECL_NODE,
+            TValue.From<TObject>(LDeclNode));
+        for LI := 1 to ANode.ChildCount() - 1 do
+          ASem.VisitNode(ANode.GetChild(LI));
+      end
+      else
+        ASem.VisitChildren(ANode);
+    end);
+
   // array_index — visit children
   AParse.Config().RegisterSemanticRule('expr.array_index',
     procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
@@ -576,6 +637,22 @@ begin
       ASem.VisitChildren(ANode);
     end);
 
+  // set_range — visit children (low and high bound of a lo..hi element)
+  AParse.Config().RegisterSemanticRule('expr.set_range',
+    procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
+    begin
+      ASem.VisitChildren(ANode);
+    end);
+
+  // format — visit the format string and the arguments; the result is a String
+  AParse.Config().RegisterSemanticRule('expr.format',
+    procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
+    begin
+      ASem.VisitChildren(ANode);
+      TParseASTNode(ANode).SetAttr(PARSE_ATTR_TYPE_KIND,
+        TValue.From<string>('type.string'));
+    end);
+
   // in — visit children (left = element, right = set)
   AParse.Config().RegisterSemanticRule('expr.in',
     procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
@@ -649,10 +726,12 @@ begin
       LTypeKind: string;
     begin
       // A single-character string literal is a Char in Pascal.
-      // GetToken().Text includes the surrounding Pascal quotes, strip them first.
+      // GetToken().Text includes the surrounding Pascal quotes; '''' is the
+      // quote character itself.
       LTypeKind := 'type.string';
-      if (Length(ANode.GetToken().Text) = 3) and
-         (ANode.GetToken().Text[1] = '''') then
+      if ((Length(ANode.GetToken().Text) = 3) and
+          (ANode.GetToken().Text[1] = '''')) or
+         (ANode.GetToken().Text = '''''''') then
         LTypeKind := 'type.char';
       TParseASTNode(ANode).SetAttr(PARSE_ATTR_TYPE_KIND,
         TValue.From<string>(LTypeKind));
@@ -671,6 +750,13 @@ begin
       TParseASTNode(ANode).SetAttr(PARSE_ATTR_TYPE_KIND,
         TValue.From<string>('type.nil'));
     end);
+
+  AParse.Config().RegisterSemanticRule('expr.replace_flag',
+    procedure(ANode: TParseASTNodeBase; ASem: TParseSemanticBase)
+    begin
+      TParseASTNode(ANode).SetAttr(PARSE_ATTR_TYPE_KIND,
+        TValue.From<string>('type.replace_flag'));
+    end);
 end;
 
 // --- Type Block ---
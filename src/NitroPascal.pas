@@ -36,7 +36,8 @@ uses
   System.SysUtils,
   System.Classes,
   System.Generics.Collections,
-  Parse;
+  Parse,
+  NitroPascal.CodeGen;
 
 const
   NITROPASCAL_VERSION_MAJOR = 0;
@@ -51,6 +52,7 @@ type
   private
     FParse:       TParse;
     FParsedUnits: TStringList;  // Tracks compiled unit deps (cycle detection)
+    FCodeGen:     TNPCodeGenOptions;  // Shared by all registered emitters
 
     // Version info fields
     FAddVersionInfo: Boolean;
@@ -121,6 +123,15 @@ type
     // Debug support
     procedure SetLineDirectives(const AEnabled: Boolean);
 
+    // Code generation
+    // Native C++ for/while/repeat loops (default) or np:: lambda wrappers
+    procedure SetNativeLoops(const AEnabled: Boolean);
+    // Default for {$R+}/{$R-}: bounds-check array and string indexing
+    // (off unless enabled, as in Delphi)
+    procedure SetRangeChecks(const AEnabled: Boolean);
+    // Flush console output at every WriteLn when stdout is a terminal
+    procedure SetConsoleLineFlush(const AEnabled: Boolean);
+
     // Pipeline
     function Compile(const ABuild: Boolean = True; const AAutoRun: Boolean = True): Boolean;
     function Run(): Cardinal;
@@ -136,8 +147,7 @@ uses
   System.IOUtils,
   NitroPascal.Lexer,
   NitroPascal.Grammar,
-  NitroPascal.Semantics,
-  NitroPascal.CodeGen;
+  NitroPascal.Semantics;
 
 { TNitroPascal }
 
@@ -148,12 +158,13 @@ begin
   FParse        := TParse.Create();
   FParsedUnits  := TStringList.Create();
   FParsedUnits.CaseSensitive := False;
+  FCodeGen      := TNPCodeGenOptions.Create();
 
   // Wire the complete NitroPascal language definition onto the internal instance
   ConfigLexer(FParse);
   ConfigGrammar(FParse);
   ConfigSemantics(FParse);
-  ConfigCodeGen(FParse);
+  ConfigCodeGen(FParse, FCodeGen);
 
   // Enable #line directives so debuggers map generated C++ back to Pascal source
   FParse.SetLineDirectives(True);
@@ -175,6 +186,7 @@ destructor TNitroPascal.Destroy();
 begin
   FreeAndNil(FParsedUnits);
   FreeAndNil(FParse);
+  FreeAndNil(FCodeGen);
   inherited Destroy();
 end;
 
@@ -355,6 +367,21 @@ begin
   FParse.SetLineDirectives(AEnabled);
 end;
 
+procedure TNitroPascal.SetNativeLoops(const AEnabled: Boolean);
+begin
+  FCodeGen.NativeLoops := AEnabled;
+end;
+
+procedure TNitroPascal.SetRangeChecks(const AEnabled: Boolean);
+begin
+  FCodeGen.RangeChecks := AEnabled;
+end;
+
+procedure TNitroPascal.SetConsoleLineFlush(const AEnabled: Boolean);
+begin
+  FCodeGen.ConsoleLineFlush := AEnabled;
+end;
+
 function TNitroPascal.ExtractUsesClause(const AFilename: string): TStringList;
 var
   LLines:    TStringList;
@@ -440,6 +467,9 @@ begin
     LUnitNP.SetSourceFile(LUnitFile);
     LUnitNP.SetOutputPath(AOutputPath);
     LUnitNP.SetBuildMode(bmLib);
+    // Units are generated with the same code generation switches
+    LUnitNP.SetNativeLoops(FCodeGen.NativeLoops);
+    LUnitNP.SetRangeChecks(FCodeGen.RangeChecks);
     // Wire the np:: runtime include path so the unit can find np/np.hpp
     LUnitNP.FParse.AddIncludePath(TPath.Combine(
       TPath.GetDirectoryName(ParamStr(0)), 'res\runtime'));
@@ -76,6 +76,34 @@ begin
   {19} ATester.RegisterTest('test_program_unit',                True);
   {20} ATester.RegisterTest('test_program_overload',            True);
   {21} ATester.RegisterTest('test_program_cpp_interop',         True);
+  {22} ATester.RegisterTest('test_program_loops',               True);
+  {23} ATester.RegisterTest('test_program_set_ordinal',         True);
+  {24} ATester.RegisterTest('test_program_range_checks',        True);
+  {25} ATester.RegisterTest('test_program_params',              True);
+  {26} ATester.RegisterTest('test_program_console',             True);
+  {27} ATester.RegisterTest('test_program_try_flow',            True);
+  {28} ATester.RegisterTest('test_program_string_alloc',        True);
+  {29} ATester.RegisterTest('test_program_string_literal',      True);
+  {30} ATester.RegisterTest('test_program_string_utf8',         True);
+  {31} ATester.RegisterTest('test_program_number_text',         True);
+  {32} ATester.RegisterTest('test_program_string_builder',      True);
+  {33} ATester.RegisterTest('test_program_string_case',         True);
+  {34} ATester.RegisterTest('test_program_string_search',       True);
+  {35} ATester.RegisterTest('test_program_format',              True);
+  {36} ATester.RegisterTest('test_program_string_intern',       True);
+  {37} ATester.RegisterTest('test_program_string_view',         True);
+  {38} ATester.RegisterTest('test_program_set_of_string',       True);
+  {39} ATester.RegisterTest('test_program_dictionary',          True);
+  {40} ATester.RegisterTest('test_program_textfile',            True);
+  {41} ATester.RegisterTest('test_program_mappedfile',          True);
+  {42} ATester.RegisterTest('test_program_typedfile',           True);
+  {43} ATester.RegisterTest('test_program_filepos64',           True);
+  {44} ATester.RegisterTest('test_program_truncate',            True);
+  {45} ATester.RegisterTest('test_program_directives',          True);
+  {46} ATester.RegisterTest('test_program_nil_deref',           True);
+  {47} ATester.RegisterTest('test_program_set_literals',        True);
+  {48} ATester.RegisterTest('test_program_dynarray_sharing',    True);
+  {49} ATester.RegisterTest('test_program_string_utf8_storage',  True);
 end;
 
 procedure RunTests(const ATestName: string; const APlatform: TParseTargetPlatform = tpWin64; const AOptLevel: TParseOptimizeLevel = olDebug); overload;